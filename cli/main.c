@@ -22,6 +22,9 @@
 
 enum longopt {
         opt_allow_unresolved_functions = 0x100,
+#if defined(TOYWASM_ENABLE_ANNOTATION_CACHE)
+        opt_annotation_cache,
+#endif
         opt_disable_jump_table,
         opt_disable_localtype_cellidx,
         opt_disable_resulttype_cellidx,
@@ -35,20 +38,37 @@ enum longopt {
         opt_dyld_stack_size,
 #endif
         opt_invoke,
+#if defined(TOYWASM_ENABLE_LAZY_VALIDATION)
+        opt_lazy_validation,
+#endif
         opt_load,
         opt_max_frames,
 #if defined(TOYWASM_ENABLE_HEAP_TRACKING)
         opt_max_memory,
 #endif
         opt_max_stack_cells,
+#if defined(TOYWASM_ENABLE_MEM_ARENA)
+        opt_module_arena,
+#endif
         opt_register,
         opt_repl,
         opt_repl_prompt,
         opt_print_build_options,
         opt_print_stats,
+#if defined(TOYWASM_ENABLE_PROFILER)
+        opt_profile,
+        opt_profile_interval,
+#endif
+#if defined(TOYWASM_ENABLE_SNAPSHOT)
+        opt_snapshot_restore,
+        opt_snapshot_save,
+#endif
         opt_timeout,
 #if defined(TOYWASM_ENABLE_TRACING)
         opt_trace,
+#endif
+#if defined(TOYWASM_USE_PARALLEL_VALIDATION)
+        opt_validation_threads,
 #endif
         opt_version,
 #if defined(TOYWASM_ENABLE_WASI)
@@ -70,6 +90,14 @@ static const struct option longopts[] = {
                 NULL,
                 opt_allow_unresolved_functions,
         },
+#if defined(TOYWASM_ENABLE_ANNOTATION_CACHE)
+        {
+                "annotation-cache",
+                required_argument,
+                NULL,
+                opt_annotation_cache,
+        },
+#endif
         {
                 "disable-jump-table",
                 no_argument,
@@ -128,6 +156,14 @@ static const struct option longopts[] = {
                 NULL,
                 opt_invoke,
         },
+#if defined(TOYWASM_ENABLE_LAZY_VALIDATION)
+        {
+                "lazy-validation",
+                no_argument,
+                NULL,
+                opt_lazy_validation,
+        },
+#endif
         {
                 "load",
                 required_argument,
@@ -154,6 +190,14 @@ static const struct option longopts[] = {
                 NULL,
                 opt_max_stack_cells,
         },
+#if defined(TOYWASM_ENABLE_MEM_ARENA)
+        {
+                "module-arena",
+                no_argument,
+                NULL,
+                opt_module_arena,
+        },
+#endif
         {
                 "repl",
                 no_argument,
@@ -178,6 +222,34 @@ static const struct option longopts[] = {
                 NULL,
                 opt_print_stats,
         },
+#if defined(TOYWASM_ENABLE_PROFILER)
+        {
+                "profile",
+                required_argument,
+                NULL,
+                opt_profile,
+        },
+        {
+                "profile-interval",
+                required_argument,
+                NULL,
+                opt_profile_interval,
+        },
+#endif
+#if defined(TOYWASM_ENABLE_SNAPSHOT)
+        {
+                "snapshot-restore",
+                required_argument,
+                NULL,
+                opt_snapshot_restore,
+        },
+        {
+                "snapshot-save",
+                required_argument,
+                NULL,
+                opt_snapshot_save,
+        },
+#endif
         {
                 "timeout",
                 required_argument,
@@ -191,6 +263,14 @@ static const struct option longopts[] = {
                 NULL,
                 opt_trace,
         },
+#endif
+#if defined(TOYWASM_USE_PARALLEL_VALIDATION)
+        {
+                "validation-threads",
+                required_argument,
+                NULL,
+                opt_validation_threads,
+        },
 #endif
         {
                 "version",
@@ -247,6 +327,9 @@ static const struct option longopts[] = {
 };
 
 static const char *opt_metavars[] = {
+#if defined(TOYWASM_ENABLE_ANNOTATION_CACHE)
+        [opt_annotation_cache] = "CACHE_DIR",
+#endif
         [opt_invoke] = "FUNCTION[ FUNCTION_ARGS...]",
         [opt_load] = "MODULE_PATH",
 #if defined(TOYWASM_ENABLE_DYLD)
@@ -261,6 +344,14 @@ static const char *opt_metavars[] = {
         [opt_wasi_littlefs_dir] = "LITTLEFS_IMAGE_PATH::LFS_DIR[::GUEST_DIR]",
         [opt_wasi_littlefs_block_size] = "BLOCK_SIZE",
         [opt_wasi_littlefs_disk_version] = "DISK_VERSION",
+#endif
+#if defined(TOYWASM_ENABLE_PROFILER)
+        [opt_profile] = "FOLDED_STACKS_PATH",
+        [opt_profile_interval] = "INTERVAL_MS",
+#endif
+#if defined(TOYWASM_ENABLE_SNAPSHOT)
+        [opt_snapshot_restore] = "SNAPSHOT_PATH",
+        [opt_snapshot_save] = "SNAPSHOT_PATH",
 #endif
         [opt_timeout] = "TIMEOUT_MS",
 #if defined(TOYWASM_ENABLE_TRACING)
@@ -272,6 +363,9 @@ static const char *opt_metavars[] = {
 #if defined(TOYWASM_ENABLE_HEAP_TRACKING)
         [opt_max_memory] = "MEMORY_LIMIT_IN_BYTES",
 #endif
+#if defined(TOYWASM_USE_PARALLEL_VALIDATION)
+        [opt_validation_threads] = "NUMBER_OF_THREADS",
+#endif
 };
 
 static void
@@ -313,6 +407,13 @@ print_usage(void)
 #endif
         printf("\tLoad a module and invoke its function\n\t\ttoywasm --load "
                "module --invoke \"func arg1 arg2\"\n");
+#if defined(TOYWASM_ENABLE_SNAPSHOT)
+        printf("\tSave a snapshot of an initialized instance\n\t\ttoywasm "
+               "--load module --snapshot-save snapshot\n");
+        printf("\tRestore the snapshot instead of initializing the "
+               "instance\n\t\ttoywasm --snapshot-restore snapshot --load "
+               "module --invoke \"func arg1 arg2\"\n");
+#endif
 }
 
 int
@@ -388,6 +489,11 @@ main(int argc, char **argv)
                 case opt_allow_unresolved_functions:
                         opts->allow_unresolved_functions = true;
                         break;
+#if defined(TOYWASM_ENABLE_ANNOTATION_CACHE)
+                case opt_annotation_cache:
+                        opts->load_options.annotation_cache_dir = optarg;
+                        break;
+#endif
                 case opt_disable_jump_table:
                         opts->load_options.generate_jump_table = false;
                         break;
@@ -441,6 +547,11 @@ main(int argc, char **argv)
                                 goto fail;
                         }
                         break;
+#if defined(TOYWASM_ENABLE_LAZY_VALIDATION)
+                case opt_lazy_validation:
+                        opts->load_options.lazy_validation = true;
+                        break;
+#endif
                 case opt_load:
                         ret = toywasm_repl_load(state, NULL, optarg, false);
                         if (ret != 0) {
@@ -477,6 +588,11 @@ main(int argc, char **argv)
                                 goto fail;
                         }
                         break;
+#if defined(TOYWASM_ENABLE_MEM_ARENA)
+                case opt_module_arena:
+                        opts->module_arena = true;
+                        break;
+#endif
                 case opt_register:
                         ret = toywasm_repl_register(state, NULL, optarg);
                         if (ret != 0) {
@@ -496,6 +612,48 @@ main(int argc, char **argv)
                 case opt_print_stats:
                         opts->print_stats = true;
                         break;
+#if defined(TOYWASM_ENABLE_PROFILER)
+                case opt_profile:
+                        opts->profile = optarg;
+                        break;
+                case opt_profile_interval:
+                        ret = str_to_u32(optarg, 0,
+                                         &opts->profile_interval_ms);
+                        if (ret != 0) {
+                                goto fail;
+                        }
+                        break;
+#endif
+#if defined(TOYWASM_ENABLE_SNAPSHOT)
+                case opt_snapshot_restore:
+                        /*
+                         * it applies to the modules loaded after it.
+                         * reject the cases where it would be silently
+                         * ignored.
+                         */
+                        if (opts->snapshot_restore != NULL ||
+                            state->modules.lsize > 0) {
+                                xlog_error("--snapshot-restore should be "
+                                           "given once, before --load");
+                                ret = EPROTO;
+                                goto fail;
+                        }
+                        opts->snapshot_restore = optarg;
+                        break;
+                case opt_snapshot_save:
+                        /* it saves the last module loaded before it */
+                        if (state->modules.lsize == 0) {
+                                xlog_error("--snapshot-save should follow "
+                                           "--load");
+                                ret = EPROTO;
+                                goto fail;
+                        }
+                        ret = toywasm_repl_save_snapshot(state, NULL, optarg);
+                        if (ret != 0) {
+                                goto fail;
+                        }
+                        break;
+#endif
                 case opt_timeout:
                         toywasm_repl_set_timeout(state, atoi(optarg));
                         break;
@@ -503,6 +661,16 @@ main(int argc, char **argv)
                 case opt_trace:
                         xlog_tracing = atoi(optarg);
                         break;
+#endif
+#if defined(TOYWASM_USE_PARALLEL_VALIDATION)
+                case opt_validation_threads:
+                        ret = str_to_u32(
+                                optarg, 0,
+                                &opts->load_options.validation_threads);
+                        if (ret != 0) {
+                                goto fail;
+                        }
+                        break;
 #endif
                 case opt_version:
                         toywasm_repl_print_version();
@@ -573,6 +741,14 @@ main(int argc, char **argv)
         argc -= optind;
         argv += optind;
 
+#if defined(TOYWASM_ENABLE_SNAPSHOT)
+        if (opts->snapshot_restore != NULL && state->modules.lsize == 0 &&
+            argc == 0 && !do_repl) {
+                xlog_error("--snapshot-restore without a module to restore");
+                goto fail;
+        }
+#endif
+
         if (do_repl) {
                 ret = toywasm_repl(state);
                 if (ret != 0) {
@@ -29,8 +29,10 @@
 #include "load_context.h"
 #include "mem.h"
 #include "module.h"
+#include "module_cache.h"
 #include "module_writer.h"
 #include "nbio.h"
+#include "profiler.h"
 #include "repl.h"
 #include "report.h"
 #include "str_to_uint.h"
@@ -177,15 +179,17 @@ repl_unload_u(struct repl_state *state, struct repl_module_state_u *mod_u)
 {
 #if defined(TOYWASM_ENABLE_DYLD)
         if (state->opts.enable_dyld) {
-                struct dyld *d = &mod_u->u.dyld;
+                struct dyld *d = mod_u->u.dyld;
 #if defined(TOYWASM_ENABLE_DYLD)
                 if (state->opts.print_stats) {
-                        nbio_printf("=== dyld memory consumption immediately "
+                        nbio_printf("=== dyld stats immediately "
                                     "before dyld_clear ===\n");
                         dyld_print_stats(d);
                 }
 #endif
                 dyld_clear(d);
+                mem_free(state->dyld_mctx, d, sizeof(*d));
+                mod_u->u.dyld = NULL;
                 return;
         }
 #endif
@@ -206,9 +210,49 @@ print_memory_usage(const struct mem_context *mctx, const char *label)
 #endif
 }
 
+static int
+setup_profiler(struct repl_state *state, struct exec_context *ctx)
+{
+#if defined(TOYWASM_ENABLE_PROFILER)
+        if (state->opts.profile == NULL) {
+                return 0;
+        }
+        if (state->profiler == NULL) {
+                int ret = profiler_create(state->mctx,
+                                          state->opts.profile_interval_ms,
+                                          &state->profiler);
+                if (ret != 0) {
+                        xlog_error("profiler_create failed with %d", ret);
+                        return ret;
+                }
+        }
+        ctx->profiler = state->profiler;
+#endif
+        return 0;
+}
+
+static void
+finish_profiler(struct repl_state *state)
+{
+#if defined(TOYWASM_ENABLE_PROFILER)
+        if (state->profiler == NULL) {
+                return;
+        }
+        int ret = profiler_write(state->profiler, state->opts.profile);
+        if (ret != 0) {
+                /* log and ignore */
+                xlog_error("failed to write profile %s (error %d)",
+                           state->opts.profile, ret);
+        }
+        profiler_destroy(state->profiler);
+        state->profiler = NULL;
+#endif
+}
+
 void
 toywasm_repl_reset(struct repl_state *state)
 {
+        finish_profiler(state);
         if (state->opts.print_stats) {
                 nbio_printf("=== memory consumption immediately before a repl "
                             "reset ===\n");
@@ -241,6 +285,12 @@ toywasm_repl_reset(struct repl_state *state)
                 repl_unload_u(state, mod_u);
         }
         VEC_FREE(state->mctx, state->modules);
+#if defined(TOYWASM_ENABLE_DYLD) && defined(TOYWASM_ENABLE_MODULE_CACHE)
+        if (state->module_cache != NULL) {
+                module_cache_destroy(state->module_cache);
+                state->module_cache = NULL;
+        }
+#endif
         VEC_FREE(state->mctx, state->param);
         VEC_FREE(state->mctx, state->result);
 
@@ -563,6 +613,10 @@ repl_exec_init(struct repl_state *state, struct repl_module_state *mod,
         int ret;
         exec_context_init(ctx, mod->inst, mod->instance_mctx);
         ctx->options = state->opts.exec_options;
+        ret = setup_profiler(state, ctx);
+        if (ret != 0) {
+                goto fail;
+        }
         if (has_timeout) {
                 setup_timeout(ctx);
         }
@@ -623,7 +677,14 @@ repl_load_from_buf(struct repl_state *state, const char *modname,
         }
         mod->module_mctx = mctx2;
         mod->instance_mctx = mctx2 + 1;
-        mem_context_init(mod->module_mctx);
+#if defined(TOYWASM_ENABLE_MEM_ARENA)
+        if (state->opts.module_arena) {
+                mem_context_init_arena(mod->module_mctx);
+        } else
+#endif
+        {
+                mem_context_init(mod->module_mctx);
+        }
         mem_context_init(mod->instance_mctx);
         mod->module_mctx->parent = state->modules_mctx;
         mod->instance_mctx->parent = state->instances_mctx;
@@ -699,10 +760,30 @@ repl_load_from_buf(struct repl_state *state, const char *modname,
                 goto fail;
         }
         set_memory(state, cconv_memory(mod->inst));
-        ret = repl_exec_init(state, mod, trap_ok);
-        if (ret != 0) {
-                xlog_printf("repl_exec_init failed\n");
-                goto fail;
+#if defined(TOYWASM_ENABLE_SNAPSHOT)
+        if (state->opts.snapshot_restore != NULL) {
+                report_init(&report);
+                ret = instance_restore_snapshot(
+                        mod->inst, state->opts.snapshot_restore, &report);
+                if (ret != 0) {
+                        const char *msg = report_getmessage(&report);
+                        xlog_error("instance_restore_snapshot failed with "
+                                   "%d: %s",
+                                   ret, msg);
+                        nbio_printf("snapshot restore error: %s\n", msg);
+                }
+                report_clear(&report);
+                if (ret != 0) {
+                        goto fail;
+                }
+        } else
+#endif
+        {
+                ret = repl_exec_init(state, mod, trap_ok);
+                if (ret != 0) {
+                        xlog_printf("repl_exec_init failed\n");
+                        goto fail;
+                }
         }
 #if defined(TOYWASM_ENABLE_HEAP_TRACKING)
         if (state->opts.print_stats) {
@@ -738,22 +819,47 @@ toywasm_repl_load(struct repl_state *state, const char *modname,
                 if (trap_ok) {
                         return ENOTSUP; /* not implemented */
                 }
-                struct dyld *d = &mod_u->u.dyld;
+#if defined(TOYWASM_ENABLE_MODULE_CACHE)
+                if (state->module_cache == NULL) {
+                        /*
+                         * use dyld_mctx so that the shared modules are
+                         * accounted to dyld, as they are without the
+                         * cache.
+                         */
+                        ret = module_cache_create(state->dyld_mctx,
+                                                  &state->opts.load_options,
+                                                  &state->module_cache);
+                        if (ret != 0) {
+                                return ret;
+                        }
+                }
+#endif
+                struct dyld *d = mem_alloc(state->dyld_mctx, sizeof(*d));
+                if (d == NULL) {
+                        return ENOMEM;
+                }
                 dyld_init(d, state->dyld_mctx);
                 d->opts = state->opts.dyld_options;
                 d->opts.base_import_obj = state->imports;
+#if defined(TOYWASM_ENABLE_MODULE_CACHE)
+                d->opts.module_cache = state->module_cache;
+#endif
                 ret = dyld_load(d, filename);
                 if (ret != 0) {
-                        return ret;
+                        goto fail_dyld;
                 }
                 set_memory(state, dyld_memory(d));
                 ret = dyld_execute_init_funcs(d);
                 if (ret != 0) {
                         dyld_clear(d);
-                        return ret;
+                        goto fail_dyld;
                 }
+                mod_u->u.dyld = d;
                 state->modules.lsize++;
                 return 0;
+fail_dyld:
+                mem_free(state->dyld_mctx, d, sizeof(*d));
+                return ret;
         }
 #endif
         struct repl_module_state *mod = &mod_u->u.repl;
@@ -844,6 +950,31 @@ fail:
 #endif
 }
 
+int
+toywasm_repl_save_snapshot(struct repl_state *state, const char *modname,
+                           const char *filename)
+{
+#if defined(TOYWASM_ENABLE_SNAPSHOT)
+        struct repl_module_state *mod;
+        int ret;
+        ret = find_mod(state, modname, &mod);
+        if (ret != 0) {
+                goto fail;
+        }
+        ret = instance_save_snapshot(mod->inst, filename);
+        if (ret != 0) {
+                xlog_error("failed to write snapshot %s (error %d)", filename,
+                           ret);
+                goto fail;
+        }
+        ret = 0;
+fail:
+        return ret;
+#else
+        return ENOTSUP;
+#endif
+}
+
 int
 toywasm_repl_register(struct repl_state *state, const char *modname,
                       const char *register_name)
@@ -1215,7 +1346,7 @@ toywasm_repl_invoke(struct repl_state *state, const char *modname,
         struct mem_context *mctx;
 #if defined(TOYWASM_ENABLE_DYLD)
         if (state->opts.enable_dyld) {
-                struct dyld *d = &mod_u->u.dyld;
+                struct dyld *d = mod_u->u.dyld;
                 inst = dyld_main_object_instance(d);
                 mctx = state->mctx;
         } else
@@ -1272,6 +1403,11 @@ toywasm_repl_invoke(struct repl_state *state, const char *modname,
         struct exec_context *ctx = &ctx0;
         exec_context_init(ctx, inst, mctx);
         ctx->options = state->opts.exec_options;
+        ret = setup_profiler(state, ctx);
+        if (ret != 0) {
+                exec_context_clear(ctx);
+                goto fail;
+        }
         const struct trap_info *trap;
 #if defined(TOYWASM_ENABLE_WASI_THREADS)
         struct wasi_threads_instance *wasi_threads = state->wasi_threads;
@@ -1509,6 +1645,9 @@ repl_options_init(struct repl_options *opts)
 {
         opts->prompt = "toywasm";
         opts->print_stats = false;
+#if defined(TOYWASM_ENABLE_PROFILER)
+        opts->profile_interval_ms = PROFILER_INTERVAL_MS_DEFAULT;
+#endif
         load_options_set_defaults(&opts->load_options);
         exec_options_set_defaults(&opts->exec_options);
 #if defined(TOYWASM_ENABLE_DYLD)
@@ -15,12 +15,25 @@ struct repl_options {
         struct repl_state *state;
         bool print_stats;
         bool allow_unresolved_functions;
+#if defined(TOYWASM_ENABLE_MEM_ARENA)
+        /* allocate modules from arenas. see mem_context_init_arena */
+        bool module_arena;
+#endif
 #if defined(TOYWASM_ENABLE_DYLD)
         bool enable_dyld;
         struct dyld_options dyld_options;
 #endif
         struct load_options load_options;
         struct exec_options exec_options;
+#if defined(TOYWASM_ENABLE_SNAPSHOT)
+        /* restore instances from this file instead of initializing them */
+        const char *snapshot_restore;
+#endif
+#if defined(TOYWASM_ENABLE_PROFILER)
+        /* write the profile to this file on toywasm_repl_reset */
+        const char *profile;
+        uint32_t profile_interval_ms;
+#endif
 #if defined(TOYWASM_ENABLE_WASI_LITTLEFS)
         struct wasi_littlefs_mount_cfg wasi_littlefs_mount_cfg;
 #endif
@@ -44,7 +57,11 @@ struct repl_module_state {
 struct repl_module_state_u {
         union {
 #if defined(TOYWASM_ENABLE_DYLD)
-                struct dyld dyld;
+                /*
+                 * a pointer because a dyld instance is referenced by
+                 * its objects and thus can't be moved by VEC_PREALLOC.
+                 */
+                struct dyld *dyld;
 #endif
                 struct repl_module_state repl;
         } u;
@@ -69,6 +86,9 @@ struct repl_state {
         struct wasi_threads_instance *wasi_threads;
         VEC(, struct wasi_vfs *) vfses;
         struct repl_options opts;
+#if defined(TOYWASM_ENABLE_PROFILER)
+        struct profiler *profiler;
+#endif
         struct timespec abstimeout;
         bool has_timeout;
         struct mem_context *mctx;
@@ -77,6 +97,10 @@ struct repl_state {
         struct mem_context *wasi_mctx;
         struct mem_context *dyld_mctx;
         struct mem_context *impobj_mctx;
+#if defined(TOYWASM_ENABLE_DYLD) && defined(TOYWASM_ENABLE_MODULE_CACHE)
+        /* modules shared among dyld instances. created on demand */
+        struct module_cache *module_cache;
+#endif
 };
 
 void toywasm_repl_state_init(struct repl_state *state);
@@ -91,6 +115,8 @@ int toywasm_repl_register(struct repl_state *state, const char *modname,
 int toywasm_repl_invoke(struct repl_state *state, const char *modname,
                         const char *cmd, uint32_t *exitcodep,
                         bool print_result);
+int toywasm_repl_save_snapshot(struct repl_state *state, const char *modname,
+                               const char *filename);
 void toywasm_repl_print_build_options(void);
 void toywasm_repl_print_version(void);
 
@@ -43,6 +43,12 @@ cmake_dependent_option(TOYWASM_FORCE_USE_TAILCALL
 # TOYWASM_USE_SIMD=ON -> use -msimd128 for wasm target
 option(TOYWASM_USE_SIMD "Use SIMD" OFF)
 
+# TOYWASM_USE_HOST_SIMD=ON -> implement wasm SIMD instructions with
+#                             the host C compiler's vector extensions
+#                             where available. (simd_vector.h)
+#                             for wasm target, it requires TOYWASM_USE_SIMD.
+option(TOYWASM_USE_HOST_SIMD "Use host vector extensions for wasm SIMD" ON)
+
 # run wasm-opt on the produced toywasm executable
 option(TOYWASM_USE_WASM_OPT "Use wasm-opt" OFF)
 
@@ -52,6 +58,15 @@ option(TOYWASM_USE_SHORT_ENUMS "Use -fshort-enum" ON)
 # TOYWASM_USE_USER_SCHED=ON uses a simple userland scheduler instead of pthread.
 option(TOYWASM_USE_USER_SCHED "Use userland scheduler" OFF)
 
+# TOYWASM_USE_MN_SCHED=ON runs wasi-threads threads on a fixed pool of
+# host threads (one per cpu) with work stealing, instead of creating a
+# host thread for each wasm thread. (lib/mnsched.c)
+cmake_dependent_option(TOYWASM_USE_MN_SCHED
+    "Use M:N scheduler for wasi-threads"
+    OFF
+    "TOYWASM_ENABLE_WASM_THREADS;NOT TOYWASM_USE_USER_SCHED"
+    OFF)
+
 # track and limit heap usage.
 option(TOYWASM_ENABLE_HEAP_TRACKING "Enable heap usage tracking" ON)
 cmake_dependent_option(TOYWASM_ENABLE_HEAP_TRACKING_PEAK
@@ -60,6 +75,10 @@ cmake_dependent_option(TOYWASM_ENABLE_HEAP_TRACKING_PEAK
     "TOYWASM_ENABLE_HEAP_TRACKING"
     OFF)
 
+# enable the arena mode of mem_context. (mem_context_init_arena)
+# the cli uses it for modules with --module-arena.
+option(TOYWASM_ENABLE_MEM_ARENA "Enable arena allocator for mem_context" ON)
+
 # options to enable/disable "toywasm --trace" stuff
 option(TOYWASM_ENABLE_TRACING "Enable xlog_trace" OFF)
 cmake_dependent_option(TOYWASM_ENABLE_TRACING_INSN
@@ -76,6 +95,13 @@ option(TOYWASM_SORT_EXPORTS "Sort module export" ON)
 # otherwise, linear search is used.
 option(TOYWASM_USE_JUMP_BINARY_SEARCH "Enable binary search for jump tables" ON)
 
+# TOYWASM_USE_JUMP_HASH=ON builds a hash table for each jump table to
+# make the lookup O(1), at the cost of extra memory. (about 1-2x of
+# the jump table) it's off by default because it doesn't make
+# a measurable difference in our benchmarks so far.
+# TOYWASM_USE_JUMP_BINARY_SEARCH is ignored in that case.
+option(TOYWASM_USE_JUMP_HASH "Enable hash tables for jump tables" OFF)
+
 # TOYWASM_USE_JUMP_CACHE and TOYWASM_JUMP_CACHE2_SIZE controls
 # two independent jump table caching logic.
 # there is little reasons to enable both of them.
@@ -83,10 +109,26 @@ option(TOYWASM_USE_JUMP_BINARY_SEARCH "Enable binary search for jump tables" ON)
 option(TOYWASM_USE_JUMP_CACHE "Enable single-entry cache for jump tables" OFF)
 set(TOYWASM_JUMP_CACHE2_SIZE "4" CACHE STRING "The size of jump cache")
 
+# TOYWASM_CALL_INDIRECT_CACHE_SIZE controls the number of entries of
+# the cache of call_indirect targets, indexed by the call site and
+# the table index. 0 disables the cache.
+set(TOYWASM_CALL_INDIRECT_CACHE_SIZE "8" CACHE STRING "The size of call_indirect cache")
+
 # TOYWASM_USE_LOCALS_CACHE=ON -> faster execution
 # TOYWASM_USE_LOCALS_CACHE=OFF -> slightly smaller code and exec_context
 option(TOYWASM_USE_LOCALS_CACHE "Enable current_locals" ON)
 
+# TOYWASM_USE_INSN_FUSION=ON makes the interpreter execute a few common
+# instruction sequences (eg. "i32.const; i32.add") in a single step.
+# it can be turned off for differential testing.
+option(TOYWASM_USE_INSN_FUSION "Execute common instruction sequences at once" ON)
+
+# TOYWASM_USE_INLINE_CALL=ON makes the call instructions perform
+# wasm-to-wasm calls in place and keep dispatching instructions,
+# instead of returning to the main loop, when the new frame fits
+# in the already allocated space.
+option(TOYWASM_USE_INLINE_CALL "Perform wasm-to-wasm calls in place" ON)
+
 # use separate stack for operand stack and function locals or not
 option(TOYWASM_USE_SEPARATE_LOCALS "Separate locals and stack" ON)
 
@@ -120,6 +162,18 @@ cmake_dependent_option(TOYWASM_USE_LOCALTYPE_CELLIDX
     "TOYWASM_USE_SMALL_CELLS"
     OFF)
 
+# TOYWASM_USE_UNIFORM_LOCALS=ON makes the loader choose the layout of
+# locals per function. for a function whose parameters and locals have
+# the same cell size (eg. all i32) the offset of a local is simply
+# computed as localidx * cellsize, as if we were using fixed-sized
+# cells. such functions don't need the above mentioned indexes.
+# other functions, eg. ones mixing i32 and i64, use the indexes.
+cmake_dependent_option(TOYWASM_USE_UNIFORM_LOCALS
+    "Use O(1) local lookup for functions with same-sized locals"
+    ON
+    "TOYWASM_USE_SMALL_CELLS"
+    OFF)
+
 # TOYWASM_USE_LOCALS_FAST_PATH=ON -> faster execution
 # TOYWASM_USE_LOCALS_FAST_PATH=OFF -> slightly smaller code and exec_context
 cmake_dependent_option(TOYWASM_USE_LOCALS_FAST_PATH
@@ -134,17 +188,73 @@ cmake_dependent_option(TOYWASM_USE_LOCALS_FAST_PATH
 # TOYWASM_PREALLOC_SHARED_MEMORY=OFF
 #   on-demand (on memory.grow) allocation of shared memories.
 #   can save memory, but slower and very complex memory.grow processing.
+# this only affects shared memories which are not reserved.
+# (see TOYWASM_USE_RESERVED_MEMORY)
 cmake_dependent_option(TOYWASM_PREALLOC_SHARED_MEMORY
     "Preallocate shared memory"
     OFF
     "TOYWASM_ENABLE_WASM_THREADS"
     OFF)
 
+# TOYWASM_USE_RESERVED_MEMORY=ON
+#   reserve the address space for the max possible size of each
+#   linear memory with mmap on instantiation and commit pages
+#   on memory.grow. memory.grow never moves the memory.
+#   for shared memories, it also means that memory.grow doesn't need
+#   to suspend other threads.
+#   it needs mmap and a 64-bit address space.
+# TOYWASM_USE_RESERVED_MEMORY=OFF
+#   use malloc/realloc for linear memories.
+if(CMAKE_SIZEOF_VOID_P EQUAL 8 AND CMAKE_SYSTEM_NAME MATCHES "Linux")
+set(TOYWASM_USE_RESERVED_MEMORY_DEFAULT ON)
+else()
+set(TOYWASM_USE_RESERVED_MEMORY_DEFAULT OFF)
+endif()
+option(TOYWASM_USE_RESERVED_MEMORY
+    "Reserve address space for linear memories"
+    ${TOYWASM_USE_RESERVED_MEMORY_DEFAULT})
+
 # enable logic to write a module to a file.
 # currently it's only used by repl ":save" command.
 option(TOYWASM_ENABLE_WRITER "Enable module writer" ON)
 option(TOYWASM_MAINTAIN_EXPR_END "Maintain the end pointer of expr" OFF)
 
+# enable the on-disk cache of annotations. (load_options.annotation_cache_dir)
+# it allows to skip the validation of function bodies when loading
+# the same module again.
+option(TOYWASM_ENABLE_ANNOTATION_CACHE "Enable annotation cache" ON)
+
+# enable load_options.lazy_validation.
+# it allows to defer the validation of function bodies until their
+# first call.
+option(TOYWASM_ENABLE_LAZY_VALIDATION "Enable lazy validation" ON)
+
+# enable instance_save_snapshot/instance_restore_snapshot, which allow
+# to skip the initialization of an instance by restoring its state
+# saved after a previous initialization.
+option(TOYWASM_ENABLE_SNAPSHOT "Enable instance snapshot" ON)
+
+# enable instance_pool_xxx APIs, which create instances by copying
+# the state of an initialized template instance.
+option(TOYWASM_ENABLE_INSTANCE_POOL "Enable instance pool" ON)
+
+# enable module_cache_xxx APIs, which share loaded modules among
+# their users. eg. dyld objects loaded from the same file.
+option(TOYWASM_ENABLE_MODULE_CACHE "Enable module cache" ON)
+
+# enable the sampling profiler. (exec_context::profiler)
+# it costs nothing unless a profiler is attached to an exec_context.
+option(TOYWASM_ENABLE_PROFILER "Enable sampling profiler" ON)
+
+# enable load_options.validation_threads, which allows to validate
+# function bodies with multiple threads.
+# it's ignored with TOYWASM_USE_USER_SCHED.
+cmake_dependent_option(TOYWASM_USE_PARALLEL_VALIDATION
+    "Validate function bodies in parallel"
+    ON
+    "TOYWASM_ENABLE_WASM_THREADS"
+    OFF)
+
 # enable SIMD. we made this an option because it's large.
 option(TOYWASM_ENABLE_WASM_SIMD "Enable SIMD" ON)
 
@@ -173,6 +283,33 @@ cmake_dependent_option(TOYWASM_ENABLE_LITTLEFS_STATS
     "TOYWASM_ENABLE_WASI"
     OFF)
 
+# use a per-instance epoll set for poll_oneoff.
+# the registrations are kept across calls so that a call only needs
+# to update the subscriptions which changed since the previous call.
+# linux-only. it falls back to poll at runtime if epoll is not available.
+if(CMAKE_SYSTEM_NAME MATCHES "Linux")
+set(TOYWASM_USE_WASI_EPOLL_DEFAULT ON)
+else()
+set(TOYWASM_USE_WASI_EPOLL_DEFAULT OFF)
+endif()
+cmake_dependent_option(TOYWASM_USE_WASI_EPOLL
+    "Use epoll for WASI poll_oneoff"
+    ${TOYWASM_USE_WASI_EPOLL_DEFAULT}
+    "TOYWASM_ENABLE_WASI"
+    OFF)
+
+# use io_uring to wait for blocking i/o on host fds. (eg. fd_read on
+# a pipe) with TOYWASM_USE_USER_SCHED, the waiting threads are taken off
+# the run queue until the i/o is ready, instead of polling in turn.
+# linux-only. it falls back to poll at runtime if io_uring is not
+# available. it isn't available with host pthreads because
+# the io_uring instance is not thread-safe.
+cmake_dependent_option(TOYWASM_USE_WASI_IO_URING
+    "Use io_uring for blocking WASI i/o"
+    OFF
+    "TOYWASM_ENABLE_WASI"
+    OFF)
+
 # enable wasi-threads.
 cmake_dependent_option(TOYWASM_ENABLE_WASI_THREADS
     "Enable wasi-threads proposal"
@@ -310,6 +447,24 @@ endif() # NOT THREADS_FOUND
 endif() # wasi but not wasi-threads
 endif() # TOYWASM_ENABLE_WASM_THREADS AND NOT TOYWASM_USE_USER_SCHED
 
+if(TOYWASM_USE_WASI_EPOLL AND NOT CMAKE_SYSTEM_NAME MATCHES "Linux")
+message(WARNING "Disabling TOYWASM_USE_WASI_EPOLL on non-Linux")
+set(TOYWASM_USE_WASI_EPOLL OFF CACHE BOOL "not linux" FORCE)
+endif()
+if(TOYWASM_USE_WASI_IO_URING AND NOT CMAKE_SYSTEM_NAME MATCHES "Linux")
+message(WARNING "Disabling TOYWASM_USE_WASI_IO_URING on non-Linux")
+set(TOYWASM_USE_WASI_IO_URING OFF CACHE BOOL "not linux" FORCE)
+endif()
+if(TOYWASM_USE_WASI_IO_URING AND TOYWASM_ENABLE_WASM_THREADS AND NOT TOYWASM_USE_USER_SCHED)
+message(WARNING "Disabling TOYWASM_USE_WASI_IO_URING because of host threads")
+set(TOYWASM_USE_WASI_IO_URING OFF CACHE BOOL "host threads" FORCE)
+endif()
+
+if(TOYWASM_USE_USER_SCHED AND TOYWASM_USE_MN_SCHED)
+message(WARNING "Disabling TOYWASM_USE_MN_SCHED because of TOYWASM_USE_USER_SCHED")
+set(TOYWASM_USE_MN_SCHED OFF CACHE BOOL "user sched" FORCE)
+endif()
+
 # GCC doesn't seem to have a way to only allow statement expressions
 if(CMAKE_C_COMPILER_ID MATCHES "Clang")
 set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -pedantic -Wno-gnu-statement-expression")
@@ -0,0 +1,248 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <toywasm/exec_context.h>
+#include <toywasm/fileio.h>
+#include <toywasm/instance.h>
+#include <toywasm/instance_pool.h>
+#include <toywasm/load_context.h>
+#include <toywasm/mem.h>
+#include <toywasm/module.h>
+#include <toywasm/report.h>
+#include <toywasm/timeutil.h>
+#include <toywasm/toywasm_config.h>
+#include <toywasm/type.h>
+#include <toywasm/xlog.h>
+
+struct bench {
+        const struct module *m;
+        struct mem_context *mctx;
+        struct instance_pool *pool;
+        uint32_t funcidx;
+        bool call;
+};
+
+static int
+call_func(struct bench *b, struct instance *inst)
+{
+        struct exec_context ectx;
+        int ret;
+        if (!b->call) {
+                return 0;
+        }
+        exec_context_init(&ectx, inst, b->mctx);
+        ret = instance_execute_func_nocheck(&ectx, b->funcidx);
+        ret = instance_execute_handle_restart(&ectx, ret);
+        if (ret != 0) {
+                xlog_error("instance_execute_func failed with %d", ret);
+        }
+        exec_context_clear(&ectx);
+        return ret;
+}
+
+static int
+bench_instance_create(struct bench *b)
+{
+        struct instance *inst;
+        struct report report;
+        int ret;
+        report_init(&report);
+        ret = instance_create(b->mctx, b->m, &inst, NULL, &report);
+        if (ret != 0) {
+                xlog_error("instance_create failed with %d: %s", ret,
+                           report_getmessage(&report));
+                report_clear(&report);
+                return ret;
+        }
+        report_clear(&report);
+        ret = call_func(b, inst);
+        instance_destroy(inst);
+        return ret;
+}
+
+static int
+pool_get(struct bench *b, struct instance **instp)
+{
+        struct report report;
+        int ret;
+        report_init(&report);
+        ret = instance_pool_get(b->pool, instp, &report);
+        if (ret != 0) {
+                xlog_error("instance_pool_get failed with %d: %s", ret,
+                           report_getmessage(&report));
+        }
+        report_clear(&report);
+        return ret;
+}
+
+static int
+bench_pool_new(struct bench *b)
+{
+        struct instance *inst;
+        int ret;
+        ret = pool_get(b, &inst);
+        if (ret != 0) {
+                return ret;
+        }
+        ret = call_func(b, inst);
+        instance_destroy(inst);
+        return ret;
+}
+
+static int
+bench_pool_recycle(struct bench *b)
+{
+        struct instance *inst;
+        int ret;
+        ret = pool_get(b, &inst);
+        if (ret != 0) {
+                return ret;
+        }
+        ret = call_func(b, inst);
+        instance_pool_put(b->pool, inst);
+        return ret;
+}
+
+static int
+run(struct bench *b, const char *name, int (*fn)(struct bench *b),
+    uint32_t n)
+{
+        struct timespec start;
+        struct timespec end;
+        struct timespec diff;
+        uint32_t i;
+        int ret;
+
+        ret = timespec_now(CLOCK_MONOTONIC, &start);
+        if (ret != 0) {
+                return ret;
+        }
+        for (i = 0; i < n; i++) {
+                ret = fn(b);
+                if (ret != 0) {
+                        return ret;
+                }
+        }
+        ret = timespec_now(CLOCK_MONOTONIC, &end);
+        if (ret != 0) {
+                return ret;
+        }
+        timespec_sub(&end, &start, &diff);
+        double sec = (double)diff.tv_sec + (double)diff.tv_nsec / 1e9;
+        printf("%-24s %10.0f instances/s\n", name, (double)n / sec);
+        return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+        struct bench b0;
+        struct bench *b = &b0;
+        uint8_t *p = NULL;
+        size_t sz = 0;
+        struct module *m = NULL;
+        struct instance *tmpl = NULL;
+        uint32_t n = 1000;
+        int ret;
+
+        struct mem_context mctx0;
+        struct mem_context *mctx = &mctx0;
+        mem_context_init(mctx);
+        memset(b, 0, sizeof(*b));
+        b->mctx = mctx;
+
+        if (argc < 2 || argc > 4) {
+                fprintf(stderr, "usage: %s MODULE [ITERATIONS [FUNCTION]]\n",
+                        argv[0]);
+                ret = EINVAL;
+                goto fail;
+        }
+        if (argc >= 3) {
+                n = (uint32_t)strtoul(argv[2], NULL, 0);
+        }
+        ret = map_file(argv[1], (void **)&p, &sz);
+        if (ret != 0) {
+                xlog_error("map_file failed with %d", ret);
+                goto fail;
+        }
+        struct load_context lctx;
+        load_context_init(&lctx, mctx);
+        ret = module_create(&m, p, p + sz, &lctx);
+        if (ret != 0) {
+                xlog_error("module_create failed with %d: %s", ret,
+                           report_getmessage(&lctx.report));
+                load_context_clear(&lctx);
+                goto fail;
+        }
+        load_context_clear(&lctx);
+        b->m = m;
+        if (argc >= 4) {
+                struct name name;
+                set_name_cstr(&name, argv[3]);
+                ret = module_find_export(m, &name, EXTERNTYPE_FUNC,
+                                         &b->funcidx);
+                if (ret != 0) {
+                        xlog_error("module_find_export failed with %d", ret);
+                        goto fail;
+                }
+                const struct functype *ft = module_functype(m, b->funcidx);
+                if (ft->parameter.ntypes != 0 || ft->result.ntypes != 0) {
+                        xlog_error("unexpected function type");
+                        ret = EINVAL;
+                        goto fail;
+                }
+                b->call = true;
+        }
+
+        struct report report;
+        report_init(&report);
+        ret = instance_create(mctx, m, &tmpl, NULL, &report);
+        if (ret != 0) {
+                xlog_error("instance_create failed with %d: %s", ret,
+                           report_getmessage(&report));
+                report_clear(&report);
+                goto fail;
+        }
+        report_clear(&report);
+        ret = instance_pool_create(mctx, tmpl, NULL, &b->pool);
+        if (ret != 0) {
+                xlog_error("instance_pool_create failed with %d", ret);
+                goto fail;
+        }
+
+        ret = run(b, "instance_create", bench_instance_create, n);
+        if (ret != 0) {
+                goto fail;
+        }
+        ret = run(b, "instance_pool (new)", bench_pool_new, n);
+        if (ret != 0) {
+                goto fail;
+        }
+        ret = run(b, "instance_pool (recycle)", bench_pool_recycle, n);
+        if (ret != 0) {
+                goto fail;
+        }
+        ret = 0;
+fail:
+        if (b->pool != NULL) {
+                instance_pool_destroy(b->pool);
+        }
+        if (tmpl != NULL) {
+                instance_destroy(tmpl);
+        }
+        if (m != NULL) {
+                module_destroy(mctx, m);
+        }
+        if (p != NULL) {
+                unmap_file(p, sz);
+        }
+        mem_context_clear(mctx);
+        if (ret != 0) {
+                exit(1);
+        }
+        exit(0);
+}
@@ -135,6 +135,9 @@ print_localtype(FILE *out, const struct localtype *lt)
                 PRINT(out, "},\n");
         }
 
+#if defined(TOYWASM_USE_UNIFORM_LOCALS)
+        PRINT_U8_FIELD(out, lt, csz);
+#endif
 #if defined(TOYWASM_USE_LOCALTYPE_CELLIDX)
         PRINT(out, ".cellidx = \n");
         PRINT_CELLIDX(out, &lt->cellidx, lt->nlocals + 1);
@@ -476,6 +479,7 @@ dump_module_as_cstruct(FILE *out, const char *name, const struct module *m)
                 PRINT_RESULTTYPE(out, &ft->parameter);
                 PRINT(out, ".result = ");
                 PRINT_RESULTTYPE(out, &ft->result);
+                PRINT(out, ".id = UINT64_C(0x%" PRIx64 "),\n", ft->id);
                 PRINT(out, "},\n");
         }
         PRINT(out, "};\n");
@@ -0,0 +1,385 @@
+/*
+ * cache file format: (all integers are uint32_t in the host byte order)
+ *
+ *   header:
+ *     magic ANNOTATION_CACHE_MAGIC
+ *     version ANNOTATION_CACHE_VERSION
+ *     the identity of the annotations: (see annotation_cache_identity)
+ *       length and bytes of TOYWASM_VERSION
+ *       length and bytes of toywasm_config_string
+ *       generate_jump_table
+ *       length and bytes of the module binary
+ *     nfuncs
+ *
+ *   for each function, in the order of the code section:
+ *     size of the function body expr in bytes
+ *     maxlabels
+ *     maxcells
+ *     njumps
+ *     jumps (pc, targetpc) x njumps
+ *     (only for TOYWASM_USE_SMALL_CELLS)
+ *       default_size
+ *       ntypes
+ *       type annotations (pc, size) x ntypes
+ *
+ * all pc values are offsets from the beginning of the module binary.
+ * thus the file is independent from where the module is loaded.
+ *
+ * the byte order and the layout of the annotations depend on
+ * the build configuration of toywasm. they are covered by the hash
+ * used as the key. (see annotation_cache_key)
+ *
+ * the key is only used to name the file. because a hit means skipping
+ * the validation, the whole identity is stored in the file and
+ * compared on a lookup. a mismatch, eg. a hash collision, is a miss.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "annotation_cache.h"
+#include "expr.h"
+#include "fileio.h"
+#include "load_context.h"
+#include "mem.h"
+#include "module.h"
+#include "toywasm_version.h"
+#include "type.h"
+#include "util.h"
+#include "xlog.h"
+
+#if defined(TOYWASM_ENABLE_ANNOTATION_CACHE)
+
+#define ANNOTATION_CACHE_MAGIC 0x43415754 /* "TWAC" in little endian */
+#define ANNOTATION_CACHE_VERSION 2
+
+extern const char *const toywasm_config_string;
+
+static uint64_t
+annotation_cache_key(const struct load_context *ctx, const uint8_t *p,
+                     const uint8_t *ep)
+{
+        uint64_t h = FNV1A64_INIT;
+        h = fnv1a64(h, TOYWASM_VERSION, strlen(TOYWASM_VERSION));
+        h = fnv1a64(h, toywasm_config_string, strlen(toywasm_config_string));
+        const uint8_t generate_jump_table = ctx->options.generate_jump_table;
+        h = fnv1a64(h, &generate_jump_table, sizeof(generate_jump_table));
+        h = fnv1a64(h, p, ep - p);
+        return h;
+}
+
+static bool
+read_u32_from_cache(struct annotation_cache *c, uint32_t *vp)
+{
+        if (c->ep - c->p < (ptrdiff_t)sizeof(*vp)) {
+                return false;
+        }
+        memcpy(vp, c->p, sizeof(*vp));
+        c->p += sizeof(*vp);
+        return true;
+}
+
+static bool
+read_array_from_cache(struct annotation_cache *c, uint32_t n, size_t elemsz,
+                      const uint8_t **pp)
+{
+        if ((size_t)(c->ep - c->p) / elemsz < n) {
+                return false;
+        }
+        *pp = c->p;
+        c->p += n * elemsz;
+        return true;
+}
+
+/*
+ * check a length-prefixed byte string in the cache file.
+ */
+static bool
+match_bytes_in_cache(struct annotation_cache *c, const void *p, size_t sz)
+{
+        const uint8_t *cp;
+        uint32_t len;
+        return read_u32_from_cache(c, &len) && len == sz &&
+               read_array_from_cache(c, len, 1, &cp) && !memcmp(cp, p, sz);
+}
+
+/*
+ * check if the cache file was made for exactly the same module and
+ * the same toywasm configuration.
+ */
+static bool
+match_identity_in_cache(struct annotation_cache *c,
+                        const struct load_context *ctx)
+{
+        uint32_t u32;
+        return match_bytes_in_cache(c, TOYWASM_VERSION,
+                                    strlen(TOYWASM_VERSION)) &&
+               match_bytes_in_cache(c, toywasm_config_string,
+                                    strlen(toywasm_config_string)) &&
+               read_u32_from_cache(c, &u32) &&
+               u32 == ctx->options.generate_jump_table &&
+               match_bytes_in_cache(c, c->bin, c->binsz);
+}
+
+static void
+annotation_cache_free(struct mem_context *mctx, struct annotation_cache *c)
+{
+        if (c->buf != NULL) {
+                unmap_file(c->buf, c->bufsize);
+        }
+        if (c->path != NULL) {
+                mem_free(mctx, c->path, strlen(c->path) + 1);
+        }
+        mem_free(mctx, c, sizeof(*c));
+}
+
+int
+annotation_cache_open(struct load_context *ctx, const uint8_t *p,
+                      const uint8_t *ep)
+{
+        struct mem_context *mctx = load_mctx(ctx);
+        const char *dir = ctx->options.annotation_cache_dir;
+        int ret;
+
+        assert(dir != NULL);
+        /* the load context might be reused for another module */
+        annotation_cache_close(ctx);
+        struct annotation_cache *c = mem_zalloc(mctx, sizeof(*c));
+        if (c == NULL) {
+                return ENOMEM;
+        }
+        uint64_t key = annotation_cache_key(ctx, p, ep);
+        size_t size = ep - p;
+        int len = snprintf(NULL, 0, "%s/%016" PRIx64 "-%zu.annotations", dir,
+                           key, size);
+        if (len < 0) {
+                ret = EINVAL;
+                goto fail;
+        }
+        c->path = mem_alloc(mctx, (size_t)len + 1);
+        if (c->path == NULL) {
+                ret = ENOMEM;
+                goto fail;
+        }
+        snprintf(c->path, (size_t)len + 1, "%s/%016" PRIx64 "-%zu.annotations",
+                 dir, key, size);
+        c->bin = p;
+        c->binsz = size;
+        ctx->acache = c;
+
+        ret = map_file(c->path, &c->buf, &c->bufsize);
+        if (ret != 0) {
+                c->buf = NULL;
+                xlog_trace("annotation cache miss: %s (error %d)", c->path,
+                           ret);
+                return 0;
+        }
+        c->p = c->buf;
+        c->ep = c->p + c->bufsize;
+        uint32_t magic;
+        uint32_t version;
+        if (!read_u32_from_cache(c, &magic) ||
+            !read_u32_from_cache(c, &version) ||
+            magic != ANNOTATION_CACHE_MAGIC ||
+            version != ANNOTATION_CACHE_VERSION) {
+                xlog_trace("annotation cache broken: %s", c->path);
+                return 0;
+        }
+        if (!match_identity_in_cache(c, ctx) ||
+            !read_u32_from_cache(c, &c->nfuncs)) {
+                xlog_trace("annotation cache mismatch: %s", c->path);
+                return 0;
+        }
+        xlog_trace("annotation cache hit: %s", c->path);
+        c->hit = true;
+        return 0;
+fail:
+        annotation_cache_free(mctx, c);
+        return ret;
+}
+
+/*
+ * restore the annotations for the function from the cache.
+ *
+ * returns ENOENT if the cache can't be used. in that case, the caller
+ * should validate the function as usual. once it happens, the rest
+ * of the cache is not used either.
+ */
+int
+annotation_cache_read_func(struct load_context *ctx, uint32_t idx,
+                           uint32_t size, struct expr_exec_info *ei)
+{
+        struct mem_context *mctx = load_mctx(ctx);
+        struct annotation_cache *c = ctx->acache;
+        const uint8_t *jumps;
+        uint32_t u32;
+        int ret;
+
+        if (c == NULL || !c->hit) {
+                return ENOENT;
+        }
+        memset(ei, 0, sizeof(*ei));
+        if (idx != c->nused || idx >= c->nfuncs) {
+                goto broken;
+        }
+        if (!read_u32_from_cache(c, &u32) || u32 != size ||
+            !read_u32_from_cache(c, &ei->maxlabels) ||
+            !read_u32_from_cache(c, &ei->maxcells) ||
+            !read_u32_from_cache(c, &ei->njumps) ||
+            !read_array_from_cache(c, ei->njumps, sizeof(*ei->jumps),
+                                   &jumps)) {
+                goto broken;
+        }
+#if defined(TOYWASM_USE_SMALL_CELLS)
+        struct type_annotations *an = &ei->type_annotations;
+        const uint8_t *types;
+        if (!read_u32_from_cache(c, &an->default_size) ||
+            !read_u32_from_cache(c, &an->ntypes) ||
+            !read_array_from_cache(c, an->ntypes, sizeof(*an->types),
+                                   &types)) {
+                goto broken;
+        }
+        if (an->ntypes > 0) {
+                an->types = mem_alloc(mctx, an->ntypes * sizeof(*an->types));
+                if (an->types == NULL) {
+                        ret = ENOMEM;
+                        goto fail;
+                }
+                memcpy(an->types, types, an->ntypes * sizeof(*an->types));
+        }
+#endif
+        if (ei->njumps > 0) {
+                ei->jumps = mem_alloc(mctx, ei->njumps * sizeof(*ei->jumps));
+                if (ei->jumps == NULL) {
+                        ret = ENOMEM;
+                        goto fail;
+                }
+                memcpy(ei->jumps, jumps, ei->njumps * sizeof(*ei->jumps));
+#if defined(TOYWASM_USE_JUMP_HASH)
+                ret = build_jump_hash(mctx, ei);
+                if (ret != 0) {
+                        goto fail;
+                }
+#endif
+        }
+        c->nused++;
+        return 0;
+broken:
+        xlog_trace("annotation cache broken: %s (func %" PRIu32 ")", c->path,
+                   idx);
+        ret = ENOENT;
+        c->hit = false;
+fail:
+#if defined(TOYWASM_USE_SMALL_CELLS)
+        mem_free(mctx, ei->type_annotations.types,
+                 ei->type_annotations.ntypes *
+                         sizeof(*ei->type_annotations.types));
+#endif
+        mem_free(mctx, ei->jumps, ei->njumps * sizeof(*ei->jumps));
+        memset(ei, 0, sizeof(*ei));
+        return ret;
+}
+
+static bool
+write_u32(FILE *fp, uint32_t v)
+{
+        return fwrite(&v, sizeof(v), 1, fp) == 1;
+}
+
+static bool
+write_array(FILE *fp, const void *p, uint32_t n, size_t elemsz)
+{
+        return n == 0 || fwrite(p, elemsz, n, fp) == n;
+}
+
+static bool
+write_bytes(FILE *fp, const void *p, size_t sz)
+{
+        return sz <= UINT32_MAX && write_u32(fp, (uint32_t)sz) &&
+               write_array(fp, p, (uint32_t)sz, 1);
+}
+
+/*
+ * write the annotations of the successfully loaded module to
+ * the cache file, unless it was a cache hit.
+ *
+ * errors are not fatal. we just don't have a cache in that case.
+ */
+void
+annotation_cache_save(struct load_context *ctx, const struct module *m)
+{
+        struct mem_context *mctx = load_mctx(ctx);
+        struct annotation_cache *c = ctx->acache;
+        if (c == NULL || (c->hit && c->nused == m->nfuncs)) {
+                return;
+        }
+#if defined(TOYWASM_ENABLE_LAZY_VALIDATION)
+        if (m->lazy != NULL) {
+                /* we don't have annotations for some of functions yet */
+                return;
+        }
+#endif
+        /*
+         * Note: write to a temporary file and rename it so that
+         * concurrent readers and writers of the same cache never see
+         * a partially written file.
+         */
+        struct file_writer fw;
+        if (file_writer_open(mctx, c->path, &fw) != 0) {
+                return;
+        }
+        FILE *fp = fw.fp;
+        bool ok = write_u32(fp, ANNOTATION_CACHE_MAGIC) &&
+                  write_u32(fp, ANNOTATION_CACHE_VERSION) &&
+                  write_bytes(fp, TOYWASM_VERSION, strlen(TOYWASM_VERSION)) &&
+                  write_bytes(fp, toywasm_config_string,
+                              strlen(toywasm_config_string)) &&
+                  write_u32(fp, ctx->options.generate_jump_table) &&
+                  write_bytes(fp, c->bin, c->binsz) &&
+                  write_u32(fp, m->nfuncs);
+        uint32_t i;
+        for (i = 0; ok && i < m->nfuncs; i++) {
+                const struct expr *e = &m->funcs[i].e;
+                const struct expr_exec_info *ei = &e->ei;
+                size_t size = expr_end(e) - e->start;
+                ok = size <= UINT32_MAX && write_u32(fp, (uint32_t)size) &&
+                     write_u32(fp, ei->maxlabels) &&
+                     write_u32(fp, ei->maxcells) &&
+                     write_u32(fp, ei->njumps) &&
+                     write_array(fp, ei->jumps, ei->njumps,
+                                 sizeof(*ei->jumps));
+#if defined(TOYWASM_USE_SMALL_CELLS)
+                const struct type_annotations *an = &ei->type_annotations;
+                ok = ok && write_u32(fp, an->default_size) &&
+                     write_u32(fp, an->ntypes) &&
+                     write_array(fp, an->types, an->ntypes,
+                                 sizeof(*an->types));
+#endif
+        }
+        if (!ok) {
+                xlog_trace("failed to write %s", c->path);
+                file_writer_abort(mctx, &fw);
+                return;
+        }
+        if (file_writer_commit(mctx, &fw, c->path) != 0) {
+                return;
+        }
+        xlog_trace("annotation cache saved: %s", c->path);
+}
+
+void
+annotation_cache_close(struct load_context *ctx)
+{
+        struct annotation_cache *c = ctx->acache;
+        if (c == NULL) {
+                return;
+        }
+        annotation_cache_free(load_mctx(ctx), c);
+        ctx->acache = NULL;
+}
+
+#endif /* defined(TOYWASM_ENABLE_ANNOTATION_CACHE) */
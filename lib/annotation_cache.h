@@ -0,0 +1,51 @@
+#if !defined(_TOYWASM_ANNOTATION_CACHE_H)
+#define _TOYWASM_ANNOTATION_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "platform.h"
+
+struct expr_exec_info;
+struct load_context;
+struct mem_context;
+struct module;
+
+/*
+ * a persistent on-disk cache of the annotations generated by
+ * the validation of function bodies. (see doc/annotations.md)
+ *
+ * the cache file is named after a hash of the module binary and
+ * the configuration of toywasm. they are also stored in the file
+ * as they are and compared on a lookup. on a cache hit, module_create
+ * skips the validation of function bodies entirely.
+ *
+ * Note: the content of the cache is trusted. the cache directory
+ * should not be writable by untrusted users.
+ */
+struct annotation_cache {
+        char *path;
+        const uint8_t *bin; /* the module binary */
+        size_t binsz;
+        void *buf;
+        size_t bufsize;
+        const uint8_t *p;  /* the next func record */
+        const uint8_t *ep; /* the end of buf */
+        uint32_t nfuncs;
+        uint32_t nused;
+        bool hit;
+};
+
+__BEGIN_EXTERN_C
+
+int annotation_cache_open(struct load_context *ctx, const uint8_t *p,
+                          const uint8_t *ep);
+int annotation_cache_read_func(struct load_context *ctx, uint32_t idx,
+                               uint32_t size, struct expr_exec_info *ei);
+void annotation_cache_save(struct load_context *ctx, const struct module *m);
+void annotation_cache_close(struct load_context *ctx);
+
+__END_EXTERN_C
+
+#endif /* !defined(_TOYWASM_ANNOTATION_CACHE_H) */
@@ -145,6 +145,14 @@ uint32_t
 localtype_cellidx(const struct localtype *lt, uint32_t idx, uint32_t *cszp)
 {
         assert(idx < lt->nlocals || (idx == lt->nlocals && cszp == NULL));
+#if defined(TOYWASM_USE_UNIFORM_LOCALS)
+        if (lt->csz != 0) {
+                if (cszp != NULL) {
+                        *cszp = lt->csz;
+                }
+                return idx * lt->csz;
+        }
+#endif
 #if defined(TOYWASM_USE_LOCALTYPE_CELLIDX)
         if (__predict_true(lt->cellidx.cellidxes != NULL)) {
                 return localcellidx_lookup(&lt->cellidx, idx, cszp);
@@ -216,6 +224,14 @@ frame_locals_cellidx(struct exec_context *ctx, uint32_t localidx,
 {
         xassert(cszp != NULL);
 #if defined(TOYWASM_USE_SMALL_CELLS)
+#if defined(TOYWASM_USE_UNIFORM_LOCALS)
+        /* all parameters and locals have the same size */
+        const uint32_t csz = ctx->frame_csz;
+        if (__predict_true(csz != 0)) {
+                *cszp = csz;
+                return localidx * csz;
+        }
+#endif
 #if defined(TOYWASM_USE_LOCALS_FAST_PATH)
         if (__predict_true(ctx->fast)) {
                 return frame_locals_cellidx_fast(ctx, localidx, cszp);
@@ -14,6 +14,7 @@ cluster_init(struct cluster *c)
 
         c->suspend_state = SUSPEND_STATE_NONE;
         c->nparked = 0;
+        c->noffcpu = 0;
         toywasm_cv_init(&c->stop_cv);
 }
 
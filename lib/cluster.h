@@ -25,6 +25,11 @@ struct cluster {
         /* suspend */
         _Atomic enum suspend_state suspend_state;
         uint32_t nparked;
+        /*
+         * the number of threads which are not running on any host
+         * threads. (see suspend_offcpu)
+         */
+        uint32_t noffcpu;
         TOYWASM_CV_DEFINE(stop_cv);
 };
 
@@ -11,7 +11,10 @@
 #include "expr.h"
 #include "insn.h"
 #include "leb128.h"
+#include "mnsched.h"
+#include "module.h"
 #include "platform.h"
+#include "profiler.h"
 #include "restart.h"
 #include "suspend.h"
 #include "timeutil.h"
@@ -110,6 +113,9 @@ set_current_frame(struct exec_context *ctx, const struct funcframe *frame,
                         &m->funcs[funcidx - m->nimportedfuncs];
                 assert(frame->nresults == resulttype_cellsize(&ft->result));
                 assert(ei == NULL || ei == &func->e.ei);
+#if defined(TOYWASM_USE_UNIFORM_LOCALS)
+                ctx->frame_csz = func->localtype.csz;
+#endif
 #if defined(TOYWASM_USE_LOCALS_FAST_PATH)
                 const uint16_t *paramtype_cellidxes =
                         ft->parameter.cellidx.cellidxes;
@@ -151,26 +157,13 @@ static bool branch_to_label(struct exec_context *ctx, uint32_t labelidx,
  */
 
 /*
- * Note: the parameters of this function is redundant.
- * - for functions, localtype, paramtype, nresults can be obtained
- *   from instance+funcidx.
- * - const exprs, where funcidx is FUNCIDX_INVALID, do never have
- *   locals or parameters.
+ * frame_prealloc: reserve everything a new frame needs at once.
+ * ie. the frame itself, its locals, labels and operand stack.
  */
-int
-frame_enter(struct exec_context *ctx, struct instance *inst, uint32_t funcidx,
-            const struct expr_exec_info *ei, const struct localtype *localtype,
-            const struct resulttype *paramtype, uint32_t nresults,
-            const struct cell *params)
+static int
+frame_prealloc(struct exec_context *ctx, const struct expr_exec_info *ei,
+               uint32_t nlocals)
 {
-        assert(funcidx != FUNCIDX_INVALID ||
-               (localtype->nlocals == 0 && paramtype->ntypes == 0));
-
-        /*
-         * Note: params can be in ctx->stack.
-         * Be careful when resizing the later.
-         */
-        struct funcframe *frame;
         int ret;
 
         if (ctx->frames.lsize == ctx->options.max_frames) {
@@ -181,30 +174,84 @@ frame_enter(struct exec_context *ctx, struct instance *inst, uint32_t funcidx,
         if (ret != 0) {
                 return ret;
         }
-        const uint32_t nparams = resulttype_cellsize(paramtype);
-        const uint32_t func_nlocals = localtype_cellsize(localtype);
-        const uint32_t nlocals = nparams + func_nlocals;
-        frame = &VEC_NEXTELEM(ctx->frames);
-        frame->instance = inst;
-        frame->funcidx = funcidx;
-        frame->nresults = nresults;
-        frame->labelidx = ctx->labels.lsize;
 #if defined(TOYWASM_USE_SEPARATE_LOCALS)
-        frame->localidx = ctx->locals.lsize;
         ret = VEC_PREALLOC(exec_mctx(ctx), ctx->locals, nlocals);
         if (ret != 0) {
                 return ret;
         }
+        ret = stack_prealloc(ctx, ei->maxcells);
+#else
+        ret = stack_prealloc(ctx, nlocals + ei->maxcells);
 #endif
+        if (ret != 0) {
+                return ret;
+        }
         if (ei->maxlabels > 1) {
-                frame->labelidx = ctx->labels.lsize;
                 ret = VEC_PREALLOC(exec_mctx(ctx), ctx->labels,
                                    ei->maxlabels - 1);
                 if (ret != 0) {
                         return ret;
                 }
         }
+        return 0;
+}
 
+#if defined(TOYWASM_USE_INLINE_CALL)
+/*
+ * frame_fits: return true if frame_prealloc would succeed
+ * without allocating anything.
+ */
+static bool
+frame_fits(const struct exec_context *ctx, const struct expr_exec_info *ei,
+           uint32_t nlocals)
+{
+        if (ctx->frames.lsize >= ctx->frames.psize ||
+            ctx->frames.lsize == ctx->options.max_frames) {
+                return false;
+        }
+#if defined(TOYWASM_USE_SEPARATE_LOCALS)
+        if (ctx->locals.psize - ctx->locals.lsize < nlocals) {
+                return false;
+        }
+        const uint32_t ncells = ei->maxcells;
+#else
+        const uint32_t ncells = nlocals + ei->maxcells;
+#endif
+        if (ctx->stack.psize - ctx->stack.lsize < ncells ||
+            ctx->options.max_stackcells - ctx->stack.lsize < ncells) {
+                return false;
+        }
+        if (ei->maxlabels > 1 &&
+            ctx->labels.psize - ctx->labels.lsize < ei->maxlabels - 1) {
+                return false;
+        }
+        return true;
+}
+#endif /* defined(TOYWASM_USE_INLINE_CALL) */
+
+/*
+ * frame_setup: push a new frame.
+ * the space should have been reserved by frame_prealloc.
+ *
+ * params should be either &VEC_NEXTELEM(ctx->stack) or
+ * outside of ctx->stack.
+ */
+static void
+frame_setup(struct exec_context *ctx, struct instance *inst, uint32_t funcidx,
+            const struct expr_exec_info *ei, uint32_t nparams,
+            uint32_t nlocals, uint32_t nresults, const struct cell *params)
+{
+        struct funcframe *frame;
+
+        assert(ctx->frames.lsize < ctx->frames.psize);
+        frame = &VEC_NEXTELEM(ctx->frames);
+        frame->instance = inst;
+        frame->funcidx = funcidx;
+        frame->nresults = nresults;
+        frame->labelidx = ctx->labels.lsize;
+#if defined(TOYWASM_USE_SEPARATE_LOCALS)
+        frame->localidx = ctx->locals.lsize;
+#endif
         if (ctx->frames.lsize > 0) {
                 /*
                  * Note: ctx->instance can be different from
@@ -225,25 +272,9 @@ frame_enter(struct exec_context *ctx, struct instance *inst, uint32_t funcidx,
 #if defined(TOYWASM_USE_SEPARATE_LOCALS)
         struct cell *locals = &VEC_ELEM(ctx->locals, frame->localidx);
         cells_copy(locals, params, nparams);
-
-        /*
-         * As we've copied "params" above, now it's safe to resize
-         * stack.
-         */
-        ret = stack_prealloc(ctx, ei->maxcells);
-        if (ret != 0) {
-                return ret;
-        }
 #else
-        const bool params_on_stack = params == &VEC_NEXTELEM(ctx->stack);
-
-        ret = stack_prealloc(ctx, nlocals + ei->maxcells);
-        if (ret != 0) {
-                return ret;
-        }
-
         struct cell *locals = &VEC_NEXTELEM(ctx->stack);
-        if (params_on_stack) {
+        if (params == locals) {
                 xlog_trace_insn("params on stack");
                 /* params are already in place */
         } else {
@@ -282,12 +313,52 @@ frame_enter(struct exec_context *ctx, struct instance *inst, uint32_t funcidx,
 #if defined(TOYWASM_USE_SEPARATE_LOCALS)
         assert(ctx->locals.lsize + nlocals <= ctx->locals.psize);
         ctx->locals.lsize += nlocals;
+        assert(ctx->stack.lsize + ei->maxcells <= ctx->stack.psize);
 #else
         assert(ctx->stack.lsize + nlocals + ei->maxcells <= ctx->stack.psize);
         ctx->stack.lsize += nlocals;
 #endif
+        assert(ei->maxlabels <= 1 ||
+               ctx->labels.lsize + ei->maxlabels - 1 <= ctx->labels.psize);
         set_current_frame(ctx, frame, ei);
         assert(ctx->ei == ei);
+}
+
+/*
+ * Note: the parameters of this function is redundant.
+ * - for functions, localtype, paramtype, nresults can be obtained
+ *   from instance+funcidx.
+ * - const exprs, where funcidx is FUNCIDX_INVALID, do never have
+ *   locals or parameters.
+ */
+int
+frame_enter(struct exec_context *ctx, struct instance *inst, uint32_t funcidx,
+            const struct expr_exec_info *ei, const struct localtype *localtype,
+            const struct resulttype *paramtype, uint32_t nresults,
+            const struct cell *params)
+{
+        assert(funcidx != FUNCIDX_INVALID ||
+               (localtype->nlocals == 0 && paramtype->ntypes == 0));
+
+        const uint32_t nparams = resulttype_cellsize(paramtype);
+        const uint32_t func_nlocals = localtype_cellsize(localtype);
+        const uint32_t nlocals = nparams + func_nlocals;
+        int ret;
+
+        /*
+         * Note: params can be in ctx->stack.
+         * Be careful when resizing the later.
+         */
+        const bool params_on_stack = params == &VEC_NEXTELEM(ctx->stack);
+        ret = frame_prealloc(ctx, ei, nlocals);
+        if (ret != 0) {
+                return ret;
+        }
+        if (params_on_stack) {
+                params = &VEC_NEXTELEM(ctx->stack);
+        }
+        frame_setup(ctx, inst, funcidx, ei, nparams, nlocals, nresults,
+                    params);
         return 0;
 }
 
@@ -330,6 +401,21 @@ frame_exit(struct exec_context *ctx)
 static const struct jump *
 jump_table_lookup(const struct expr_exec_info *ei, uint32_t blockpc)
 {
+#if defined(TOYWASM_USE_JUMP_HASH)
+        assert(ei->jump_hash != NULL);
+        const uint32_t mask = ((uint32_t)1 << ei->jump_hash_bits) - 1;
+        uint32_t h = JUMP_HASH(blockpc, ei->jump_hash_bits);
+        while (true) {
+                const uint32_t idx = ei->jump_hash[h];
+                assert(idx != JUMP_HASH_EMPTY);
+                assert(idx < ei->njumps);
+                const struct jump *jump = &ei->jumps[idx];
+                if (jump->pc == blockpc) {
+                        return jump;
+                }
+                h = (h + 1) & mask;
+        }
+#else  /* defined(TOYWASM_USE_JUMP_HASH) */
         uint32_t left = 0;
         uint32_t right = ei->njumps;
 #if defined(TOYWASM_USE_JUMP_BINARY_SEARCH)
@@ -360,6 +446,7 @@ jump_table_lookup(const struct expr_exec_info *ei, uint32_t blockpc)
         }
 #endif /* defined(TOYWASM_USE_JUMP_BINARY_SEARCH) */
         assert(false);
+#endif /* defined(TOYWASM_USE_JUMP_HASH) */
 }
 
 static const struct jump *
@@ -388,18 +475,44 @@ funcinst_func(const struct funcinst *fi)
         assert(!fi->is_host);
         const struct instance *inst = fi->u.wasm.instance;
         uint32_t funcidx = fi->u.wasm.funcidx;
+        const struct module *m = inst->module;
+        assert(funcidx >= m->nimportedfuncs);
+        assert(funcidx < m->nimportedfuncs + m->nfuncs);
+#if !defined(NDEBUG)
         /*
          * Note: We do never create multiple funcinst for a func.
          * When re-exporting a function, we share the funcinst
          * from the original instance directly.
+         *
+         * An exception is a copy made by an embedder to rebind
+         * an import in place. (eg. dyld_patch_plt in libdyld)
+         * Such a copy should be identical to the original.
          */
-        assert(VEC_ELEM(inst->funcs, funcidx) == fi);
-        const struct module *m = inst->module;
-        assert(funcidx >= m->nimportedfuncs);
-        assert(funcidx < m->nimportedfuncs + m->nfuncs);
+        const struct funcinst *orig = VEC_ELEM(inst->funcs, funcidx);
+        assert(orig == fi ||
+               (!fi->is_host && !orig->is_host &&
+                fi->u.wasm.instance == orig->u.wasm.instance &&
+                fi->u.wasm.funcidx == orig->u.wasm.funcidx));
+#endif
         return &m->funcs[funcidx - m->nimportedfuncs];
 }
 
+#if defined(TOYWASM_ENABLE_LAZY_VALIDATION)
+static int
+lazy_validate(struct exec_context *ctx, const struct module *m,
+              uint32_t funcidx)
+{
+        STAT_INC(ctx, lazy_validation);
+        int ret = module_validate_func_lazily(m, funcidx - m->nimportedfuncs);
+        if (ret == EINVAL) {
+                return trap_with_id(ctx, TRAP_INVALID_FUNCTION,
+                                    "function %" PRIu32 " failed validation",
+                                    funcidx);
+        }
+        return ret;
+}
+#endif
+
 static int
 do_wasm_call(struct exec_context *ctx, const struct funcinst *finst)
 {
@@ -407,6 +520,21 @@ do_wasm_call(struct exec_context *ctx, const struct funcinst *finst)
         const struct functype *type = funcinst_functype(finst);
         struct instance *callee_inst = finst->u.wasm.instance;
         const struct func *func = funcinst_func(finst);
+#if defined(TOYWASM_ENABLE_LAZY_VALIDATION)
+        const struct module *m = callee_inst->module;
+        if (__predict_false(m->lazy != NULL)) {
+                uint32_t funcidx = finst->u.wasm.funcidx;
+                struct lazy_func *lf =
+                        &m->lazy->funcs[funcidx - m->nimportedfuncs];
+                if (atomic_load_explicit(&lf->state, memory_order_acquire) !=
+                    LAZY_FUNC_VALID) {
+                        ret = lazy_validate(ctx, m, funcidx);
+                        if (ret != 0) {
+                                return ret;
+                        }
+                }
+        }
+#endif
         uint32_t nparams = resulttype_cellsize(&type->parameter);
         uint32_t nresults = resulttype_cellsize(&type->result);
         assert(ctx->stack.lsize >= nparams);
@@ -421,6 +549,62 @@ do_wasm_call(struct exec_context *ctx, const struct funcinst *finst)
         return 0;
 }
 
+#if defined(TOYWASM_USE_INLINE_CALL)
+/*
+ * exec_call_inline: a fast path of do_call for the call instructions.
+ *
+ * it performs a wasm-to-wasm call in place, without bouncing through
+ * exec_expr_continue, so that the caller can keep dispatching
+ * instructions.
+ *
+ * it gives up and returns false if the callee is a host function,
+ * needs lazy validation, or if the new frame doesn't fit in the space
+ * we have already allocated. in that case, nothing has been changed
+ * and the caller should use the slow path. (schedule_call)
+ *
+ * the caller should have synced ctx->p and ctx->stack.
+ */
+bool
+exec_call_inline(struct exec_context *ctx, const struct funcinst *finst)
+{
+        if (finst->is_host) {
+                return false;
+        }
+        struct instance *callee_inst = finst->u.wasm.instance;
+        const uint32_t funcidx = finst->u.wasm.funcidx;
+        const struct module *m = callee_inst->module;
+#if defined(TOYWASM_ENABLE_LAZY_VALIDATION)
+        if (__predict_false(m->lazy != NULL)) {
+                struct lazy_func *lf =
+                        &m->lazy->funcs[funcidx - m->nimportedfuncs];
+                if (atomic_load_explicit(&lf->state, memory_order_acquire) !=
+                    LAZY_FUNC_VALID) {
+                        return false;
+                }
+        }
+#endif
+        const struct functype *type = module_functype(m, funcidx);
+        const struct func *func = funcinst_func(finst);
+        const struct expr_exec_info *ei = &func->e.ei;
+        const uint32_t nparams = resulttype_cellsize(&type->parameter);
+        const uint32_t nlocals =
+                nparams + localtype_cellsize(&func->localtype);
+        assert(ctx->stack.lsize >= nparams);
+        ctx->stack.lsize -= nparams;
+        if (__predict_false(!frame_fits(ctx, ei, nlocals))) {
+                ctx->stack.lsize += nparams;
+                return false;
+        }
+        STAT_INC(ctx, call);
+        STAT_INC(ctx, inline_call);
+        frame_setup(ctx, callee_inst, funcidx, ei, nparams, nlocals,
+                    resulttype_cellsize(&type->result),
+                    &VEC_NEXTELEM(ctx->stack));
+        ctx->p = func->e.start;
+        return true;
+}
+#endif /* defined(TOYWASM_USE_INLINE_CALL) */
+
 static int
 do_host_call(struct exec_context *ctx, const struct funcinst *finst)
 {
@@ -1084,6 +1268,19 @@ check_interrupt(struct exec_context *ctx)
                 return ETOYWASMRESTART;
         }
 #else /* defined(TOYWASM_USE_USER_SCHED) */
+#if defined(TOYWASM_USE_MN_SCHED)
+        if (ctx->mnsched_thread != NULL) {
+                int ret = mnsched_check_resched(ctx->mnsched_thread);
+                if (ret != 0) {
+                        if (ret == ETOYWASMRESTART) {
+                                xlog_trace("%s: need resched ctx %p",
+                                           __func__, (void *)ctx);
+                                STAT_INC(ctx, interrupt_mnsched);
+                        }
+                        return ret;
+                }
+        }
+#endif
 
 #undef TSAN
 #if defined(__has_feature)
@@ -1142,6 +1339,16 @@ check_interrupt_interval_ms(struct exec_context *ctx)
                         }
                 }
         }
+#endif
+#if defined(TOYWASM_ENABLE_PROFILER)
+        if (ctx->profiler != NULL) {
+                /* sample more frequently */
+                const uint32_t profiler_ms =
+                        profiler_interval_ms(ctx->profiler);
+                if ((uint32_t)interval_ms > profiler_ms) {
+                        interval_ms = (int)profiler_ms;
+                }
+        }
 #endif
         return interval_ms;
 }
@@ -1194,6 +1401,34 @@ adjust_check_interval(struct exec_context *ctx, const struct timespec *now,
 }
 #endif /* defined(ADJUST_CHECK_INTERVAL) */
 
+#if defined(TOYWASM_ENABLE_PROFILER)
+/*
+ * take a profiler sample, weighted by the time elapsed since *lastp.
+ * (the previous sample or the start of exec_expr_continue)
+ */
+static int
+take_profiler_sample(struct exec_context *ctx, struct timespec *lastp)
+{
+#if defined(_WIN32)
+        /* no timespec_now. assume the nominal interval. */
+        profiler_sample(ctx->profiler, ctx,
+                        (uint64_t)profiler_interval_ms(ctx->profiler) * 1000);
+        return 0;
+#else
+        struct timespec now;
+        struct timespec diff;
+        int ret = timespec_now(CLOCK_MONOTONIC, &now);
+        if (ret != 0) {
+                return ret;
+        }
+        timespec_sub(&now, lastp, &diff);
+        profiler_sample(ctx->profiler, ctx, timespec_to_us(&diff));
+        *lastp = now;
+        return 0;
+#endif
+}
+#endif
+
 /*
  * REVISIT: probably it's cleaner to integrate into frame_exit
  */
@@ -1243,6 +1478,17 @@ exec_expr_continue(struct exec_context *ctx)
 #if defined(ADJUST_CHECK_INTERVAL)
         struct timespec last;
         bool has_last = false;
+#endif
+#if defined(TOYWASM_ENABLE_PROFILER)
+        struct timespec profiler_last;
+#if !defined(_WIN32)
+        if (ctx->profiler != NULL) {
+                int ret = timespec_now(CLOCK_MONOTONIC, &profiler_last);
+                if (ret != 0) {
+                        return ret;
+                }
+        }
+#endif
 #endif
         uint32_t n = ctx->check_interval;
         assert(n > 0);
@@ -1334,6 +1580,15 @@ exec_expr_continue(struct exec_context *ctx)
                         }
                         last = now;
                         has_last = true;
+#endif
+#if defined(TOYWASM_ENABLE_PROFILER)
+                        if (ctx->profiler != NULL) {
+                                ret = take_profiler_sample(ctx,
+                                                           &profiler_last);
+                                if (ret != 0) {
+                                        return ret;
+                                }
+                        }
 #endif
                         ret = check_interrupt(ctx);
                         if (ret != 0) {
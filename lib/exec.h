@@ -66,6 +66,9 @@ int frame_enter(struct exec_context *ctx, struct instance *inst,
                 const struct localtype *localtype,
                 const struct resulttype *paramtype, uint32_t nresults,
                 const struct cell *params);
+#if defined(TOYWASM_USE_INLINE_CALL)
+bool exec_call_inline(struct exec_context *ctx, const struct funcinst *finst);
+#endif
 void frame_clear(struct funcframe *frame);
 void frame_exit(struct exec_context *ctx);
 struct cell *frame_locals(const struct exec_context *ctx,
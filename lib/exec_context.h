@@ -56,6 +56,7 @@ struct funcframe {
  *   memory.grow on multithreaded configuration.
  *
  *   - context switch requests for TOYWASM_USE_USER_SCHED
+ *     and TOYWASM_USE_MN_SCHED
  *
  *   the caller should usually resume the execution by
  *   calling instance_execute_handle_restart.
@@ -95,6 +96,7 @@ enum trapid {
         TRAP_THROW_REF_NULL,
         TRAP_UNRESOLVED_IMPORTED_FUNC,
         TRAP_MEMORY_NOT_FOUND,
+        TRAP_INVALID_FUNCTION,
 };
 
 enum exec_event {
@@ -114,14 +116,23 @@ enum restart_type {
         RESTART_NONE,
         RESTART_TIMER,
         RESTART_HOSTFUNC,
+#if defined(TOYWASM_USE_WASI_IO_URING)
+        RESTART_URING,
+#endif
 };
 
 struct exec_stat {
         uint64_t call;
         uint64_t host_call; /* included in call */
+#if defined(TOYWASM_USE_INLINE_CALL)
+        uint64_t inline_call; /* included in call */
+#endif
 #if defined(TOYWASM_ENABLE_WASM_TAILCALL)
         uint64_t tail_call;      /* included in call */
         uint64_t host_tail_call; /* included in host_call and call */
+#endif
+#if defined(TOYWASM_ENABLE_LAZY_VALIDATION)
+        uint64_t lazy_validation;
 #endif
         uint64_t branch;
         uint64_t branch_goto_else;
@@ -130,9 +141,16 @@ struct exec_stat {
 #endif
 #if TOYWASM_JUMP_CACHE2_SIZE > 0
         uint64_t jump_cache2_hit;
+#endif
+#if TOYWASM_CALL_INDIRECT_CACHE_SIZE > 0
+        uint64_t indirect_cache_hit;
+        uint64_t indirect_cache_miss;
 #endif
         uint64_t jump_table_search;
         uint64_t jump_loop;
+#if defined(TOYWASM_USE_INSN_FUSION)
+        uint64_t fused_insn;
+#endif
 #if defined(TOYWASM_USE_SMALL_CELLS)
         uint64_t type_annotation_lookup1;
         uint64_t type_annotation_lookup2;
@@ -142,6 +160,9 @@ struct exec_stat {
         uint64_t interrupt_suspend;
 #if defined(TOYWASM_USE_USER_SCHED)
         uint64_t interrupt_usched;
+#endif
+#if defined(TOYWASM_USE_MN_SCHED)
+        uint64_t interrupt_mnsched;
 #endif
         uint64_t interrupt_user;
         uint64_t interrupt_debug;
@@ -152,6 +173,10 @@ struct exec_stat {
 #endif
 #if defined(TOYWASM_ENABLE_WASM_THREADS)
         uint64_t atomic_wait_restart;
+        uint64_t atomic_lock_contended;
+#if defined(TOYWASM_USE_MN_SCHED)
+        uint64_t atomic_wait_park;
+#endif
 #endif
 #if defined(TOYWASM_ENABLE_WASM_EXCEPTION_HANDLING)
         uint64_t exception;
@@ -166,12 +191,25 @@ struct jump_cache {
         const uint8_t *target;
 };
 
+/*
+ * a call_indirect cache entry. it's valid while the table
+ * generation matches.
+ */
+struct call_indirect_cache {
+        const struct tableinst *table;
+        uint64_t gen;
+        uint32_t idx;
+        const struct functype *ft;
+        const struct funcinst *func;
+};
+
 struct trap_info {
         enum trapid trapid;
 };
 
 struct sched;
 struct context;
+struct profiler;
 
 struct restart_info {
         enum restart_type restart_type;
@@ -185,6 +223,16 @@ struct restart_info {
                         struct timespec abstimeout;
                 } timer;
 
+#if defined(TOYWASM_USE_WASI_IO_URING)
+                /*
+                 * RESTART_URING
+                 * wasi_uring_wait_fd
+                 */
+                struct {
+                        uint64_t id;
+                } uring;
+#endif
+
                 /*
                  * RESTART_HOSTFUNC
                  *
@@ -207,6 +255,9 @@ struct exec_context {
         const struct expr_exec_info *ei;
 #if defined(TOYWASM_USE_LOCALS_FAST_PATH)
         bool fast;
+#endif
+#if defined(TOYWASM_USE_UNIFORM_LOCALS)
+        uint32_t frame_csz; /* struct localtype::csz */
 #endif
         union {
 #if defined(TOYWASM_USE_LOCALS_FAST_PATH)
@@ -236,6 +287,10 @@ struct exec_context {
 #if TOYWASM_JUMP_CACHE2_SIZE > 0
         struct jump_cache cache[TOYWASM_JUMP_CACHE2_SIZE];
 #endif
+#if TOYWASM_CALL_INDIRECT_CACHE_SIZE > 0
+        struct call_indirect_cache
+                call_indirect_cache[TOYWASM_CALL_INDIRECT_CACHE_SIZE];
+#endif
 
         /* Execution stacks */
         VEC(, struct funcframe) frames;
@@ -275,11 +330,23 @@ struct exec_context {
         unsigned int user_intr_delay_count;
         unsigned int user_intr_delay;
         uint32_t check_interval;
+#if defined(TOYWASM_ENABLE_PROFILER)
+        /*
+         * The `profiler` field enables the sampling profiler.
+         * see profiler.h.
+         */
+        struct profiler *profiler;
+#endif
 
 #if defined(TOYWASM_USE_USER_SCHED)
         /* scheduler */
         struct sched *sched;
         SLIST_ENTRY(struct exec_context) rq;
+        bool sched_blocked; /* see sched_block */
+#endif
+#if defined(TOYWASM_USE_MN_SCHED)
+        /* NULL unless this context is run by mnsched */
+        struct mnsched_thread *mnsched_thread;
 #endif
 
         /* Trap */
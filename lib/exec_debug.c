@@ -30,9 +30,15 @@ exec_context_print_stats(struct exec_context *ctx)
 
         STAT_PRINT(call);
         STAT_PRINT(host_call);
+#if defined(TOYWASM_USE_INLINE_CALL)
+        STAT_PRINT(inline_call);
+#endif
 #if defined(TOYWASM_ENABLE_WASM_TAILCALL)
         STAT_PRINT(tail_call);
         STAT_PRINT(host_tail_call);
+#endif
+#if defined(TOYWASM_ENABLE_LAZY_VALIDATION)
+        STAT_PRINT(lazy_validation);
 #endif
         STAT_PRINT(branch);
         STAT_PRINT(branch_goto_else);
@@ -41,9 +47,16 @@ exec_context_print_stats(struct exec_context *ctx)
 #endif
 #if TOYWASM_JUMP_CACHE2_SIZE > 0
         STAT_PRINT(jump_cache2_hit);
+#endif
+#if TOYWASM_CALL_INDIRECT_CACHE_SIZE > 0
+        STAT_PRINT(indirect_cache_hit);
+        STAT_PRINT(indirect_cache_miss);
 #endif
         STAT_PRINT(jump_table_search);
         STAT_PRINT(jump_loop);
+#if defined(TOYWASM_USE_INSN_FUSION)
+        STAT_PRINT(fused_insn);
+#endif
 #if defined(TOYWASM_USE_SMALL_CELLS)
         STAT_PRINT(type_annotation_lookup1);
         STAT_PRINT(type_annotation_lookup2);
@@ -53,6 +66,9 @@ exec_context_print_stats(struct exec_context *ctx)
         STAT_PRINT(interrupt_suspend);
 #if defined(TOYWASM_USE_USER_SCHED)
         STAT_PRINT(interrupt_usched);
+#endif
+#if defined(TOYWASM_USE_MN_SCHED)
+        STAT_PRINT(interrupt_mnsched);
 #endif
         STAT_PRINT(interrupt_user);
         STAT_PRINT(interrupt_debug);
@@ -63,6 +79,10 @@ exec_context_print_stats(struct exec_context *ctx)
 #endif
 #if defined(TOYWASM_ENABLE_WASM_THREADS)
         STAT_PRINT(atomic_wait_restart);
+        STAT_PRINT(atomic_lock_contended);
+#if defined(TOYWASM_USE_MN_SCHED)
+        STAT_PRINT(atomic_wait_park);
+#endif
 #endif
 #if defined(TOYWASM_ENABLE_WASM_EXCEPTION_HANDLING)
         STAT_PRINT(exception);
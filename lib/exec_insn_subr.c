@@ -1,20 +1,24 @@
 #include <assert.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "bitmap.h"
 #include "exec.h"
+#include "instance.h"
 #include "leb128.h"
 #include "mem.h"
+#include "mnsched.h"
 #include "platform.h"
 #include "restart.h"
 #include "shared_memory_impl.h"
 #include "suspend.h"
 #include "timeutil.h"
 #include "type.h"
+#include "usched.h"
 #include "util.h"
 #include "xlog.h"
 
@@ -40,13 +44,40 @@ trap_with_id(struct exec_context *ctx, enum trapid id, const char *fmt, ...)
         return ret;
 }
 
+/*
+ * meminst->allocated is only updated while other threads can be
+ * accessing the memory for a reserved shared memory. (see memory_grow)
+ * its meminst->data never moves and the pages are committed before
+ * allocated is updated. thus a relaxed load is enough here.
+ * a stale value only makes us take the slow path.
+ */
+static size_t
+meminst_allocated(struct meminst *mi)
+{
+#if defined(TOYWASM_ENABLE_WASM_THREADS)
+        return atomic_load_explicit(&mi->allocated, memory_order_relaxed);
+#else
+        return mi->allocated;
+#endif
+}
+
+static void
+meminst_set_allocated(struct meminst *mi, size_t allocated)
+{
+#if defined(TOYWASM_ENABLE_WASM_THREADS)
+        atomic_store_explicit(&mi->allocated, allocated, memory_order_release);
+#else
+        mi->allocated = allocated;
+#endif
+}
+
 int
 memory_instance_getptr2(struct meminst *meminst, uint32_t ptr, uint32_t offset,
                         uint32_t size, void **pp, bool *movedp)
 {
-        assert(meminst->allocated <=
-               (uint64_t)meminst->size_in_pages
-                       << memtype_page_shift(meminst->type));
+        const size_t allocated = meminst_allocated(meminst);
+        assert(allocated <= (uint64_t)meminst->size_in_pages
+                                     << memtype_page_shift(meminst->type));
         uint32_t ea;
         if (ADD_U32_OVERFLOW(ptr, offset, &ea)) {
                 /*
@@ -72,15 +103,26 @@ memory_instance_getptr2(struct meminst *meminst, uint32_t ptr, uint32_t offset,
         if (ADD_U32_OVERFLOW(ea, size - 1, &last_byte)) {
                 goto do_trap;
         }
-        if (__predict_false(last_byte >= meminst->allocated)) {
+        if (__predict_false(last_byte >= allocated)) {
                 const uint32_t page_shift = memtype_page_shift(meminst->type);
                 uint32_t need_in_pages = (last_byte >> page_shift) + 1;
                 if (need_in_pages > meminst->size_in_pages) {
 do_trap:
                         return ETOYWASMTRAP;
                 }
+#if defined(TOYWASM_USE_RESERVED_MEMORY)
+                if (meminst->reserved != 0) {
+                        /*
+                         * a reserved shared memory being grown by
+                         * another thread. memory_grow commits the pages
+                         * before updating size_in_pages, which we have
+                         * checked above.
+                         */
+                        goto success;
+                }
+#endif
                 /*
-                 * Note: shared memories do never come here because
+                 * Note: other shared memories do never come here because
                  * we handle their growth in memory_grow.
                  */
                 assert((meminst->type->flags & MEMTYPE_FLAG_SHARED) == 0);
@@ -90,21 +132,20 @@ do_trap:
                 }
 #endif
                 size_t need = (size_t)last_byte + 1;
-                assert(need > meminst->allocated);
+                assert(need > allocated);
                 void *np = mem_extend(meminst->mctx, meminst->data,
-                                      meminst->allocated, need);
+                                      allocated, need);
                 if (np == NULL) {
                         return ENOMEM;
                 }
                 meminst->data = np;
-                xlog_trace_insn("extend memory from %zu to %zu",
-                                meminst->allocated, need);
+                xlog_trace_insn("extend memory from %zu to %zu", allocated,
+                                need);
                 if (movedp != NULL) {
                         *movedp = true;
                 }
-                memset(meminst->data + meminst->allocated, 0,
-                       need - meminst->allocated);
-                meminst->allocated = need;
+                memset(meminst->data + allocated, 0, need - allocated);
+                meminst_set_allocated(meminst, need);
         }
 success:
         xlog_trace_insn("memory access: at %08" PRIx32 " + %08" PRIx32
@@ -157,7 +198,10 @@ memory_atomic_getptr(struct exec_context *ctx, uint32_t memidx, uint32_t ptr,
         struct toywasm_mutex *lock = NULL;
         if (shared != NULL && lockp != NULL) {
                 lock = atomics_mutex_getptr(&shared->tab, ptr + offset);
-                toywasm_mutex_lock(lock);
+                if (!toywasm_mutex_trylock(lock)) {
+                        STAT_INC(ctx, atomic_lock_contended);
+                        toywasm_mutex_lock(lock);
+                }
         }
         int ret;
         ret = memory_getptr(ctx, memidx, ptr, offset, size, pp);
@@ -268,6 +312,7 @@ table_init(struct exec_context *ectx, uint32_t tableidx, uint32_t elemidx,
         assert(t->type->et == elem->type);
         uint32_t csz = valtype_cellsize(t->type->et);
         uint32_t i;
+        table_bump_gen(t);
         for (i = 0; i < n; i++) {
                 struct val val;
                 if (elem->funcs != NULL) {
@@ -290,11 +335,28 @@ fail:
         return ret;
 }
 
+/*
+ * table_bump_gen: give the table a new generation.
+ *
+ * the generations are taken from a process-wide counter, rather than
+ * counted per table, so that they are never reused, even by a table
+ * allocated at the address of a destroyed one. otherwise, a cache
+ * entry for the old table could match the new one.
+ */
+void
+table_bump_gen(struct tableinst *t)
+{
+        static _Atomic uint64_t table_gen;
+        t->gen = atomic_fetch_add_explicit(&table_gen, 1,
+                                           memory_order_relaxed) + 1;
+}
+
 void
 table_set(struct tableinst *tinst, uint32_t elemidx, const struct val *val)
 {
         uint32_t csz = valtype_cellsize(tinst->type->et);
         val_to_cells(val, &tinst->cells[elemidx * csz], csz);
+        table_bump_gen(tinst);
 }
 
 void
@@ -329,7 +391,9 @@ table_get_func(struct exec_context *ectx, const struct tableinst *t,
                 goto fail;
         }
         const struct functype *actual_ft = funcinst_functype(func);
-        if (__predict_false(compare_functype(ft, actual_ft))) {
+        /* usually the canonical ids are enough. see functype_set_id */
+        if (__predict_false((ft->id != actual_ft->id || ft->id == 0) &&
+                            compare_functype(ft, actual_ft))) {
                 ret = trap_with_id(
                         ectx, TRAP_CALL_INDIRECT_FUNCTYPE_MISMATCH,
                         "call_indirect (functype mismatch) %" PRIu32, i);
@@ -382,6 +446,7 @@ table_grow(struct tableinst *t, const struct val *val, uint32_t n)
         }
         uint32_t oldsize = t->size;
         t->size = newsize;
+        table_bump_gen(t);
         return oldsize;
 }
 
@@ -432,9 +497,13 @@ memory_grow_impl(struct exec_context *ctx, struct meminst *mi, uint32_t sz)
          * For shared memory,
          * - mi->size_in_bytes is updated only with memory_lock held.
          *   also, it's _Atomic to allow fetches w/o the lock held.
-         * - actual memory accesses including load/store instructions and
-         *   host functions will be suspended with suspend_threads.
-         *   mi->allocated is protected with the same mechanism.
+         * - for a reserved memory, mi->data never moves. we commit
+         *   the pages in place and then publish the new size.
+         *   memory accesses in other threads can continue.
+         * - otherwise, actual memory accesses including load/store
+         *   instructions and host functions will be suspended with
+         *   suspend_threads. mi->allocated is protected with the same
+         *   mechanism.
          */
         memory_lock(mi);
         uint32_t orig_size;
@@ -455,6 +524,33 @@ retry:
         }
         xlog_trace("memory grow %" PRIu32 " -> %" PRIu32, mi->size_in_pages,
                    new_size);
+#if defined(TOYWASM_USE_RESERVED_MEMORY)
+        if (mi->reserved != 0) {
+                /*
+                 * commit the pages in place. the memory never moves.
+                 *
+                 * Note: memory_getptr2 in other threads can see
+                 * the new size_in_pages before the new allocated.
+                 * it's ok as the pages have already been committed.
+                 */
+                size_t new_size_in_bytes = (size_t)new_size << page_shift;
+                assert(new_size_in_bytes <= mi->reserved);
+                if (new_size != orig_size) {
+                        int ret = mem_vm_commit(mi->mctx, mi->data,
+                                                mi->allocated,
+                                                new_size_in_bytes);
+                        if (ret != 0) {
+                                memory_unlock(mi);
+                                xlog_trace("%s: commit failed", __func__);
+                                return (uint32_t)-1; /* fail */
+                        }
+                }
+                mi->size_in_pages = new_size;
+                meminst_set_allocated(mi, new_size_in_bytes);
+                memory_unlock(mi);
+                return orig_size; /* success */
+        }
+#endif
         bool do_realloc = new_size != orig_size;
 #if defined(TOYWASM_ENABLE_WASM_THREADS)
         const bool shared = mi->shared != NULL;
@@ -510,7 +606,7 @@ retry:
                                 ret = 0;
                                 mi->data = np;
                                 assert(new_size_in_bytes > mi->allocated);
-                                mi->allocated = new_size_in_bytes;
+                                meminst_set_allocated(mi, new_size_in_bytes);
                         }
                 }
 #if defined(TOYWASM_ENABLE_WASM_THREADS)
@@ -627,6 +723,33 @@ memory_wait(struct exec_context *ctx, uint32_t memidx, uint32_t addr,
                 return ret;
         }
         assert((lock == NULL) == (shared == NULL));
+#if defined(TOYWASM_USE_MN_SCHED)
+        struct mnsched_thread *t = ctx->mnsched_thread;
+        if (t != NULL && t->waiting) {
+                /*
+                 * we are resuming after mnsched_park.
+                 * either we have been notified, our timeout has expired,
+                 * or it's just a periodic wakeup to check interrupts.
+                 */
+                if (mnsched_unpark(t, &shared->tab, addr + offset)) {
+                        *resultp = 0; /* ok */
+                        ret = 0;
+                        goto fail;
+                }
+                if (abstimeout != NULL) {
+                        struct timespec now;
+                        ret = timespec_now(CLOCK_REALTIME, &now);
+                        if (ret != 0) {
+                                goto fail;
+                        }
+                        if (timespec_cmp(abstimeout, &now) <= 0) {
+                                *resultp = 2; /* timed out */
+                                ret = 0;
+                                goto fail;
+                        }
+                }
+        }
+#endif
 #if !defined(FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION)
 retry:;
 #endif
@@ -672,6 +795,33 @@ retry:;
                         xlog_trace("%s: next %ju.%09lu\n", __func__,
                                    (uintmax_t)tv->tv_sec, tv->tv_nsec);
                 }
+#if defined(TOYWASM_USE_MN_SCHED)
+                if (t != NULL) {
+                        /*
+                         * park the thread instead of blocking the
+                         * host thread.
+                         */
+                        ret = mnsched_park(t, &shared->tab, addr + offset,
+                                           tv);
+                        if (ret == 0) {
+                                STAT_INC(ctx, atomic_wait_park);
+                                ret = ETOYWASMRESTART;
+                        }
+                        goto fail;
+                }
+#endif
+#if defined(TOYWASM_USE_USER_SCHED)
+                if (ctx->sched != NULL &&
+                    sched_wait_events(ctx->sched, tv)) {
+                        /*
+                         * atomics_wait would just sleep as no other
+                         * threads can run meanwhile. instead, we waited
+                         * for the threads blocked on i/o. yield to them.
+                         */
+                        ret = ETOYWASMRESTART;
+                        goto fail;
+                }
+#endif
                 ret = atomics_wait(&shared->tab, addr + offset, tv);
                 if (ret == 0) {
                         *resultp = 0; /* ok */
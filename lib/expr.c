@@ -19,6 +19,56 @@
 #include "validation.h"
 #include "xlog.h"
 
+#if defined(TOYWASM_USE_JUMP_HASH)
+/*
+ * build a hash table on top of the jump table so that the execution
+ * logic can find the jump table entry for a block without searching.
+ */
+int
+build_jump_hash(struct mem_context *mctx, struct expr_exec_info *ei)
+{
+        assert(ei->jumps != NULL);
+        assert(ei->njumps > 0);
+        assert(ei->jump_hash == NULL);
+        /*
+         * keep the load factor <= 0.5.
+         *
+         * Note: "else" entries, whose pc is the block pc + 1, are not
+         * in the hash table. they are always next to the corresponding
+         * "if" entries.
+         */
+        uint32_t bits = 1;
+        while (bits < 31 && ((uint64_t)1 << bits) < (uint64_t)ei->njumps * 2) {
+                bits++;
+        }
+        size_t nslots = (size_t)1 << bits;
+        uint32_t *hash = mem_alloc(mctx, nslots * sizeof(*hash));
+        if (hash == NULL) {
+                return ENOMEM;
+        }
+        size_t i;
+        for (i = 0; i < nslots; i++) {
+                hash[i] = JUMP_HASH_EMPTY;
+        }
+        const uint32_t mask = (uint32_t)nslots - 1;
+        uint32_t j;
+        for (j = 0; j < ei->njumps; j++) {
+                const uint32_t pc = ei->jumps[j].pc;
+                if (j > 0 && ei->jumps[j - 1].pc + 1 == pc) {
+                        continue; /* "else" */
+                }
+                uint32_t h = JUMP_HASH(pc, bits);
+                while (hash[h] != JUMP_HASH_EMPTY) {
+                        h = (h + 1) & mask;
+                }
+                hash[h] = j;
+        }
+        ei->jump_hash = hash;
+        ei->jump_hash_bits = bits;
+        return 0;
+}
+#endif
+
 static int
 read_expr_common(const uint8_t **pp, const uint8_t *ep, struct expr *expr,
                  uint32_t nlocals, const struct localchunk *locals,
@@ -112,6 +162,14 @@ read_expr_common(const uint8_t **pp, const uint8_t *ep, struct expr *expr,
                         break;
                 }
         }
+#if defined(TOYWASM_USE_JUMP_HASH)
+        if (ei->jumps != NULL) {
+                ret = build_jump_hash(mctx, ei);
+                if (ret != 0) {
+                        goto fail;
+                }
+        }
+#endif
 #if defined(TOYWASM_ENABLE_TRACING_INSN)
         for (i = 0; i < ei->njumps; i++) {
                 const struct jump *j = &ei->jumps[i];
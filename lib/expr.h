@@ -3,6 +3,7 @@
 #include "valtype.h"
 
 struct expr;
+struct expr_exec_info;
 struct resulttype;
 struct localchunk;
 struct load_context;
@@ -18,5 +19,6 @@ int read_expr(const uint8_t **pp, const uint8_t *ep, struct expr *expr,
               uint32_t nlocals, const struct localchunk *localchunks,
               struct resulttype *, struct resulttype *,
               struct load_context *lctx);
+int build_jump_hash(struct mem_context *mctx, struct expr_exec_info *ei);
 int read_const_expr(const uint8_t **pp, const uint8_t *ep, struct expr *expr,
                     enum valtype type, struct load_context *lctx);
@@ -1,7 +1,12 @@
+#define _DEFAULT_SOURCE /* mkstemp, fsync, fdopen */
+
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #if defined(_WIN32)
 #include <io.h>
@@ -17,6 +22,7 @@ typedef int ssize_t;
 #endif
 
 #include "fileio.h"
+#include "mem.h"
 #include "xlog.h"
 
 /*
@@ -161,3 +167,106 @@ unmap_file(void *p, size_t sz)
 }
 
 #endif
+
+int
+file_writer_open(struct mem_context *mctx, const char *path,
+                 struct file_writer *fw)
+{
+        static const char suffix[] = ".XXXXXX";
+        int ret;
+
+        fw->fp = NULL;
+        fw->tmppathsz = strlen(path) + sizeof(suffix);
+        fw->tmppath = mem_alloc(mctx, fw->tmppathsz);
+        if (fw->tmppath == NULL) {
+                return ENOMEM;
+        }
+        snprintf(fw->tmppath, fw->tmppathsz, "%s%s", path, suffix);
+#if defined(_WIN32)
+        if (_mktemp_s(fw->tmppath, fw->tmppathsz) != 0) {
+                ret = EEXIST;
+                goto fail;
+        }
+        fw->fp = fopen(fw->tmppath, "wb");
+        if (fw->fp == NULL) {
+                ret = errno;
+                assert(ret != 0);
+                goto fail;
+        }
+#else
+        int fd = mkstemp(fw->tmppath);
+        if (fd == -1) {
+                ret = errno;
+                assert(ret != 0);
+                goto fail;
+        }
+        fw->fp = fdopen(fd, "wb");
+        if (fw->fp == NULL) {
+                ret = errno;
+                assert(ret != 0);
+                close(fd);
+                remove(fw->tmppath);
+                goto fail;
+        }
+#endif
+        xlog_trace("created %s", fw->tmppath);
+        return 0;
+fail:
+        xlog_trace("failed to create a temporary file for %s (error %d)",
+                   path, ret);
+        mem_free(mctx, fw->tmppath, fw->tmppathsz);
+        fw->tmppath = NULL;
+        return ret;
+}
+
+static int
+errno_or_eio(void)
+{
+        if (errno != 0) {
+                return errno;
+        }
+        return EIO;
+}
+
+int
+file_writer_commit(struct mem_context *mctx, struct file_writer *fw,
+                   const char *path)
+{
+        int ret = 0;
+
+        if (fflush(fw->fp) != 0) {
+                ret = errno_or_eio();
+        }
+#if !defined(_WIN32)
+        if (ret == 0 && fsync(fileno(fw->fp)) != 0) {
+                ret = errno_or_eio();
+        }
+#endif
+        if (fclose(fw->fp) != 0 && ret == 0) {
+                ret = errno_or_eio();
+        }
+        fw->fp = NULL;
+        if (ret == 0 && rename(fw->tmppath, path) != 0) {
+                ret = errno_or_eio();
+        }
+        if (ret != 0) {
+                xlog_trace("failed to write %s (error %d)", path, ret);
+                file_writer_abort(mctx, fw);
+                return ret;
+        }
+        mem_free(mctx, fw->tmppath, fw->tmppathsz);
+        fw->tmppath = NULL;
+        return 0;
+}
+
+void
+file_writer_abort(struct mem_context *mctx, struct file_writer *fw)
+{
+        if (fw->fp != NULL) {
+                fclose(fw->fp);
+                fw->fp = NULL;
+        }
+        remove(fw->tmppath);
+        mem_free(mctx, fw->tmppath, fw->tmppathsz);
+        fw->tmppath = NULL;
+}
@@ -1,8 +1,39 @@
+#include <stdio.h>
+
 #include "platform.h"
 
+struct mem_context;
+
+/*
+ * a writer to replace a file atomically.
+ *
+ * file_writer_open creates a uniquely named temporary file next to
+ * the given path. after writing the contents to fw->fp,
+ * file_writer_commit flushes it to the disk and renames it to
+ * the path. readers never see a partially written file, even if they
+ * have the old file mapped. file_writer_abort removes the temporary
+ * file instead.
+ *
+ * either of file_writer_commit or file_writer_abort should be called
+ * after a successful file_writer_open.
+ *
+ * Note: the file is created with mode 0600, as mkstemp does.
+ */
+struct file_writer {
+        FILE *fp;
+        char *tmppath;
+        size_t tmppathsz;
+};
+
 __BEGIN_EXTERN_C
 
 int map_file(const char *filename, void **pp, size_t *szp);
 void unmap_file(void *p, size_t sz);
 
+int file_writer_open(struct mem_context *mctx, const char *path,
+                     struct file_writer *fw);
+int file_writer_commit(struct mem_context *mctx, struct file_writer *fw,
+                       const char *path);
+void file_writer_abort(struct mem_context *mctx, struct file_writer *fw);
+
 __END_EXTERN_C
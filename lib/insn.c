@@ -22,6 +22,7 @@
 #include "leb128.h"
 #include "mem.h"
 #include "platform.h"
+#include "simd_vector.h"
 #include "type.h"
 #include "util.h"
 #include "validation.h"
@@ -211,13 +212,44 @@ local_set(struct exec_context *ctx, uint32_t localidx,
  */
 static int
 get_func_indirect(struct exec_context *ectx, uint32_t tableidx,
-                  uint32_t typeidx, uint32_t i, const struct funcinst **fip)
+                  uint32_t typeidx, uint32_t i, const uint8_t *p,
+                  const struct funcinst **fip)
 {
         const struct instance *inst = ectx->instance;
         const struct module *m = inst->module;
         const struct functype *ft = &m->types[typeidx];
         const struct tableinst *t = VEC_ELEM(inst->tables, tableidx);
+#if TOYWASM_CALL_INDIRECT_CACHE_SIZE > 0
+        /*
+         * the cache is indexed by the call site and the table index.
+         * a polymorphic call site can use multiple entries.
+         *
+         * Note: the entry itself has everything which determines
+         * the result. the call site is merely a hint.
+         */
+        const uint32_t key = ptr2pc(m, p) + i;
+        const uint32_t ncaches = ARRAYCOUNT(ectx->call_indirect_cache);
+        struct call_indirect_cache *cache =
+                &ectx->call_indirect_cache[key % ncaches];
+        if (cache->table == t && cache->gen == t->gen && cache->idx == i &&
+            cache->ft == ft) {
+                STAT_INC(ectx, indirect_cache_hit);
+                *fip = cache->func;
+                return 0;
+        }
+        STAT_INC(ectx, indirect_cache_miss);
+        int ret = table_get_func(ectx, t, i, ft, fip);
+        if (ret == 0) {
+                cache->table = t;
+                cache->gen = t->gen;
+                cache->idx = i;
+                cache->ft = ft;
+                cache->func = *fip;
+        }
+        return ret;
+#else
         return table_get_func(ectx, t, i, ft, fip);
+#endif
 }
 
 /*
@@ -380,7 +412,7 @@ wasm_popcount64(uint64_t v)
         return wasm_popcount((uint32_t)v) + wasm_popcount((uint32_t)(v >> 32));
 }
 
-#if defined(TOYWASM_ENABLE_WASM_SIMD)
+#if defined(TOYWASM_ENABLE_WASM_SIMD) && !defined(USE_HOST_SIMD)
 /*
  * note on wasm_llneg/wasm_llabs:
  *
@@ -407,7 +439,7 @@ wasm_llabs(int64_t v)
         }
         return v;
 }
-#endif /* defined(TOYWASM_ENABLE_WASM_SIMD) */
+#endif /* defined(TOYWASM_ENABLE_WASM_SIMD) && !defined(USE_HOST_SIMD) */
 
 static int
 get_functype(struct module *m, uint32_t typeidx, struct functype **ftp)
@@ -1042,8 +1074,9 @@ static const size_t instructions_size = ARRAYCOUNT(instructions);
 #undef INSTRUCTION
 #undef INSTRUCTION_INDIRECT
 
-#if defined(TOYWASM_USE_SEPARATE_EXECUTE) &&                                  \
-        defined(TOYWASM_ENABLE_TRACING_INSN)
+#if (defined(TOYWASM_USE_SEPARATE_EXECUTE) &&                                 \
+     defined(TOYWASM_ENABLE_TRACING_INSN)) ||                                 \
+        defined(TOYWASM_ENABLE_PROFILER)
 
 #define INSTRUCTION(CODE, NAME, FUNC, FLAGS)                                  \
         case CODE:                                                            \
@@ -1051,7 +1084,7 @@ static const size_t instructions_size = ARRAYCOUNT(instructions);
 
 #define INSTRUCTION_INDIRECT(CODE, NAME)
 
-static const char *
+const char *
 instruction_name(uint8_t group, uint32_t op)
 {
         switch (group) {
@@ -1094,7 +1127,10 @@ instruction_name(uint8_t group, uint32_t op)
 
 #undef INSTRUCTION
 #undef INSTRUCTION_INDIRECT
+#endif
 
+#if defined(TOYWASM_USE_SEPARATE_EXECUTE) &&                                  \
+        defined(TOYWASM_ENABLE_TRACING_INSN)
 static uint8_t
 exec_instruction_table_to_group(const struct exec_instruction_desc *exec_table)
 {
@@ -2,3 +2,12 @@
 #include <stdint.h>
 
 uint32_t read_insn_nocheck(const uint8_t **pp);
+
+/*
+ * group is the prefix byte (eg. 0xfc) or 0 for instructions without
+ * a prefix.
+ *
+ * available only with TOYWASM_ENABLE_TRACING_INSN or
+ * TOYWASM_ENABLE_PROFILER.
+ */
+const char *instruction_name(uint8_t group, uint32_t op);
@@ -88,6 +88,23 @@ INSN_IMPL(local_get)
                 uint32_t csz;
                 local_get(ectx, localidx, STACK, &csz);
                 STACK_ADJ(csz);
+#if defined(TOYWASM_USE_INSN_FUSION)
+                /*
+                 * execute a run of consecutive local.get without
+                 * going through the dispatch for each of them.
+                 * (eg. "local.get 0; local.get 1; i32.add")
+                 *
+                 * it's safe to peek the next opcode because
+                 * a validated function body always ends with "end".
+                 */
+                while (*p == 0x20) {
+                        p++;
+                        localidx = read_leb_u32_nocheck(&p);
+                        local_get(ectx, localidx, STACK, &csz);
+                        STACK_ADJ(csz);
+                        STAT_INC(ectx, fused_insn);
+                }
+#endif
         } else if (VALIDATING) {
                 struct val val_c;
                 CHECK(localidx < VCTX->locals.lsize);
@@ -340,7 +357,73 @@ LOADOP(i64_load16_u, 16, 64, (uint64_t)(uint16_t))
 LOADOP(i64_load32_s, 32, 64, (int64_t)(int32_t))
 LOADOP(i64_load32_u, 32, 64, (uint64_t)(uint32_t))
 
+#if defined(TOYWASM_USE_INSN_FUSION)
+/*
+ * fuse "i32.const c; OP" where OP is a binary operation which never
+ * traps. it saves a dispatch and a push/pop pair.
+ *
+ * each fused pair has its own code here. a generic implementation,
+ * which switches on the opcode again, would eat most of the benefit.
+ * only the operations frequently used with a constant operand
+ * (eg. "local.get; i32.const 1; i32.add; local.set") are listed.
+ *
+ * it's safe to peek the next opcode because a validated function
+ * body always ends with "end".
+ */
+#define FUSE_I32_CONST_BINOP(OPCODE, EXPR)                                    \
+        case OPCODE: {                                                        \
+                struct val val_a;                                             \
+                pop_val(&val_a, 1, ECTX);                                     \
+                const uint32_t a = val_a.u.i32;                               \
+                const uint32_t b = (uint32_t)v;                               \
+                val_c.u.i32 = (EXPR);                                         \
+                p++;                                                          \
+                STAT_INC(ECTX, fused_insn);                                   \
+                break;                                                        \
+        }
+
+INSN_IMPL(i32_const)
+{
+        int ret;
+        LOAD_PC;
+        READ_LEB_I32(v);
+        struct val val_c;
+        if (EXECUTING) {
+                switch (*p) {
+                FUSE_I32_CONST_BINOP(0x46, a == b)       /* i32.eq */
+                FUSE_I32_CONST_BINOP(0x47, a != b)       /* i32.ne */
+                FUSE_I32_CONST_BINOP(0x48, (int32_t)a < (int32_t)b) /* lt_s */
+                FUSE_I32_CONST_BINOP(0x49, a < b)        /* i32.lt_u */
+                FUSE_I32_CONST_BINOP(0x4a, (int32_t)a > (int32_t)b) /* gt_s */
+                FUSE_I32_CONST_BINOP(0x4b, a > b)        /* i32.gt_u */
+                FUSE_I32_CONST_BINOP(0x4c, (int32_t)a <= (int32_t)b) /* le_s */
+                FUSE_I32_CONST_BINOP(0x4d, a <= b)       /* i32.le_u */
+                FUSE_I32_CONST_BINOP(0x4e, (int32_t)a >= (int32_t)b) /* ge_s */
+                FUSE_I32_CONST_BINOP(0x4f, a >= b)       /* i32.ge_u */
+                FUSE_I32_CONST_BINOP(0x6a, a + b)        /* i32.add */
+                FUSE_I32_CONST_BINOP(0x6b, a - b)        /* i32.sub */
+                FUSE_I32_CONST_BINOP(0x6c, a * b)        /* i32.mul */
+                FUSE_I32_CONST_BINOP(0x71, a & b)        /* i32.and */
+                FUSE_I32_CONST_BINOP(0x72, a | b)        /* i32.or */
+                FUSE_I32_CONST_BINOP(0x73, a ^ b)        /* i32.xor */
+                FUSE_I32_CONST_BINOP(0x74, a << (b % 32)) /* i32.shl */
+                FUSE_I32_CONST_BINOP(0x76, a >> (b % 32)) /* i32.shr_u */
+                default:
+                        val_c.u.i32 = v;
+                        break;
+                }
+        }
+        PUSH_VAL(TYPE_i32, c);
+        SAVE_PC;
+        INSN_SUCCESS;
+fail:
+        INSN_FAIL;
+}
+
+#undef FUSE_I32_CONST_BINOP
+#else
 CONSTOP(i32_const, 32, i32)
+#endif
 CONSTOP(i64_const, 64, i64)
 CONSTOP_F(f32_const, 32, f32)
 CONSTOP_F(f64_const, 64, f64)
@@ -458,7 +458,18 @@ INSN_IMPL(call)
         CHECK(funcidx < m->nimportedfuncs + m->nfuncs);
         if (EXECUTING) {
                 struct exec_context *ectx = ECTX;
-                schedule_call(ectx, VEC_ELEM(ectx->instance->funcs, funcidx));
+                const struct funcinst *func =
+                        VEC_ELEM(ectx->instance->funcs, funcidx);
+#if defined(TOYWASM_USE_INLINE_CALL)
+                SAVE_STACK_PTR;
+                ectx->p = p;
+                if (__predict_true(exec_call_inline(ectx, func))) {
+                        RELOAD_PC;
+                        LOAD_STACK_PTR;
+                        INSN_SUCCESS;
+                }
+#endif
+                schedule_call(ectx, func);
         } else if (VALIDATING) {
                 struct validation_context *vctx = VCTX;
                 const struct functype *ft = module_functype(m, funcidx);
@@ -495,10 +506,20 @@ INSN_IMPL(call_indirect)
 #if defined(__GNUC__) && !defined(__clang__)
                 func = NULL;
 #endif
-                ret = get_func_indirect(ectx, tableidx, typeidx, i, &func);
+                ret = get_func_indirect(ectx, tableidx, typeidx, i, p,
+                                        &func);
                 if (__predict_false(ret != 0)) {
                         goto fail;
                 }
+#if defined(TOYWASM_USE_INLINE_CALL)
+                SAVE_STACK_PTR;
+                ectx->p = p;
+                if (__predict_true(exec_call_inline(ectx, func))) {
+                        RELOAD_PC;
+                        LOAD_STACK_PTR;
+                        INSN_SUCCESS;
+                }
+#endif
                 schedule_call(ectx, func);
         } else if (VALIDATING) {
                 struct validation_context *vctx = VCTX;
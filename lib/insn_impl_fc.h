@@ -199,11 +199,11 @@ INSN_IMPL(table_copy)
                 if (ret != 0) {
                         goto fail;
                 }
-                const struct tableinst *t_dst =
-                        VEC_ELEM(inst->tables, tableidx_dst);
+                struct tableinst *t_dst = VEC_ELEM(inst->tables, tableidx_dst);
                 const struct tableinst *t_src =
                         VEC_ELEM(inst->tables, tableidx_src);
                 assert(t_src->type->et == t_dst->type->et);
+                table_bump_gen(t_dst);
                 uint32_t csz = valtype_cellsize(t_src->type->et);
                 cells_move(&t_dst->cells[d * csz], &t_src->cells[s * csz],
                            n * csz);
@@ -282,6 +282,7 @@ INSN_IMPL(table_fill)
                 uint32_t end = start + n;
                 uint32_t i;
                 uint32_t csz = valtype_cellsize(t->type->et);
+                table_bump_gen(t);
                 for (i = start; i < end; i++) {
                         val_to_cells(&val_val, &t->cells[i * csz], csz);
                 }
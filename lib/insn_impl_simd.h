@@ -3,12 +3,14 @@
  *
  * https://github.com/WebAssembly/simd
  *
- * this is a dumb pure C implementation, mainly for portability reasons.
+ * the base is a dumb pure C implementation, mainly for portability reasons.
  *
- * if performance matters, it's probably better to use vector instrinsics
- * available on host:
- * https://gcc.gnu.org/onlinedocs/gcc/Vector-Extensions.html
- * https://clang.llvm.org/docs/LanguageExtensions.html#vectors-and-extended-vectors
+ * when USE_HOST_SIMD is defined (see simd_vector.h), many of
+ * the instructions are implemented with the vector extensions of
+ * the host C compiler instead. the pure C versions are kept as
+ * the fallback, next to the vector versions.
+ *
+ * see also:
  * https://github.com/simd-everywhere/simde
  */
 
@@ -58,6 +60,44 @@
 #define GET_LANE(I_OR_F, LS, a, I)                                            \
         le##I_OR_F##LS##_decode(&LANEPTR##I_OR_F##LS(a)[I])
 
+#if defined(USE_HOST_SIMD)
+/*
+ * T - vector type suffix. (see simd_vector.h)
+ * a, b, c - struct val *
+ */
+#define VLOAD(T, a) ((simd_##T)simd_load(LANEPTRi128(a)))
+#define VSTORE(a, v) simd_store(LANEPTRi128(a), (simd_i8)(v))
+
+#define VOP1(T, a, b, OP) VSTORE(a, OP VLOAD(T, b))
+#define VOP2(T, a, b, c, OP) VSTORE(a, VLOAD(T, b) OP VLOAD(T, c))
+
+/*
+ * a = (b CMP c) ? c : b
+ *
+ * T is the type to compare. U is an unsigned integer type with
+ * the same lane size.
+ */
+#define VSELECT(T, U, a, b, c, CMP)                                           \
+        do {                                                                  \
+                const simd_##T _b = VLOAD(T, b);                              \
+                const simd_##T _c = VLOAD(T, c);                              \
+                const simd_##U _m = (simd_##U)(_b CMP _c);                    \
+                VSTORE(a, (_m & (simd_##U)_c) | (~_m & (simd_##U)_b));        \
+        } while (0)
+
+/* sign-extend the lower 16 bits of each lanes of simd_s32 */
+#define VEVEN16(v) ((simd_s32)((simd_i32)(v) << 16) >> 16)
+
+/* clamp the lanes of the vector v (of type T) to [LO, HI] */
+#define VCLAMP(T, v, LO, HI)                                                  \
+        do {                                                                  \
+                simd_##T _m = (simd_##T)((v) < (LO));                         \
+                v = ((v) & ~_m) | (_m & (LO));                                \
+                _m = (simd_##T)((v) > (HI));                                  \
+                v = ((v) & ~_m) | (_m & (HI));                                \
+        } while (0)
+#endif /* defined(USE_HOST_SIMD) */
+
 /*
  * MEM - num of bits in memory
  * STACK_TYPE - type on stack (v128)
@@ -185,7 +225,7 @@ fail:                                                                         \
                 if (EXECUTING) {                                              \
                         uint##LS##_t le;                                      \
                         le##LS##_encode(&le, (uint##LS##_t)val_x.u.i##STACK); \
-                        FOREACH_LANES(LS, &val_v.u.v128, &le, SPLAT1);        \
+                        SPLAT_##LS(&val_v.u.v128, &le);                       \
                 }                                                             \
                 PUSH_VAL(TYPE_v128, v);                                       \
                 SAVE_PC;                                                      \
@@ -403,6 +443,49 @@ fail:                                                                         \
 #define EXTADD1_s(LS, a, b, I) EXTADD1(s, LS, HALF##LS, a, b, I)
 #define EXTADD1_u(LS, a, b, I) EXTADD1(u, LS, HALF##LS, a, b, I)
 
+#if defined(USE_HOST_SIMD)
+/*
+ * a - the destination (128 bits)
+ * b - the source (64 bits)
+ */
+#define VEXTEND(TD, TS, a, b)                                                 \
+        do {                                                                  \
+                simd_##TS _s;                                                 \
+                memcpy(&_s, b, sizeof(_s));                                   \
+                const simd_##TD _d = __builtin_convertvector(_s, simd_##TD);  \
+                simd_store(a, (simd_i8)_d);                                   \
+        } while (0)
+
+#define EXTEND_8x8_s(a, b) VEXTEND(s16, s8x8, a, b)
+#define EXTEND_8x8_u(a, b) VEXTEND(i16, i8x8, a, b)
+#define EXTEND_16x4_s(a, b) VEXTEND(s32, s16x4, a, b)
+#define EXTEND_16x4_u(a, b) VEXTEND(i32, i16x4, a, b)
+#define EXTEND_32x2_s(a, b) VEXTEND(s64, s32x2, a, b)
+#define EXTEND_32x2_u(a, b) VEXTEND(i64, i32x2, a, b)
+
+/*
+ * sum the even and odd half-lanes in the wider lanes.
+ * LS - the lane size of the result
+ */
+#define VEXTADD_s(LS, a, b)                                                   \
+        do {                                                                  \
+                const simd_s##LS _v = (simd_s##LS)simd_load(b);               \
+                const simd_s##LS _even =                                      \
+                        (simd_s##LS)((simd_i##LS)_v << (LS / 2)) >> (LS / 2); \
+                simd_store(a, (simd_i8)(_even + (_v >> (LS / 2))));           \
+        } while (0)
+#define VEXTADD_u(LS, a, b)                                                   \
+        do {                                                                  \
+                const simd_i##LS _v = (simd_i##LS)simd_load(b);               \
+                const simd_i##LS _even = (_v << (LS / 2)) >> (LS / 2);        \
+                simd_store(a, (simd_i8)(_even + (_v >> (LS / 2))));           \
+        } while (0)
+
+#define EXTADD_16x8_s(a, b) VEXTADD_s(16, a, b)
+#define EXTADD_16x8_u(a, b) VEXTADD_u(16, a, b)
+#define EXTADD_32x4_s(a, b) VEXTADD_s(32, a, b)
+#define EXTADD_32x4_u(a, b) VEXTADD_u(32, a, b)
+#else
 #define EXTEND_8x8_s(a, b) FOREACH_LANES(16, a, b, EXTEND1_s)
 #define EXTEND_8x8_u(a, b) FOREACH_LANES(16, a, b, EXTEND1_u)
 #define EXTEND_16x4_s(a, b) FOREACH_LANES(32, a, b, EXTEND1_s)
@@ -414,23 +497,64 @@ fail:                                                                         \
 #define EXTADD_16x8_u(a, b) FOREACH_LANES(16, a, b, EXTADD1_u)
 #define EXTADD_32x4_s(a, b) FOREACH_LANES(32, a, b, EXTADD1_s)
 #define EXTADD_32x4_u(a, b) FOREACH_LANES(32, a, b, EXTADD1_u)
+#endif
 
 #define EXTMUL1_s(LS, a, b, c, I) EXTMUL1(s, LS, HALF##LS, a, b, c, I)
 #define EXTMUL1_u(LS, a, b, c, I) EXTMUL1(u, LS, HALF##LS, a, b, c, I)
 
+#if defined(USE_HOST_SIMD)
+/*
+ * a - the destination (128 bits)
+ * b, c - the sources (64 bits)
+ *
+ * Note: the products never overflow the wider lanes.
+ */
+#define VEXTMUL(TD, TS, a, b, c)                                              \
+        do {                                                                  \
+                simd_##TS _b;                                                 \
+                simd_##TS _c;                                                 \
+                memcpy(&_b, b, sizeof(_b));                                   \
+                memcpy(&_c, c, sizeof(_c));                                   \
+                const simd_##TD _r = __builtin_convertvector(_b, simd_##TD) * \
+                                     __builtin_convertvector(_c, simd_##TD);  \
+                simd_store(a, (simd_i8)_r);                                   \
+        } while (0)
+
+#define EXTMUL_16_s(a, b, c) VEXTMUL(s16, s8x8, a, b, c)
+#define EXTMUL_16_u(a, b, c) VEXTMUL(i16, i8x8, a, b, c)
+#define EXTMUL_32_s(a, b, c) VEXTMUL(s32, s16x4, a, b, c)
+#define EXTMUL_32_u(a, b, c) VEXTMUL(i32, i16x4, a, b, c)
+#define EXTMUL_64_s(a, b, c) VEXTMUL(s64, s32x2, a, b, c)
+#define EXTMUL_64_u(a, b, c) VEXTMUL(i64, i32x2, a, b, c)
+#else
 #define EXTMUL_16_s(a, b, c) FOREACH_LANES3(16, a, b, c, EXTMUL1_s)
 #define EXTMUL_16_u(a, b, c) FOREACH_LANES3(16, a, b, c, EXTMUL1_u)
 #define EXTMUL_32_s(a, b, c) FOREACH_LANES3(32, a, b, c, EXTMUL1_s)
 #define EXTMUL_32_u(a, b, c) FOREACH_LANES3(32, a, b, c, EXTMUL1_u)
 #define EXTMUL_64_s(a, b, c) FOREACH_LANES3(64, a, b, c, EXTMUL1_s)
 #define EXTMUL_64_u(a, b, c) FOREACH_LANES3(64, a, b, c, EXTMUL1_u)
+#endif
 
 #define SPLAT1(LS, D, S, I) COPYBITS##LS(&(D)->i##LS[I], S)
 
+#if defined(USE_HOST_SIMD)
+#define VSPLAT(LS, D, S)                                                      \
+        do {                                                                  \
+                uint##LS##_t _v;                                              \
+                memcpy(&_v, S, sizeof(_v));                                   \
+                simd_store(D, (simd_i8)((simd_i##LS){0} + _v));               \
+        } while (0)
+
+#define SPLAT_8(D, S) VSPLAT(8, D, S)
+#define SPLAT_16(D, S) VSPLAT(16, D, S)
+#define SPLAT_32(D, S) VSPLAT(32, D, S)
+#define SPLAT_64(D, S) VSPLAT(64, D, S)
+#else
 #define SPLAT_8(D, S) FOREACH_LANES(8, D, S, SPLAT1)
 #define SPLAT_16(D, S) FOREACH_LANES(16, D, S, SPLAT1)
 #define SPLAT_32(D, S) FOREACH_LANES(32, D, S, SPLAT1)
 #define SPLAT_64(D, S) FOREACH_LANES(64, D, S, SPLAT1)
+#endif
 
 #define FOREACH_LANES(LS, D, S, OP)                                           \
         do {                                                                  \
@@ -448,6 +572,14 @@ fail:                                                                         \
                 }                                                             \
         } while (0)
 
+#if defined(USE_HOST_SIMD)
+/*
+ * every OP used with SIMD_FOREACH_LANES_OP2 has a vector version,
+ * named VECTOR_##OP, which processes all the lanes at once.
+ */
+#define FOREACH_LANES3_2(I_OR_F, LS, a, b, c, OP)                             \
+        VECTOR_##OP(I_OR_F, LS, a, b, c)
+#else
 #define FOREACH_LANES3_2(I_OR_F, LS, a, b, c, OP)                             \
         do {                                                                  \
                 unsigned int _i;                                              \
@@ -455,6 +587,7 @@ fail:                                                                         \
                         OP(I_OR_F, LS, a, b, c, _i);                          \
                 }                                                             \
         } while (0)
+#endif
 
 #define FOREACH_LANES2_2(I_OR_F, LS, a, b, OP)                                \
         do {                                                                  \
@@ -526,6 +659,29 @@ SIMD_SPLATOP(i64x2_splat, i, 64, 64)
 SIMD_SPLATOP(f32x4_splat, f, 32, 32)
 SIMD_SPLATOP(f64x2_splat, f, 64, 64)
 
+#if defined(USE_HOST_SIMD)
+#define VSHL(LS, a, b, c)                                                     \
+        VSTORE(a, VLOAD(i##LS, b) << (uint##LS##_t)((c)->u.i32 % LS))
+#define VSHR_s(LS, a, b, c)                                                   \
+        VSTORE(a, VLOAD(s##LS, b) >> (int##LS##_t)((c)->u.i32 % LS))
+#define VSHR_u(LS, a, b, c)                                                   \
+        VSTORE(a, VLOAD(i##LS, b) >> (uint##LS##_t)((c)->u.i32 % LS))
+
+#define SHL_8(a, b, c) VSHL(8, a, b, c)
+#define SHL_16(a, b, c) VSHL(16, a, b, c)
+#define SHL_32(a, b, c) VSHL(32, a, b, c)
+#define SHL_64(a, b, c) VSHL(64, a, b, c)
+
+#define SHR_s_8(a, b, c) VSHR_s(8, a, b, c)
+#define SHR_s_16(a, b, c) VSHR_s(16, a, b, c)
+#define SHR_s_32(a, b, c) VSHR_s(32, a, b, c)
+#define SHR_s_64(a, b, c) VSHR_s(64, a, b, c)
+
+#define SHR_u_8(a, b, c) VSHR_u(8, a, b, c)
+#define SHR_u_16(a, b, c) VSHR_u(16, a, b, c)
+#define SHR_u_32(a, b, c) VSHR_u(32, a, b, c)
+#define SHR_u_64(a, b, c) VSHR_u(64, a, b, c)
+#else
 #define SHL1(LS, a, b, c, I)                                                  \
         SET_LANE(i, LS, a, I,                                                 \
                  (uint##LS##_t)(GET_LANE(i, LS, b, I) << ((c)->u.i32 % LS)))
@@ -550,6 +706,7 @@ SIMD_SPLATOP(f64x2_splat, f, 64, 64)
 #define SHR_u_16(a, b, c) FOREACH_LANES3(16, a, b, c, SHR_u1)
 #define SHR_u_32(a, b, c) FOREACH_LANES3(32, a, b, c, SHR_u1)
 #define SHR_u_64(a, b, c) FOREACH_LANES3(64, a, b, c, SHR_u1)
+#endif
 
 SIMD_SHIFTOP(i8x16_shl, SHL_8)
 SIMD_SHIFTOP(i8x16_shr_s, SHR_s_8)
@@ -613,10 +770,23 @@ SIMD_BOOLOP(v128_any_true, 0, V128_ANY_TRUE)
 
 #define ALL_TRUE(LS, a, b, I) a &= (LANEPTRi##LS(b)[I] != 0)
 
+#if defined(USE_HOST_SIMD)
+#define VALL_TRUE(LS, r, v)                                                   \
+        do {                                                                  \
+                const simd_i64 _z = (simd_i64)(VLOAD(i##LS, v) == 0);         \
+                r = (_z[0] | _z[1]) == 0;                                     \
+        } while (0)
+
+#define ALL_TRUE_8x16(r, v) VALL_TRUE(8, r, v)
+#define ALL_TRUE_16x8(r, v) VALL_TRUE(16, r, v)
+#define ALL_TRUE_32x4(r, v) VALL_TRUE(32, r, v)
+#define ALL_TRUE_64x2(r, v) VALL_TRUE(64, r, v)
+#else
 #define ALL_TRUE_8x16(r, v) FOREACH_LANES(8, r, v, ALL_TRUE)
 #define ALL_TRUE_16x8(r, v) FOREACH_LANES(16, r, v, ALL_TRUE)
 #define ALL_TRUE_32x4(r, v) FOREACH_LANES(32, r, v, ALL_TRUE)
 #define ALL_TRUE_64x2(r, v) FOREACH_LANES(64, r, v, ALL_TRUE)
+#endif
 
 SIMD_BOOLOP(i8x16_all_true, 1, ALL_TRUE_8x16)
 SIMD_BOOLOP(i16x8_all_true, 1, ALL_TRUE_16x8)
@@ -626,7 +796,11 @@ SIMD_BOOLOP(i64x2_all_true, 1, ALL_TRUE_64x2)
 #define BITMASK(LS, a, b, I)                                                  \
         a |= (uint32_t)((int##LS##_t)GET_LANE(i, LS, b, I) < 0) << I
 
+#if defined(USE_HOST_SIMD)
+#define BITMASK_8x16(r, v) r = simd_bitmask8(LANEPTRi128(v))
+#else
 #define BITMASK_8x16(r, v) FOREACH_LANES(8, r, v, BITMASK)
+#endif
 #define BITMASK_16x8(r, v) FOREACH_LANES(16, r, v, BITMASK)
 #define BITMASK_32x4(r, v) FOREACH_LANES(32, r, v, BITMASK)
 #define BITMASK_64x2(r, v) FOREACH_LANES(64, r, v, BITMASK)
@@ -655,6 +829,14 @@ SIMD_BOOLOP(i64x2_bitmask, 0, BITMASK_64x2)
                          ? (uint##LS##_t) - 1                                 \
                          : 0)
 
+#if defined(USE_HOST_SIMD)
+#define ADD_8x16(a, b, c) VOP2(i8, a, b, c, +)
+#define ADD_16x8(a, b, c) VOP2(i16, a, b, c, +)
+#define ADD_32x4(a, b, c) VOP2(i32, a, b, c, +)
+#define ADD_64x2(a, b, c) VOP2(i64, a, b, c, +)
+#define FADD_32x4(a, b, c) VOP2(f32, a, b, c, +)
+#define FADD_64x2(a, b, c) VOP2(f64, a, b, c, +)
+#else
 #define ADD1(LS, a, b, c, I) LANE_OP3(i, LS, a, b, c, I, ADD)
 #define FADD1(LS, a, b, c, I) LANE_OP3(f, LS, a, b, c, I, FADD)
 
@@ -664,6 +846,7 @@ SIMD_BOOLOP(i64x2_bitmask, 0, BITMASK_64x2)
 #define ADD_64x2(a, b, c) FOREACH_LANES3(64, a, b, c, ADD1)
 #define FADD_32x4(a, b, c) FOREACH_LANES3(32, a, b, c, FADD1)
 #define FADD_64x2(a, b, c) FOREACH_LANES3(64, a, b, c, FADD1)
+#endif
 
 SIMD_OP2(i8x16_add, ADD_8x16)
 SIMD_OP2(i16x8_add, ADD_16x8)
@@ -672,6 +855,14 @@ SIMD_OP2(i64x2_add, ADD_64x2)
 SIMD_OP2(f32x4_add, FADD_32x4)
 SIMD_OP2(f64x2_add, FADD_64x2)
 
+#if defined(USE_HOST_SIMD)
+#define SUB_8x16(a, b, c) VOP2(i8, a, b, c, -)
+#define SUB_16x8(a, b, c) VOP2(i16, a, b, c, -)
+#define SUB_32x4(a, b, c) VOP2(i32, a, b, c, -)
+#define SUB_64x2(a, b, c) VOP2(i64, a, b, c, -)
+#define FSUB_32x4(a, b, c) VOP2(f32, a, b, c, -)
+#define FSUB_64x2(a, b, c) VOP2(f64, a, b, c, -)
+#else
 #define SUB1(LS, a, b, c, I) LANE_OP3(i, LS, a, b, c, I, SUB)
 #define FSUB1(LS, a, b, c, I) LANE_OP3(f, LS, a, b, c, I, FSUB)
 
@@ -681,6 +872,7 @@ SIMD_OP2(f64x2_add, FADD_64x2)
 #define SUB_64x2(a, b, c) FOREACH_LANES3(64, a, b, c, SUB1)
 #define FSUB_32x4(a, b, c) FOREACH_LANES3(32, a, b, c, FSUB1)
 #define FSUB_64x2(a, b, c) FOREACH_LANES3(64, a, b, c, FSUB1)
+#endif
 
 SIMD_OP2(i8x16_sub, SUB_8x16)
 SIMD_OP2(i16x8_sub, SUB_16x8)
@@ -704,6 +896,62 @@ SIMD_OP2(f64x2_sub, FSUB_64x2)
 #define SUB_SAT_s(N, a, b) SAT_s(N, (int##N##_t)a - (int##N##_t)b)
 #define SUB_SAT_u(N, a, b) SAT_u(N, (uint##N##_t)a - (uint##N##_t)b)
 
+#if defined(USE_HOST_SIMD)
+/*
+ * the computation is done with unsigned lanes.
+ *
+ * unsigned: the result wraps around iff it's smaller (larger for
+ * sub) than the first operand.
+ *
+ * signed: the result overflows iff its sign differs from the signs of
+ * both operands. (for sub, the operands have different signs and
+ * the sign of the result differs from the first operand.)
+ * the saturated value is INT_MIN for a negative first operand,
+ * INT_MAX otherwise.
+ */
+#define VADD_SAT_u(LS, a, b, c)                                               \
+        do {                                                                  \
+                const simd_i##LS _b = VLOAD(i##LS, b);                        \
+                const simd_i##LS _r = _b + VLOAD(i##LS, c);                   \
+                VSTORE(a, _r | (simd_i##LS)(_r < _b));                        \
+        } while (0)
+#define VSUB_SAT_u(LS, a, b, c)                                               \
+        do {                                                                  \
+                const simd_i##LS _b = VLOAD(i##LS, b);                        \
+                const simd_i##LS _r = _b - VLOAD(i##LS, c);                   \
+                VSTORE(a, _r & ~(simd_i##LS)(_r > _b));                       \
+        } while (0)
+#define VSAT_s(LS, a, b, r, OVF)                                              \
+        do {                                                                  \
+                const simd_i##LS _m = (simd_i##LS)((simd_s##LS)(OVF) < 0);    \
+                const simd_i##LS _sat =                                       \
+                        ((b) >> (LS - 1)) + (uint##LS##_t)INT##LS##_MAX;      \
+                VSTORE(a, ((r) & ~_m) | (_sat & _m));                         \
+        } while (0)
+#define VADD_SAT_s(LS, a, b, c)                                               \
+        do {                                                                  \
+                const simd_i##LS _b = VLOAD(i##LS, b);                        \
+                const simd_i##LS _c = VLOAD(i##LS, c);                        \
+                const simd_i##LS _r = _b + _c;                                \
+                VSAT_s(LS, a, _b, _r, (_b ^ _r) & (_c ^ _r));                 \
+        } while (0)
+#define VSUB_SAT_s(LS, a, b, c)                                               \
+        do {                                                                  \
+                const simd_i##LS _b = VLOAD(i##LS, b);                        \
+                const simd_i##LS _c = VLOAD(i##LS, c);                        \
+                const simd_i##LS _r = _b - _c;                                \
+                VSAT_s(LS, a, _b, _r, (_b ^ _c) & (_b ^ _r));                 \
+        } while (0)
+
+#define ADD_SAT_8_s(a, b, c) VADD_SAT_s(8, a, b, c)
+#define ADD_SAT_8_u(a, b, c) VADD_SAT_u(8, a, b, c)
+#define ADD_SAT_16_s(a, b, c) VADD_SAT_s(16, a, b, c)
+#define ADD_SAT_16_u(a, b, c) VADD_SAT_u(16, a, b, c)
+#define SUB_SAT_8_s(a, b, c) VSUB_SAT_s(8, a, b, c)
+#define SUB_SAT_8_u(a, b, c) VSUB_SAT_u(8, a, b, c)
+#define SUB_SAT_16_s(a, b, c) VSUB_SAT_s(16, a, b, c)
+#define SUB_SAT_16_u(a, b, c) VSUB_SAT_u(16, a, b, c)
+#else
 #define ADD_SAT_s1(LS, a, b, c, I) LANE_OP3(i, LS, a, b, c, I, ADD_SAT_s)
 #define ADD_SAT_u1(LS, a, b, c, I) LANE_OP3(i, LS, a, b, c, I, ADD_SAT_u)
 #define SUB_SAT_s1(LS, a, b, c, I) LANE_OP3(i, LS, a, b, c, I, SUB_SAT_s)
@@ -717,6 +965,7 @@ SIMD_OP2(f64x2_sub, FSUB_64x2)
 #define SUB_SAT_8_u(a, b, c) FOREACH_LANES3(8, a, b, c, SUB_SAT_u1)
 #define SUB_SAT_16_s(a, b, c) FOREACH_LANES3(16, a, b, c, SUB_SAT_s1)
 #define SUB_SAT_16_u(a, b, c) FOREACH_LANES3(16, a, b, c, SUB_SAT_u1)
+#endif
 
 SIMD_OP2(i8x16_add_sat_s, ADD_SAT_8_s)
 SIMD_OP2(i16x8_add_sat_s, ADD_SAT_16_s)
@@ -727,6 +976,13 @@ SIMD_OP2(i16x8_add_sat_u, ADD_SAT_16_u)
 SIMD_OP2(i8x16_sub_sat_u, SUB_SAT_8_u)
 SIMD_OP2(i16x8_sub_sat_u, SUB_SAT_16_u)
 
+#if defined(USE_HOST_SIMD)
+#define MUL_16x8(a, b, c) VOP2(i16, a, b, c, *)
+#define MUL_32x4(a, b, c) VOP2(i32, a, b, c, *)
+#define MUL_64x2(a, b, c) VOP2(i64, a, b, c, *)
+#define FMUL_32x4(a, b, c) VOP2(f32, a, b, c, *)
+#define FMUL_64x2(a, b, c) VOP2(f64, a, b, c, *)
+#else
 #define MUL1(LS, a, b, c, I) LANE_OP3(i, LS, a, b, c, I, MUL)
 #define FMUL1(LS, a, b, c, I) LANE_OP3(f, LS, a, b, c, I, FMUL)
 
@@ -735,6 +991,7 @@ SIMD_OP2(i16x8_sub_sat_u, SUB_SAT_16_u)
 #define MUL_64x2(a, b, c) FOREACH_LANES3(64, a, b, c, MUL1)
 #define FMUL_32x4(a, b, c) FOREACH_LANES3(32, a, b, c, FMUL1)
 #define FMUL_64x2(a, b, c) FOREACH_LANES3(64, a, b, c, FMUL1)
+#endif
 
 SIMD_OP2(i16x8_mul, MUL_16x8)
 SIMD_OP2(i32x4_mul, MUL_32x4)
@@ -742,10 +999,15 @@ SIMD_OP2(i64x2_mul, MUL_64x2)
 SIMD_OP2(f32x4_mul, FMUL_32x4)
 SIMD_OP2(f64x2_mul, FMUL_64x2)
 
+#if defined(USE_HOST_SIMD)
+#define FDIV_32x4(a, b, c) VOP2(f32, a, b, c, /)
+#define FDIV_64x2(a, b, c) VOP2(f64, a, b, c, /)
+#else
 #define FDIV1(LS, a, b, c, I) LANE_OP3(f, LS, a, b, c, I, FDIV)
 
 #define FDIV_32x4(a, b, c) FOREACH_LANES3(32, a, b, c, FDIV1)
 #define FDIV_64x2(a, b, c) FOREACH_LANES3(64, a, b, c, FDIV1)
+#endif
 
 SIMD_OP2(f32x4_div, FDIV_32x4)
 SIMD_OP2(f64x2_div, FDIV_64x2)
@@ -758,6 +1020,20 @@ SIMD_OP2(f64x2_div, FDIV_64x2)
 #define MIN_s(N, a, b) (uint##N##_t) MIN((int##N##_t)a, (int##N##_t)b)
 #define MIN_u(N, a, b) MIN((uint##N##_t)a, (uint##N##_t)b)
 
+#if defined(USE_HOST_SIMD)
+#define MAX_s_8x16(a, b, c) VSELECT(s8, i8, a, b, c, <)
+#define MAX_s_16x8(a, b, c) VSELECT(s16, i16, a, b, c, <)
+#define MAX_s_32x4(a, b, c) VSELECT(s32, i32, a, b, c, <)
+#define MAX_u_8x16(a, b, c) VSELECT(i8, i8, a, b, c, <)
+#define MAX_u_16x8(a, b, c) VSELECT(i16, i16, a, b, c, <)
+#define MAX_u_32x4(a, b, c) VSELECT(i32, i32, a, b, c, <)
+#define MIN_s_8x16(a, b, c) VSELECT(s8, i8, a, b, c, >)
+#define MIN_s_16x8(a, b, c) VSELECT(s16, i16, a, b, c, >)
+#define MIN_s_32x4(a, b, c) VSELECT(s32, i32, a, b, c, >)
+#define MIN_u_8x16(a, b, c) VSELECT(i8, i8, a, b, c, >)
+#define MIN_u_16x8(a, b, c) VSELECT(i16, i16, a, b, c, >)
+#define MIN_u_32x4(a, b, c) VSELECT(i32, i32, a, b, c, >)
+#else
 #define MAX_s1(LS, a, b, c, I) LANE_OP3(i, LS, a, b, c, I, MAX_s)
 #define MAX_u1(LS, a, b, c, I) LANE_OP3(i, LS, a, b, c, I, MAX_u)
 #define MIN_s1(LS, a, b, c, I) LANE_OP3(i, LS, a, b, c, I, MIN_s)
@@ -775,6 +1051,7 @@ SIMD_OP2(f64x2_div, FDIV_64x2)
 #define MIN_u_8x16(a, b, c) FOREACH_LANES3(8, a, b, c, MIN_u1)
 #define MIN_u_16x8(a, b, c) FOREACH_LANES3(16, a, b, c, MIN_u1)
 #define MIN_u_32x4(a, b, c) FOREACH_LANES3(32, a, b, c, MIN_u1)
+#endif
 
 SIMD_OP2(i8x16_max_s, MAX_s_8x16)
 SIMD_OP2(i16x8_max_s, MAX_s_16x8)
@@ -803,10 +1080,17 @@ SIMD_OP2(i32x4_min_u, MIN_u_32x4)
 #define FMAX_64x2(a, b, c) FOREACH_LANES3(64, a, b, c, FMAX1)
 #define FMIN_32x4(a, b, c) FOREACH_LANES3(32, a, b, c, FMINF1)
 #define FMIN_64x2(a, b, c) FOREACH_LANES3(64, a, b, c, FMIN1)
+#if defined(USE_HOST_SIMD)
+#define FPMAX_32x4(a, b, c) VSELECT(f32, i32, a, b, c, <)
+#define FPMAX_64x2(a, b, c) VSELECT(f64, i64, a, b, c, <)
+#define FPMIN_32x4(a, b, c) VSELECT(f32, i32, a, b, c, >)
+#define FPMIN_64x2(a, b, c) VSELECT(f64, i64, a, b, c, >)
+#else
 #define FPMAX_32x4(a, b, c) FOREACH_LANES3(32, a, b, c, FPMAX1)
 #define FPMAX_64x2(a, b, c) FOREACH_LANES3(64, a, b, c, FPMAX1)
 #define FPMIN_32x4(a, b, c) FOREACH_LANES3(32, a, b, c, FPMIN1)
 #define FPMIN_64x2(a, b, c) FOREACH_LANES3(64, a, b, c, FPMIN1)
+#endif
 
 SIMD_OP2(f32x4_max, FMAX_32x4)
 SIMD_OP2(f64x2_max, FMAX_64x2)
@@ -832,11 +1116,22 @@ SIMD_OP2(f64x2_pmin, FPMIN_64x2)
 #define FNEG1(LS, a, b, I) LANE_OP2(f, LS, a, b, I, FNEG)
 #define FSQRT1(LS, a, b, I) LANE_OP2(f, LS, a, b, I, FSQRT)
 
+#if defined(USE_HOST_SIMD)
+/* abs and neg only touch the sign bit, even for NaNs */
+#define FABS_32(a, b) VSTORE(a, VLOAD(i32, b) & (uint32_t)INT32_MAX)
+#define FNEG_32(a, b) VSTORE(a, VLOAD(i32, b) ^ ~(uint32_t)INT32_MAX)
+#else
 #define FABS_32(a, b) FOREACH_LANES(32, a, b, FABS1)
 #define FNEG_32(a, b) FOREACH_LANES(32, a, b, FNEG1)
+#endif
 #define FSQRT_32(a, b) FOREACH_LANES(32, a, b, FSQRT1)
+#if defined(USE_HOST_SIMD)
+#define FABS_64(a, b) VSTORE(a, VLOAD(i64, b) & (uint64_t)INT64_MAX)
+#define FNEG_64(a, b) VSTORE(a, VLOAD(i64, b) ^ ~(uint64_t)INT64_MAX)
+#else
 #define FABS_64(a, b) FOREACH_LANES(64, a, b, FABS1)
 #define FNEG_64(a, b) FOREACH_LANES(64, a, b, FNEG1)
+#endif
 #define FSQRT_64(a, b) FOREACH_LANES(64, a, b, FSQRT1)
 
 SIMD_OP1(f32x4_abs, FABS_32)
@@ -858,10 +1153,26 @@ SIMD_OP1(f64x2_sqrt, FSQRT_64)
 #define CONVERT_LOW_u1(LS, a, b, I)                                           \
         lef##LS##_encode(&LANEPTRf##LS(a)[I], le32_decode(&LANEPTRi32(b)[I]))
 
+#if defined(USE_HOST_SIMD)
+#define VCONVERT(TD, TS, a, b)                                                \
+        VSTORE(a, __builtin_convertvector(VLOAD(TS, b), simd_##TD))
+#define VCONVERT_LOW(TD, TS, a, b)                                            \
+        do {                                                                  \
+                simd_##TS _s;                                                 \
+                memcpy(&_s, LANEPTRi128(b), sizeof(_s));                      \
+                VSTORE(a, __builtin_convertvector(_s, simd_##TD));            \
+        } while (0)
+
+#define CONVERT_32_s(a, b) VCONVERT(f32, s32, a, b)
+#define CONVERT_32_u(a, b) VCONVERT(f32, i32, a, b)
+#define CONVERT_LOW_64_s(a, b) VCONVERT_LOW(f64, s32x2, a, b)
+#define CONVERT_LOW_64_u(a, b) VCONVERT_LOW(f64, i32x2, a, b)
+#else
 #define CONVERT_32_s(a, b) FOREACH_LANES(32, a, b, CONVERT_s1)
 #define CONVERT_32_u(a, b) FOREACH_LANES(32, a, b, CONVERT_u1)
 #define CONVERT_LOW_64_s(a, b) FOREACH_LANES(64, a, b, CONVERT_LOW_s1)
 #define CONVERT_LOW_64_u(a, b) FOREACH_LANES(64, a, b, CONVERT_LOW_u1)
+#endif
 
 SIMD_OP1(f32x4_convert_i32x4_s, CONVERT_32_s)
 SIMD_OP1(f32x4_convert_i32x4_u, CONVERT_32_u)
@@ -890,16 +1201,50 @@ SIMD_OP1(f64x2_convert_low_i32x4_u, CONVERT_LOW_64_u)
 #define _NARROW_u1(LS, FROM, a, b, c, I) NARROW1(u, LS, FROM, a, b, c, I)
 #define NARROW_u1(LS, a, b, c, I) _NARROW_u1(LS, DBL##LS, a, b, c, I)
 
+#if defined(USE_HOST_SIMD)
+/*
+ * TS - the source type
+ * TD - the type of the half of the result
+ */
+#define VNARROW(TS, TD, LO, HI, a, b, c)                                      \
+        do {                                                                  \
+                simd_##TS _b = VLOAD(TS, b);                                  \
+                simd_##TS _c = VLOAD(TS, c);                                  \
+                VCLAMP(TS, _b, LO, HI);                                       \
+                VCLAMP(TS, _c, LO, HI);                                       \
+                const simd_##TD _lo = __builtin_convertvector(_b, simd_##TD); \
+                const simd_##TD _hi = __builtin_convertvector(_c, simd_##TD); \
+                memcpy(&LANEPTRi8(a)[0], &_lo, 8);                            \
+                memcpy(&LANEPTRi8(a)[8], &_hi, 8);                            \
+        } while (0)
+
+#define NARROW_8_s(a, b, c) VNARROW(s16, i8x8, INT8_MIN, INT8_MAX, a, b, c)
+#define NARROW_8_u(a, b, c) VNARROW(s16, i8x8, 0, UINT8_MAX, a, b, c)
+#define NARROW_16_s(a, b, c)                                                  \
+        VNARROW(s32, i16x4, INT16_MIN, INT16_MAX, a, b, c)
+#define NARROW_16_u(a, b, c) VNARROW(s32, i16x4, 0, UINT16_MAX, a, b, c)
+#else
 #define NARROW_8_s(a, b, c) FOREACH_LANES3(8, a, b, c, NARROW_s1)
 #define NARROW_8_u(a, b, c) FOREACH_LANES3(8, a, b, c, NARROW_u1)
 #define NARROW_16_s(a, b, c) FOREACH_LANES3(16, a, b, c, NARROW_s1)
 #define NARROW_16_u(a, b, c) FOREACH_LANES3(16, a, b, c, NARROW_u1)
+#endif
 
 SIMD_OP2(i8x16_narrow_i16x8_s, NARROW_8_s)
 SIMD_OP2(i8x16_narrow_i16x8_u, NARROW_8_u)
 SIMD_OP2(i16x8_narrow_i32x4_s, NARROW_16_s)
 SIMD_OP2(i16x8_narrow_i32x4_u, NARROW_16_u)
 
+#if defined(USE_HOST_SIMD)
+#define DEMOTE_32(a, b)                                                       \
+        do {                                                                  \
+                const simd_f32x2 _r =                                         \
+                        __builtin_convertvector(VLOAD(f64, b), simd_f32x2);   \
+                memcpy(&LANEPTRi8(a)[0], &_r, 8);                             \
+                memset(&LANEPTRi8(a)[8], 0, 8);                               \
+        } while (0)
+#define PROMOTE_LOW_64(a, b) VCONVERT_LOW(f64, f32x2, a, b)
+#else
 #define DEMOTE_32(a, b)                                                       \
         SET_LANE(f, 32, a, 0, GET_LANE(f, 64, b, 0));                         \
         SET_LANE(f, 32, a, 1, GET_LANE(f, 64, b, 1));                         \
@@ -908,6 +1253,7 @@ SIMD_OP2(i16x8_narrow_i32x4_u, NARROW_16_u)
 #define PROMOTE_LOW_64(a, b)                                                  \
         SET_LANE(f, 64, a, 0, (double)GET_LANE(f, 32, b, 0));                 \
         SET_LANE(f, 64, a, 1, (double)GET_LANE(f, 32, b, 1))
+#endif
 
 SIMD_OP1(f32x4_demote_f64x2_zero, DEMOTE_32)
 SIMD_OP1(f64x2_promote_low_f32x4, PROMOTE_LOW_64)
@@ -1001,6 +1347,27 @@ SIMD_OP2(i64x2_extmul_high_i32x4_u, EXTMUL_HIGH_64_u)
 #define GE_S(I_OR_F, LS, a, b, c, I)                                          \
         CMP_LANE(I_OR_F, LS, a, b, c, I, (int##LS##_t), >=)
 
+#if defined(USE_HOST_SIMD)
+#define VECTOR_EQ(I_OR_F, LS, a, b, c) VOP2(I_OR_F##LS, a, b, c, ==)
+#define VECTOR_NE(I_OR_F, LS, a, b, c) VOP2(I_OR_F##LS, a, b, c, !=)
+#define VECTOR_LT(I_OR_F, LS, a, b, c) VOP2(I_OR_F##LS, a, b, c, <)
+#define VECTOR_GT(I_OR_F, LS, a, b, c) VOP2(I_OR_F##LS, a, b, c, >)
+#define VECTOR_LE(I_OR_F, LS, a, b, c) VOP2(I_OR_F##LS, a, b, c, <=)
+#define VECTOR_GE(I_OR_F, LS, a, b, c) VOP2(I_OR_F##LS, a, b, c, >=)
+#define VECTOR_LT_S(I_OR_F, LS, a, b, c) VOP2(s##LS, a, b, c, <)
+#define VECTOR_GT_S(I_OR_F, LS, a, b, c) VOP2(s##LS, a, b, c, >)
+#define VECTOR_LE_S(I_OR_F, LS, a, b, c) VOP2(s##LS, a, b, c, <=)
+#define VECTOR_GE_S(I_OR_F, LS, a, b, c) VOP2(s##LS, a, b, c, >=)
+
+/* (a + b + 1) / 2 without overflow */
+#define VECTOR_LANE_AVGR(I_OR_F, LS, a, b, c)                                 \
+        do {                                                                  \
+                const simd_i##LS _b = VLOAD(i##LS, b);                        \
+                const simd_i##LS _c = VLOAD(i##LS, c);                        \
+                VSTORE(a, (_b | _c) - ((_b ^ _c) >> 1));                      \
+        } while (0)
+#endif
+
 #define AVGR(N, a, b) (((a) + (b) + 1) / 2)
 
 #define LANE_AVGR(I_OR_F, LS, a, b, c, I)                                     \
@@ -1097,6 +1464,34 @@ SIMD_FOREACH_LANES_OP1(f64x2_trunc, f, 64, LANE_TRUNC)
 SIMD_FOREACH_LANES_OP1(f64x2_floor, f, 64, LANE_FLOOR)
 SIMD_FOREACH_LANES_OP1(f64x2_nearest, f, 64, LANE_NEAREST)
 
+#if defined(USE_HOST_SIMD)
+/* abs(x) = (x ^ s) - s where s = (x < 0) ? -1 : 0 */
+#define VABS(LS, a, b)                                                        \
+        do {                                                                  \
+                const simd_i##LS _b = VLOAD(i##LS, b);                        \
+                const simd_i##LS _s =                                         \
+                        (simd_i##LS)((simd_s##LS)_b >> (LS - 1));             \
+                VSTORE(a, (_b ^ _s) - _s);                                    \
+        } while (0)
+
+#define ABS_8x16(a, b) VABS(8, a, b)
+#define ABS_16x8(a, b) VABS(16, a, b)
+#define ABS_32x4(a, b) VABS(32, a, b)
+#define ABS_64x2(a, b) VABS(64, a, b)
+#define NEG_8x16(a, b) VOP1(i8, a, b, -)
+#define NEG_16x8(a, b) VOP1(i16, a, b, -)
+#define NEG_32x4(a, b) VOP1(i32, a, b, -)
+#define NEG_64x2(a, b) VOP1(i64, a, b, -)
+
+SIMD_OP1(i8x16_abs, ABS_8x16)
+SIMD_OP1(i8x16_neg, NEG_8x16)
+SIMD_OP1(i16x8_abs, ABS_16x8)
+SIMD_OP1(i16x8_neg, NEG_16x8)
+SIMD_OP1(i32x4_abs, ABS_32x4)
+SIMD_OP1(i32x4_neg, NEG_32x4)
+SIMD_OP1(i64x2_abs, ABS_64x2)
+SIMD_OP1(i64x2_neg, NEG_64x2)
+#else
 SIMD_FOREACH_LANES_OP1(i8x16_abs, i, 8, LANE_ABS)
 SIMD_FOREACH_LANES_OP1(i8x16_neg, i, 8, LANE_NEG)
 SIMD_FOREACH_LANES_OP1(i16x8_abs, i, 16, LANE_ABS)
@@ -1105,14 +1500,39 @@ SIMD_FOREACH_LANES_OP1(i32x4_abs, i, 32, LANE_ABS)
 SIMD_FOREACH_LANES_OP1(i32x4_neg, i, 32, LANE_NEG)
 SIMD_FOREACH_LANES_OP1(i64x2_abs, i, 64, LANE_ABS)
 SIMD_FOREACH_LANES_OP1(i64x2_neg, i, 64, LANE_NEG)
+#endif
 
 #define Q15MULR(N, a, b)                                                      \
         (uint##N##_t) SAT_s(                                                  \
                 N,                                                            \
                 ((EXTEND_s(32, N, a)) * (EXTEND_s(32, N, b)) + 0x4000) >> 15)
 
+#if defined(USE_HOST_SIMD)
+/*
+ * process the even and odd 16-bit lanes separately in 32-bit lanes.
+ * the only case to saturate is 0x8000 * 0x8000, which yields 0x8000.
+ */
+#define VQ15MULR(r, b, c)                                                     \
+        do {                                                                  \
+                r = ((b) * (c) + 0x4000) >> 15;                               \
+                r += (simd_s32)(r == 0x8000);                                 \
+        } while (0)
+
+#define VECTOR_LANE_Q15MULR(I_OR_F, LS, a, b, c)                              \
+        do {                                                                  \
+                const simd_s32 _b = VLOAD(s32, b);                            \
+                const simd_s32 _c = VLOAD(s32, c);                            \
+                simd_s32 _even;                                               \
+                simd_s32 _odd;                                                \
+                VQ15MULR(_even, VEVEN16(_b), VEVEN16(_c));                    \
+                VQ15MULR(_odd, _b >> 16, _c >> 16);                           \
+                VSTORE(a, ((simd_i32)_even & 0xffff) |                        \
+                                  ((simd_i32)_odd << 16));                    \
+        } while (0)
+#else
 #define LANE_Q15MULR(I_OR_F, LS, a, b, c, I)                                  \
         LANE_OP3(I_OR_F, LS, a, b, c, I, Q15MULR)
+#endif
 
 SIMD_FOREACH_LANES_OP2(i16x8_q15mulr_sat_s, i, 16, LANE_Q15MULR)
 
@@ -1128,7 +1548,21 @@ SIMD_FOREACH_LANES_OP2(i16x8_q15mulr_sat_s, i, 16, LANE_Q15MULR)
                                     32, 16,                                   \
                                     le16_decode(&LANEPTRi16(c)[I * 2 + 1]))))
 
+#if defined(USE_HOST_SIMD)
+/*
+ * Note: the sum can overflow only when all the inputs are INT16_MIN.
+ * do the addition with unsigned lanes to get the wrapped result.
+ */
+#define DOT32(a, b, c)                                                        \
+        do {                                                                  \
+                const simd_s32 _b = VLOAD(s32, b);                            \
+                const simd_s32 _c = VLOAD(s32, c);                            \
+                VSTORE(a, (simd_i32)(VEVEN16(_b) * VEVEN16(_c)) +             \
+                                  (simd_i32)((_b >> 16) * (_c >> 16)));       \
+        } while (0)
+#else
 #define DOT32(a, b, c) FOREACH_LANES3(32, a, b, c, DOT32_1)
+#endif
 
 SIMD_OP2(i32x4_dot_i16x8_s, DOT32)
 
@@ -1200,6 +1634,11 @@ SIMD_FOREACH_LANES_OP1(i8x16_popcnt, i, 8, LANE_POPCNT)
                 LANEPTR##I_OR_F##LS(a)[I] = r;                                \
         } while (0)
 
+#if defined(USE_HOST_SIMD)
+#define VECTOR_LANE_SWIZZLE(I_OR_F, LS, a, b, c)                              \
+        simd_swizzle(LANEPTRi128(a), LANEPTRi128(b), LANEPTRi128(c))
+#endif
+
 SIMD_FOREACH_LANES_OP2(i8x16_swizzle, i, 8, LANE_SWIZZLE)
 
 INSN_IMPL(i8x16_shuffle)
@@ -1215,6 +1654,10 @@ INSN_IMPL(i8x16_shuffle)
         POP_VAL(TYPE_v128, a);
         struct val val_c;
         if (EXECUTING) {
+#if defined(USE_HOST_SIMD)
+                simd_shuffle(&val_c.u.v128, &val_a.u.v128, &val_b.u.v128,
+                             lane);
+#else
                 uint8_t *result = val_c.u.v128.i8;
                 const uint8_t *a = val_a.u.v128.i8;
                 const uint8_t *b = val_b.u.v128.i8;
@@ -1226,6 +1669,7 @@ INSN_IMPL(i8x16_shuffle)
                                 result[i] = b[s - 16];
                         }
                 }
+#endif
         }
         PUSH_VAL(TYPE_v128, c);
         SAVE_PC;
@@ -53,7 +53,8 @@ INSN_IMPL(return_call_indirect)
 #if defined(__GNUC__) && !defined(__clang__)
                 func = NULL;
 #endif
-                ret = get_func_indirect(ectx, tableidx, typeidx, i, &func);
+                ret = get_func_indirect(ectx, tableidx, typeidx, i, p,
+                                        &func);
                 if (__predict_false(ret != 0)) {
                         goto fail;
                 }
@@ -157,6 +157,94 @@ check_tagtype(const struct import_object_entry *e, const void *vp)
 }
 #endif
 
+#if defined(TOYWASM_USE_RESERVED_MEMORY)
+/*
+ * reserve the address space for the max possible size of the memory
+ * so that memory.grow never needs to move the memory.
+ *
+ * on failure to reserve the address space, just leave the memory
+ * unreserved. it's handled in the same way as
+ * !defined(TOYWASM_USE_RESERVED_MEMORY).
+ */
+static int
+memory_instance_reserve(struct mem_context *mctx, struct meminst *mp,
+                        const struct memtype *mt)
+{
+        const uint32_t page_shift = memtype_page_shift(mt);
+        uint64_t max_in_bytes = (uint64_t)mt->lim.max << page_shift;
+        uint64_t min_in_bytes = (uint64_t)mt->lim.min << page_shift;
+        int ret;
+        if (max_in_bytes == 0 || max_in_bytes > SIZE_MAX) {
+                return 0;
+        }
+        void *p = mem_vm_reserve((size_t)max_in_bytes);
+        if (p == NULL) {
+                xlog_trace("%s: failed to reserve %" PRIu64 " bytes",
+                           __func__, max_in_bytes);
+                return 0;
+        }
+        ret = mem_vm_commit(mctx, p, 0, (size_t)min_in_bytes);
+        if (ret != 0) {
+                mem_vm_release(mctx, p, (size_t)max_in_bytes, 0);
+                return ret;
+        }
+        mp->data = p;
+        mp->allocated = (size_t)min_in_bytes;
+        mp->reserved = (size_t)max_in_bytes;
+        return 0;
+}
+#endif
+
+static void
+memory_instance_free_data(struct mem_context *mctx, struct meminst *mi)
+{
+#if defined(TOYWASM_USE_RESERVED_MEMORY)
+        if (mi->reserved != 0) {
+                mem_vm_release(mctx, mi->data, mi->reserved, mi->allocated);
+                return;
+        }
+#endif
+        mem_free(mctx, mi->data, mi->allocated);
+}
+
+#if defined(TOYWASM_ENABLE_WASM_THREADS)
+/*
+ * allocate a shared memory which we failed to reserve.
+ * memory.grow on it needs to suspend other threads.
+ */
+static int
+shared_memory_alloc(struct mem_context *mctx, struct meminst *mp,
+                    const struct memtype *mt)
+{
+#if defined(TOYWASM_PREALLOC_SHARED_MEMORY)
+        /*
+         * REVISIT: a lim.max allocation failure below is not fatal.
+         * we can just fall back to a smaller allocation. (we may
+         * need some heuristics to decide the size.)
+         * if the application eventually ends up with growing the
+         * memory up to lim.max, it will probably fail. i guess it's
+         * rare, though.
+         */
+        uint32_t need_in_pages = mt->lim.max;
+#else
+        uint32_t need_in_pages = mt->lim.min;
+#endif /* defined(TOYWASM_PREALLOC_SHARED_MEMORY) */
+        uint32_t page_shift = memtype_page_shift(mt);
+        uint64_t need_in_bytes = (uint64_t)need_in_pages << page_shift;
+        if (need_in_bytes > SIZE_MAX) {
+                return EOVERFLOW;
+        }
+        if (need_in_bytes > 0) {
+                mp->data = mem_zalloc(mctx, (size_t)need_in_bytes);
+                if (mp->data == NULL) {
+                        return ENOMEM;
+                }
+        }
+        mp->allocated = (size_t)need_in_bytes;
+        return 0;
+}
+#endif
+
 int
 memory_instance_create(struct mem_context *mctx, struct meminst **mip,
                        const struct memtype *mt) NO_THREAD_SAFETY_ANALYSIS
@@ -169,44 +257,35 @@ memory_instance_create(struct mem_context *mctx, struct meminst **mip,
                 ret = ENOMEM;
                 goto fail;
         }
+#if defined(TOYWASM_USE_RESERVED_MEMORY)
+        /*
+         * Note: this includes shared memories. as a reserved memory
+         * never moves, memory.grow on it doesn't need to suspend
+         * other threads.
+         */
+        ret = memory_instance_reserve(mctx, mp, mt);
+        if (ret != 0) {
+                mem_free(mctx, mp, sizeof(*mp));
+                goto fail;
+        }
+#endif
 #if defined(TOYWASM_ENABLE_WASM_THREADS)
         if ((mt->flags & MEMTYPE_FLAG_SHARED) != 0) {
-#if defined(TOYWASM_PREALLOC_SHARED_MEMORY)
-                /*
-                 * REVISIT: a lim.max allocation failure below is not fatal.
-                 * we can just fall back to a smaller allocation. (we may
-                 * need some heuristics to decide the size.)
-                 * if the application eventually ends up with growing the
-                 * memory up to lim.max, it will probably fail. i guess it's
-                 * rare, though.
-                 */
-                uint32_t need_in_pages = mt->lim.max;
-#else
-                uint32_t need_in_pages = mt->lim.min;
-#endif /* defined(TOYWASM_PREALLOC_SHARED_MEMORY) */
-                uint32_t page_shift = memtype_page_shift(mt);
-                uint64_t need_in_bytes = need_in_pages << page_shift;
-                if (need_in_bytes > SIZE_MAX) {
-                        ret = EOVERFLOW;
-                        goto fail1;
+                bool reserved = false;
+#if defined(TOYWASM_USE_RESERVED_MEMORY)
+                reserved = mp->reserved != 0;
+#endif
+                if (!reserved) {
+                        ret = shared_memory_alloc(mctx, mp, mt);
+                        if (ret != 0) {
+                                goto fail1;
+                        }
                 }
                 mp->shared = mem_zalloc(mctx, sizeof(*mp->shared));
                 if (mp->shared == NULL) {
                         ret = ENOMEM;
                         goto fail1;
                 }
-                if (need_in_bytes > 0) {
-                        if (need_in_bytes > SIZE_MAX) {
-                                ret = EOVERFLOW;
-                                goto fail2;
-                        }
-                        mp->data = mem_zalloc(mctx, (size_t)need_in_bytes);
-                        if (mp->data == NULL) {
-                                ret = ENOMEM;
-                                goto fail2;
-                        }
-                }
-                mp->allocated = (size_t)need_in_bytes;
                 waiter_list_table_init(&mp->shared->tab);
                 toywasm_mutex_init(&mp->shared->lock);
         }
@@ -217,9 +296,8 @@ memory_instance_create(struct mem_context *mctx, struct meminst **mip,
         *mip = mp;
         return 0;
 #if defined(TOYWASM_ENABLE_WASM_THREADS)
-fail2:
-        mem_free(mctx, mp->shared, sizeof(*mp->shared));
 fail1:
+        memory_instance_free_data(mctx, mp);
         mem_free(mctx, mp, sizeof(*mp));
 #endif
 fail:
@@ -236,11 +314,12 @@ memory_instance_destroy(struct mem_context *mctx, struct meminst *mi)
 #if defined(TOYWASM_ENABLE_WASM_THREADS)
         struct shared_meminst *shared = mi->shared;
         if (shared != NULL) {
+                waiter_list_table_destroy(&shared->tab);
                 toywasm_mutex_destroy(&shared->lock);
                 mem_free(mctx, shared, sizeof(*shared));
         }
 #endif
-        mem_free(mctx, mi->data, mi->allocated);
+        memory_instance_free_data(mctx, mi);
         mem_free(mctx, mi, sizeof(*mi));
 }
 
@@ -308,6 +387,7 @@ table_instance_create(struct mem_context *mctx, struct tableinst **tip,
         }
         tinst->type = tt;
         tinst->mctx = mctx;
+        table_bump_gen(tinst);
         tinst->size = tinst->type->lim.min;
         uint32_t csz = valtype_cellsize(tt->et);
         size_t ncells;
@@ -752,7 +832,13 @@ instance_execute_handle_restart_once(struct exec_context *ctx, int exec_ret)
 #if defined(TOYWASM_USE_USER_SCHED)
                 struct sched *sched = ctx->sched;
                 if (sched != NULL) {
-                        sched_enqueue(sched, ctx);
+                        /*
+                         * a blocked thread is enqueued by sched_wakeup
+                         * when its event happens.
+                         */
+                        if (!ctx->sched_blocked) {
+                                sched_enqueue(sched, ctx);
+                        }
                         sched_run(sched, ctx);
                         ret = ctx->exec_ret;
                 } else
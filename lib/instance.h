@@ -45,6 +45,33 @@ int instance_create_no_init(struct mem_context *mctx, const struct module *m,
                             struct report *report);
 int instance_execute_init(struct exec_context *ctx);
 
+/*
+ * instance_save_snapshot saves the state of the memories, globals
+ * and tables defined by the module into a file. it's expected to be
+ * used right after a successful instance_execute_init.
+ *
+ * instance_restore_snapshot restores the state saved by
+ * instance_save_snapshot into an instance just created with
+ * instance_create_no_init for the same module. it's an alternative
+ * of instance_execute_init. that is, the active element/data segments
+ * and the start function are not executed. where possible, memories
+ * are mapped copy-on-write from the file.
+ *
+ * Note: the state of imported entities and the side effects of
+ * the initialization outside of the instance (eg. host states) are
+ * not saved. it's the caller's responsibility to ensure they are
+ * compatible with the snapshot.
+ *
+ * Note: on a failure, instance_restore_snapshot leaves the instance
+ * in an unspecified state. the instance should be destroyed.
+ *
+ * these functions are available only if toywasm is built with
+ * TOYWASM_ENABLE_SNAPSHOT.
+ */
+int instance_save_snapshot(const struct instance *inst, const char *filename);
+int instance_restore_snapshot(struct instance *inst, const char *filename,
+                              struct report *report);
+
 /*
  * Note: If you have multiple instances linked together
  * with import/export, usually the only safe way to destroy those
@@ -156,6 +183,7 @@ struct tabletype;
 int table_instance_create(struct mem_context *mctx, struct tableinst **tip,
                           const struct tabletype *tt);
 void table_instance_destroy(struct mem_context *mctx, struct tableinst *ti);
+void table_bump_gen(struct tableinst *t);
 void table_set(struct tableinst *tinst, uint32_t elemidx,
                const struct val *val);
 void table_get(struct tableinst *tinst, uint32_t elemidx, struct val *val);
@@ -0,0 +1,289 @@
+#define _GNU_SOURCE /* memfd_create */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "instance.h"
+#include "instance_pool.h"
+#include "instance_state.h"
+#include "mem.h"
+#include "report.h"
+#include "type.h"
+#include "util.h"
+#include "vec.h"
+#include "xlog.h"
+
+#if defined(TOYWASM_USE_RESERVED_MEMORY) && defined(__linux__)
+/*
+ * keep the memory images of the template in a memfd so that we can
+ * map them copy-on-write into new instances and reset them with
+ * mem_vm_discard.
+ */
+#define INSTANCE_POOL_USE_MEMFD
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(TOYWASM_ENABLE_INSTANCE_POOL)
+
+struct instance_pool {
+        struct mem_context *mctx;
+        const struct instance *tmpl;
+        const struct import_object *imports;
+        VEC(, struct instance *) free; /* instances ready for reuse */
+#if defined(INSTANCE_POOL_USE_MEMFD)
+        int fd;
+        uint64_t *offsets; /* the offset in fd for each defined memory */
+#endif
+};
+
+#if defined(INSTANCE_POOL_USE_MEMFD)
+static int
+instance_pool_create_images(struct instance_pool *pool)
+{
+        const struct instance *tmpl = pool->tmpl;
+        const struct module *m = tmpl->module;
+        const size_t pagesize = mem_vm_pagesize();
+        uint64_t off = 0;
+        uint32_t i;
+        int ret;
+
+        pool->offsets = mem_calloc(pool->mctx, m->nmems,
+                                   sizeof(*pool->offsets));
+        if (pool->offsets == NULL) {
+                return ENOMEM;
+        }
+        for (i = 0; i < m->nmems; i++) {
+                const struct meminst *mi =
+                        VEC_ELEM(tmpl->mems, m->nimportedmems + i);
+                pool->offsets[i] = off;
+                off += HOWMANY(meminst_size_in_bytes(mi), pagesize) *
+                       pagesize;
+        }
+        int fd = memfd_create("toywasm-instance-pool", MFD_CLOEXEC);
+        if (fd == -1) {
+                return errno;
+        }
+        if (ftruncate(fd, (off_t)off)) {
+                ret = errno;
+                goto fail;
+        }
+        for (i = 0; i < m->nmems; i++) {
+                const struct meminst *mi =
+                        VEC_ELEM(tmpl->mems, m->nimportedmems + i);
+                /* the rest of the memory is zero */
+                size_t done = 0;
+                while (done < mi->allocated) {
+                        ssize_t n = pwrite(fd, mi->data + done,
+                                           mi->allocated - done,
+                                           (off_t)(pool->offsets[i] + done));
+                        if (n == -1) {
+                                ret = errno;
+                                goto fail;
+                        }
+                        done += n;
+                }
+        }
+        pool->fd = fd;
+        return 0;
+fail:
+        close(fd);
+        return ret;
+}
+#endif
+
+int
+instance_pool_create(struct mem_context *mctx, const struct instance *tmpl,
+                     const struct import_object *imports,
+                     struct instance_pool **poolp)
+{
+        struct instance_pool *pool;
+
+        pool = mem_zalloc(mctx, sizeof(*pool));
+        if (pool == NULL) {
+                return ENOMEM;
+        }
+        pool->mctx = mctx;
+        pool->tmpl = tmpl;
+        pool->imports = imports;
+        VEC_INIT(pool->free);
+#if defined(INSTANCE_POOL_USE_MEMFD)
+        pool->fd = -1;
+        if (tmpl->module->nmems > 0) {
+                int ret = instance_pool_create_images(pool);
+                if (ret != 0) {
+                        instance_pool_destroy(pool);
+                        return ret;
+                }
+        }
+#endif
+        *poolp = pool;
+        return 0;
+}
+
+void
+instance_pool_destroy(struct instance_pool *pool)
+{
+        struct instance **instp;
+        VEC_FOREACH(instp, pool->free) {
+                instance_destroy(*instp);
+        }
+        VEC_FREE(pool->mctx, pool->free);
+#if defined(INSTANCE_POOL_USE_MEMFD)
+        if (pool->fd != -1) {
+                close(pool->fd);
+        }
+        mem_free(pool->mctx, pool->offsets,
+                 pool->tmpl->module->nmems * sizeof(*pool->offsets));
+#endif
+        mem_free(pool->mctx, pool, sizeof(*pool));
+}
+
+static int
+instance_pool_copy_memory(struct instance_pool *pool, uint32_t idx,
+                          const struct meminst *tmi, struct meminst *mi,
+                          bool fresh)
+{
+        const uint64_t len = meminst_size_in_bytes(tmi);
+        int ret;
+
+        ret = memory_resize(mi, tmi->size_in_pages, fresh);
+        if (ret != 0) {
+                return ret;
+        }
+#if defined(INSTANCE_POOL_USE_MEMFD)
+        if (mi->reserved != 0 && len > 0) {
+                if (fresh) {
+                        return mem_vm_map_file(mi->data, len, pool->fd,
+                                               pool->offsets[idx]);
+                }
+                /* revert the dirtied pages to the image */
+                return mem_vm_discard(mi->data, len);
+        }
+#endif
+        size_t n = tmi->allocated;
+        if (n > 0) {
+                void *p;
+                bool moved;
+                /* ensure mi->allocated >= n */
+                ret = memory_instance_getptr2(mi, (uint32_t)(n - 1), 0, 1, &p,
+                                              &moved);
+                if (ret != 0) {
+                        return ret;
+                }
+                memcpy(mi->data, tmi->data, n);
+        }
+        if (!fresh && mi->allocated > n) {
+                memset(mi->data + n, 0, mi->allocated - n);
+        }
+        assert(mi->allocated <= len);
+        return 0;
+}
+
+/*
+ * make the state of the instance same as the template.
+ *
+ * returns EBUSY if it's an instance being recycled and it can't be
+ * reset cheaply.
+ */
+static int
+instance_pool_copy_state(struct instance_pool *pool, struct instance *inst,
+                         bool fresh)
+{
+        const struct instance *tmpl = pool->tmpl;
+        const struct module *m = tmpl->module;
+        uint32_t i;
+        int ret;
+
+        for (i = 0; i < m->nmems; i++) {
+                const struct meminst *tmi =
+                        VEC_ELEM(tmpl->mems, m->nimportedmems + i);
+                struct meminst *mi = VEC_ELEM(inst->mems, m->nimportedmems + i);
+                ret = instance_pool_copy_memory(pool, i, tmi, mi, fresh);
+                if (ret != 0) {
+                        return ret;
+                }
+        }
+        for (i = 0; i < m->ntables; i++) {
+                struct tableinst *tt =
+                        VEC_ELEM(tmpl->tables, m->nimportedtables + i);
+                struct tableinst *t =
+                        VEC_ELEM(inst->tables, m->nimportedtables + i);
+                const enum valtype type = t->type->et;
+                ret = table_resize(t, tt->size, fresh);
+                if (ret != 0) {
+                        return ret;
+                }
+                uint32_t j;
+                for (j = 0; j < tt->size; j++) {
+                        struct val val;
+                        table_get(tt, j, &val);
+                        instance_relocate_val(tmpl, inst, type, &val);
+                        table_set(t, j, &val);
+                }
+        }
+        for (i = 0; i < m->nglobals; i++) {
+                const struct globalinst *tginst =
+                        VEC_ELEM(tmpl->globals, m->nimportedglobals + i);
+                struct globalinst *ginst =
+                        VEC_ELEM(inst->globals, m->nimportedglobals + i);
+                struct val val = tginst->val;
+                instance_relocate_val(tmpl, inst, ginst->type->t, &val);
+                global_set(ginst, &val);
+        }
+        if (m->ndatas > 0) {
+                memcpy(inst->data_dropped.data, tmpl->data_dropped.data,
+                       HOWMANY(m->ndatas, 32) * sizeof(uint32_t));
+        }
+        if (m->nelems > 0) {
+                memcpy(inst->elem_dropped.data, tmpl->elem_dropped.data,
+                       HOWMANY(m->nelems, 32) * sizeof(uint32_t));
+        }
+        return 0;
+}
+
+int
+instance_pool_get(struct instance_pool *pool, struct instance **instp,
+                  struct report *report)
+{
+        struct instance *inst;
+        int ret;
+
+        if (pool->free.lsize > 0) {
+                *instp = *VEC_POP(pool->free);
+                return 0;
+        }
+        ret = instance_create_no_init(pool->mctx, pool->tmpl->module, &inst,
+                                      pool->imports, report);
+        if (ret != 0) {
+                return ret;
+        }
+        ret = instance_pool_copy_state(pool, inst, true);
+        if (ret != 0) {
+                report_error(report, "failed to copy the template: %d", ret);
+                instance_destroy(inst);
+                return ret;
+        }
+        *instp = inst;
+        return 0;
+}
+
+void
+instance_pool_put(struct instance_pool *pool, struct instance *inst)
+{
+        assert(inst->module == pool->tmpl->module);
+        int ret = instance_pool_copy_state(pool, inst, false);
+        if (ret == 0) {
+                ret = VEC_PREALLOC(pool->mctx, pool->free, 1);
+        }
+        if (ret != 0) {
+                xlog_trace("%s: destroying an instance (%d)", __func__, ret);
+                instance_destroy(inst);
+                return;
+        }
+        *VEC_PUSH(pool->free) = inst;
+}
+
+#endif /* defined(TOYWASM_ENABLE_INSTANCE_POOL) */
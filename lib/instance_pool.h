@@ -0,0 +1,54 @@
+#if !defined(_TOYWASM_INSTANCE_POOL_H)
+#define _TOYWASM_INSTANCE_POOL_H
+
+#include "platform.h"
+
+struct import_object;
+struct instance;
+struct instance_pool;
+struct mem_context;
+struct report;
+
+__BEGIN_EXTERN_C
+
+/*
+ * instance pool: a cheap way to create many instances of a module
+ * with the same initial state.
+ *
+ * instance_pool_create takes an initialized instance (eg. by
+ * instance_create) as a template. the template and the imports used
+ * to create it should not be modified or destroyed while the pool
+ * is alive.
+ *
+ * instance_pool_get returns an instance whose memories, globals and
+ * tables are in the same state as the template's. it's either
+ * recycled from the pool or created with instance_create_no_init and
+ * then populated from the template. in the latter case, where possible,
+ * memories are mapped copy-on-write from an image of the template.
+ * the initialization (instance_execute_init) is not executed.
+ *
+ * instance_pool_put returns an instance obtained by instance_pool_get
+ * to the pool. the state of the instance is reset for the next
+ * instance_pool_get. instances which can't be reset cheaply (eg. ones
+ * whose memory has been grown) are destroyed instead.
+ *
+ * Note: like instance snapshots, the state of imported entities is
+ * not reset.
+ *
+ * Note: a pool is not thread-safe.
+ *
+ * these functions are available only if toywasm is built with
+ * TOYWASM_ENABLE_INSTANCE_POOL.
+ */
+int instance_pool_create(struct mem_context *mctx,
+                         const struct instance *tmpl,
+                         const struct import_object *imports,
+                         struct instance_pool **poolp);
+void instance_pool_destroy(struct instance_pool *pool);
+int instance_pool_get(struct instance_pool *pool, struct instance **instp,
+                      struct report *report);
+void instance_pool_put(struct instance_pool *pool, struct instance *inst);
+
+__END_EXTERN_C
+
+#endif /* !defined(_TOYWASM_INSTANCE_POOL_H) */
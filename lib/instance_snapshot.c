@@ -0,0 +1,735 @@
+/*
+ * instance snapshot
+ *
+ * a snapshot is the state of the linear memories, globals and tables
+ * of an instance, typically taken right after instance_execute_init.
+ * by restoring it into another instance of the same module, the
+ * initialization (active element/data segments and the start function)
+ * can be skipped entirely.
+ *
+ * only the entities defined by the module are saved. the state of
+ * imported memories, globals and tables, as well as any host state
+ * the initialization might have changed, is not a part of a snapshot.
+ *
+ * snapshot file format: (all integers are in the host byte order)
+ *
+ *   header:
+ *     u32 magic SNAPSHOT_MAGIC
+ *     u32 version SNAPSHOT_VERSION
+ *     u64 size of the module binary
+ *     u64 fnv1a64 hash of the module binary
+ *     u32 nmems
+ *     u32 nglobals
+ *     u32 ntables
+ *     u32 ndatas
+ *     u32 nelems
+ *
+ *   for each global:
+ *     u32 valtype
+ *     u8 value[SNAPSHOT_VAL_SIZE]
+ *
+ *   for each table:
+ *     u32 reftype
+ *     u32 size
+ *     u32 elements x size
+ *
+ *   data_dropped: u32 x HOWMANY(ndatas, 32)
+ *   elem_dropped: u32 x HOWMANY(nelems, 32)
+ *
+ *   for each memory:
+ *     u32 size in pages
+ *     u32 page shift
+ *     u64 file offset of the image
+ *     u64 size of the image in bytes
+ *
+ *   memory images. each of them starts at a SNAPSHOT_ALIGN boundary
+ *   and is padded to SNAPSHOT_ALIGN so that it can be mapped
+ *   with mmap.
+ *
+ * a reference is encoded as 0 for null and funcidx + 1 for a funcref.
+ * non-null externref is not supported because it's a host pointer.
+ *
+ * the module size and hash are to reject a snapshot taken with
+ * another module, which happens to have the same number of entities.
+ *
+ * a snapshot file is written to a temporary file and then renamed.
+ * (see file_writer) thus it's safe to overwrite a snapshot which
+ * is being restored, or even mapped, by other instances.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bitmap.h"
+#include "fileio.h"
+#include "instance.h"
+#include "instance_state.h"
+#include "mem.h"
+#include "report.h"
+#include "type.h"
+#include "util.h"
+#include "xlog.h"
+
+#if defined(TOYWASM_USE_RESERVED_MEMORY)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(TOYWASM_ENABLE_SNAPSHOT)
+
+#define SNAPSHOT_MAGIC 0x4e535754 /* "TWSN" in little endian */
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_VAL_SIZE 16
+#define SNAPSHOT_ALIGN 65536
+
+struct snapshot_writer {
+        void (*write)(struct snapshot_writer *w, const void *p, size_t sz);
+        FILE *fp;
+        uint64_t size;
+        int error;
+};
+
+static void
+snapshot_count(struct snapshot_writer *w, const void *p, size_t sz)
+{
+        w->size += sz;
+}
+
+static void
+snapshot_write_to_file(struct snapshot_writer *w, const void *p, size_t sz)
+{
+        if (w->error != 0) {
+                return;
+        }
+        if (fwrite(p, sz, 1, w->fp) != 1) {
+                w->error = ferror(w->fp);
+                if (w->error == 0) {
+                        w->error = EIO;
+                }
+                return;
+        }
+        w->size += sz;
+}
+
+static void
+snapshot_write(struct snapshot_writer *w, const void *p, size_t sz)
+{
+        if (sz == 0) {
+                return;
+        }
+        w->write(w, p, sz);
+}
+
+static void
+snapshot_write_u32(struct snapshot_writer *w, uint32_t v)
+{
+        snapshot_write(w, &v, sizeof(v));
+}
+
+static void
+snapshot_write_u64(struct snapshot_writer *w, uint64_t v)
+{
+        snapshot_write(w, &v, sizeof(v));
+}
+
+static void
+snapshot_write_zero(struct snapshot_writer *w, uint64_t sz)
+{
+        static const uint8_t zero[4096];
+        while (sz > 0) {
+                size_t n = sizeof(zero);
+                if (n > sz) {
+                        n = sz;
+                }
+                snapshot_write(w, zero, n);
+                sz -= n;
+        }
+}
+
+static void
+snapshot_set_error(struct snapshot_writer *w, int error)
+{
+        if (w->error == 0) {
+                w->error = error;
+        }
+}
+
+static uint64_t
+snapshot_roundup(uint64_t sz)
+{
+        return HOWMANY(sz, SNAPSHOT_ALIGN) * SNAPSHOT_ALIGN;
+}
+
+static uint64_t
+snapshot_module_hash(const struct module *m)
+{
+        return fnv1a64(FNV1A64_INIT, m->bin, m->binsz);
+}
+
+static int
+encode_ref(const struct instance *inst, enum valtype type,
+           const struct val *val, uint32_t *resultp)
+{
+        switch (type) {
+        case TYPE_funcref:
+                return instance_encode_funcref(inst, val->u.funcref.func,
+                                               resultp);
+        case TYPE_externref:
+                if (val->u.externref == NULL) {
+                        *resultp = 0;
+                        return 0;
+                }
+                break;
+        default:
+                break;
+        }
+        return ENOTSUP;
+}
+
+static int
+encode_val(const struct instance *inst, enum valtype type,
+           const struct val *val, uint8_t buf[SNAPSHOT_VAL_SIZE])
+{
+        uint32_t u32;
+        int ret;
+
+        memset(buf, 0, SNAPSHOT_VAL_SIZE);
+        switch (type) {
+        case TYPE_i32:
+        case TYPE_f32:
+                memcpy(buf, &val->u.i32, sizeof(val->u.i32));
+                break;
+        case TYPE_i64:
+        case TYPE_f64:
+                memcpy(buf, &val->u.i64, sizeof(val->u.i64));
+                break;
+#if defined(TOYWASM_ENABLE_WASM_SIMD)
+        case TYPE_v128:
+                memcpy(buf, &val->u.v128, sizeof(val->u.v128));
+                break;
+#endif
+        default:
+                ret = encode_ref(inst, type, val, &u32);
+                if (ret != 0) {
+                        return ret;
+                }
+                memcpy(buf, &u32, sizeof(u32));
+                break;
+        }
+        return 0;
+}
+
+/*
+ * write everything but memory images.
+ * data_offset is the file offset of the first memory image.
+ */
+static void
+snapshot_write_header(struct snapshot_writer *w, const struct instance *inst,
+                      uint64_t module_hash, uint64_t data_offset)
+{
+        const struct module *m = inst->module;
+        uint32_t i;
+        int ret;
+
+        snapshot_write_u32(w, SNAPSHOT_MAGIC);
+        snapshot_write_u32(w, SNAPSHOT_VERSION);
+        snapshot_write_u64(w, m->binsz);
+        snapshot_write_u64(w, module_hash);
+        snapshot_write_u32(w, m->nmems);
+        snapshot_write_u32(w, m->nglobals);
+        snapshot_write_u32(w, m->ntables);
+        snapshot_write_u32(w, m->ndatas);
+        snapshot_write_u32(w, m->nelems);
+        for (i = 0; i < m->nglobals; i++) {
+                const struct globalinst *ginst =
+                        VEC_ELEM(inst->globals, m->nimportedglobals + i);
+                const enum valtype type = ginst->type->t;
+                uint8_t buf[SNAPSHOT_VAL_SIZE];
+                ret = encode_val(inst, type, &ginst->val, buf);
+                if (ret != 0) {
+                        xlog_trace("global %" PRIu32 " can't be saved",
+                                   m->nimportedglobals + i);
+                        snapshot_set_error(w, ret);
+                }
+                snapshot_write_u32(w, type);
+                snapshot_write(w, buf, sizeof(buf));
+        }
+        for (i = 0; i < m->ntables; i++) {
+                struct tableinst *t =
+                        VEC_ELEM(inst->tables, m->nimportedtables + i);
+                const enum valtype type = t->type->et;
+                snapshot_write_u32(w, type);
+                snapshot_write_u32(w, t->size);
+                uint32_t j;
+                for (j = 0; j < t->size; j++) {
+                        struct val val;
+                        uint32_t u32 = 0;
+                        table_get(t, j, &val);
+                        ret = encode_ref(inst, type, &val, &u32);
+                        if (ret != 0) {
+                                xlog_trace("table %" PRIu32 " elem %" PRIu32
+                                           " can't be saved",
+                                           m->nimportedtables + i, j);
+                                snapshot_set_error(w, ret);
+                        }
+                        snapshot_write_u32(w, u32);
+                }
+        }
+        for (i = 0; i < HOWMANY(m->ndatas, 32); i++) {
+                snapshot_write_u32(w, inst->data_dropped.data[i]);
+        }
+        for (i = 0; i < HOWMANY(m->nelems, 32); i++) {
+                snapshot_write_u32(w, inst->elem_dropped.data[i]);
+        }
+        for (i = 0; i < m->nmems; i++) {
+                const struct meminst *mi =
+                        VEC_ELEM(inst->mems, m->nimportedmems + i);
+                const uint64_t len = meminst_size_in_bytes(mi);
+                snapshot_write_u32(w, mi->size_in_pages);
+                snapshot_write_u32(w, memtype_page_shift(mi->type));
+                snapshot_write_u64(w, data_offset);
+                snapshot_write_u64(w, len);
+                data_offset += snapshot_roundup(len);
+        }
+}
+
+int
+instance_save_snapshot(const struct instance *inst, const char *filename)
+{
+        const struct module *m = inst->module;
+        struct snapshot_writer writer;
+        struct snapshot_writer *w = &writer;
+        struct file_writer fw;
+        uint32_t i;
+        int ret;
+
+        /* calculate the size of the header */
+        const uint64_t module_hash = snapshot_module_hash(m);
+        memset(w, 0, sizeof(*w));
+        w->write = snapshot_count;
+        snapshot_write_header(w, inst, module_hash, 0);
+        if (w->error != 0) {
+                return w->error;
+        }
+        const uint64_t header_size = w->size;
+        const uint64_t data_offset = snapshot_roundup(header_size);
+
+        ret = file_writer_open(inst->mctx, filename, &fw);
+        if (ret != 0) {
+                return ret;
+        }
+        memset(w, 0, sizeof(*w));
+        w->write = snapshot_write_to_file;
+        w->fp = fw.fp;
+        snapshot_write_header(w, inst, module_hash, data_offset);
+        assert(w->error != 0 || w->size == header_size);
+        snapshot_write_zero(w, data_offset - header_size);
+        for (i = 0; i < m->nmems; i++) {
+                const struct meminst *mi =
+                        VEC_ELEM(inst->mems, m->nimportedmems + i);
+                const uint64_t len = meminst_size_in_bytes(mi);
+                /*
+                 * Note: mi->allocated can be smaller than the size of
+                 * the memory. (sub-page allocation) the rest is zero.
+                 */
+                size_t allocated = mi->allocated;
+                if (allocated > len) {
+                        allocated = len;
+                }
+                snapshot_write(w, mi->data, allocated);
+                snapshot_write_zero(w, snapshot_roundup(len) - allocated);
+        }
+        if (w->error != 0) {
+                file_writer_abort(inst->mctx, &fw);
+                return w->error;
+        }
+        return file_writer_commit(inst->mctx, &fw, filename);
+}
+
+struct snapshot_reader {
+        const char *filename;
+        void *buf;
+        size_t bufsize;
+        const uint8_t *p;
+        const uint8_t *ep;
+        struct report *report;
+#if defined(TOYWASM_USE_RESERVED_MEMORY)
+        int fd; /* the file buf is mapped from */
+#endif
+};
+
+#if defined(TOYWASM_USE_RESERVED_MEMORY)
+/*
+ * open the file and map it.
+ *
+ * the fd is kept open to map memory images with mem_vm_map_file.
+ * opening the file by name again would be racy because the file
+ * might have been replaced with another snapshot meanwhile.
+ * (see file_writer)
+ */
+static int
+snapshot_reader_open(struct snapshot_reader *r, const char *filename)
+{
+        struct stat st;
+        int ret;
+
+        r->fd = open(filename, O_RDONLY);
+        if (r->fd == -1) {
+                return errno;
+        }
+        if (fstat(r->fd, &st) == -1) {
+                ret = errno;
+                goto fail;
+        }
+        if ((uintmax_t)st.st_size > SIZE_MAX) {
+                ret = EOVERFLOW;
+                goto fail;
+        }
+        r->bufsize = (size_t)st.st_size;
+        if (r->bufsize == 0) {
+                /* mmap would fail with a confusing error */
+                ret = EINVAL;
+                goto fail;
+        }
+        r->buf = mmap(NULL, r->bufsize, PROT_READ, MAP_SHARED, r->fd, 0);
+        if (r->buf == MAP_FAILED) {
+                ret = errno;
+                goto fail;
+        }
+        return 0;
+fail:
+        close(r->fd);
+        return ret;
+}
+
+static void
+snapshot_reader_close(struct snapshot_reader *r)
+{
+        munmap(r->buf, r->bufsize);
+        close(r->fd);
+}
+#else
+static int
+snapshot_reader_open(struct snapshot_reader *r, const char *filename)
+{
+        return map_file(filename, &r->buf, &r->bufsize);
+}
+
+static void
+snapshot_reader_close(struct snapshot_reader *r)
+{
+        unmap_file(r->buf, r->bufsize);
+}
+#endif
+
+static bool
+snapshot_read(struct snapshot_reader *r, void *vp, size_t sz)
+{
+        if ((size_t)(r->ep - r->p) < sz) {
+                return false;
+        }
+        memcpy(vp, r->p, sz);
+        r->p += sz;
+        return true;
+}
+
+static bool
+snapshot_read_u32(struct snapshot_reader *r, uint32_t *vp)
+{
+        return snapshot_read(r, vp, sizeof(*vp));
+}
+
+static bool
+snapshot_read_u64(struct snapshot_reader *r, uint64_t *vp)
+{
+        return snapshot_read(r, vp, sizeof(*vp));
+}
+
+static int
+decode_ref(const struct instance *inst, enum valtype type, uint32_t u32,
+           struct val *val)
+{
+        memset(val, 0, sizeof(*val));
+        switch (type) {
+        case TYPE_funcref:
+                return instance_decode_funcref(inst, u32,
+                                               &val->u.funcref.func);
+        case TYPE_externref:
+                if (u32 == 0) {
+                        return 0;
+                }
+                break;
+        default:
+                break;
+        }
+        return EINVAL;
+}
+
+static int
+decode_val(const struct instance *inst, enum valtype type,
+           const uint8_t buf[SNAPSHOT_VAL_SIZE], struct val *val)
+{
+        uint32_t u32;
+
+        memset(val, 0, sizeof(*val));
+        switch (type) {
+        case TYPE_i32:
+        case TYPE_f32:
+                memcpy(&val->u.i32, buf, sizeof(val->u.i32));
+                break;
+        case TYPE_i64:
+        case TYPE_f64:
+                memcpy(&val->u.i64, buf, sizeof(val->u.i64));
+                break;
+#if defined(TOYWASM_ENABLE_WASM_SIMD)
+        case TYPE_v128:
+                memcpy(&val->u.v128, buf, sizeof(val->u.v128));
+                break;
+#endif
+        default:
+                memcpy(&u32, buf, sizeof(u32));
+                return decode_ref(inst, type, u32, val);
+        }
+        return 0;
+}
+
+static bool
+is_zero(const uint8_t *p, size_t sz)
+{
+        size_t i;
+        for (i = 0; i < sz; i++) {
+                if (p[i] != 0) {
+                        return false;
+                }
+        }
+        return true;
+}
+
+#if defined(TOYWASM_USE_RESERVED_MEMORY)
+/*
+ * map the image copy-on-write if possible.
+ * returns ENOTSUP if the image should be copied instead.
+ */
+static int
+snapshot_map_memory(struct snapshot_reader *r, struct meminst *mi,
+                    uint64_t off, uint64_t len)
+{
+        const size_t pagesize = mem_vm_pagesize();
+        if (mi->reserved == 0 || len == 0 || (off % pagesize) != 0 ||
+            off + HOWMANY(len, pagesize) * pagesize > r->bufsize) {
+                return ENOTSUP;
+        }
+        assert(((uintptr_t)mi->data % pagesize) == 0);
+        assert(mi->allocated == len);
+        int ret = mem_vm_map_file(mi->data, len, r->fd, off);
+        if (ret == 0) {
+                xlog_trace("mapped %" PRIu64 " bytes from %s at %" PRIu64,
+                           len, r->filename, off);
+                return 0;
+        }
+        if (ret == EFAULT) {
+                report_error(r->report, "failed to map snapshot %s",
+                             r->filename);
+                return ret;
+        }
+        /* the range is intact. fall back to copying. */
+        xlog_trace("failed to map %s (error %d)", r->filename, ret);
+        return ENOTSUP;
+}
+#endif
+
+static int
+snapshot_restore_memory(struct snapshot_reader *r, struct meminst *mi,
+                        uint32_t size_in_pages, uint32_t page_shift,
+                        uint64_t off, uint64_t len)
+{
+        if (page_shift != memtype_page_shift(mi->type) ||
+            len != (uint64_t)size_in_pages << page_shift ||
+            size_in_pages < mi->size_in_pages ||
+            off > r->bufsize || len > r->bufsize - off) {
+                return EINVAL;
+        }
+        int ret;
+        ret = memory_resize(mi, size_in_pages, true);
+        if (ret != 0) {
+                report_error(r->report, "failed to grow memory to %" PRIu32
+                             " pages", size_in_pages);
+                return ret;
+        }
+#if defined(TOYWASM_USE_RESERVED_MEMORY)
+        ret = snapshot_map_memory(r, mi, off, len);
+        if (ret != ENOTSUP) {
+                return ret;
+        }
+#endif
+        /*
+         * copy the image. we can skip zero chunks because
+         * the memory of a new instance is zero-filled.
+         */
+        const uint32_t chunk_size = 65536;
+        const uint8_t *image = (const uint8_t *)r->buf + off;
+        uint64_t done = 0;
+        while (done < len) {
+                uint32_t n = chunk_size;
+                if (n > len - done) {
+                        n = (uint32_t)(len - done);
+                }
+                if (!is_zero(image + done, n)) {
+                        void *p;
+                        bool moved;
+                        ret = memory_instance_getptr2(mi, (uint32_t)done, 0,
+                                                      n, &p, &moved);
+                        if (ret != 0) {
+                                return ret;
+                        }
+                        memcpy(p, image + done, n);
+                }
+                done += n;
+        }
+        return 0;
+}
+
+int
+instance_restore_snapshot(struct instance *inst, const char *filename,
+                          struct report *report)
+{
+        const struct module *m = inst->module;
+        struct snapshot_reader reader;
+        struct snapshot_reader *r = &reader;
+        uint32_t u32[7];
+        uint64_t module_size;
+        uint64_t module_hash;
+        uint32_t i;
+        int ret;
+
+        memset(r, 0, sizeof(*r));
+        ret = snapshot_reader_open(r, filename);
+        if (ret != 0) {
+                report_error(report, "failed to map snapshot %s: %d",
+                             filename, ret);
+                return ret;
+        }
+        r->filename = filename;
+        r->p = r->buf;
+        r->ep = r->p + r->bufsize;
+        r->report = report;
+        if (!snapshot_read_u32(r, &u32[0]) || !snapshot_read_u32(r, &u32[1])) {
+                goto broken;
+        }
+        if (u32[0] != SNAPSHOT_MAGIC || u32[1] != SNAPSHOT_VERSION) {
+                report_error(report,
+                             "snapshot %s has a wrong magic or version",
+                             filename);
+                ret = EINVAL;
+                goto fail;
+        }
+        if (!snapshot_read_u64(r, &module_size) ||
+            !snapshot_read_u64(r, &module_hash)) {
+                goto broken;
+        }
+        for (i = 2; i < ARRAYCOUNT(u32); i++) {
+                if (!snapshot_read_u32(r, &u32[i])) {
+                        goto broken;
+                }
+        }
+        if (module_size != m->binsz ||
+            module_hash != snapshot_module_hash(m) || u32[2] != m->nmems ||
+            u32[3] != m->nglobals || u32[4] != m->ntables ||
+            u32[5] != m->ndatas || u32[6] != m->nelems) {
+                report_error(report, "snapshot %s doesn't match the module",
+                             filename);
+                ret = EINVAL;
+                goto fail;
+        }
+        for (i = 0; i < m->nglobals; i++) {
+                struct globalinst *ginst =
+                        VEC_ELEM(inst->globals, m->nimportedglobals + i);
+                uint8_t val_buf[SNAPSHOT_VAL_SIZE];
+                uint32_t type;
+                struct val val;
+                if (!snapshot_read_u32(r, &type) ||
+                    !snapshot_read(r, val_buf, sizeof(val_buf)) ||
+                    type != ginst->type->t ||
+                    decode_val(inst, type, val_buf, &val) != 0) {
+                        goto broken;
+                }
+                global_set(ginst, &val);
+        }
+        for (i = 0; i < m->ntables; i++) {
+                struct tableinst *t =
+                        VEC_ELEM(inst->tables, m->nimportedtables + i);
+                uint32_t type;
+                uint32_t size;
+                if (!snapshot_read_u32(r, &type) ||
+                    !snapshot_read_u32(r, &size) || type != t->type->et ||
+                    size < t->size ||
+                    (size_t)(r->ep - r->p) / sizeof(uint32_t) < size) {
+                        goto broken;
+                }
+                ret = table_resize(t, size, true);
+                if (ret != 0) {
+                        report_error(report,
+                                     "failed to grow table to %" PRIu32,
+                                     size);
+                        goto fail;
+                }
+                uint32_t j;
+                for (j = 0; j < size; j++) {
+                        struct val val;
+                        uint32_t elem;
+                        if (!snapshot_read_u32(r, &elem) ||
+                            decode_ref(inst, type, elem, &val) != 0) {
+                                goto broken;
+                        }
+                        table_set(t, j, &val);
+                }
+        }
+        for (i = 0; i < HOWMANY(m->ndatas, 32); i++) {
+                if (!snapshot_read_u32(r, &inst->data_dropped.data[i])) {
+                        goto broken;
+                }
+        }
+        for (i = 0; i < HOWMANY(m->nelems, 32); i++) {
+                if (!snapshot_read_u32(r, &inst->elem_dropped.data[i])) {
+                        goto broken;
+                }
+        }
+        for (i = 0; i < m->nmems; i++) {
+                struct meminst *mi = VEC_ELEM(inst->mems, m->nimportedmems + i);
+                uint32_t size_in_pages;
+                uint32_t page_shift;
+                uint64_t off;
+                uint64_t len;
+                if (!snapshot_read_u32(r, &size_in_pages) ||
+                    !snapshot_read_u32(r, &page_shift) ||
+                    !snapshot_read_u64(r, &off) ||
+                    !snapshot_read_u64(r, &len)) {
+                        goto broken;
+                }
+                ret = snapshot_restore_memory(r, mi, size_in_pages,
+                                              page_shift, off, len);
+                if (ret == EINVAL) {
+                        goto broken;
+                }
+                if (ret != 0) {
+                        goto fail;
+                }
+        }
+        xlog_trace("snapshot restored: %s", filename);
+        ret = 0;
+fail:
+        snapshot_reader_close(r);
+        return ret;
+broken:
+        report_error(report, "snapshot %s is broken", filename);
+        ret = EINVAL;
+        goto fail;
+}
+
+#endif /* defined(TOYWASM_ENABLE_SNAPSHOT) */
@@ -0,0 +1,106 @@
+#include <errno.h>
+#include <string.h>
+
+#include "instance.h"
+#include "instance_state.h"
+#include "type.h"
+
+uint64_t
+meminst_size_in_bytes(const struct meminst *mi)
+{
+        return (uint64_t)mi->size_in_pages << memtype_page_shift(mi->type);
+}
+
+static bool
+is_defined_by(const struct funcinst *fi, const struct instance *inst)
+{
+        return !fi->is_host && fi->u.wasm.instance == inst;
+}
+
+int
+instance_encode_funcref(const struct instance *inst,
+                        const struct funcinst *fi, uint32_t *resultp)
+{
+        const struct module *m = inst->module;
+        if (fi == NULL) {
+                *resultp = 0;
+                return 0;
+        }
+        if (is_defined_by(fi, inst)) {
+                *resultp = fi->u.wasm.funcidx + 1;
+                return 0;
+        }
+        uint32_t i;
+        for (i = 0; i < m->nimportedfuncs; i++) {
+                if (VEC_ELEM(inst->funcs, i) == fi) {
+                        *resultp = i + 1;
+                        return 0;
+                }
+        }
+        /* a function which is not reachable from this instance */
+        return ENOTSUP;
+}
+
+int
+instance_decode_funcref(const struct instance *inst, uint32_t u32,
+                        const struct funcinst **fip)
+{
+        const struct module *m = inst->module;
+        if (u32 == 0) {
+                *fip = NULL;
+                return 0;
+        }
+        if (u32 - 1 >= m->nimportedfuncs + m->nfuncs) {
+                return EINVAL;
+        }
+        *fip = VEC_ELEM(inst->funcs, u32 - 1);
+        return 0;
+}
+
+void
+instance_relocate_val(const struct instance *from, const struct instance *to,
+                      enum valtype type, struct val *val)
+{
+        if (type != TYPE_funcref) {
+                return;
+        }
+        const struct funcinst *fi = val->u.funcref.func;
+        if (fi != NULL && is_defined_by(fi, from)) {
+                val->u.funcref.func = VEC_ELEM(to->funcs, fi->u.wasm.funcidx);
+        }
+}
+
+int
+memory_resize(struct meminst *mi, uint32_t size_in_pages, bool may_grow)
+{
+        const uint32_t cur = mi->size_in_pages;
+        if (cur == size_in_pages) {
+                return 0;
+        }
+        if (!may_grow || cur > size_in_pages) {
+                /* we can't shrink a memory */
+                return EBUSY;
+        }
+        if (memory_grow(mi, size_in_pages - cur) == (uint32_t)-1) {
+                return ENOMEM;
+        }
+        return 0;
+}
+
+int
+table_resize(struct tableinst *t, uint32_t size, bool may_grow)
+{
+        const uint32_t cur = t->size;
+        if (cur == size) {
+                return 0;
+        }
+        if (!may_grow || cur > size) {
+                return EBUSY;
+        }
+        struct val val_null;
+        memset(&val_null, 0, sizeof(val_null));
+        if ((uint32_t)table_grow(t, &val_null, size - cur) == (uint32_t)-1) {
+                return ENOMEM;
+        }
+        return 0;
+}
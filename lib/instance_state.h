@@ -0,0 +1,53 @@
+#if !defined(_TOYWASM_INSTANCE_STATE_H)
+#define _TOYWASM_INSTANCE_STATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "platform.h"
+#include "valtype.h"
+
+struct funcinst;
+struct instance;
+struct meminst;
+struct tableinst;
+struct val;
+
+__BEGIN_EXTERN_C
+
+/*
+ * helpers to save and copy the state of the entities defined by
+ * an instance. they are shared by instance snapshots and instance pools.
+ *
+ * meminst_size_in_bytes returns the size of the memory in bytes.
+ *
+ * instance_encode_funcref encodes a funcref as 0 for null and
+ * funcidx + 1 for a function of the instance, including imported ones.
+ * it returns ENOTSUP for a function not reachable from the instance.
+ * instance_decode_funcref does the opposite. it returns EINVAL for
+ * an out of range funcidx.
+ *
+ * instance_relocate_val makes a funcref pointing to a function defined
+ * by the instance "from" point to the corresponding function of
+ * the instance "to", which should be an instance of the same module.
+ * other values, including funcrefs to imported functions, are left
+ * as they are.
+ *
+ * memory_resize and table_resize make the size of the memory or table
+ * the given size. they fail with EBUSY if it requires shrinking,
+ * or growing while may_grow is false.
+ */
+uint64_t meminst_size_in_bytes(const struct meminst *mi);
+int instance_encode_funcref(const struct instance *inst,
+                            const struct funcinst *fi, uint32_t *resultp);
+int instance_decode_funcref(const struct instance *inst, uint32_t u32,
+                            const struct funcinst **fip);
+void instance_relocate_val(const struct instance *from,
+                           const struct instance *to, enum valtype type,
+                           struct val *val);
+int memory_resize(struct meminst *mi, uint32_t size_in_pages, bool may_grow);
+int table_resize(struct tableinst *t, uint32_t size, bool may_grow);
+
+__END_EXTERN_C
+
+#endif /* !defined(_TOYWASM_INSTANCE_STATE_H) */
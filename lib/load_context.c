@@ -1,6 +1,7 @@
 #include <errno.h>
 #include <string.h>
 
+#include "annotation_cache.h"
 #include "context.h"
 #include "load_context.h"
 #include "mem.h"
@@ -25,4 +26,7 @@ load_context_clear(struct load_context *ctx)
                 validation_context_clear(ctx->vctx);
                 mem_free(mctx, ctx->vctx, sizeof(*ctx->vctx));
         }
+#if defined(TOYWASM_ENABLE_ANNOTATION_CACHE)
+        annotation_cache_close(ctx);
+#endif
 }
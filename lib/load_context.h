@@ -6,6 +6,8 @@
 #include "platform.h"
 #include "report.h"
 
+struct annotation_cache;
+
 struct load_context {
         struct module *module;
         struct report report;
@@ -16,6 +18,9 @@ struct load_context {
         struct load_options options;
         struct mem_context *mctx;
         struct validation_context *vctx;
+#if defined(TOYWASM_ENABLE_ANNOTATION_CACHE)
+        struct annotation_cache *acache;
+#endif
 };
 
 #define load_mctx(l) (l)->mctx
@@ -1,6 +1,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <pthread.h>
+#include <stdbool.h>
 
 #include "lock.h"
 
@@ -25,6 +26,14 @@ toywasm_mutex_lock(struct toywasm_mutex *lock) NO_THREAD_SAFETY_ANALYSIS
         assert(ret == 0);
 }
 
+bool
+toywasm_mutex_trylock(struct toywasm_mutex *lock) NO_THREAD_SAFETY_ANALYSIS
+{
+        int ret = pthread_mutex_trylock(&lock->lock);
+        assert(ret == 0 || ret == EBUSY);
+        return ret == 0;
+}
+
 void
 toywasm_mutex_unlock(struct toywasm_mutex *lock) NO_THREAD_SAFETY_ANALYSIS
 {
@@ -1,6 +1,8 @@
 #if !defined(_TOYWASM_LOCK_H)
 #define _TOYWASM_LOCK_H
 
+#include <stdbool.h>
+
 #include "toywasm_config.h"
 
 #include "platform.h"
@@ -31,6 +33,8 @@
 #define REQUIRES(...) _TAS(__attribute__((requires_capability((__VA_ARGS__)))))
 #define EXCLUDES(...) _TAS(__attribute__((locks_excluded((__VA_ARGS__)))))
 #define ACQUIRES(...) _TAS(__attribute__((acquire_capability((__VA_ARGS__)))))
+#define TRY_ACQUIRES(...)                                                     \
+        _TAS(__attribute__((try_acquire_capability(__VA_ARGS__))))
 #define RELEASES(...) _TAS(__attribute__((release_capability((__VA_ARGS__)))))
 #define ASSERT_HELD(l) _TAS(__attribute__((assert_capability(l))))
 #define NO_THREAD_SAFETY_ANALYSIS                                             \
@@ -49,6 +53,8 @@ __BEGIN_EXTERN_C
 void toywasm_mutex_init(struct toywasm_mutex *lock);
 void toywasm_mutex_destroy(struct toywasm_mutex *lock);
 void toywasm_mutex_lock(struct toywasm_mutex *lock) ACQUIRES(lock);
+bool toywasm_mutex_trylock(struct toywasm_mutex *lock)
+        TRY_ACQUIRES(true, lock);
 void toywasm_mutex_unlock(struct toywasm_mutex *lock) RELEASES(lock);
 #define TOYWASM_CV_DEFINE(name) pthread_cond_t name
 void toywasm_cv_init(pthread_cond_t *cv);
@@ -71,6 +77,7 @@ __END_EXTERN_C
 #define toywasm_mutex_init(a)
 #define toywasm_mutex_destroy(a)
 #define toywasm_mutex_lock(a)
+#define toywasm_mutex_trylock(a) true
 #define toywasm_mutex_unlock(a)
 #define TOYWASM_CV_DEFINE(name) ctassert(1)
 #define toywasm_cv_init(a)
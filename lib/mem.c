@@ -1,4 +1,5 @@
 #define _DARWIN_C_SOURCE /* malloc/malloc.h */
+#define _DEFAULT_SOURCE  /* MAP_ANONYMOUS, MAP_NORESERVE, MADV_DONTNEED */
 
 #include <assert.h>
 #include <errno.h>
@@ -6,6 +7,7 @@
 #include <stdatomic.h>
 #endif
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,6 +18,11 @@
 
 #include "mem.h"
 
+#if defined(TOYWASM_USE_RESERVED_MEMORY)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #if __STDC_VERSION__ < 201112L || defined(__STDC_NO_ATOMICS__)
 static size_t
 atomic_fetch_sub(size_t *p, size_t diff)
@@ -35,6 +42,22 @@ atomic_compare_exchange_weak(size_t *p, size_t *ov, size_t nv)
 #endif
 
 #if defined(TOYWASM_ENABLE_HEAP_TRACKING)
+static void
+mem_update_peak(struct mem_context *ctx, size_t nv)
+{
+#if defined(TOYWASM_ENABLE_HEAP_TRACKING_PEAK)
+        size_t opeak;
+        size_t npeak;
+        do {
+                opeak = ctx->peak;
+                if (opeak >= nv) {
+                        break;
+                }
+                npeak = nv;
+        } while (!atomic_compare_exchange_weak(&ctx->peak, &opeak, npeak));
+#endif
+}
+
 static void
 mem_unreserve_one(struct mem_context *ctx, size_t diff)
 {
@@ -57,17 +80,7 @@ mem_reserve_one(struct mem_context *ctx, size_t diff)
                 }
                 nv = ov + diff;
         } while (!atomic_compare_exchange_weak(&ctx->allocated, &ov, nv));
-#if defined(TOYWASM_ENABLE_HEAP_TRACKING_PEAK)
-        size_t opeak;
-        size_t npeak;
-        do {
-                opeak = ctx->peak;
-                if (opeak >= nv) {
-                        break;
-                }
-                npeak = nv;
-        } while (!atomic_compare_exchange_weak(&ctx->peak, &opeak, npeak));
-#endif
+        mem_update_peak(ctx, nv);
         return 0;
 }
 #endif
@@ -112,6 +125,195 @@ assert_malloc_size(void *p, size_t sz)
 #endif
 }
 
+#if defined(TOYWASM_ENABLE_MEM_ARENA)
+/*
+ * the arena mode.
+ *
+ * blocks are carved from chunks. each block has a header with its
+ * capacity so that mem_extend can often extend it in place. when a block
+ * which is not the last one needs to grow, it's moved with a doubled
+ * capacity. it bounds the waste for arrays which are extended one
+ * element at a time. (eg. jump tables built during validation)
+ */
+
+#define ARENA_CHUNK_SIZE ((size_t)64 * 1024)
+
+struct mem_arena_chunk {
+        struct mem_arena_chunk *next;
+        size_t size; /* including the header */
+        size_t used; /* including the header */
+};
+
+union mem_arena_block {
+        size_t capacity; /* excluding the header */
+        max_align_t align;
+};
+
+#define ARENA_ALIGN sizeof(union mem_arena_block)
+ctassert((ARENA_ALIGN & (ARENA_ALIGN - 1)) == 0);
+
+static size_t
+arena_roundup(size_t sz)
+{
+        return (sz + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+static union mem_arena_block *
+arena_block(void *p)
+{
+        return (union mem_arena_block *)p - 1;
+}
+
+static uint8_t *
+arena_chunk_top(const struct mem_arena_chunk *c)
+{
+        return (uint8_t *)c + c->used;
+}
+
+static bool
+arena_is_last(const struct mem_context *ctx, const union mem_arena_block *b)
+{
+        const struct mem_arena_chunk *c = ctx->chunks;
+        return c != NULL &&
+               (const uint8_t *)(b + 1) + b->capacity == arena_chunk_top(c);
+}
+
+static struct mem_arena_chunk *
+arena_chunk_alloc(struct mem_context *ctx, size_t need)
+{
+        const size_t hdrsize = arena_roundup(sizeof(struct mem_arena_chunk));
+        size_t size = hdrsize + need;
+        if (size < ARENA_CHUNK_SIZE) {
+                size = ARENA_CHUNK_SIZE;
+        }
+        if (mem_reserve(ctx, size)) {
+                return NULL;
+        }
+        struct mem_arena_chunk *c = malloc(size);
+        if (c == NULL) {
+                mem_unreserve(ctx, size);
+                return NULL;
+        }
+        c->size = size;
+        c->used = hdrsize;
+        if (need > ARENA_CHUNK_SIZE / 4 && ctx->chunks != NULL) {
+                /* keep using the current chunk for smaller blocks */
+                c->next = ctx->chunks->next;
+                ctx->chunks->next = c;
+        } else {
+                c->next = ctx->chunks;
+                ctx->chunks = c;
+        }
+        return c;
+}
+
+static void *
+arena_alloc(struct mem_context *ctx, size_t sz)
+{
+        if (sz > SIZE_MAX / 2) {
+                return NULL;
+        }
+        const size_t capacity = arena_roundup(sz);
+        const size_t need = sizeof(union mem_arena_block) + capacity;
+        struct mem_arena_chunk *c = ctx->chunks;
+        if (c == NULL || c->size - c->used < need) {
+                c = arena_chunk_alloc(ctx, need);
+                if (c == NULL) {
+                        return NULL;
+                }
+        }
+        union mem_arena_block *b = (void *)arena_chunk_top(c);
+        b->capacity = capacity;
+        c->used += need;
+        return b + 1;
+}
+
+static void
+arena_free(struct mem_context *ctx, void *p)
+{
+        union mem_arena_block *b = arena_block(p);
+        if (arena_is_last(ctx, b)) {
+                ctx->chunks->used -= sizeof(*b) + b->capacity;
+        }
+}
+
+static void *
+arena_extend(struct mem_context *ctx, void *p, size_t oldsz, size_t newsz)
+{
+        if (p == NULL) {
+                return arena_alloc(ctx, newsz);
+        }
+        union mem_arena_block *b = arena_block(p);
+        assert(oldsz <= b->capacity);
+        if (newsz <= b->capacity) {
+                return p;
+        }
+        if (newsz > SIZE_MAX / 2) {
+                return NULL;
+        }
+        const size_t capacity = arena_roundup(newsz);
+        if (arena_is_last(ctx, b)) {
+                struct mem_arena_chunk *c = ctx->chunks;
+                const size_t diff = capacity - b->capacity;
+                if (c->size - c->used >= diff) {
+                        c->used += diff;
+                        b->capacity = capacity;
+                        return p;
+                }
+        }
+        size_t nsz = newsz;
+        if (nsz < b->capacity * 2 && b->capacity <= SIZE_MAX / 4) {
+                nsz = b->capacity * 2;
+        }
+        void *np = arena_alloc(ctx, nsz);
+        if (np == NULL) {
+                return NULL;
+        }
+        memcpy(np, p, oldsz);
+        return np;
+}
+
+static void *
+arena_shrink(struct mem_context *ctx, void *p, size_t newsz)
+{
+        union mem_arena_block *b = arena_block(p);
+        const size_t capacity = arena_roundup(newsz);
+        assert(capacity <= b->capacity);
+        if (arena_is_last(ctx, b)) {
+                ctx->chunks->used -= b->capacity - capacity;
+                b->capacity = capacity;
+        }
+        return p;
+}
+
+static void
+arena_release(struct mem_context *ctx)
+{
+        struct mem_arena_chunk *c = ctx->chunks;
+        while (c != NULL) {
+                struct mem_arena_chunk *next = c->next;
+                size_t size = c->size;
+                free(c);
+                mem_unreserve(ctx, size);
+                c = next;
+        }
+        ctx->chunks = NULL;
+}
+
+void
+mem_context_init_arena(struct mem_context *ctx)
+{
+        mem_context_init(ctx);
+        ctx->arena = true;
+}
+
+bool
+mem_context_is_arena(const struct mem_context *ctx)
+{
+        return ctx->arena;
+}
+#endif /* defined(TOYWASM_ENABLE_MEM_ARENA) */
+
 void
 mem_context_init(struct mem_context *ctx)
 {
@@ -123,14 +325,68 @@ mem_context_init(struct mem_context *ctx)
 #endif
 #endif
         ctx->parent = NULL;
+#if defined(TOYWASM_ENABLE_MEM_ARENA)
+        ctx->arena = false;
+        ctx->chunks = NULL;
+#endif
 }
 
 void
 mem_context_clear(struct mem_context *ctx)
 {
+#if defined(TOYWASM_ENABLE_MEM_ARENA)
+        if (ctx->arena) {
+                arena_release(ctx);
+        }
+#endif
         assert(ctx->allocated == 0);
 }
 
+size_t
+mem_context_available(const struct mem_context *ctx)
+{
+        size_t avail = SIZE_MAX;
+#if defined(TOYWASM_ENABLE_HEAP_TRACKING)
+        for (; ctx != NULL; ctx = ctx->parent) {
+                size_t allocated = ctx->allocated;
+                size_t n = ctx->limit - allocated;
+                if (n < avail) {
+                        avail = n;
+                }
+        }
+#endif
+        return avail;
+}
+
+int
+mem_context_transfer(struct mem_context *dst, struct mem_context *src)
+{
+        assert(src->parent == NULL);
+#if defined(TOYWASM_ENABLE_HEAP_TRACKING)
+        size_t sz = src->allocated;
+        if (sz > 0) {
+                int ret = mem_reserve(dst, sz);
+                if (ret != 0) {
+                        return ret;
+                }
+                mem_unreserve(src, sz);
+        }
+#if defined(TOYWASM_ENABLE_HEAP_TRACKING_PEAK)
+        /*
+         * src might have used more than sz at some point.
+         * account the excess as if it happened now.
+         */
+        size_t excess = src->peak - sz;
+        struct mem_context *c;
+        for (c = dst; c != NULL; c = c->parent) {
+                mem_update_peak(c, c->allocated + excess);
+        }
+        src->peak = 0;
+#endif
+#endif
+        return 0;
+}
+
 int
 mem_context_setlimit(struct mem_context *ctx, size_t limit)
 {
@@ -147,6 +403,11 @@ void *
 mem_alloc(struct mem_context *ctx, size_t sz)
 {
         assert(sz > 0);
+#if defined(TOYWASM_ENABLE_MEM_ARENA)
+        if (ctx->arena) {
+                return arena_alloc(ctx, sz);
+        }
+#endif
         if (mem_reserve(ctx, sz)) {
                 return NULL;
         }
@@ -187,6 +448,12 @@ mem_free(struct mem_context *ctx, void *p, size_t sz)
                 return;
         }
         assert(sz > 0);
+#if defined(TOYWASM_ENABLE_MEM_ARENA)
+        if (ctx->arena) {
+                arena_free(ctx, p);
+                return;
+        }
+#endif
         assert_malloc_size(p, sz);
         free(p);
         mem_unreserve(ctx, sz);
@@ -195,6 +462,13 @@ mem_free(struct mem_context *ctx, void *p, size_t sz)
 void *
 mem_extend(struct mem_context *ctx, void *p, size_t oldsz, size_t newsz)
 {
+#if defined(TOYWASM_ENABLE_MEM_ARENA)
+        if (ctx->arena) {
+                assert((p == NULL) == (oldsz == 0));
+                assert(oldsz < newsz);
+                return arena_extend(ctx, p, oldsz, newsz);
+        }
+#endif
         if (p != NULL) {
                 assert(oldsz > 0);
                 assert_malloc_size(p, oldsz);
@@ -229,6 +503,11 @@ mem_shrink(struct mem_context *ctx, void *p, size_t oldsz, size_t newsz)
 {
         assert(p != NULL);
         assert(oldsz > newsz);
+#if defined(TOYWASM_ENABLE_MEM_ARENA)
+        if (ctx->arena) {
+                return arena_shrink(ctx, p, newsz);
+        }
+#endif
         assert_malloc_size(p, oldsz);
         void *np = realloc(p, newsz);
         if (np == NULL) {
@@ -238,3 +517,133 @@ mem_shrink(struct mem_context *ctx, void *p, size_t oldsz, size_t newsz)
         mem_unreserve(ctx, diff);
         return np;
 }
+
+#if defined(TOYWASM_USE_RESERVED_MEMORY)
+size_t
+mem_vm_pagesize(void)
+{
+        return (size_t)sysconf(_SC_PAGESIZE);
+}
+
+static size_t
+mem_vm_roundup(size_t sz)
+{
+        const size_t pagesize = mem_vm_pagesize();
+        return (sz + pagesize - 1) & ~(pagesize - 1);
+}
+
+/*
+ * mem_vm_reserve: reserve the address space of the given size.
+ *
+ * the reserved range is inaccessible until it's committed with
+ * mem_vm_commit. the committed range is zero-filled and never moves.
+ * only the committed bytes are accounted to the mem_context.
+ */
+void *
+mem_vm_reserve(size_t sz)
+{
+        assert(sz > 0);
+        void *p = mmap(NULL, mem_vm_roundup(sz), PROT_NONE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED) {
+                return NULL;
+        }
+        return p;
+}
+
+int
+mem_vm_commit(struct mem_context *ctx, void *p, size_t oldsz, size_t newsz)
+{
+        assert(p != NULL);
+        assert(oldsz <= newsz);
+        size_t ocommitted = mem_vm_roundup(oldsz);
+        size_t ncommitted = mem_vm_roundup(newsz);
+        if (ocommitted == ncommitted) {
+                return 0;
+        }
+        size_t diff = ncommitted - ocommitted;
+        if (mem_reserve(ctx, diff)) {
+                return ENOMEM;
+        }
+        if (mprotect((uint8_t *)p + ocommitted, diff,
+                     PROT_READ | PROT_WRITE)) {
+                mem_unreserve(ctx, diff);
+                return ENOMEM;
+        }
+        return 0;
+}
+
+/*
+ * mem_vm_map_file: replace the committed range [p, p + sz) with
+ * a copy-on-write mapping of the file.
+ *
+ * p and off should be aligned to the host page size. the pages beyond
+ * sz up to the next host page boundary are mapped from the file as well.
+ * the accounting is not changed because the range is already committed.
+ *
+ * a failed MAP_FIXED mmap might have removed the old mapping.
+ * on a failure, the range is replaced with zero-filled anonymous
+ * memory, so that the caller can fall back to copying the contents.
+ * if even that fails, EFAULT is returned. in that case, the range is
+ * unusable and the memory should be released without touching it.
+ */
+int
+mem_vm_map_file(void *p, size_t sz, int fd, uint64_t off)
+{
+        assert(p != NULL);
+        assert(sz > 0);
+        if (off > (uint64_t)INT64_MAX) {
+                return EOVERFLOW;
+        }
+        const size_t len = mem_vm_roundup(sz);
+        void *np = mmap(p, len, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_FIXED, fd, (off_t)off);
+        if (np == MAP_FAILED) {
+                int ret = errno;
+                assert(ret != EFAULT);
+                np = mmap(p, len, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_FIXED | MAP_ANONYMOUS, -1, 0);
+                if (np == MAP_FAILED) {
+                        return EFAULT;
+                }
+                assert(np == p);
+                return ret;
+        }
+        assert(np == p);
+        return 0;
+}
+
+/*
+ * mem_vm_discard: discard the contents of the committed range [p, p + sz).
+ *
+ * the range stays accessible. anonymous pages become zero-filled.
+ * pages mapped with mem_vm_map_file revert to the contents of the file.
+ */
+int
+mem_vm_discard(void *p, size_t sz)
+{
+        assert(p != NULL);
+        if (sz == 0) {
+                return 0;
+        }
+        if (madvise(p, mem_vm_roundup(sz), MADV_DONTNEED)) {
+                return errno;
+        }
+        return 0;
+}
+
+void
+mem_vm_release(struct mem_context *ctx, void *p, size_t reserved,
+               size_t committed)
+{
+        if (p == NULL) {
+                return;
+        }
+        assert(committed <= reserved);
+        munmap(p, mem_vm_roundup(reserved));
+        size_t diff = mem_vm_roundup(committed);
+        if (diff > 0) {
+                mem_unreserve(ctx, diff);
+        }
+}
+#endif
@@ -1,7 +1,9 @@
 #if !defined(_TOYWASM_MEM_H)
 #define _TOYWASM_MEM_H
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #include "platform.h"
 #include "toywasm_config.h"
@@ -15,13 +17,49 @@ struct mem_context {
         size_t limit;
 #endif
         struct mem_context *parent;
+#if defined(TOYWASM_ENABLE_MEM_ARENA)
+        /* see mem_context_init_arena */
+        bool arena;
+        struct mem_arena_chunk *chunks; /* the current chunk first */
+#endif
 };
 
 __BEGIN_EXTERN_C
 
 void mem_context_init(struct mem_context *ctx);
 void mem_context_clear(struct mem_context *ctx);
+#if defined(TOYWASM_ENABLE_MEM_ARENA)
+/*
+ * mem_context_init_arena: initialize a mem_context in the arena mode.
+ *
+ * in the arena mode, allocations are carved from large chunks.
+ * mem_free is a no-op unless the block is the last one allocated.
+ * everything is released at once by mem_context_clear.
+ * only the chunks are accounted. (thus mem_context_setlimit works
+ * as usual.)
+ *
+ * an arena is not thread-safe.
+ */
+void mem_context_init_arena(struct mem_context *ctx);
+bool mem_context_is_arena(const struct mem_context *ctx);
+#endif
 int __must_check mem_context_setlimit(struct mem_context *ctx, size_t limit);
+
+/*
+ * mem_context_available: the number of bytes which can be allocated
+ * with the context without hitting the limits of the context and
+ * its ancestors.
+ *
+ * mem_context_transfer: move the accounting of the allocations made with
+ * src, which should not have a parent, to dst and its ancestors.
+ * after a successful transfer, the allocations should be freed with dst.
+ * the peak usage of src is moved as well.
+ * it's for a worker thread to allocate with its own context without
+ * contending on the shared counters of dst.
+ */
+size_t mem_context_available(const struct mem_context *ctx);
+int __must_check mem_context_transfer(struct mem_context *dst,
+                                      struct mem_context *src);
 void *__must_check mem_alloc(struct mem_context *ctx, size_t sz) __malloc_like
         __alloc_size(2);
 void *__must_check mem_zalloc(struct mem_context *ctx, size_t sz) __malloc_like
@@ -36,6 +74,17 @@ void *__must_check mem_extend_zero(struct mem_context *ctx, void *p,
 void *__must_check mem_shrink(struct mem_context *ctx, void *p, size_t oldsz,
                               size_t newsz) __malloc_like __alloc_size(4);
 
+#if defined(TOYWASM_USE_RESERVED_MEMORY)
+size_t mem_vm_pagesize(void);
+void *__must_check mem_vm_reserve(size_t sz);
+int __must_check mem_vm_commit(struct mem_context *ctx, void *p,
+                               size_t oldsz, size_t newsz);
+int __must_check mem_vm_map_file(void *p, size_t sz, int fd, uint64_t off);
+int __must_check mem_vm_discard(void *p, size_t sz);
+void mem_vm_release(struct mem_context *ctx, void *p, size_t reserved,
+                    size_t committed);
+#endif
+
 __END_EXTERN_C
 
 #endif /* !defined(_TOYWASM_MEM_H) */
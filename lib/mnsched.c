@@ -0,0 +1,540 @@
+/*
+ * an M:N thread scheduler.
+ *
+ * run many threads (exec_context) on a fixed number of host threads.
+ * (workers)
+ *
+ * - each worker has its own run queue. a thread spawned by another
+ *   thread is queued to the parent's worker. a worker without runnable
+ *   threads steals one from other workers.
+ *
+ * - a thread yields the worker on the restart mechanism.
+ *   (ETOYWASMRESTART) check_interrupt asks the running thread to yield
+ *   when its time slice expired and there are other threads to run.
+ *
+ * - memory.atomic.wait parks the thread instead of blocking the worker.
+ *   atomics_notify requeues it. a parked thread is also requeued when
+ *   its timeout expires so that it can check interrupts.
+ *
+ * locking order:
+ *   waiter_list_bucket::lock -> mnsched::lock -> mnsched_worker::lock
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "cluster.h"
+#include "exec.h"
+#include "instance.h"
+#include "mem.h"
+#include "mnsched.h"
+#include "suspend.h"
+#include "timeutil.h"
+#include "xlog.h"
+
+struct mnsched_worker {
+        TOYWASM_MUTEX_DEFINE(lock);
+        SLIST_HEAD_NAMED(struct mnsched_thread, mnsched_runq) runq;
+        _Atomic uint32_t nqueued;
+
+        struct mnsched *sched;
+        uint32_t idx;
+        pthread_t thread;
+        struct timespec next_resched; /* CLOCK_MONOTONIC */
+};
+
+struct mnsched {
+        TOYWASM_MUTEX_DEFINE(lock);
+        TOYWASM_CV_DEFINE(cv); /* idle workers wait on this */
+        _Atomic uint32_t nidle;
+        _Atomic uint32_t nrunnable;
+        bool shutting_down;
+
+        /* parked threads */
+        LIST_HEAD(struct mnsched_thread) parked;
+        _Atomic uint32_t nparked;
+
+        _Atomic uint32_t next_worker;
+        uint32_t nworkers;
+        struct mnsched_worker *workers;
+        struct mem_context *mctx;
+};
+
+#define MNSCHED_SLICE_MS 50
+
+static void
+runq_insert(struct mnsched_worker *w, struct mnsched_thread *t)
+{
+        toywasm_mutex_lock(&w->lock);
+        SLIST_INSERT_TAIL(&w->runq, t, rq);
+        w->nqueued++;
+        toywasm_mutex_unlock(&w->lock);
+        t->sched->nrunnable++;
+}
+
+static struct mnsched_thread *
+runq_remove(struct mnsched_worker *w)
+{
+        struct mnsched_thread *t;
+        if (w->nqueued == 0) {
+                return NULL;
+        }
+        toywasm_mutex_lock(&w->lock);
+        t = SLIST_FIRST(&w->runq);
+        if (t != NULL) {
+                SLIST_REMOVE_HEAD(&w->runq, t, rq);
+                w->nqueued--;
+        }
+        toywasm_mutex_unlock(&w->lock);
+        if (t != NULL) {
+                w->sched->nrunnable--;
+        }
+        return t;
+}
+
+/*
+ * wake up an idle worker, if any.
+ *
+ * Note: this pairs with the nidle/nrunnable dance in mnsched_idle.
+ */
+static void
+kick_idle_worker(struct mnsched *s)
+{
+        if (s->nidle > 0) {
+                toywasm_mutex_lock(&s->lock);
+                toywasm_cv_signal(&s->cv, &s->lock);
+                toywasm_mutex_unlock(&s->lock);
+        }
+}
+
+static void
+enqueue(struct mnsched_worker *w, struct mnsched_thread *t)
+{
+        xlog_trace("%s: enqueueing thread %p to worker %" PRIu32, __func__,
+                   (void *)t, w->idx);
+        runq_insert(w, t);
+        kick_idle_worker(w->sched);
+}
+
+static void
+park(struct mnsched *s, struct mnsched_thread *t) REQUIRES(s->lock)
+{
+        assert(!t->parked);
+        t->parked = true;
+        LIST_INSERT_TAIL(&s->parked, t, parkq);
+        s->nparked++;
+}
+
+static void
+unpark(struct mnsched *s, struct mnsched_thread *t) REQUIRES(s->lock)
+{
+        assert(t->parked);
+        t->parked = false;
+        LIST_REMOVE(&s->parked, t, parkq);
+        s->nparked--;
+}
+
+/*
+ * requeue parked threads whose timeouts have expired.
+ * returns the earliest timeout of the remaining threads in *nextp.
+ *
+ * if we can't get the current time, requeue all parked threads.
+ * memory.atomic.wait checks its timeout by itself when resumed and
+ * fails the thread with the error if the clock is still broken.
+ */
+static uint32_t
+expire_parked(struct mnsched *s, struct mnsched_worker *w,
+              struct timespec *nextp, bool *hasnextp) REQUIRES(s->lock)
+{
+        struct mnsched_thread *t;
+        struct mnsched_thread *next;
+        struct timespec now;
+        uint32_t n = 0;
+        int ret;
+
+        *hasnextp = false;
+        if (s->nparked == 0) {
+                return 0;
+        }
+        ret = timespec_now(CLOCK_REALTIME, &now);
+        if (ret != 0) {
+                xlog_error("%s: timespec_now failed with %d", __func__, ret);
+        }
+        for (t = LIST_FIRST(&s->parked); t != NULL; t = next) {
+                next = LIST_NEXT(t, parkq);
+                if (ret != 0 ||
+                    timespec_cmp(&t->wait_abstimeout, &now) <= 0) {
+                        unpark(s, t);
+                        runq_insert(w, t);
+                        n++;
+                } else if (!*hasnextp ||
+                           timespec_cmp(&t->wait_abstimeout, nextp) < 0) {
+                        *nextp = t->wait_abstimeout;
+                        *hasnextp = true;
+                }
+        }
+        return n;
+}
+
+/*
+ * wait for something to do.
+ * returns false if the scheduler is shutting down.
+ */
+static bool
+mnsched_idle(struct mnsched_worker *w)
+{
+        struct mnsched *s = w->sched;
+        bool ok = true;
+        toywasm_mutex_lock(&s->lock);
+        while (true) {
+                struct timespec next;
+                bool hasnext;
+                if (expire_parked(s, w, &next, &hasnext) > 0) {
+                        break;
+                }
+                s->nidle++;
+                if (s->nrunnable > 0) {
+                        s->nidle--;
+                        break;
+                }
+                if (s->shutting_down) {
+                        s->nidle--;
+                        ok = false;
+                        break;
+                }
+                if (hasnext) {
+                        toywasm_cv_timedwait(&s->cv, &s->lock, &next);
+                } else {
+                        toywasm_cv_wait(&s->cv, &s->lock);
+                }
+                s->nidle--;
+        }
+        toywasm_mutex_unlock(&s->lock);
+        return ok;
+}
+
+static struct mnsched_thread *
+pick_thread(struct mnsched_worker *w)
+{
+        struct mnsched *s = w->sched;
+        struct mnsched_thread *t;
+
+        /*
+         * check expired timeouts. it's enough for one of workers to do
+         * this. skip if another worker is holding the lock.
+         */
+        if (s->nparked > 0 && toywasm_mutex_trylock(&s->lock)) {
+                struct timespec next;
+                bool hasnext;
+                uint32_t n = expire_parked(s, w, &next, &hasnext);
+                toywasm_mutex_unlock(&s->lock);
+                if (n > 1) {
+                        kick_idle_worker(s);
+                }
+        }
+        while (true) {
+                t = runq_remove(w);
+                if (t != NULL) {
+                        return t;
+                }
+                uint32_t i;
+                for (i = 1; i < s->nworkers; i++) {
+                        struct mnsched_worker *victim =
+                                &s->workers[(w->idx + i) % s->nworkers];
+                        t = runq_remove(victim);
+                        if (t != NULL) {
+                                xlog_trace("%s: worker %" PRIu32
+                                           " stole thread %p from %" PRIu32,
+                                           __func__, w->idx, (void *)t,
+                                           victim->idx);
+                                return t;
+                        }
+                }
+                if (!mnsched_idle(w)) {
+                        return NULL;
+                }
+        }
+}
+
+static void
+run_thread(struct mnsched_worker *w, struct mnsched_thread *t)
+{
+        struct mnsched *s = w->sched;
+        struct exec_context *ctx = t->ctx;
+        struct cluster *c = ctx->cluster;
+        int ret;
+
+        if (c != NULL) {
+                suspend_oncpu(c);
+        }
+        t->worker = w;
+        ret = abstime_from_reltime_ms(CLOCK_MONOTONIC, &w->next_resched,
+                                      MNSCHED_SLICE_MS);
+        if (ret != 0) {
+                /*
+                 * we can't run the thread without a time slice.
+                 * fail the thread with the error.
+                 */
+                xlog_error("%s: abstime_from_reltime_ms failed with %d",
+                           __func__, ret);
+                goto done;
+        }
+        xlog_trace("%s: worker %" PRIu32 " running thread %p", __func__,
+                   w->idx, (void *)t);
+        if (!t->started) {
+                t->started = true;
+                ret = t->start(t);
+        } else {
+                ret = instance_execute_continue(ctx);
+        }
+        if (!IS_RESTARTABLE(ret) || ret == ETOYWASMUSERINTERRUPT) {
+done:
+                xlog_trace("%s: finishing thread %p", __func__, (void *)t);
+                if (t->waiting) {
+                        /*
+                         * the execution was terminated without resuming
+                         * memory.atomic.wait. (eg. by an interrupt)
+                         */
+                        struct toywasm_mutex *lock = atomics_mutex_getptr(
+                                t->wait_tab, t->wait_ident);
+                        toywasm_mutex_lock(lock);
+                        mnsched_unpark(t, t->wait_tab, t->wait_ident);
+                        toywasm_mutex_unlock(lock);
+                }
+                t->done(t, ret);
+                return;
+        }
+        if (c != NULL) {
+                suspend_offcpu(c);
+        }
+        toywasm_mutex_lock(&s->lock);
+        if (t->waiting && !t->wakeup_pending) {
+                xlog_trace("%s: parking thread %p", __func__, (void *)t);
+                park(s, t);
+                /* an idle worker might need to update its timeout */
+                if (s->nidle > 0) {
+                        toywasm_cv_signal(&s->cv, &s->lock);
+                }
+                toywasm_mutex_unlock(&s->lock);
+                return;
+        }
+        t->wakeup_pending = false;
+        toywasm_mutex_unlock(&s->lock);
+        enqueue(w, t);
+}
+
+static void *
+worker_main(void *vp)
+{
+        struct mnsched_worker *w = vp;
+        struct mnsched_thread *t;
+
+        while ((t = pick_thread(w)) != NULL) {
+                run_thread(w, t);
+        }
+        return NULL;
+}
+
+static void
+mnsched_wakeup(void *arg)
+{
+        struct mnsched_thread *t = arg;
+        struct mnsched *s = t->sched;
+
+        toywasm_mutex_lock(&s->lock);
+        if (!t->parked) {
+                /*
+                 * the thread is still running or already requeued.
+                 * run_thread or mnsched_unpark will notice.
+                 */
+                t->wakeup_pending = true;
+                toywasm_mutex_unlock(&s->lock);
+                return;
+        }
+        unpark(s, t);
+        toywasm_mutex_unlock(&s->lock);
+        enqueue(t->worker, t);
+}
+
+static void
+stop_workers(struct mnsched *s, uint32_t nstarted)
+{
+        uint32_t i;
+
+        toywasm_mutex_lock(&s->lock);
+        s->shutting_down = true;
+        toywasm_cv_broadcast(&s->cv, &s->lock);
+        toywasm_mutex_unlock(&s->lock);
+        for (i = 0; i < nstarted; i++) {
+                int ret = pthread_join(s->workers[i].thread, NULL);
+                if (ret != 0) {
+                        xlog_error("%s: pthread_join failed with %d",
+                                   __func__, ret);
+                }
+        }
+}
+
+static void
+free_sched(struct mnsched *s)
+{
+        struct mem_context *mctx = s->mctx;
+        uint32_t i;
+
+        for (i = 0; i < s->nworkers; i++) {
+                toywasm_mutex_destroy(&s->workers[i].lock);
+        }
+        toywasm_cv_destroy(&s->cv);
+        toywasm_mutex_destroy(&s->lock);
+        mem_free(mctx, s->workers, s->nworkers * sizeof(*s->workers));
+        mem_free(mctx, s, sizeof(*s));
+}
+
+int
+mnsched_create(struct mem_context *mctx, uint32_t nworkers,
+               struct mnsched **schedp)
+{
+        struct mnsched *s;
+        uint32_t i;
+        int ret;
+
+        if (nworkers == 0) {
+                long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+                nworkers = ncpu > 0 ? (uint32_t)ncpu : 1;
+        }
+        s = mem_zalloc(mctx, sizeof(*s));
+        if (s == NULL) {
+                return ENOMEM;
+        }
+        s->workers = mem_calloc(mctx, nworkers, sizeof(*s->workers));
+        if (s->workers == NULL) {
+                mem_free(mctx, s, sizeof(*s));
+                return ENOMEM;
+        }
+        s->mctx = mctx;
+        s->nworkers = nworkers;
+        toywasm_mutex_init(&s->lock);
+        toywasm_cv_init(&s->cv);
+        LIST_HEAD_INIT(&s->parked);
+        for (i = 0; i < nworkers; i++) {
+                struct mnsched_worker *w = &s->workers[i];
+                toywasm_mutex_init(&w->lock);
+                SLIST_HEAD_INIT(&w->runq);
+                w->sched = s;
+                w->idx = i;
+        }
+        for (i = 0; i < nworkers; i++) {
+                struct mnsched_worker *w = &s->workers[i];
+                ret = pthread_create(&w->thread, NULL, worker_main, w);
+                if (ret != 0) {
+                        xlog_error("%s: pthread_create failed with %d",
+                                   __func__, ret);
+                        stop_workers(s, i);
+                        free_sched(s);
+                        return ret;
+                }
+        }
+        xlog_trace("%s: %" PRIu32 " workers", __func__, nworkers);
+        *schedp = s;
+        return 0;
+}
+
+void
+mnsched_destroy(struct mnsched *s)
+{
+        stop_workers(s, s->nworkers);
+        assert(s->nrunnable == 0);
+        assert(s->nparked == 0);
+        free_sched(s);
+}
+
+void
+mnsched_spawn(struct mnsched *s, struct mnsched_thread *t,
+              struct mnsched_thread *parent)
+{
+        struct mnsched_worker *w;
+        if (parent != NULL && parent->worker != NULL) {
+                w = parent->worker;
+        } else {
+                w = &s->workers[s->next_worker++ % s->nworkers];
+        }
+        t->sched = s;
+        t->worker = w;
+        t->started = false;
+        t->waiting = false;
+        t->parked = false;
+        t->wakeup_pending = false;
+        if (t->ctx->cluster != NULL) {
+                suspend_offcpu(t->ctx->cluster);
+        }
+        enqueue(w, t);
+}
+
+int
+mnsched_check_resched(struct mnsched_thread *t)
+{
+        struct mnsched_worker *w = t->worker;
+        struct mnsched *s = t->sched;
+        struct timespec now;
+        int ret;
+
+        /*
+         * if nothing is waiting for this worker, no point to resched.
+         *
+         * Note: expired parked threads are requeued by workers.
+         * a worker running a long computation should yield for them.
+         */
+        if (w->nqueued == 0 && s->nparked == 0) {
+                return 0;
+        }
+        ret = timespec_now(CLOCK_MONOTONIC, &now);
+        if (ret != 0) {
+                xlog_error("%s: timespec_now failed with %d", __func__, ret);
+                return ret;
+        }
+        if (timespec_cmp(&w->next_resched, &now) <= 0) {
+                return ETOYWASMRESTART;
+        }
+        return 0;
+}
+
+int
+mnsched_park(struct mnsched_thread *t, struct waiter_list_table *tab,
+             uint32_t ident, const struct timespec *abstimeout)
+{
+        struct mnsched *s = t->sched;
+        int ret;
+
+        assert(!t->waiting);
+        /*
+         * clear the stale wakeup request, if any, before registering
+         * the waiter. as we hold the lock for ident, no one can wake
+         * the waiter before we return.
+         */
+        toywasm_mutex_lock(&s->lock);
+        t->wakeup_pending = false;
+        toywasm_mutex_unlock(&s->lock);
+        ret = atomics_wait_park(tab, ident, &t->waiter, mnsched_wakeup, t);
+        if (ret != 0) {
+                return ret;
+        }
+        t->waiting = true;
+        t->wait_tab = tab;
+        t->wait_ident = ident;
+        t->wait_abstimeout = *abstimeout;
+        return 0;
+}
+
+bool
+mnsched_unpark(struct mnsched_thread *t, struct waiter_list_table *tab,
+               uint32_t ident)
+{
+        assert(t->waiting);
+        assert(t->wait_tab == tab);
+        assert(t->wait_ident == ident);
+        t->waiting = false;
+        return atomics_wait_unpark(tab, ident, &t->waiter);
+}
@@ -0,0 +1,115 @@
+#if !defined(_TOYWASM_MNSCHED_H)
+#define _TOYWASM_MNSCHED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "list.h"
+#include "lock.h"
+#include "platform.h"
+#include "slist.h"
+#include "waitlist.h"
+
+struct exec_context;
+struct mem_context;
+struct mnsched;
+struct mnsched_worker;
+
+/*
+ * a thread scheduled by mnsched.
+ */
+struct mnsched_thread {
+        struct exec_context *ctx;
+
+        /*
+         * start: start the execution. called on a worker.
+         * the return value is handled in the same way as
+         * instance_execute_continue.
+         *
+         * done: called on a worker when the execution finished.
+         * it's the last chance for the scheduler to touch the thread.
+         */
+        int (*start)(struct mnsched_thread *t);
+        void (*done)(struct mnsched_thread *t, int ret);
+        void *arg;
+
+        /* the following fields are private to mnsched */
+        struct mnsched *sched;
+        struct mnsched_worker *worker; /* the last worker run this */
+        bool started;
+        SLIST_ENTRY(struct mnsched_thread) rq;
+
+        /* memory.atomic.wait */
+        bool waiting;
+        struct waiter_list_table *wait_tab;
+        uint32_t wait_ident;
+        struct waiter waiter;
+        struct timespec wait_abstimeout; /* CLOCK_REALTIME */
+
+        /* protected by mnsched::lock */
+        bool parked;
+        bool wakeup_pending;
+        LIST_ENTRY(struct mnsched_thread) parkq;
+};
+
+__BEGIN_EXTERN_C
+
+/*
+ * mnsched_create: create a scheduler with nworkers host threads.
+ * if nworkers is 0, use the number of online cpus.
+ */
+int mnsched_create(struct mem_context *mctx, uint32_t nworkers,
+                   struct mnsched **schedp);
+
+/*
+ * mnsched_destroy: stop the workers.
+ * all threads should have been finished.
+ */
+void mnsched_destroy(struct mnsched *sched);
+
+/*
+ * mnsched_spawn: schedule a new thread.
+ *
+ * parent is the thread calling this, or NULL if the caller is not
+ * a thread run by the scheduler. it's used as a hint to choose
+ * the run queue.
+ */
+void mnsched_spawn(struct mnsched *sched, struct mnsched_thread *t,
+                   struct mnsched_thread *parent);
+
+/*
+ * mnsched_check_resched: used by check_interrupt to make the running
+ * thread yield the worker.
+ *
+ * returns ETOYWASMRESTART if the thread should yield, 0 if it can
+ * keep running, or an error.
+ */
+int mnsched_check_resched(struct mnsched_thread *t);
+
+/*
+ * mnsched_park: used by memory.atomic.wait to block the thread
+ * without blocking the worker.
+ *
+ * the caller should rewind the execution with ETOYWASMRESTART.
+ * the thread is resumed when it's notified, or abstimeout has passed.
+ * the resumed memory.atomic.wait should call mnsched_unpark.
+ *
+ * Note: the lock for ident is held by the caller.
+ * (via memory_atomic_getptr)
+ */
+int mnsched_park(struct mnsched_thread *t, struct waiter_list_table *tab,
+                 uint32_t ident, const struct timespec *abstimeout);
+
+/*
+ * mnsched_unpark: returns true if the thread has been notified.
+ *
+ * Note: the lock for ident is held by the caller.
+ * (via memory_atomic_getptr)
+ */
+bool mnsched_unpark(struct mnsched_thread *t, struct waiter_list_table *tab,
+                    uint32_t ident);
+
+__END_EXTERN_C
+
+#endif /* !defined(_TOYWASM_MNSCHED_H) */
@@ -7,12 +7,14 @@
 #include <errno.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "annotation_cache.h"
 #include "cell.h"
 #include "decode.h"
 #include "dylink_type.h"
@@ -268,6 +270,7 @@ read_functype(const uint8_t **pp, const uint8_t *ep, uint32_t idx,
                 clear_resulttype(load_mctx(ctx), &ft->parameter);
                 goto fail;
         }
+        functype_set_id(ft);
 
         *pp = p;
 fail:
@@ -942,6 +945,9 @@ static void
 init_expr_exec_info(struct expr_exec_info *ei)
 {
         ei->jumps = NULL;
+#if defined(TOYWASM_USE_JUMP_HASH)
+        ei->jump_hash = NULL;
+#endif
 #if defined(TOYWASM_USE_SMALL_CELLS)
         ei->type_annotations.types = NULL;
 #endif
@@ -951,6 +957,13 @@ static void
 clear_expr_exec_info(struct mem_context *mctx, struct expr_exec_info *ei)
 {
         mem_free(mctx, ei->jumps, ei->njumps * sizeof(*ei->jumps));
+#if defined(TOYWASM_USE_JUMP_HASH)
+        if (ei->jump_hash != NULL) {
+                mem_free(mctx, ei->jump_hash,
+                         ((size_t)1 << ei->jump_hash_bits) *
+                                 sizeof(*ei->jump_hash));
+        }
+#endif
 #if defined(TOYWASM_USE_SMALL_CELLS)
         struct type_annotations *an = &ei->type_annotations;
         mem_free(mctx, an->types, an->ntypes * sizeof(*an->types));
@@ -1019,9 +1032,63 @@ fail:
 }
 #endif
 
+#if defined(TOYWASM_USE_UNIFORM_LOCALS)
+static bool
+merge_csz(uint32_t *cszp, enum valtype t)
+{
+        uint32_t csz = valtype_cellsize(t);
+        if (*cszp != 0 && *cszp != csz) {
+                return false;
+        }
+        *cszp = csz;
+        return true;
+}
+
+/*
+ * choose the layout of the locals of a function.
+ * see struct localtype::csz and frame_locals_cellidx.
+ */
+static uint8_t
+frame_uniform_csz(const struct resulttype *paramtype,
+                  const struct localtype *lt, uint32_t nchunks)
+{
+        uint32_t csz = 0;
+        uint32_t i;
+        for (i = 0; i < paramtype->ntypes; i++) {
+                if (!merge_csz(&csz, paramtype->types[i])) {
+                        return 0;
+                }
+        }
+        for (i = 0; i < nchunks; i++) {
+                if (!merge_csz(&csz, lt->localchunks[i].type)) {
+                        return 0;
+                }
+        }
+        /* cell indexes should fit uint32_t */
+        const uint64_t n = (uint64_t)paramtype->ntypes + lt->nlocals;
+        if (csz == 0 || n > UINT32_MAX / csz) {
+                return 0;
+        }
+        assert(csz <= UINT8_MAX);
+        return (uint8_t)csz;
+}
+#endif
+
+#if defined(TOYWASM_USE_LOCALTYPE_CELLIDX)
+static bool
+localtype_is_uniform(const struct localtype *lt)
+{
+#if defined(TOYWASM_USE_UNIFORM_LOCALS)
+        return lt->csz != 0;
+#else
+        return false;
+#endif
+}
+#endif
+
 static int
 read_locals(const uint8_t **pp, const uint8_t *ep, struct func *func,
-            const struct load_context *ctx)
+            const struct resulttype *paramtype, const struct load_context *ctx)
 {
         const uint8_t *p = *pp;
         uint32_t vec_count;
@@ -1079,8 +1146,12 @@ read_locals(const uint8_t **pp, const uint8_t *ep, struct func *func,
         }
         lt->localchunks = chunks;
         lt->nlocals = nlocals;
+#if defined(TOYWASM_USE_UNIFORM_LOCALS)
+        lt->csz = frame_uniform_csz(paramtype, lt, chunk - chunks);
+#endif
 #if defined(TOYWASM_USE_LOCALTYPE_CELLIDX)
-        if (lt->nlocals > 0 && ctx->options.generate_localtype_cellidx) {
+        if (lt->nlocals > 0 && !localtype_is_uniform(lt) &&
+            ctx->options.generate_localtype_cellidx) {
                 ret = populate_localtype_cellidx(load_mctx(ctx), lt);
                 if (ret != 0) {
                         /* this failure is not critical. let's ignore. */
@@ -1097,6 +1168,22 @@ fail:
         return ret;
 }
 
+#if defined(TOYWASM_ENABLE_ANNOTATION_CACHE) ||                              \
+        defined(TOYWASM_ENABLE_LAZY_VALIDATION)
+/*
+ * set up a function body without running read_expr on it.
+ * the caller is responsible to provide the annotations.
+ */
+static void
+set_unvalidated_body(struct func *func, const uint8_t *p, const uint8_t *cep)
+{
+        func->e.start = p;
+#if defined(TOYWASM_MAINTAIN_EXPR_END)
+        func->e.end = cep;
+#endif
+}
+#endif
+
 WRONG_FUNC_TYPE
 static int
 read_func(const uint8_t **pp, const uint8_t *ep, uint32_t idx,
@@ -1139,10 +1226,32 @@ read_func(const uint8_t **pp, const uint8_t *ep, uint32_t idx,
                 ret = EINVAL;
                 goto fail;
         }
-        ret = read_locals(&p, cep, func, ctx);
+        ret = read_locals(&p, cep, func, &ft->parameter, ctx);
         if (ret != 0) {
                 goto fail;
         }
+#if defined(TOYWASM_ENABLE_ANNOTATION_CACHE)
+        ret = annotation_cache_read_func(ctx, idx, cep - p, &func->e.ei);
+        if (ret == 0) {
+                set_unvalidated_body(func, p, cep);
+                *pp = cep;
+                return 0;
+        }
+        if (ret != ENOENT) {
+                goto fail;
+        }
+#endif
+#if defined(TOYWASM_ENABLE_LAZY_VALIDATION)
+        if (m->lazy != NULL) {
+                struct lazy_func *lf = &m->lazy->funcs[idx];
+                lf->size = cep - p;
+                atomic_init(&lf->state, LAZY_FUNC_PENDING);
+                m->lazy->npending++;
+                set_unvalidated_body(func, p, cep);
+                *pp = cep;
+                return 0;
+        }
+#endif
         ret = read_expr(&p, cep, &func->e, lt->nlocals, lt->localchunks,
                         &ft->parameter, &ft->result, ctx);
         if (ret != 0) {
@@ -1635,6 +1744,384 @@ module_funcs_clear(struct mem_context *mctx, struct module *m, uint32_t nfuncs)
         m->funcs = NULL;
 }
 
+#if defined(TOYWASM_ENABLE_LAZY_VALIDATION)
+static int
+lazy_validation_alloc(struct mem_context *mctx, struct module *m)
+{
+        struct lazy_validation *lazy = mem_zalloc(mctx, sizeof(*lazy));
+        if (lazy == NULL) {
+                return ENOMEM;
+        }
+        lazy->funcs = mem_zalloc(mctx, m->nfuncs * sizeof(*lazy->funcs));
+        if (lazy->funcs == NULL) {
+                mem_free(mctx, lazy, sizeof(*lazy));
+                return ENOMEM;
+        }
+        toywasm_mutex_init(&lazy->lock);
+        lazy->mctx = mctx;
+        m->lazy = lazy;
+        return 0;
+}
+
+static void
+lazy_validation_free(struct mem_context *mctx, struct module *m)
+{
+        struct lazy_validation *lazy = m->lazy;
+        if (lazy == NULL) {
+                return;
+        }
+        toywasm_mutex_destroy(&lazy->lock);
+        bitmap_free(mctx, &lazy->refs, lazy->refs_size);
+        mem_free(mctx, lazy->funcs, m->nfuncs * sizeof(*lazy->funcs));
+        mem_free(mctx, lazy, sizeof(*lazy));
+        m->lazy = NULL;
+}
+
+/*
+ * save the states necessary to validate the deferred functions later.
+ */
+static void
+lazy_validation_finish(struct load_context *ctx, struct module *m)
+{
+        struct lazy_validation *lazy = m->lazy;
+        if (lazy->npending == 0) {
+                lazy_validation_free(load_mctx(ctx), m);
+                return;
+        }
+        lazy->options = ctx->options;
+#if defined(TOYWASM_ENABLE_ANNOTATION_CACHE)
+        lazy->options.annotation_cache_dir = NULL;
+#endif
+        lazy->has_datacount = ctx->has_datacount;
+        lazy->ndatas_in_datacount = ctx->ndatas_in_datacount;
+        /* steal C.refs from the load context */
+        lazy->refs = ctx->refs;
+        lazy->refs_size = ctx->refs_size;
+        memset(&ctx->refs, 0, sizeof(ctx->refs));
+        ctx->refs_size = 0;
+}
+
+/*
+ * validate a function deferred by load_options.lazy_validation.
+ *
+ * returns 0 if the function is valid.
+ * returns EINVAL if the function is invalid.
+ *
+ * Note: while the module is read-only in general, this function
+ * updates the annotations of the function. it's serialized with
+ * lazy->lock. the exec logic should not look at the annotations
+ * until it observes LAZY_FUNC_VALID.
+ */
+int
+module_validate_func_lazily(const struct module *m, uint32_t idx)
+{
+        struct lazy_validation *lazy = m->lazy;
+        assert(lazy != NULL);
+        assert(idx < m->nfuncs);
+        struct lazy_func *lf = &lazy->funcs[idx];
+        int ret;
+
+        toywasm_mutex_lock(&lazy->lock);
+        uint8_t state = atomic_load_explicit(&lf->state, memory_order_relaxed);
+        if (state == LAZY_FUNC_VALID) {
+                ret = 0;
+                goto done;
+        }
+        if (state == LAZY_FUNC_INVALID) {
+                ret = EINVAL;
+                goto done;
+        }
+        assert(state == LAZY_FUNC_PENDING);
+
+        struct func *func = (struct func *)&m->funcs[idx];
+        const struct localtype *lt = &func->localtype;
+        struct functype *ft = &m->types[m->functypeidxes[idx]];
+        struct load_context lctx;
+        load_context_init(&lctx, lazy->mctx);
+        lctx.module = (struct module *)m;
+        lctx.options = lazy->options;
+        lctx.refs = lazy->refs;
+        lctx.refs_size = lazy->refs_size;
+        lctx.has_datacount = lazy->has_datacount;
+        lctx.ndatas_in_datacount = lazy->ndatas_in_datacount;
+
+        /*
+         * Note: validate into a temporary expr because other threads
+         * might be looking at func->e.start.
+         */
+        const uint8_t *p = func->e.start;
+        const uint8_t *cep = p + lf->size;
+        struct expr e;
+        ret = read_expr(&p, cep, &e, lt->nlocals, lt->localchunks,
+                        &ft->parameter, &ft->result, &lctx);
+        if (ret == 0 && p != cep) {
+                xlog_trace("func has %zu trailing bytes", cep - p);
+                clear_expr_exec_info(lazy->mctx, &e.ei);
+                ret = EINVAL;
+        }
+        if (ret == 0) {
+                func->e.ei = e.ei;
+                atomic_store_explicit(&lf->state, LAZY_FUNC_VALID,
+                                      memory_order_release);
+                lazy->npending--;
+        } else if (ret != ENOMEM) {
+                xlog_trace("lazy validation of func %" PRIu32
+                           " failed with %d: %s",
+                           m->nimportedfuncs + idx, ret,
+                           report_getmessage(&lctx.report));
+                atomic_store_explicit(&lf->state, LAZY_FUNC_INVALID,
+                                      memory_order_relaxed);
+                ret = EINVAL;
+        }
+        /* C.refs is owned by lazy */
+        memset(&lctx.refs, 0, sizeof(lctx.refs));
+        lctx.refs_size = 0;
+        load_context_clear(&lctx);
+done:
+        toywasm_mutex_unlock(&lazy->lock);
+        return ret;
+}
+#endif
+
+#if defined(TOYWASM_USE_PARALLEL_VALIDATION) && defined(USE_PTHREAD)
+#define PARALLEL_VALIDATION
+#endif
+
+#if defined(PARALLEL_VALIDATION)
+/*
+ * read and validate function bodies with multiple threads.
+ *
+ * function bodies are independent from each other once the sections
+ * preceding the code section have been loaded. each worker has its own
+ * load_context (thus its own validation_context) and processes
+ * functions picked from a shared counter.
+ *
+ * each worker allocates with its own mem_context, limited to what's
+ * available in the mem_context of the load context, so that the workers
+ * don't contend on the shared heap accounting. after all workers have
+ * finished, the accounting is transferred to the load context with
+ * mem_context_transfer.
+ */
+struct parallel_validation {
+        const struct load_context *ctx;
+        struct func *funcs;
+        const uint8_t *const *starts; /* nfuncs + 1 entries */
+        uint32_t nfuncs;
+        atomic_uint next;
+
+        struct mem_context *mctxs; /* per worker */
+        uint32_t *owners;          /* the worker which read each func */
+        atomic_uint nextworker;
+
+        /* the failure with the smallest function index */
+        TOYWASM_MUTEX_DEFINE(lock);
+        atomic_uint error_idx;
+        int error;
+        struct report report;
+};
+
+static void *
+parallel_validation_worker(void *vp)
+{
+        struct parallel_validation *pv = vp;
+        const struct load_context *ctx = pv->ctx;
+        struct load_context lctx;
+
+        const uint32_t wid = atomic_fetch_add(&pv->nextworker, 1);
+        load_context_init(&lctx, &pv->mctxs[wid]);
+        lctx.module = ctx->module;
+        lctx.options = ctx->options;
+        lctx.refs = ctx->refs; /* read-only during the code section */
+        lctx.refs_size = ctx->refs_size;
+        lctx.has_datacount = ctx->has_datacount;
+        lctx.ndatas_in_datacount = ctx->ndatas_in_datacount;
+        while (true) {
+                uint32_t i = atomic_fetch_add(&pv->next, 1);
+                if (i >= pv->nfuncs || i > atomic_load(&pv->error_idx)) {
+                        break;
+                }
+                const uint8_t *p = pv->starts[i];
+                pv->owners[i] = wid;
+                int ret = read_func(&p, pv->starts[i + 1], i, &pv->funcs[i],
+                                    &lctx);
+                if (ret == 0) {
+                        assert(p == pv->starts[i + 1]);
+                        continue;
+                }
+                /* read_func has cleared it. make it safe to clear again. */
+                memset(&pv->funcs[i], 0, sizeof(pv->funcs[i]));
+                toywasm_mutex_lock(&pv->lock);
+                if (i < atomic_load(&pv->error_idx)) {
+                        atomic_store(&pv->error_idx, i);
+                        pv->error = ret;
+                        report_clear(&pv->report);
+                        pv->report = lctx.report;
+                        report_init(&lctx.report);
+                }
+                toywasm_mutex_unlock(&pv->lock);
+                report_clear(&lctx.report);
+                report_init(&lctx.report);
+        }
+        /* C.refs is owned by ctx */
+        memset(&lctx.refs, 0, sizeof(lctx.refs));
+        lctx.refs_size = 0;
+        load_context_clear(&lctx);
+        return NULL;
+}
+
+static int
+read_funcs_parallel(const uint8_t **pp, const uint8_t *ep,
+                    struct load_context *ctx, uint32_t *countp)
+{
+        struct mem_context *mctx = load_mctx(ctx);
+        struct module *m = ctx->module;
+        const uint8_t *p = *pp;
+        const uint8_t **starts = NULL;
+        struct mem_context *mctxs = NULL;
+        uint32_t *owners = NULL;
+        pthread_t *threads = NULL;
+        uint32_t nthreads = 0;
+        uint32_t nworkers = 0;
+        uint32_t count;
+        uint32_t i;
+        int ret;
+
+        ret = read_vec_count(&p, ep, &count);
+        if (ret != 0) {
+                return ret;
+        }
+        if (count != m->nfuncs) {
+                xlog_trace("nfunc mismatch %" PRIu32 " != %" PRIu32, count,
+                           m->nfuncs);
+                return EINVAL;
+        }
+        if (count == 0) {
+                *pp = p;
+                return 0;
+        }
+
+        /* the first pass: find the boundaries of function bodies */
+        starts = mem_calloc(mctx, count + 1, sizeof(*starts));
+        if (starts == NULL) {
+                return ENOMEM;
+        }
+        for (i = 0; i < count; i++) {
+                uint32_t size;
+                starts[i] = p;
+                ret = read_leb_u32(&p, ep, &size);
+                if (ret != 0) {
+                        goto fail;
+                }
+                if ((size_t)(ep - p) < size) {
+                        ret = EINVAL;
+                        goto fail;
+                }
+                p += size;
+        }
+        starts[count] = p;
+
+        /* the calling thread is one of the workers */
+        nworkers = ctx->options.validation_threads;
+        if (nworkers > count) {
+                nworkers = count;
+        }
+        mctxs = mem_calloc(mctx, nworkers, sizeof(*mctxs));
+        owners = mem_calloc(mctx, count, sizeof(*owners));
+        if (mctxs == NULL || owners == NULL) {
+                ret = ENOMEM;
+                goto fail;
+        }
+        const size_t avail = mem_context_available(mctx);
+        for (i = 0; i < nworkers; i++) {
+                mem_context_init(&mctxs[i]);
+                ret = mem_context_setlimit(&mctxs[i], avail);
+                assert(ret == 0);
+        }
+        struct func *funcs = mem_calloc(mctx, count, sizeof(*funcs));
+        if (funcs == NULL) {
+                ret = ENOMEM;
+                goto fail;
+        }
+        struct parallel_validation pv;
+        pv.ctx = ctx;
+        pv.funcs = funcs;
+        pv.starts = starts;
+        pv.nfuncs = count;
+        atomic_init(&pv.next, 0);
+        pv.mctxs = mctxs;
+        pv.owners = owners;
+        atomic_init(&pv.nextworker, 0);
+        toywasm_mutex_init(&pv.lock);
+        atomic_init(&pv.error_idx, UINT32_MAX);
+        pv.error = 0;
+        report_init(&pv.report);
+
+        threads = mem_calloc(mctx, nworkers - 1, sizeof(*threads));
+        if (threads != NULL) {
+                for (; nthreads < nworkers - 1; nthreads++) {
+                        if (pthread_create(&threads[nthreads], NULL,
+                                           parallel_validation_worker,
+                                           &pv)) {
+                                break;
+                        }
+                }
+        }
+        xlog_trace("validating %" PRIu32 " functions with %" PRIu32
+                   " threads",
+                   count, nthreads + 1);
+        parallel_validation_worker(&pv);
+        for (i = 0; i < nthreads; i++) {
+                pthread_join(threads[i], NULL);
+        }
+        mem_free(mctx, threads, (nworkers - 1) * sizeof(*threads));
+        toywasm_mutex_destroy(&pv.lock);
+
+        /*
+         * move the accounting of the workers' allocations to mctx.
+         * workers [0, ntransferred) are done.
+         */
+        uint32_t ntransferred = 0;
+        ret = pv.error;
+        if (ret == 0) {
+                for (; ntransferred < nworkers; ntransferred++) {
+                        ret = mem_context_transfer(mctx,
+                                                   &mctxs[ntransferred]);
+                        if (ret != 0) {
+                                break;
+                        }
+                }
+        }
+        if (ret != 0) {
+                if (pv.report.msg != NULL) {
+                        report_error(&ctx->report, "%s", pv.report.msg);
+                }
+                for (i = 0; i < count; i++) {
+                        struct mem_context *fmctx = mctx;
+                        if (owners[i] >= ntransferred) {
+                                fmctx = &mctxs[owners[i]];
+                        }
+                        clear_func(fmctx, &funcs[i]);
+                }
+                mem_free(mctx, funcs, count * sizeof(*funcs));
+        } else {
+                m->funcs = funcs;
+                *countp = count;
+                *pp = p;
+        }
+        report_clear(&pv.report);
+fail:
+        if (mctxs != NULL) {
+                for (i = 0; i < nworkers; i++) {
+                        mem_context_clear(&mctxs[i]);
+                }
+                mem_free(mctx, mctxs, nworkers * sizeof(*mctxs));
+        }
+        mem_free(mctx, owners, count * sizeof(*owners));
+        mem_free(mctx, starts, (count + 1) * sizeof(*starts));
+        return ret;
+}
+#endif /* defined(PARALLEL_VALIDATION) */
+
 static int
 read_code_section(const uint8_t **pp, const uint8_t *ep,
                   struct load_context *ctx)
@@ -1644,10 +2131,48 @@ read_code_section(const uint8_t **pp, const uint8_t *ep,
         int ret;
 
         assert(m->funcs == NULL);
+#if defined(TOYWASM_ENABLE_LAZY_VALIDATION)
+        if (ctx->options.lazy_validation && m->nfuncs > 0) {
+                ret = lazy_validation_alloc(load_mctx(ctx), m);
+                if (ret != 0) {
+                        goto fail;
+                }
+        }
+#endif
         uint32_t nfuncs_in_code = 0;
-        ret = read_vec_with_ctx(load_mctx(ctx), &p, ep, sizeof(*m->funcs),
-                                read_func, clear_func, ctx, &nfuncs_in_code,
-                                &m->funcs);
+#if defined(PARALLEL_VALIDATION)
+        /*
+         * Note: the annotation cache and lazy validation assume
+         * the sequential processing. they make the validation cheap
+         * anyway.
+         */
+        bool parallel = ctx->options.validation_threads > 1;
+#if defined(TOYWASM_ENABLE_ANNOTATION_CACHE)
+        if (ctx->acache != NULL && ctx->acache->hit) {
+                parallel = false;
+        }
+#endif
+#if defined(TOYWASM_ENABLE_LAZY_VALIDATION)
+        if (m->lazy != NULL) {
+                parallel = false;
+        }
+#endif
+#if defined(TOYWASM_ENABLE_MEM_ARENA)
+        /* an arena is not thread-safe */
+        if (mem_context_is_arena(load_mctx(ctx))) {
+                parallel = false;
+        }
+#endif
+        if (parallel) {
+                ret = read_funcs_parallel(&p, ep, ctx, &nfuncs_in_code);
+        } else
+#endif
+        {
+                ret = read_vec_with_ctx(load_mctx(ctx), &p, ep,
+                                        sizeof(*m->funcs), read_func,
+                                        clear_func, ctx, &nfuncs_in_code,
+                                        &m->funcs);
+        }
         if (ret != 0) {
                 assert(nfuncs_in_code == 0);
                 goto fail;
@@ -2227,6 +2752,16 @@ module_load_into(struct module *m, const uint8_t *p, const uint8_t *ep,
         memset(m, 0, sizeof(*m));
         ctx->module = m;
         m->bin = p;
+        m->binsz = ep - p;
+
+#if defined(TOYWASM_ENABLE_ANNOTATION_CACHE)
+        if (ctx->options.annotation_cache_dir != NULL) {
+                ret = annotation_cache_open(ctx, p, ep);
+                if (ret != 0) {
+                        goto fail;
+                }
+        }
+#endif
 
         ret = read_u32(&p, ep, &v);
         if (ret != 0) {
@@ -2364,6 +2899,14 @@ module_load_into(struct module *m, const uint8_t *p, const uint8_t *ep,
         }
 #endif
 
+#if defined(TOYWASM_ENABLE_LAZY_VALIDATION)
+        if (m->lazy != NULL) {
+                lazy_validation_finish(ctx, m);
+        }
+#endif
+#if defined(TOYWASM_ENABLE_ANNOTATION_CACHE)
+        annotation_cache_save(ctx, m);
+#endif
         ret = 0;
 fail:
         return ret;
@@ -2409,6 +2952,9 @@ module_unload(struct mem_context *mctx, struct module *m)
         }
         mem_free(mctx, m->types, m->ntypes * sizeof(*m->types));
 
+#if defined(TOYWASM_ENABLE_LAZY_VALIDATION)
+        lazy_validation_free(mctx, m);
+#endif
         module_funcs_clear(mctx, m, m->nfuncs);
         mem_free(mctx, m->functypeidxes,
                  m->nfuncs * sizeof(*m->functypeidxes));
@@ -2462,6 +3008,20 @@ void
 module_destroy(struct mem_context *mctx, struct module *m)
 {
         assert(m != NULL);
+#if defined(TOYWASM_ENABLE_MEM_ARENA)
+        if (mem_context_is_arena(mctx)) {
+                /*
+                 * the memory is released by mem_context_clear at once.
+                 * no need to visit each objects.
+                 */
+#if defined(TOYWASM_ENABLE_LAZY_VALIDATION)
+                if (m->lazy != NULL) {
+                        toywasm_mutex_destroy(&m->lazy->lock);
+                }
+#endif
+                return;
+        }
+#endif
         module_unload(mctx, m);
         mem_free(mctx, m, sizeof(*m));
 }
@@ -2491,8 +3051,16 @@ module_print_stats(const struct module *m)
         size_t type_annotation_size = 0;
         size_t localtype_cellidx_size = 0;
         size_t resulttype_cellidx_size = 0;
+#if defined(TOYWASM_USE_UNIFORM_LOCALS)
+        uint32_t nuniform = 0;
+#endif
         for (i = 0; i < m->nfuncs; i++) {
                 const struct func *func = &m->funcs[i];
+#if defined(TOYWASM_USE_UNIFORM_LOCALS)
+                if (func->localtype.csz != 0) {
+                        nuniform++;
+                }
+#endif
                 const struct expr *e = &func->e;
                 const struct expr_exec_info *ei = &e->ei;
                 jump_table_size += sizeof(ei->jumps);
@@ -2500,6 +3068,14 @@ module_print_stats(const struct module *m)
                 if (ei->jumps != NULL) {
                         jump_table_size += ei->njumps * sizeof(*ei->jumps);
                 }
+#if defined(TOYWASM_USE_JUMP_HASH)
+                jump_table_size += sizeof(ei->jump_hash);
+                jump_table_size += sizeof(ei->jump_hash_bits);
+                if (ei->jump_hash != NULL) {
+                        jump_table_size += ((size_t)1 << ei->jump_hash_bits) *
+                                           sizeof(*ei->jump_hash);
+                }
+#endif
                 code_size += expr_end(e) - e->start;
 #if defined(TOYWASM_USE_SMALL_CELLS)
                 const struct type_annotations *a = &ei->type_annotations;
@@ -2532,4 +3108,8 @@ module_print_stats(const struct module *m)
                     localtype_cellidx_size);
         nbio_printf("%30s %12zu bytes\n", "result type cell idx overhead",
                     resulttype_cellidx_size);
+#if defined(TOYWASM_USE_UNIFORM_LOCALS)
+        nbio_printf("%30s %12" PRIu32 " / %" PRIu32 "\n",
+                    "funcs with uniform locals", nuniform, m->nfuncs);
+#endif
 }
@@ -11,6 +11,14 @@ __BEGIN_EXTERN_C
 
 int module_create(struct module **mp, const uint8_t *p, const uint8_t *ep,
                   struct load_context *ctx);
+
+/*
+ * module_destroy: destroy a module created by module_create.
+ *
+ * if mctx is an arena (mem_context_init_arena), this doesn't free
+ * the memory. it's released by mem_context_clear at once.
+ * an arena should be dedicated to a module.
+ */
 void module_destroy(struct mem_context *mctx, struct module *m);
 
 /*
@@ -20,5 +28,6 @@ void module_destroy(struct mem_context *mctx, struct module *m);
 int module_find_export(const struct module *m, const struct name *name,
                        uint32_t type, uint32_t *idxp);
 void module_print_stats(const struct module *m);
+int module_validate_func_lazily(const struct module *m, uint32_t idx);
 
 __END_EXTERN_C
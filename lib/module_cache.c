@@ -0,0 +1,280 @@
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "fileio.h"
+#include "load_context.h"
+#include "lock.h"
+#include "mem.h"
+#include "module.h"
+#include "module_cache.h"
+#include "options.h"
+#include "report.h"
+#include "slist.h"
+#include "util.h"
+#include "xlog.h"
+
+#if defined(TOYWASM_ENABLE_MODULE_CACHE)
+
+struct module_cache_entry {
+        struct module *module;
+        void *bin;
+        size_t binsz;
+        uint64_t hash; /* fnv1a64 of bin */
+
+        /* the identity of the file we loaded the module from */
+        uint64_t dev;
+        uint64_t ino;
+        int64_t mtime;
+
+        uint32_t refcount;
+        struct mem_context mctx;
+        SLIST_ENTRY(struct module_cache_entry) q;
+};
+
+struct module_cache {
+        TOYWASM_MUTEX_DEFINE(lock);
+        SLIST_HEAD(struct module_cache_entry) entries GUARDED_BY(lock);
+        struct load_options opts;
+        struct mem_context *mctx;
+};
+
+static void
+module_cache_entry_destroy(struct module_cache *cache,
+                           struct module_cache_entry *e)
+{
+        assert(e->refcount == 0);
+        if (e->module != NULL) {
+                module_destroy(&e->mctx, e->module);
+        }
+        if (e->bin != NULL) {
+                unmap_file(e->bin, e->binsz);
+        }
+        mem_context_clear(&e->mctx);
+        mem_free(cache->mctx, e, sizeof(*e));
+}
+
+static struct module_cache_entry *
+module_cache_find_by_identity(struct module_cache *cache,
+                              const struct stat *st) REQUIRES(cache->lock)
+{
+#if defined(_WIN32)
+        /* st_ino is not meaningful */
+        return NULL;
+#else
+        struct module_cache_entry *e;
+        SLIST_FOREACH(e, &cache->entries, q) {
+                if (e->dev == (uint64_t)st->st_dev &&
+                    e->ino == (uint64_t)st->st_ino &&
+                    e->binsz == (uint64_t)st->st_size &&
+                    e->mtime == (int64_t)st->st_mtime) {
+                        return e;
+                }
+        }
+        return NULL;
+#endif
+}
+
+static struct module_cache_entry *
+module_cache_find_by_content(struct module_cache *cache, const void *bin,
+                             size_t binsz, uint64_t hash)
+        REQUIRES(cache->lock)
+{
+        struct module_cache_entry *e;
+        SLIST_FOREACH(e, &cache->entries, q) {
+                if (e->hash == hash && e->binsz == binsz &&
+                    !memcmp(e->bin, bin, binsz)) {
+                        return e;
+                }
+        }
+        return NULL;
+}
+
+static int
+module_cache_entry_load(struct module_cache *cache,
+                        struct module_cache_entry *e, struct report *report)
+{
+        struct load_context lctx;
+        int ret;
+
+        load_context_init(&lctx, &e->mctx);
+        lctx.options = cache->opts;
+        const uint8_t *p = e->bin;
+        ret = module_create(&e->module, p, p + e->binsz, &lctx);
+        if (ret != 0) {
+                e->module = NULL;
+                if (report != NULL) {
+                        report_error(report, "%s",
+                                     report_getmessage(&lctx.report));
+                }
+        }
+        load_context_clear(&lctx);
+        return ret;
+}
+
+int
+module_cache_create(struct mem_context *mctx, const struct load_options *opts,
+                    struct module_cache **cachep)
+{
+        struct module_cache *cache;
+
+        cache = mem_zalloc(mctx, sizeof(*cache));
+        if (cache == NULL) {
+                return ENOMEM;
+        }
+        cache->mctx = mctx;
+        toywasm_mutex_init(&cache->lock);
+        SLIST_HEAD_INIT(&cache->entries);
+        if (opts != NULL) {
+                cache->opts = *opts;
+        } else {
+                load_options_set_defaults(&cache->opts);
+        }
+        *cachep = cache;
+        return 0;
+}
+
+void
+module_cache_destroy(struct module_cache *cache)
+{
+        module_cache_purge(cache);
+        assert(SLIST_EMPTY(&cache->entries));
+        toywasm_mutex_destroy(&cache->lock);
+        mem_free(cache->mctx, cache, sizeof(*cache));
+}
+
+int
+module_cache_load(struct module_cache *cache, const char *filename,
+                  struct module **mp, struct report *report)
+{
+        struct module_cache_entry *e;
+        struct stat st;
+        void *bin = NULL;
+        size_t binsz;
+        int ret;
+
+        if (stat(filename, &st) == -1) {
+                ret = errno;
+                assert(ret != 0);
+                return ret;
+        }
+        toywasm_mutex_lock(&cache->lock);
+        e = module_cache_find_by_identity(cache, &st);
+        if (e != NULL) {
+                xlog_trace("module_cache: %s hit (identity)", filename);
+                goto hit;
+        }
+        ret = map_file(filename, &bin, &binsz);
+        if (ret != 0) {
+                bin = NULL;
+                goto fail;
+        }
+        const uint64_t hash = fnv1a64(FNV1A64_INIT, bin, binsz);
+        e = module_cache_find_by_content(cache, bin, binsz, hash);
+        if (e != NULL) {
+                xlog_trace("module_cache: %s hit (content)", filename);
+                unmap_file(bin, binsz);
+                goto hit;
+        }
+        xlog_trace("module_cache: %s miss", filename);
+        e = mem_zalloc(cache->mctx, sizeof(*e));
+        if (e == NULL) {
+                ret = ENOMEM;
+                goto fail;
+        }
+        mem_context_init(&e->mctx);
+        e->mctx.parent = cache->mctx;
+        e->bin = bin;
+        e->binsz = binsz;
+        bin = NULL;
+        e->hash = hash;
+        e->dev = (uint64_t)st.st_dev;
+        e->ino = (uint64_t)st.st_ino;
+        e->mtime = (int64_t)st.st_mtime;
+        ret = module_cache_entry_load(cache, e, report);
+        if (ret != 0) {
+                module_cache_entry_destroy(cache, e);
+                goto fail;
+        }
+        SLIST_INSERT_TAIL(&cache->entries, e, q);
+hit:
+        e->refcount++;
+        *mp = e->module;
+        toywasm_mutex_unlock(&cache->lock);
+        return 0;
+fail:
+        toywasm_mutex_unlock(&cache->lock);
+        if (bin != NULL) {
+                unmap_file(bin, binsz);
+        }
+        return ret;
+}
+
+static struct module_cache_entry *
+module_cache_find_by_module(struct module_cache *cache,
+                            const struct module *m) REQUIRES(cache->lock)
+{
+        struct module_cache_entry *e;
+        SLIST_FOREACH(e, &cache->entries, q) {
+                if (e->module == m) {
+                        return e;
+                }
+        }
+        return NULL;
+}
+
+void
+module_cache_release(struct module_cache *cache, struct module *m)
+{
+        struct module_cache_entry *e;
+        toywasm_mutex_lock(&cache->lock);
+        e = module_cache_find_by_module(cache, m);
+        assert(e != NULL);
+        assert(e->refcount > 0);
+        e->refcount--;
+        toywasm_mutex_unlock(&cache->lock);
+}
+
+void
+module_cache_purge(struct module_cache *cache)
+{
+        struct module_cache_entry *e;
+        struct module_cache_entry *prev = NULL;
+        toywasm_mutex_lock(&cache->lock);
+        e = SLIST_FIRST(&cache->entries);
+        while (e != NULL) {
+                struct module_cache_entry *next = SLIST_NEXT(e, q);
+                if (e->refcount == 0) {
+                        SLIST_REMOVE(&cache->entries, prev, e, q);
+                        module_cache_entry_destroy(cache, e);
+                } else {
+                        prev = e;
+                }
+                e = next;
+        }
+        toywasm_mutex_unlock(&cache->lock);
+}
+
+void
+module_cache_stat(struct module_cache *cache, const struct module *m,
+                  struct module_cache_stat *st)
+{
+        struct module_cache_entry *e;
+        memset(st, 0, sizeof(*st));
+        toywasm_mutex_lock(&cache->lock);
+        e = module_cache_find_by_module(cache, m);
+        assert(e != NULL);
+        st->refcount = e->refcount;
+#if defined(TOYWASM_ENABLE_HEAP_TRACKING)
+        st->allocated = e->mctx.allocated;
+#if defined(TOYWASM_ENABLE_HEAP_TRACKING_PEAK)
+        st->peak = e->mctx.peak;
+#endif
+#endif
+        toywasm_mutex_unlock(&cache->lock);
+}
+
+#endif /* defined(TOYWASM_ENABLE_MODULE_CACHE) */
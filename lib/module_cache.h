@@ -0,0 +1,79 @@
+#if !defined(_TOYWASM_MODULE_CACHE_H)
+#define _TOYWASM_MODULE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "platform.h"
+
+struct load_options;
+struct mem_context;
+struct module;
+struct module_cache;
+struct report;
+
+struct module_cache_stat {
+        uint32_t refcount;
+        size_t allocated;
+        size_t peak;
+};
+
+__BEGIN_EXTERN_C
+
+/*
+ * module cache: share loaded modules among their users.
+ *
+ * a module (struct module) is immutable once loaded. it can be
+ * instantiated as many times as you like. the cache allows to avoid
+ * loading and validating the same file again, for example, libc.so
+ * used by many dyld programs.
+ *
+ * module_cache_create creates an empty cache. all modules are loaded
+ * with the load options given here. (NULL for the defaults) the options
+ * are copied. pointers in them (eg. annotation_cache_dir) should be
+ * valid while the cache is alive.
+ *
+ * module_cache_load returns a reference to the module loaded from
+ * the given file. a file is identified by its device, inode number,
+ * size and modification time. if it doesn't match any cached module,
+ * the cache compares the contents, using a hash, before actually
+ * loading the file. thus a copy of a cached file is also shared.
+ *
+ * module_cache_release drops a reference obtained by module_cache_load.
+ * an unreferenced module stays in the cache until module_cache_purge or
+ * module_cache_destroy.
+ *
+ * module_cache_destroy destroys the cache and the modules in it.
+ * all references should have been released.
+ *
+ * the memory for the cached modules is accounted to the mem_context
+ * given to module_cache_create, not to their users. module_cache_stat
+ * reports the number of references to a cached module and the memory
+ * it uses. (allocated and peak are 0 unless toywasm is built with
+ * TOYWASM_ENABLE_HEAP_TRACKING and TOYWASM_ENABLE_HEAP_TRACKING_PEAK
+ * respectively.)
+ *
+ * Note: replacing a cached file in place (eg. "cp" over it, not
+ * "mv" or "install") within the same second and without changing
+ * its size is not detected.
+ *
+ * Note: the cache is thread-safe. loading a module blocks other
+ * module_cache_load calls on the same cache.
+ *
+ * these functions are available only if toywasm is built with
+ * TOYWASM_ENABLE_MODULE_CACHE.
+ */
+int module_cache_create(struct mem_context *mctx,
+                        const struct load_options *opts,
+                        struct module_cache **cachep);
+void module_cache_destroy(struct module_cache *cache);
+int module_cache_load(struct module_cache *cache, const char *filename,
+                      struct module **mp, struct report *report);
+void module_cache_release(struct module_cache *cache, struct module *m);
+void module_cache_purge(struct module_cache *cache);
+void module_cache_stat(struct module_cache *cache, const struct module *m,
+                       struct module_cache_stat *st);
+
+__END_EXTERN_C
+
+#endif /* !defined(_TOYWASM_MODULE_CACHE_H) */
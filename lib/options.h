@@ -15,6 +15,28 @@ struct load_options {
 #if defined(TOYWASM_USE_LOCALTYPE_CELLIDX)
         bool generate_localtype_cellidx;
 #endif
+#if defined(TOYWASM_ENABLE_LAZY_VALIDATION)
+        /*
+         * defer the validation of function bodies until their first call.
+         * note that it makes an invalid module loadable. such functions
+         * trap when they are called.
+         */
+        bool lazy_validation;
+#endif
+#if defined(TOYWASM_USE_PARALLEL_VALIDATION)
+        /*
+         * the number of threads to validate function bodies.
+         * 0 and 1 mean to validate them in the calling thread.
+         */
+        uint32_t validation_threads;
+#endif
+#if defined(TOYWASM_ENABLE_ANNOTATION_CACHE)
+        /*
+         * a directory to store the annotation cache files.
+         * NULL to disable the cache. see doc/annotations.md
+         */
+        const char *annotation_cache_dir;
+#endif
 };
 
 struct exec_options {
@@ -0,0 +1,385 @@
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "exec_context.h"
+#include "insn.h"
+#include "instance.h"
+#include "leb128.h"
+#include "lock.h"
+#include "mem.h"
+#include "name.h"
+#include "profiler.h"
+#include "type.h"
+#include "util.h"
+#include "vec.h"
+#include "xlog.h"
+
+#if defined(TOYWASM_ENABLE_PROFILER)
+
+/*
+ * the samples are kept in two hash tables.
+ *
+ * funcs: a wasm function (module, funcidx) seen in samples and
+ * its name. names are resolved when a function is seen for the first
+ * time so that we don't need modules when writing the result.
+ *
+ * stacks: unique call stacks. a stack is a list of indexes of funcs,
+ * from the outermost caller to the callee, followed by the opcode
+ * being executed.
+ */
+
+#define PROFILER_HASH_BITS 10
+#define PROFILER_HASH_SIZE (1U << PROFILER_HASH_BITS)
+#define PROFILER_NONE UINT32_MAX
+
+struct profiler_func {
+        const struct module *module;
+        uint32_t funcidx;
+        uint32_t next; /* hash chain */
+        uint32_t namelen;
+        char *name;
+};
+
+struct profiler_stack {
+        uint32_t hash;
+        uint32_t next;     /* hash chain */
+        uint32_t op;       /* (group << 24) | op */
+        uint32_t nframes;
+        uint32_t frameidx; /* index in profiler::frames */
+        uint64_t weight_us;
+};
+
+struct profiler {
+        struct mem_context *mctx;
+        uint32_t interval_ms;
+        TOYWASM_MUTEX_DEFINE(lock);
+        uint64_t nsamples;
+        uint64_t ndropped;
+        uint32_t func_hash[PROFILER_HASH_SIZE];
+        uint32_t stack_hash[PROFILER_HASH_SIZE];
+        VEC(, struct profiler_func) funcs;
+        VEC(, struct profiler_stack) stacks;
+        VEC(, uint32_t) frames;
+        VEC(, uint32_t) scratch; /* the stack being sampled */
+        struct nametable nametable;
+};
+
+static uint32_t
+fnv1a32(uint32_t h, uint32_t v)
+{
+        unsigned int i;
+        for (i = 0; i < 4; i++) {
+                h ^= (v >> (i * 8)) & 0xff;
+                h *= UINT32_C(16777619);
+        }
+        return h;
+}
+
+static uint32_t
+profiler_func_hash(const struct module *m, uint32_t funcidx)
+{
+        uint32_t h = (uint32_t)(uintptr_t)m ^ funcidx;
+        return (uint32_t)(h * UINT32_C(0x9e3779b1)) >>
+               (32 - PROFILER_HASH_BITS);
+}
+
+/*
+ * nametable_lookup_xxx fill "<unknown>" for functions without names.
+ * (see name.c)
+ */
+static bool
+name_is_unknown(const struct name *name)
+{
+        static const char unknown[] = "<unknown>";
+        return name->nbytes == sizeof(unknown) - 1 &&
+               !memcmp(name->data, unknown, name->nbytes);
+}
+
+/*
+ * "module:func", or just "func" for modules without names.
+ *
+ * the folded stacks format uses ';' and ' ' as separators.
+ * replace them in names.
+ */
+static int
+profiler_func_name(struct profiler *profiler, struct profiler_func *f)
+{
+        struct name module_name;
+        struct name func_name;
+        char buf[sizeof("func[4294967295]")];
+        uint32_t modlen = 0;
+        uint32_t len;
+
+        if (f->funcidx == FUNCIDX_INVALID) {
+                /* eg. a const expr */
+                set_name_cstr(&func_name, "<expr>");
+        } else {
+                nametable_lookup_func(&profiler->nametable, f->module,
+                                      f->funcidx, &func_name);
+                if (name_is_unknown(&func_name)) {
+                        snprintf(buf, sizeof(buf), "func[%" PRIu32 "]",
+                                 f->funcidx);
+                        set_name_cstr(&func_name, buf);
+                }
+        }
+        nametable_lookup_module(&profiler->nametable, f->module,
+                                &module_name);
+        if (!name_is_unknown(&module_name)) {
+                modlen = module_name.nbytes + 1;
+        }
+        len = modlen + func_name.nbytes;
+        char *p = mem_alloc(profiler->mctx, len + 1);
+        if (p == NULL) {
+                return ENOMEM;
+        }
+        if (modlen > 0) {
+                memcpy(p, module_name.data, module_name.nbytes);
+                p[modlen - 1] = ':';
+        }
+        memcpy(p + modlen, func_name.data, func_name.nbytes);
+        p[len] = 0;
+        uint32_t i;
+        for (i = 0; i < len; i++) {
+                if (p[i] == ';' || p[i] == ' ' || p[i] == '\n') {
+                        p[i] = '_';
+                }
+        }
+        f->name = p;
+        f->namelen = len;
+        return 0;
+}
+
+static int
+profiler_lookup_func(struct profiler *profiler, const struct module *m,
+                     uint32_t funcidx, uint32_t *idxp)
+{
+        uint32_t *headp = &profiler->func_hash[profiler_func_hash(m, funcidx)];
+        uint32_t idx;
+        int ret;
+
+        for (idx = *headp; idx != PROFILER_NONE;
+             idx = VEC_ELEM(profiler->funcs, idx).next) {
+                const struct profiler_func *f =
+                        &VEC_ELEM(profiler->funcs, idx);
+                if (f->module == m && f->funcidx == funcidx) {
+                        *idxp = idx;
+                        return 0;
+                }
+        }
+        ret = VEC_PREALLOC(profiler->mctx, profiler->funcs, 1);
+        if (ret != 0) {
+                return ret;
+        }
+        struct profiler_func *f = &VEC_NEXTELEM(profiler->funcs);
+        f->module = m;
+        f->funcidx = funcidx;
+        ret = profiler_func_name(profiler, f);
+        if (ret != 0) {
+                return ret;
+        }
+        idx = profiler->funcs.lsize++;
+        f->next = *headp;
+        *headp = idx;
+        *idxp = idx;
+        return 0;
+}
+
+static int
+profiler_record(struct profiler *profiler, uint32_t op, uint64_t weight_us)
+{
+        const uint32_t *frames = profiler->scratch.p;
+        const uint32_t nframes = profiler->scratch.lsize;
+        uint32_t h = UINT32_C(2166136261);
+        uint32_t i;
+        int ret;
+
+        for (i = 0; i < nframes; i++) {
+                h = fnv1a32(h, frames[i]);
+        }
+        h = fnv1a32(h, op);
+        uint32_t *headp = &profiler->stack_hash[h & (PROFILER_HASH_SIZE - 1)];
+        uint32_t idx;
+        for (idx = *headp; idx != PROFILER_NONE;
+             idx = VEC_ELEM(profiler->stacks, idx).next) {
+                struct profiler_stack *s = &VEC_ELEM(profiler->stacks, idx);
+                if (s->hash == h && s->op == op && s->nframes == nframes &&
+                    !memcmp(&VEC_ELEM(profiler->frames, s->frameidx), frames,
+                            nframes * sizeof(*frames))) {
+                        s->weight_us += weight_us;
+                        return 0;
+                }
+        }
+        ret = VEC_PREALLOC(profiler->mctx, profiler->stacks, 1);
+        if (ret != 0) {
+                return ret;
+        }
+        ret = VEC_PREALLOC(profiler->mctx, profiler->frames, nframes);
+        if (ret != 0) {
+                return ret;
+        }
+        struct profiler_stack *s = VEC_PUSH(profiler->stacks);
+        s->hash = h;
+        s->op = op;
+        s->nframes = nframes;
+        s->frameidx = profiler->frames.lsize;
+        s->weight_us = weight_us;
+        s->next = *headp;
+        *headp = profiler->stacks.lsize - 1;
+        if (nframes > 0) {
+                memcpy(&VEC_NEXTELEM(profiler->frames), frames,
+                       nframes * sizeof(*frames));
+                profiler->frames.lsize += nframes;
+        }
+        return 0;
+}
+
+static int
+profiler_sample1(struct profiler *profiler, const struct exec_context *ctx,
+                 uint64_t weight_us)
+{
+        const uint32_t nframes = ctx->frames.lsize;
+        uint32_t i;
+        int ret;
+
+        ret = VEC_RESIZE(profiler->mctx, profiler->scratch, nframes);
+        if (ret != 0) {
+                return ret;
+        }
+        for (i = 0; i < nframes; i++) {
+                const struct funcframe *frame = &VEC_ELEM(ctx->frames, i);
+                ret = profiler_lookup_func(profiler, frame->instance->module,
+                                           frame->funcidx,
+                                           &VEC_ELEM(profiler->scratch, i));
+                if (ret != 0) {
+                        return ret;
+                }
+        }
+
+        /*
+         * the instruction we are going to execute next.
+         * it's always a valid instruction as the code has been validated.
+         */
+        const uint8_t *p = ctx->p;
+        uint32_t group = *p++;
+        uint32_t op;
+        if (group == 0xfc || group == 0xfd || group == 0xfe) {
+                op = read_leb_u32_nocheck(&p);
+        } else {
+                op = group;
+                group = 0;
+        }
+        return profiler_record(profiler, (group << 24) | op, weight_us);
+}
+
+int
+profiler_create(struct mem_context *mctx, uint32_t interval_ms,
+                struct profiler **profilerp)
+{
+        struct profiler *profiler;
+
+        if (interval_ms < PROFILER_INTERVAL_MS_MIN) {
+                return EINVAL;
+        }
+        profiler = mem_zalloc(mctx, sizeof(*profiler));
+        if (profiler == NULL) {
+                return ENOMEM;
+        }
+        profiler->mctx = mctx;
+        profiler->interval_ms = interval_ms;
+        toywasm_mutex_init(&profiler->lock);
+        memset(profiler->func_hash, 0xff, sizeof(profiler->func_hash));
+        memset(profiler->stack_hash, 0xff, sizeof(profiler->stack_hash));
+        VEC_INIT(profiler->funcs);
+        VEC_INIT(profiler->stacks);
+        VEC_INIT(profiler->frames);
+        VEC_INIT(profiler->scratch);
+        nametable_init(&profiler->nametable);
+        *profilerp = profiler;
+        return 0;
+}
+
+void
+profiler_destroy(struct profiler *profiler)
+{
+        struct mem_context *mctx = profiler->mctx;
+        struct profiler_func *f;
+        VEC_FOREACH(f, profiler->funcs) {
+                mem_free(mctx, f->name, f->namelen + 1);
+        }
+        VEC_FREE(mctx, profiler->funcs);
+        VEC_FREE(mctx, profiler->stacks);
+        VEC_FREE(mctx, profiler->frames);
+        VEC_FREE(mctx, profiler->scratch);
+        nametable_clear(&profiler->nametable);
+        toywasm_mutex_destroy(&profiler->lock);
+        mem_free(mctx, profiler, sizeof(*profiler));
+}
+
+uint32_t
+profiler_interval_ms(const struct profiler *profiler)
+{
+        return profiler->interval_ms;
+}
+
+void
+profiler_sample(struct profiler *profiler, const struct exec_context *ctx,
+                uint64_t weight_us)
+{
+        toywasm_mutex_lock(&profiler->lock);
+        int ret = profiler_sample1(profiler, ctx, weight_us);
+        if (ret == 0) {
+                profiler->nsamples++;
+        } else {
+                /* just drop the sample. it isn't fatal for the execution. */
+                profiler->ndropped++;
+        }
+        toywasm_mutex_unlock(&profiler->lock);
+}
+
+int
+profiler_write(struct profiler *profiler, const char *filename)
+{
+        int ret;
+
+        FILE *fp = fopen(filename, "w");
+        if (fp == NULL) {
+                assert(errno != 0);
+                return errno;
+        }
+        toywasm_mutex_lock(&profiler->lock);
+        const struct profiler_stack *s;
+        VEC_FOREACH(s, profiler->stacks) {
+                uint32_t i;
+                for (i = 0; i < s->nframes; i++) {
+                        const uint32_t idx =
+                                VEC_ELEM(profiler->frames, s->frameidx + i);
+                        const struct profiler_func *f =
+                                &VEC_ELEM(profiler->funcs, idx);
+                        fprintf(fp, "%s;", f->name);
+                }
+                fprintf(fp, "%s %" PRIu64 "\n",
+                        instruction_name(s->op >> 24, s->op & 0xffffff),
+                        s->weight_us);
+        }
+        xlog_trace("profiler: %" PRIu64 " samples (%" PRIu64
+                   " dropped) %" PRIu32 " stacks %" PRIu32 " functions",
+                   profiler->nsamples, profiler->ndropped,
+                   profiler->stacks.lsize, profiler->funcs.lsize);
+        toywasm_mutex_unlock(&profiler->lock);
+        bool error = ferror(fp);
+        ret = fclose(fp);
+        if (ret != 0) {
+                assert(errno != 0);
+                return errno;
+        }
+        if (error) {
+                return EIO;
+        }
+        return 0;
+}
+
+#endif /* defined(TOYWASM_ENABLE_PROFILER) */
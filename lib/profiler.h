@@ -0,0 +1,67 @@
+#if !defined(_TOYWASM_PROFILER_H)
+#define _TOYWASM_PROFILER_H
+
+#include <stdint.h>
+
+#include "platform.h"
+
+struct exec_context;
+struct mem_context;
+struct profiler;
+
+__BEGIN_EXTERN_C
+
+/*
+ * a sampling profiler.
+ *
+ * to use it, an embedder creates a profiler with profiler_create and
+ * sets it to exec_context::profiler before starting execution.
+ * while executing wasm code, the interpreter main loop takes a sample
+ * of the wasm call stack and the instruction being executed about
+ * every interval_ms milliseconds. it piggybacks on the periodic
+ * check_interrupt() call. (see adjust_check_interval in exec.c)
+ * a profiler can be shared among exec_contexts, including ones
+ * running on different threads.
+ *
+ * each sample is weighted by the time elapsed since the previous
+ * sample of the exec_context, in microseconds. the actual interval
+ * can be quite different from interval_ms because the interpreter
+ * can only estimate how many instructions it executes in a given time.
+ *
+ * profiler_write writes the samples in the "folded stacks" format
+ * understood by flamegraph tools. (eg. flamegraph.pl, inferno, speedscope)
+ * each line looks like:
+ *
+ *   caller;callee;opcode microseconds
+ *
+ * functions are named after the name section, or the export names
+ * if the module doesn't have the name section. functions without names
+ * are shown as func[funcidx].
+ *
+ * Note: time spent outside of the interpreter loop, eg. in host
+ * functions, is not sampled. it's counted in the weight of
+ * the next sample if the interpreter loop doesn't return in
+ * the meantime.
+ *
+ * Note: the modules should not be destroyed while they are
+ * being profiled.
+ *
+ * these functions are available only if toywasm is built with
+ * TOYWASM_ENABLE_PROFILER.
+ */
+#define PROFILER_INTERVAL_MS_DEFAULT 10
+#define PROFILER_INTERVAL_MS_MIN 2
+
+int profiler_create(struct mem_context *mctx, uint32_t interval_ms,
+                    struct profiler **profilerp);
+void profiler_destroy(struct profiler *profiler);
+int profiler_write(struct profiler *profiler, const char *filename);
+
+/* for the interpreter */
+uint32_t profiler_interval_ms(const struct profiler *profiler);
+void profiler_sample(struct profiler *profiler, const struct exec_context *ctx,
+                     uint64_t weight_us);
+
+__END_EXTERN_C
+
+#endif /* !defined(_TOYWASM_PROFILER_H) */
@@ -0,0 +1,201 @@
+#if !defined(_TOYWASM_SIMD_VECTOR_H)
+#define _TOYWASM_SIMD_VECTOR_H
+
+/*
+ * helpers to implement wasm SIMD instructions with the vector extensions
+ * of the host C compiler.
+ *
+ * https://gcc.gnu.org/onlinedocs/gcc/Vector-Extensions.html
+ * https://clang.llvm.org/docs/LanguageExtensions.html#vectors-and-extended-vectors
+ *
+ * the compiler lowers the generic vector operations to whatever the
+ * target provides. (eg. SSE2/AVX2 on x86, NEON on arm64, simd128 on wasm)
+ * a few operations, which the generic vector extensions can't express
+ * efficiently, use target-specific intrinsics directly.
+ *
+ * the wasm v128 representation in memory is little endian. we only use
+ * this on little endian hosts so that wasm lanes and host vector lanes
+ * have the same layout.
+ *
+ * USE_HOST_SIMD is defined if it's enabled with TOYWASM_USE_HOST_SIMD
+ * and available. for wasm targets, it also requires simd128.
+ * (TOYWASM_USE_SIMD) otherwise the compiler would lower the vectors
+ * to scalar code, which is no better than the portable implementation.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+#include "toywasm_config.h"
+#include "type.h"
+
+#if defined(TOYWASM_USE_HOST_SIMD) && defined(__GNUC__) &&                    \
+        defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#if __has_builtin(__builtin_convertvector) &&                                  \
+        (!defined(__wasm__) || defined(__wasm_simd128__))
+#define USE_HOST_SIMD
+#endif
+#endif
+
+#if defined(USE_HOST_SIMD)
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#else
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#endif
+
+#define SIMD_VECTOR_TYPE(T, N) T __attribute__((vector_size(N)))
+
+/*
+ * following the convention of this implementation, "i" lanes are
+ * unsigned. "s" is used for signed lanes.
+ */
+typedef SIMD_VECTOR_TYPE(uint8_t, 16) simd_i8;
+typedef SIMD_VECTOR_TYPE(int8_t, 16) simd_s8;
+typedef SIMD_VECTOR_TYPE(uint16_t, 16) simd_i16;
+typedef SIMD_VECTOR_TYPE(int16_t, 16) simd_s16;
+typedef SIMD_VECTOR_TYPE(uint32_t, 16) simd_i32;
+typedef SIMD_VECTOR_TYPE(int32_t, 16) simd_s32;
+typedef SIMD_VECTOR_TYPE(uint64_t, 16) simd_i64;
+typedef SIMD_VECTOR_TYPE(int64_t, 16) simd_s64;
+typedef SIMD_VECTOR_TYPE(float, 16) simd_f32;
+typedef SIMD_VECTOR_TYPE(double, 16) simd_f64;
+
+/* the half of v128. for extending and narrowing conversions */
+typedef SIMD_VECTOR_TYPE(uint8_t, 8) simd_i8x8;
+typedef SIMD_VECTOR_TYPE(int8_t, 8) simd_s8x8;
+typedef SIMD_VECTOR_TYPE(uint16_t, 8) simd_i16x4;
+typedef SIMD_VECTOR_TYPE(int16_t, 8) simd_s16x4;
+typedef SIMD_VECTOR_TYPE(uint32_t, 8) simd_i32x2;
+typedef SIMD_VECTOR_TYPE(int32_t, 8) simd_s32x2;
+typedef SIMD_VECTOR_TYPE(float, 8) simd_f32x2;
+
+/*
+ * Note: use memcpy as the values on the operand stack and
+ * in the linear memory are not necessarily aligned.
+ * compilers turn them into unaligned vector loads/stores.
+ */
+
+static inline simd_i8
+simd_load(const void *p)
+{
+        simd_i8 v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+}
+
+static inline void
+simd_store(void *p, simd_i8 v)
+{
+        memcpy(p, &v, sizeof(v));
+}
+
+/*
+ * i8x16.swizzle: out-of-range indexes (>= 16) select 0.
+ */
+static inline void
+simd_swizzle(union v128 *r, const union v128 *a, const union v128 *idx)
+{
+#if defined(__aarch64__) && defined(__ARM_NEON)
+        vst1q_u8(r->i8, vqtbl1q_u8(vld1q_u8(a->i8), vld1q_u8(idx->i8)));
+#elif defined(__wasm_simd128__)
+        wasm_v128_store(r, wasm_i8x16_swizzle(wasm_v128_load(a),
+                                              wasm_v128_load(idx)));
+#elif defined(__SSSE3__)
+        /* pshufb selects 0 if the msb of the index is set */
+        const __m128i i = _mm_adds_epu8(
+                _mm_loadu_si128((const void *)idx), _mm_set1_epi8(0x70));
+        const __m128i va = _mm_loadu_si128((const void *)a);
+        _mm_storeu_si128((void *)r, _mm_shuffle_epi8(va, i));
+#elif !defined(__clang__)
+        /*
+         * GCC's __builtin_shuffle with two operands takes the indexes
+         * modulo 32. map out-of-range indexes to the zero vector.
+         */
+        const simd_i8 zero = {0};
+        simd_i8 i = simd_load(idx);
+        i = (i & (simd_i8)(i < 16)) | (16 & (simd_i8)(i >= 16));
+        simd_store(r, __builtin_shuffle(simd_load(a), zero, i));
+#else
+        uint8_t result[16];
+        unsigned int i;
+        for (i = 0; i < 16; i++) {
+                uint8_t s = idx->i8[i];
+                result[i] = (s < 16) ? a->i8[s] : 0;
+        }
+        memcpy(r, result, sizeof(result));
+#endif
+}
+
+/*
+ * i8x16.shuffle: the indexes are validated to be < 32.
+ */
+static inline void
+simd_shuffle(union v128 *r, const union v128 *a, const union v128 *b,
+             const uint8_t lane[16])
+{
+#if defined(__aarch64__) && defined(__ARM_NEON)
+        const uint8x16x2_t t = {{vld1q_u8(a->i8), vld1q_u8(b->i8)}};
+        vst1q_u8(r->i8, vqtbl2q_u8(t, vld1q_u8(lane)));
+#elif !defined(__clang__)
+        simd_store(r, __builtin_shuffle(simd_load(a), simd_load(b),
+                                        simd_load(lane)));
+#elif defined(__SSSE3__)
+        const __m128i i = _mm_loadu_si128((const void *)lane);
+        /* lanes from a: 0-15. lanes from b: 16-31. */
+        const __m128i ia =
+                _mm_or_si128(i, _mm_cmpgt_epi8(i, _mm_set1_epi8(15)));
+        const __m128i ib = _mm_sub_epi8(i, _mm_set1_epi8(16));
+        _mm_storeu_si128(
+                (void *)r,
+                _mm_or_si128(
+                        _mm_shuffle_epi8(_mm_loadu_si128((const void *)a), ia),
+                        _mm_shuffle_epi8(_mm_loadu_si128((const void *)b),
+                                         ib)));
+#else
+        uint8_t result[16];
+        unsigned int i;
+        for (i = 0; i < 16; i++) {
+                uint8_t s = lane[i];
+                result[i] = (s < 16) ? a->i8[s] : b->i8[s - 16];
+        }
+        memcpy(r, result, sizeof(result));
+#endif
+}
+
+/*
+ * i8x16.bitmask
+ */
+static inline uint32_t
+simd_bitmask8(const union v128 *a)
+{
+#if defined(__SSE2__)
+        return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const void *)a));
+#else
+        /*
+         * take the msb of each lanes, move it to the bit position
+         * in the byte, and then sum the bytes in each 64-bit halves.
+         * as the bits don't overlap, the sums never carry.
+         */
+        const simd_i8 weights = {1, 2, 4, 8, 16, 32, 64, 128,
+                                 1, 2, 4, 8, 16, 32, 64, 128};
+        const simd_i64 bits = (simd_i64)(
+                ((simd_s8)simd_load(a) < 0) & (simd_s8)weights);
+        const uint64_t m = UINT64_C(0x0101010101010101);
+        return (uint32_t)((bits[0] * m) >> 56) |
+               (uint32_t)(((bits[1] * m) >> 56) << 8);
+#endif
+}
+
+#endif /* defined(USE_HOST_SIMD) */
+
+#endif /* !defined(_TOYWASM_SIMD_VECTOR_H) */
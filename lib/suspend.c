@@ -8,6 +8,13 @@
 #include "xlog.h"
 
 #if !defined(TOYWASM_USE_USER_SCHED)
+static bool
+all_parked(const struct cluster *c) REQUIRES(c->lock)
+{
+        /* all threads except the one calling suspend_threads */
+        return c->nrunners == c->nparked + c->noffcpu + 1;
+}
+
 static void
 parked(struct cluster *c) REQUIRES(c->lock)
 {
@@ -15,7 +22,7 @@ parked(struct cluster *c) REQUIRES(c->lock)
         assert(c->nrunners > c->nparked);
         xlog_trace("%s: parked %" PRIu32 " / %" PRIu32, __func__, c->nparked,
                    c->nrunners);
-        if (c->nrunners == c->nparked + 1) {
+        if (all_parked(c)) {
                 toywasm_cv_broadcast(&c->stop_cv, &c->lock);
         }
         while (c->suspend_state == SUSPEND_STATE_STOPPING) {
@@ -26,7 +33,7 @@ parked(struct cluster *c) REQUIRES(c->lock)
         assert(c->nparked > 0);
         assert(c->nrunners > c->nparked);
         c->nparked--;
-        assert(c->nrunners != c->nparked + 1);
+        assert(!all_parked(c));
         assert(c->suspend_state == SUSPEND_STATE_RESUMING);
         if (c->nparked == 0) {
                 c->suspend_state = SUSPEND_STATE_NONE;
@@ -87,7 +94,7 @@ retry:
         struct timespec end;
         timespec_now(CLOCK_REALTIME, &start);
         c->suspend_state = SUSPEND_STATE_STOPPING;
-        while (c->nrunners != c->nparked + 1) {
+        while (!all_parked(c)) {
                 xlog_trace("%s: waiting %" PRIu32 " / %" PRIu32, __func__,
                            c->nparked, c->nrunners);
                 toywasm_cv_wait(&c->stop_cv, &c->lock);
@@ -112,7 +119,7 @@ resume_threads(struct cluster *c)
         xlog_trace("%s: resuming", __func__);
         toywasm_mutex_lock(&c->lock);
         assert(c->suspend_state == SUSPEND_STATE_STOPPING);
-        assert(c->nrunners == c->nparked + 1);
+        assert(all_parked(c));
         if (c->nparked > 0) {
                 c->suspend_state = SUSPEND_STATE_RESUMING;
         } else {
@@ -122,3 +129,31 @@ resume_threads(struct cluster *c)
         toywasm_mutex_unlock(&c->lock);
 #endif /* !defined(TOYWASM_USE_USER_SCHED) */
 }
+
+void
+suspend_offcpu(struct cluster *c)
+{
+#if !defined(TOYWASM_USE_USER_SCHED)
+        toywasm_mutex_lock(&c->lock);
+        c->noffcpu++;
+        assert(c->nrunners >= c->nparked + c->noffcpu);
+        if (c->suspend_state == SUSPEND_STATE_STOPPING && all_parked(c)) {
+                toywasm_cv_broadcast(&c->stop_cv, &c->lock);
+        }
+        toywasm_mutex_unlock(&c->lock);
+#endif /* !defined(TOYWASM_USE_USER_SCHED) */
+}
+
+void
+suspend_oncpu(struct cluster *c)
+{
+#if !defined(TOYWASM_USE_USER_SCHED)
+        toywasm_mutex_lock(&c->lock);
+        while (c->suspend_state == SUSPEND_STATE_STOPPING) {
+                toywasm_cv_wait(&c->stop_cv, &c->lock);
+        }
+        assert(c->noffcpu > 0);
+        c->noffcpu--;
+        toywasm_mutex_unlock(&c->lock);
+#endif /* !defined(TOYWASM_USE_USER_SCHED) */
+}
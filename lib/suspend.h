@@ -38,3 +38,17 @@ void suspend_threads(struct cluster *c);
  * should only be called after a successful call of suspend_threads().
  */
 void resume_threads(struct cluster *c);
+
+/*
+ * suspend_offcpu: called by a scheduler when a thread is descheduled.
+ * suspend_oncpu: called by a scheduler before running a thread.
+ *
+ * a thread between them doesn't access the memory. suspend_threads
+ * treats it as if it's parked. suspend_oncpu blocks while other
+ * threads are being suspended.
+ *
+ * these are for schedulers which run many threads on a few host
+ * threads. (TOYWASM_USE_MN_SCHED)
+ */
+void suspend_offcpu(struct cluster *c);
+void suspend_oncpu(struct cluster *c);
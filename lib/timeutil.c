@@ -125,6 +125,20 @@ timespec_to_ms(const struct timespec *tv)
         return ms1 + ms2;
 }
 
+uint64_t
+timespec_to_us(const struct timespec *tv)
+{
+        if (UINT64_MAX / 1000000 < (uint64_t)tv->tv_sec) {
+                return UINT64_MAX;
+        }
+        uint64_t us1 = (uint64_t)tv->tv_sec * 1000000;
+        uint64_t us2 = tv->tv_nsec / 1000;
+        if (UINT64_MAX - us1 < us2) {
+                return UINT64_MAX;
+        }
+        return us1 + us2;
+}
+
 #if !defined(_WIN32)
 int
 timespec_now(clockid_t id, struct timespec *a)
@@ -20,6 +20,7 @@ void timespec_sub(const struct timespec *a, const struct timespec *b,
                   struct timespec *c);
 int timespec_from_ns(struct timespec *a, uint64_t ns);
 uint64_t timespec_to_ms(const struct timespec *tv);
+uint64_t timespec_to_us(const struct timespec *tv);
 
 #if !defined(_WIN32)
 int timespec_now(clockid_t id, struct timespec *a);
@@ -237,12 +237,76 @@ compare_resulttype(const struct resulttype *a, const struct resulttype *b)
 int
 compare_functype(const struct functype *a, const struct functype *b)
 {
+        if (a->id != 0 && b->id != 0) {
+                return a->id != b->id;
+        }
         if (compare_resulttype(&a->parameter, &b->parameter)) {
                 return 1;
         }
         return compare_resulttype(&a->result, &b->result);
 }
 
+static uint64_t
+valtype_id(enum valtype t)
+{
+        switch (t) {
+        case TYPE_i32:
+                return 1;
+        case TYPE_i64:
+                return 2;
+        case TYPE_f32:
+                return 3;
+        case TYPE_f64:
+                return 4;
+        case TYPE_v128:
+                return 5;
+        case TYPE_funcref:
+                return 6;
+        case TYPE_externref:
+                return 7;
+        case TYPE_exnref:
+                return 8;
+        default:
+                assert(false);
+                return 0;
+        }
+}
+
+/*
+ * functype_set_id: calculate the canonical id of the type.
+ *
+ * the id is simply an encoding of the type: a 4-bit code for each
+ * parameter, 0xf as a separator, and then a 4-bit code for each result.
+ * because the codes are non-zero, it's unique without any
+ * interning table. thus it works across modules and host functions,
+ * eg. for funcrefs passed among instances.
+ *
+ * a type with more than 15 parameters and results in total doesn't
+ * fit. it gets 0, which makes compare_functype compare the types
+ * structurally.
+ */
+void
+functype_set_id(struct functype *ft)
+{
+        const struct resulttype *pt = &ft->parameter;
+        const struct resulttype *rt = &ft->result;
+        uint64_t id = 0;
+        uint32_t i;
+
+        ft->id = 0;
+        if (pt->ntypes + rt->ntypes > 15) {
+                return;
+        }
+        for (i = 0; i < pt->ntypes; i++) {
+                id = (id << 4) | valtype_id(pt->types[i]);
+        }
+        id = (id << 4) | 0xf;
+        for (i = 0; i < rt->ntypes; i++) {
+                id = (id << 4) | valtype_id(rt->types[i]);
+        }
+        ft->id = id;
+}
+
 int
 compare_name(const struct name *a, const struct name *b)
 {
@@ -339,6 +403,7 @@ functype_from_string(struct mem_context *mctx, const char *p,
         if (ret != 0) {
                 goto fail;
         }
+        functype_set_id(ft);
         *resultp = ft;
         return 0;
 fail:
@@ -9,6 +9,7 @@
 #include "bitmap.h"
 #include "cell.h"
 #include "lock.h"
+#include "options.h"
 #include "platform.h"
 #include "vec.h"
 
@@ -25,6 +26,14 @@ struct jump {
         uint32_t targetpc;
 };
 
+/*
+ * jump hash. see expr_exec_info.
+ * a multiplicative hash. "bits" should be in [1, 32).
+ */
+#define JUMP_HASH_EMPTY UINT32_MAX
+#define JUMP_HASH(pc, bits)                                                   \
+        ((uint32_t)((uint32_t)(pc) * UINT32_C(0x9e3779b1)) >> (32 - (bits)))
+
 /*
  * type annotations. see doc/annotations.md
  */
@@ -43,6 +52,16 @@ struct type_annotations {
 struct expr_exec_info {
         uint32_t njumps;
         struct jump *jumps;
+#if defined(TOYWASM_USE_JUMP_HASH)
+        /*
+         * an open-addressing hash table to map a block pc to
+         * the index of the corresponding entry in jumps[].
+         * (JUMP_HASH_EMPTY for empty slots)
+         * the table has (1 << jump_hash_bits) slots.
+         */
+        uint32_t *jump_hash;
+        uint32_t jump_hash_bits;
+#endif
 
         uint32_t maxlabels; /* max labels (including the implicit one) */
         uint32_t maxcells;  /* max cells on stack */
@@ -129,6 +148,13 @@ struct resulttype {
 struct functype {
         struct resulttype parameter;
         struct resulttype result;
+
+        /*
+         * a canonical id of the type. (functype_set_id)
+         * two types with non-zero ids are the same iff the ids are equal.
+         * 0 if unknown or the type is too large to have an id.
+         */
+        uint64_t id;
 };
 
 struct funcref {
@@ -259,6 +285,14 @@ struct localtype {
 #if defined(TOYWASM_USE_LOCALTYPE_CELLIDX)
         struct localcellidx cellidx;
 #endif
+#if defined(TOYWASM_USE_UNIFORM_LOCALS)
+        /*
+         * the cell size of the parameters and the locals of the function
+         * if all of them have the same size. otherwise 0.
+         * cellidx is not used if it's non-zero.
+         */
+        uint8_t csz;
+#endif
 };
 
 struct func {
@@ -473,13 +507,47 @@ enum section_id {
  * - names
  * - data segments
  * - exprs
- * - module->bin (currently only used to calculate "pc")
+ * - module->bin (used to calculate "pc" and to identify the module
+ *   in a snapshot)
  *
  * This structure and all referenced child structures are read-only
  * until module_destroy().
  * Thus it can be safely shared among threads without any serializations.
+ * (An exception is the annotations of functions with deferred validation,
+ * which are serialized by struct lazy_validation.)
  */
 
+#if defined(TOYWASM_ENABLE_LAZY_VALIDATION)
+/*
+ * load_options.lazy_validation defers the validation of function bodies
+ * (and thus the generation of their annotations) until their first call.
+ */
+enum lazy_func_state {
+        LAZY_FUNC_VALID = 0,
+        LAZY_FUNC_PENDING,
+        LAZY_FUNC_INVALID,
+};
+
+struct lazy_func {
+        uint32_t size; /* the size of the body expr in bytes */
+        _Atomic uint8_t state; /* enum lazy_func_state */
+};
+
+struct lazy_validation {
+        TOYWASM_MUTEX_DEFINE(lock);
+        uint32_t npending;
+        struct lazy_func *funcs; /* shares indexes with module->funcs */
+
+        /* a copy of the load-time states needed for validation */
+        struct mem_context *mctx;
+        struct load_options options;
+        struct bitmap refs;
+        uint32_t refs_size;
+        bool has_datacount;
+        uint32_t ndatas_in_datacount;
+};
+#endif
+
 struct module {
         uint32_t ntypes;
         struct functype *types;
@@ -524,6 +592,7 @@ struct module {
         struct wasm_export *exports;
 
         const uint8_t *bin;
+        size_t binsz;
 
 #if defined(TOYWASM_ENABLE_WASM_NAME_SECTION)
         /*
@@ -541,6 +610,12 @@ struct module {
 #if defined(TOYWASM_ENABLE_DYLD)
         struct dylink *dylink;
 #endif
+#if defined(TOYWASM_ENABLE_LAZY_VALIDATION)
+        /*
+         * NULL if every function has been validated at the load time.
+         */
+        struct lazy_validation *lazy;
+#endif
 };
 
 struct exec_context;
@@ -577,8 +652,26 @@ struct meminst {
          * in case of sub-page allocation. wasm page size (64KB) is a bit
          * too large for small use cases. the sub-page allocation is an
          * implementation detail which is not visible to the wasm modules.
+         *
+         * Note: memory_getptr2 reads allocated w/o locks. for a reserved
+         * shared memory, memory.grow updates it without suspending
+         * other threads. thus it's _Atomic when threads are enabled.
+         * (see meminst_allocated in exec_insn_subr.c)
          */
+#if defined(TOYWASM_ENABLE_WASM_THREADS)
+        _Atomic size_t allocated;
+#else
         size_t allocated;
+#endif
+#if defined(TOYWASM_USE_RESERVED_MEMORY)
+        /*
+         * meminst->reserved is the size of the address space reserved
+         * for meminst->data with mem_vm_reserve. when it's non-zero,
+         * meminst->data never moves and meminst->allocated is always
+         * same as the size of the memory in bytes.
+         */
+        size_t reserved;
+#endif
         const struct memtype *type;
 
 #if defined(TOYWASM_ENABLE_WASM_THREADS)
@@ -609,6 +702,13 @@ struct tableinst {
         struct cell *cells;
         uint32_t size; /* overrides type->min */
         const struct tabletype *type;
+
+        /*
+         * renewed whenever the contents of the table are modified.
+         * it allows caching of table lookups. (eg. call_indirect)
+         * unique among all tables in the process. (table_bump_gen)
+         */
+        uint64_t gen;
         struct mem_context *mctx;
 };
 
@@ -736,6 +836,7 @@ int functype_to_string(char **p, const struct functype *ft);
 void functype_string_free(char *p);
 
 void clear_functype(struct mem_context *mctx, struct functype *ft);
+void functype_set_id(struct functype *ft);
 void clear_resulttype(struct mem_context *mctx, struct resulttype *rt);
 
 /*
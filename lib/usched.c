@@ -20,10 +20,12 @@
  *   so that the thread has a chances to check reschedule requests
  *   frequently enough.
  *
- * - no real i/o wait. when a thread wants to block on an i/o event, it just
- *   yields the cpu to other threads. when the thread is scheduled next time,
- *   it simply polls the event again. an ideal scheduler implementation
- *   would have a list of event sources to poll on instead.
+ * - no real i/o wait by default. when a thread wants to block on an i/o
+ *   event, it just yields the cpu to other threads. when the thread is
+ *   scheduled next time, it simply polls the event again.
+ *   an exception is TOYWASM_USE_WASI_IO_URING, which uses an event source
+ *   (sched_block/sched_wakeup) to keep threads waiting for i/o off
+ *   the run queue.
  */
 
 #include <assert.h>
@@ -50,8 +52,27 @@ sched_run(struct sched *sched, struct exec_context *caller)
         struct runq *q = &sched->runq;
         struct exec_context *ctx;
 
-        while ((ctx = SLIST_FIRST(q)) != NULL) {
+        while (true) {
                 int ret;
+                if (sched->nblocked > 0) {
+                        /*
+                         * pick up the threads whose events have happened.
+                         * if no threads are runnable, block on the
+                         * event source.
+                         */
+                        int timeout_ms = 0;
+                        if (SLIST_FIRST(q) == NULL) {
+                                timeout_ms = RR_INTERVAL_MS;
+                        }
+                        sched->evsrc->wait(sched->evsrc, sched, timeout_ms);
+                }
+                ctx = SLIST_FIRST(q);
+                if (ctx == NULL) {
+                        if (sched->nblocked > 0) {
+                                continue;
+                        }
+                        break;
+                }
                 SLIST_REMOVE_HEAD(q, ctx, rq);
                 xlog_trace("%s: running ctx %p", __func__, (void *)ctx);
                 ret = abstime_from_reltime_ms(
@@ -69,6 +90,11 @@ sched_run(struct sched *sched, struct exec_context *caller)
                  */
                 ret = instance_execute_continue(ctx);
                 if (IS_RESTARTABLE(ret) && ret != ETOYWASMUSERINTERRUPT) {
+                        if (ctx->sched_blocked) {
+                                xlog_trace("%s: ctx %p blocked", __func__,
+                                           (void *)ctx);
+                                continue;
+                        }
                         xlog_trace("%s: re-enqueueing ctx %p", __func__,
                                    (void *)ctx);
                         SLIST_INSERT_TAIL(q, ctx, rq);
@@ -88,11 +114,14 @@ void
 sched_init(struct sched *sched)
 {
         SLIST_HEAD_INIT(&sched->runq);
+        sched->nblocked = 0;
+        sched->evsrc = NULL;
 }
 
 void
 sched_clear(struct sched *sched)
 {
+        assert(sched->nblocked == 0);
 }
 
 bool
@@ -101,8 +130,12 @@ sched_need_resched(struct sched *sched)
         struct timespec now;
         int ret;
 
-        /* if we are the only thread, no point to resched. */
-        if (SLIST_FIRST(&sched->runq) == NULL) {
+        /*
+         * if we are the only thread, no point to resched.
+         * blocked threads count here because their events are only
+         * processed by sched_run.
+         */
+        if (SLIST_FIRST(&sched->runq) == NULL && sched->nblocked == 0) {
                 return false;
         }
 
@@ -123,3 +156,49 @@ sched_need_resched(struct sched *sched)
         }
         return false;
 }
+
+void
+sched_block(struct sched *sched, struct exec_context *ctx,
+            struct sched_event_source *src)
+{
+        xlog_trace("%s: blocking ctx %p", __func__, (void *)ctx);
+        assert(sched == ctx->sched);
+        assert(!ctx->sched_blocked);
+        assert(sched->evsrc == NULL || sched->evsrc == src);
+        sched->evsrc = src;
+        ctx->sched_blocked = true;
+        sched->nblocked++;
+}
+
+void
+sched_wakeup(struct sched *sched, struct exec_context *ctx)
+{
+        xlog_trace("%s: waking up ctx %p", __func__, (void *)ctx);
+        assert(sched == ctx->sched);
+        assert(ctx->sched_blocked);
+        assert(sched->nblocked > 0);
+        ctx->sched_blocked = false;
+        sched->nblocked--;
+        SLIST_INSERT_TAIL(&sched->runq, ctx, rq);
+}
+
+bool
+sched_wait_events(struct sched *sched, const struct timespec *abstimeout)
+{
+        const uint32_t nblocked = sched->nblocked;
+        int timeout_ms;
+        int ret;
+
+        if (nblocked == 0) {
+                return false;
+        }
+        ret = abstime_to_reltime_ms_roundup(CLOCK_REALTIME, abstimeout,
+                                            &timeout_ms);
+        if (ret != 0) {
+                xlog_error("%s: abstime_to_reltime_ms_roundup failed with %d",
+                           __func__, ret);
+                timeout_ms = 0;
+        }
+        sched->evsrc->wait(sched->evsrc, sched, timeout_ms);
+        return sched->nblocked < nblocked;
+}
@@ -1,14 +1,37 @@
 #include <stdbool.h>
+#include <stdint.h>
 #include <time.h>
 
 #include "platform.h"
 #include "slist.h"
 
 struct exec_context;
+struct sched;
+
+/*
+ * an event source, which threads blocked with sched_block wait on.
+ * eg. io_uring. (libwasi/wasi_uring.c)
+ *
+ * wait: wait for events up to timeout_ms and call sched_wakeup for
+ * the threads whose events have happened.
+ * if timeout_ms is 0, it should only process the events which have
+ * already happened.
+ * if timeout_ms is not 0 and no threads have been woken up within
+ * the timeout, it should wake up all the threads blocked on the source
+ * so that they can check interrupts. (eg. proc_exit from another thread)
+ */
+struct sched_event_source {
+        void (*wait)(struct sched_event_source *src, struct sched *sched,
+                     int timeout_ms);
+};
 
 struct sched {
         SLIST_HEAD_NAMED(struct exec_context, runq) runq;
         struct timespec next_resched;
+
+        /* the number of threads blocked with sched_block */
+        uint32_t nblocked;
+        struct sched_event_source *evsrc;
 };
 
 __BEGIN_EXTERN_C
@@ -19,4 +42,29 @@ void sched_init(struct sched *sched);
 void sched_clear(struct sched *sched);
 bool sched_need_resched(struct sched *sched);
 
+/*
+ * sched_block: make the running thread wait for an event from src.
+ *
+ * the caller should return a restartable error (ETOYWASMRESTART) to
+ * yield the scheduler. the thread is not scheduled until the event
+ * source calls sched_wakeup for it.
+ *
+ * only a single event source is supported per scheduler.
+ */
+void sched_block(struct sched *sched, struct exec_context *ctx,
+                 struct sched_event_source *src);
+void sched_wakeup(struct sched *sched, struct exec_context *ctx);
+
+/*
+ * sched_wait_events: wait for the events for the blocked threads
+ * up to abstimeout. (CLOCK_REALTIME)
+ *
+ * it's intended to be used by a thread which has nothing to do but
+ * waiting for other threads. eg. memory.atomic.wait.
+ * returns true if any threads have been woken up. in that case,
+ * the caller should yield the scheduler.
+ */
+bool sched_wait_events(struct sched *sched,
+                       const struct timespec *abstimeout);
+
 __END_EXTERN_C
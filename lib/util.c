@@ -87,3 +87,15 @@ xstrnstr(const char *haystack, const char *needle, size_t len)
         return NULL;
 #endif
 }
+
+uint64_t
+fnv1a64(uint64_t h, const void *vp, size_t sz)
+{
+        const uint8_t *p = vp;
+        size_t i;
+        for (i = 0; i < sz; i++) {
+                h ^= p[i];
+                h *= UINT64_C(0x100000001b3);
+        }
+        return h;
+}
@@ -23,6 +23,12 @@ int __must_check array_shrink(struct mem_context *ctx, void **p,
 
 #define HOWMANY(a, b) ((a + (b - 1)) / b)
 
+/*
+ * 64-bit FNV-1a hash. start with h = FNV1A64_INIT.
+ */
+#define FNV1A64_INIT UINT64_C(0xcbf29ce484222325)
+uint64_t fnv1a64(uint64_t h, const void *p, size_t sz);
+
 /*
  * strnstr is a FreeBSD extension. xstrnstr is a wrapper of strnstr
  * with a fallback implementation for other platforms.
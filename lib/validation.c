@@ -405,7 +405,7 @@ record_type_annotation(struct validation_context *vctx, const uint8_t *p,
                 }
         } else {
                 assert(an->types[an->ntypes - 1].pc < pc);
-                if (an->types[an->ntypes - 1].size == t) {
+                if (an->types[an->ntypes - 1].size == csz) {
                         return 0;
                 }
         }
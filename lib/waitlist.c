@@ -15,22 +15,9 @@
 #include <pthread.h>
 #endif
 
-#include "list.h"
 #include "waitlist.h"
 #include "xlog.h"
 
-#if defined(USE_PTHREAD)
-static TOYWASM_MUTEX_DEFINE(g_atomics_lock) = {
-        PTHREAD_MUTEX_INITIALIZER,
-};
-#endif
-
-struct waiter {
-        LIST_ENTRY(struct waiter) e;
-        TOYWASM_CV_DEFINE(cv);
-        bool woken;
-};
-
 struct waiter_list {
         struct waiter_list *next;
         LIST_HEAD(struct waiter) waiters;
@@ -38,12 +25,26 @@ struct waiter_list {
         uint32_t nwaiters;
 };
 
+/*
+ * map an address to a bucket.
+ *
+ * atomic accesses are naturally aligned and at most 8 bytes.
+ * use the same bucket for an aligned 8-byte block so that
+ * overlapping accesses of different sizes are serialized by
+ * the same lock.
+ */
+static struct waiter_list_bucket *
+waiter_list_bucket(struct waiter_list_table *tab, uint32_t ident)
+{
+        uint32_t h = (ident >> 3) * UINT32_C(0x9e3779b1);
+        return &tab->buckets[h >> (32 - WAITER_LIST_NBUCKETS_SHIFT)];
+}
+
 struct toywasm_mutex *
 atomics_mutex_getptr(struct waiter_list_table *tab, uint32_t ident)
 {
-        /* REVISIT: is it worth to use finer grained lock? */
 #if defined(USE_PTHREAD)
-        return &g_atomics_lock;
+        return &waiter_list_bucket(tab, ident)->lock;
 #else
         /* return a dummy non-NULL pointer */
         static char dummy;
@@ -56,7 +57,7 @@ waiter_list_lookup(struct waiter_list_table *tab, uint32_t ident,
                    struct toywasm_mutex **lockp, bool allocate)
 {
         struct waiter_list *l;
-        struct waiter_list **headp = &tab->lists[0];
+        struct waiter_list **headp = &waiter_list_bucket(tab, ident)->lists;
         struct toywasm_mutex *lock = atomics_mutex_getptr(tab, ident);
         *lockp = lock;
         for (l = *headp; l != NULL; l = l->next) {
@@ -81,7 +82,7 @@ waiter_list_lookup(struct waiter_list_table *tab, uint32_t ident,
 static void
 waiter_list_free(struct waiter_list_table *tab, struct waiter_list *l1)
 {
-        struct waiter_list **pp = &tab->lists[0];
+        struct waiter_list **pp = &waiter_list_bucket(tab, l1->ident)->lists;
         struct waiter_list *l;
         for (l = *pp; l != NULL; l = *pp) {
                 if (l == l1) {
@@ -100,7 +101,22 @@ waiter_list_free(struct waiter_list_table *tab, struct waiter_list *l1)
 void
 waiter_list_table_init(struct waiter_list_table *tab)
 {
-        tab->lists[0] = 0;
+        uint32_t i;
+        for (i = 0; i < WAITER_LIST_NBUCKETS; i++) {
+                struct waiter_list_bucket *b = &tab->buckets[i];
+                toywasm_mutex_init(&b->lock);
+                b->lists = NULL;
+        }
+}
+
+void
+waiter_list_table_destroy(struct waiter_list_table *tab)
+{
+        uint32_t i;
+        for (i = 0; i < WAITER_LIST_NBUCKETS; i++) {
+                assert(tab->buckets[i].lists == NULL);
+                toywasm_mutex_destroy(&tab->buckets[i].lock);
+        }
 }
 
 static void
@@ -108,6 +124,7 @@ waiter_init(struct waiter *w)
 {
         toywasm_cv_init(&w->cv);
         w->woken = false;
+        w->wakeup = NULL;
 }
 
 static void
@@ -158,6 +175,10 @@ waiter_wakeup(struct waiter_list *l, struct toywasm_mutex *lock,
               struct waiter *w) REQUIRES(lock)
 {
         w->woken = true;
+        if (w->wakeup != NULL) {
+                w->wakeup(w->wakeup_arg);
+                return;
+        }
         toywasm_cv_signal(&w->cv, lock);
 }
 
@@ -240,3 +261,51 @@ atomics_wait(struct waiter_list_table *tab, uint32_t ident,
         waiter_destroy(w);
         return ret;
 }
+
+/*
+ * Note: the lock in held by the caller. (via memory_atomic_getptr)
+ */
+int
+atomics_wait_park(struct waiter_list_table *tab, uint32_t ident,
+                  struct waiter *w, void (*wakeup)(void *arg), void *arg)
+{
+        xlog_trace("%s: ident=%" PRIx32, __func__, ident);
+        struct toywasm_mutex *lock;
+        struct waiter_list *l = waiter_list_lookup(tab, ident, &lock, true);
+        assert_held(lock);
+        if (l == NULL) {
+                return ENOMEM;
+        }
+        if (l->nwaiters == UINT32_MAX) {
+                return EOVERFLOW;
+        }
+        w->woken = false;
+        w->wakeup = wakeup;
+        w->wakeup_arg = arg;
+        waiter_insert_tail(l, w);
+        return 0;
+}
+
+/*
+ * Note: the lock in held by the caller. (via memory_atomic_getptr)
+ */
+bool
+atomics_wait_unpark(struct waiter_list_table *tab, uint32_t ident,
+                    struct waiter *w)
+{
+        xlog_trace("%s: ident=%" PRIx32 " woken=%d", __func__, ident,
+                   (int)w->woken);
+        if (w->woken) {
+                /* atomics_notify has already removed the waiter */
+                return true;
+        }
+        struct toywasm_mutex *lock;
+        struct waiter_list *l = waiter_list_lookup(tab, ident, &lock, false);
+        assert_held(lock);
+        assert(l != NULL);
+        waiter_remove(l, w);
+        if (l->nwaiters == 0) {
+                waiter_list_free(tab, l);
+        }
+        return false;
+}
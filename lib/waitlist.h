@@ -1,20 +1,75 @@
+#if !defined(_TOYWASM_WAITLIST_H)
+#define _TOYWASM_WAITLIST_H
+
+#include <stdbool.h>
 #include <stdint.h>
 
+#include "list.h"
+#include "lock.h"
+
 struct toywasm_mutex;
 struct waiter_list;
 struct timespec;
 
+struct waiter {
+        LIST_ENTRY(struct waiter) e;
+        TOYWASM_CV_DEFINE(cv);
+        bool woken;
+
+        /*
+         * if non-NULL, atomics_notify calls this instead of signalling
+         * the cv. (see atomics_wait_park)
+         */
+        void (*wakeup)(void *arg);
+        void *wakeup_arg;
+};
+
+/*
+ * a shared memory has WAITER_LIST_NBUCKETS buckets.
+ * an address is mapped to a bucket with a hash. each bucket has its own
+ * lock, which serializes atomic operations (including wait/notify)
+ * on the addresses mapped to the bucket, and a list of waiter_lists.
+ */
+#define WAITER_LIST_NBUCKETS_SHIFT 6
+#define WAITER_LIST_NBUCKETS (1U << WAITER_LIST_NBUCKETS_SHIFT)
+
+struct waiter_list_bucket {
+        TOYWASM_MUTEX_DEFINE(lock);
+        struct waiter_list *lists;
+};
+
 struct waiter_list_table {
-        struct waiter_list *lists[1];
+        struct waiter_list_bucket buckets[WAITER_LIST_NBUCKETS];
 };
 
 uint32_t atomics_notify(struct waiter_list_table *tab, uint32_t ident,
                         uint32_t count);
 
 void waiter_list_table_init(struct waiter_list_table *tab);
+void waiter_list_table_destroy(struct waiter_list_table *tab);
 
 int atomics_wait(struct waiter_list_table *tab, uint32_t ident,
                  const struct timespec *abstimeout);
 
+/*
+ * atomics_wait_park: register the waiter without blocking.
+ *
+ * the caller should arrange to resume the execution when w->wakeup is
+ * called, and then call atomics_wait_unpark.
+ */
+int atomics_wait_park(struct waiter_list_table *tab, uint32_t ident,
+                      struct waiter *w, void (*wakeup)(void *arg),
+                      void *arg);
+
+/*
+ * atomics_wait_unpark: undo atomics_wait_park.
+ *
+ * returns true if the waiter has been woken by atomics_notify.
+ */
+bool atomics_wait_unpark(struct waiter_list_table *tab, uint32_t ident,
+                         struct waiter *w);
+
 struct toywasm_mutex *atomics_mutex_getptr(struct waiter_list_table *tab,
                                            uint32_t ident);
+
+#endif /* !defined(_TOYWASM_WAITLIST_H) */
@@ -29,7 +29,9 @@
 #include "load_context.h"
 #include "mem.h"
 #include "module.h"
+#include "module_cache.h"
 #include "slist.h"
+#include "timeutil.h"
 #include "type.h"
 #include "util.h"
 #include "xlog.h"
@@ -273,6 +275,23 @@ is_main_object(struct dyld_object *obj)
         return SLIST_FIRST(&dyld->objs) == obj;
 }
 
+/*
+ * the current time in ns for startup timing. 0 if not available.
+ */
+static uint64_t
+dyld_now_ns(void)
+{
+#if defined(_WIN32)
+        return 0;
+#else
+        struct timespec now;
+        if (timespec_now(CLOCK_MONOTONIC, &now)) {
+                return 0;
+        }
+        return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+#endif
+}
+
 void
 dyld_options_set_defaults(struct dyld_options *opts)
 {
@@ -699,6 +718,12 @@ dyld_object_destroy(struct dyld_object *obj)
         if (obj->instance != NULL) {
                 instance_destroy(obj->instance);
         }
+#if defined(TOYWASM_ENABLE_MODULE_CACHE)
+        if (obj->module != NULL && d->opts.module_cache != NULL) {
+                module_cache_release(d->opts.module_cache, obj->module);
+                obj->module = NULL;
+        }
+#endif
         if (obj->module != NULL) {
                 module_destroy(&obj->module_mctx, obj->module);
         }
@@ -826,6 +851,137 @@ dyld_execute_all_init_funcs(struct dyld *d, struct dyld_object *start)
         return 0;
 }
 
+static int
+dyld_load_module(struct dyld *d, struct dyld_object *obj, const char *filename)
+{
+        int ret;
+#if defined(TOYWASM_ENABLE_MODULE_CACHE)
+        if (d->opts.module_cache != NULL) {
+                struct report report;
+                report_init(&report);
+                ret = module_cache_load(d->opts.module_cache, filename,
+                                        &obj->module, &report);
+                if (ret != 0) {
+                        xlog_error("module_cache_load failed with %d: %s",
+                                   ret, report_getmessage(&report));
+                }
+                report_clear(&report);
+                return ret;
+        }
+#endif
+        ret = map_file(filename, (void *)&obj->bin, &obj->binsz);
+        if (ret != 0) {
+                return ret;
+        }
+        struct load_context lctx;
+        load_context_init(&lctx, &obj->module_mctx);
+        ret = module_create(&obj->module, obj->bin, obj->bin + obj->binsz,
+                            &lctx);
+        if (ret != 0) {
+                xlog_error("module_create failed with %d: %s", ret,
+                           report_getmessage(&lctx.report));
+        }
+        load_context_clear(&lctx);
+        return ret;
+}
+
+static bool
+is_symbol_export(const struct wasm_export *ex)
+{
+        return ex->desc.type == EXTERNTYPE_FUNC ||
+               ex->desc.type == EXTERNTYPE_GLOBAL;
+}
+
+static uint32_t
+symbol_hash(const struct name *name)
+{
+        uint64_t h = fnv1a64(FNV1A64_INIT, name->data, name->nbytes);
+        return (uint32_t)(h ^ (h >> 32));
+}
+
+static void
+dyld_symtab_insert_obj(struct dyld_symbol *tab, uint32_t bits,
+                       struct dyld_object *obj)
+{
+        const struct module *m = obj->module;
+        const uint32_t mask = (UINT32_C(1) << bits) - 1;
+        uint32_t i;
+        for (i = 0; i < m->nexports; i++) {
+                const struct wasm_export *ex = &m->exports[i];
+                if (!is_symbol_export(ex)) {
+                        continue;
+                }
+                uint32_t hash = symbol_hash(&ex->name);
+                uint32_t slot = hash & mask;
+                while (tab[slot].name != NULL) {
+                        slot = (slot + 1) & mask;
+                }
+                struct dyld_symbol *sym = &tab[slot];
+                sym->name = &ex->name;
+                sym->hash = hash;
+                sym->type = ex->desc.type;
+                sym->idx = ex->desc.idx;
+                sym->obj = obj;
+        }
+}
+
+/*
+ * dyld_symtab_add: add the exports of the object to the symbol table.
+ *
+ * this should be called right before appending the object to dyld::objs
+ * so that the table reflects the search order.
+ *
+ * when growing the table, we rebuild it from scratch, rather than
+ * moving the existing entries, to keep the entries with the same
+ * name in the load order.
+ */
+static int
+dyld_symtab_add(struct dyld *d, struct dyld_object *obj)
+{
+        const struct module *m = obj->module;
+        uint32_t n = 0;
+        uint32_t i;
+        for (i = 0; i < m->nexports; i++) {
+                if (is_symbol_export(&m->exports[i])) {
+                        n++;
+                }
+        }
+        uint32_t nsyms = d->nsyms + n;
+        /* keep the load factor <= 1/2 */
+        if (d->symtab == NULL || (uint64_t)nsyms * 2 >
+                                         (UINT64_C(1) << d->symtab_bits)) {
+                uint32_t bits = 4;
+                while ((uint64_t)nsyms * 2 > (UINT64_C(1) << bits)) {
+                        bits++;
+                }
+                if (bits >= 32) {
+                        return EOVERFLOW;
+                }
+                struct dyld_symbol *tab;
+                size_t sz = ((size_t)1 << bits) * sizeof(*tab);
+                tab = mem_zalloc(d->mctx, sz);
+                if (tab == NULL) {
+                        return ENOMEM;
+                }
+                struct dyld_object *o;
+                SLIST_FOREACH(o, &d->objs, q) {
+                        dyld_symtab_insert_obj(tab, bits, o);
+                }
+                if (d->symtab != NULL) {
+                        mem_free(d->mctx, d->symtab,
+                                 ((size_t)1 << d->symtab_bits) *
+                                         sizeof(*d->symtab));
+                }
+                d->symtab = tab;
+                d->symtab_bits = bits;
+                xlog_trace("dyld: symtab rebuilt with %" PRIu32 " slots",
+                           UINT32_C(1) << bits);
+        }
+        dyld_symtab_insert_obj(d->symtab, d->symtab_bits, obj);
+        d->nsyms = nsyms;
+        return 0;
+}
+
 static int
 dyld_load_object_from_file(struct dyld *d, const struct name *name,
                            const char *filename, struct dyld_object **objp)
@@ -843,21 +999,10 @@ dyld_load_object_from_file(struct dyld *d, const struct name *name,
         obj->instance_mctx.parent = d->mctx;
         obj->dyld = d;
         obj->name = name;
-        ret = map_file(filename, (void *)&obj->bin, &obj->binsz);
+        ret = dyld_load_module(d, obj, filename);
         if (ret != 0) {
                 goto fail;
         }
-        struct load_context lctx;
-        load_context_init(&lctx, &obj->module_mctx);
-        ret = module_create(&obj->module, obj->bin, obj->bin + obj->binsz,
-                            &lctx);
-        if (ret != 0) {
-                xlog_error("module_create failed with %d: %s", ret,
-                           report_getmessage(&lctx.report));
-                load_context_clear(&lctx);
-                goto fail;
-        }
-        load_context_clear(&lctx);
         if (obj->module->dylink == NULL) {
                 xlog_error("module %.*s doesn't have dylink.0", CSTR(name));
                 ret = EINVAL;
@@ -945,6 +1090,10 @@ dyld_load_object_from_file(struct dyld *d, const struct name *name,
         if (ret != 0) {
                 goto fail;
         }
+        ret = dyld_symtab_add(d, obj);
+        if (ret != 0) {
+                goto fail;
+        }
         SLIST_INSERT_TAIL(&d->objs, obj, q);
         xlog_trace("dyld: %.*s loaded", CSTR(name));
         if (objp != NULL) {
@@ -1236,25 +1385,24 @@ symtype_str(enum symtype symtype)
         assert(false);
 }
 
-int
-dyld_resolve_symbol_in_obj(struct dyld_object *refobj, struct dyld_object *obj,
-                           enum symtype symtype, const struct name *sym,
-                           uint32_t *resultp)
+static enum externtype
+symtype_externtype(enum symtype symtype)
 {
-        struct dyld *d = refobj->dyld;
-        enum externtype etype;
         if (symtype == SYM_TYPE_FUNC) {
-                etype = EXTERNTYPE_FUNC;
-        } else {
-                etype = EXTERNTYPE_GLOBAL;
-        }
-        const struct module *m = obj->module;
-        uint32_t idx;
-        int ret;
-        ret = module_find_export(m, sym, etype, &idx);
-        if (ret != 0) {
-                return ENOENT;
+                return EXTERNTYPE_FUNC;
         }
+        return EXTERNTYPE_GLOBAL;
+}
+
+/*
+ * resolve a symbol to the export with the given index.
+ */
+static int
+dyld_resolve_export(struct dyld_object *refobj, struct dyld_object *obj,
+                    enum symtype symtype, const struct name *sym, uint32_t idx,
+                    uint32_t *resultp)
+{
+        struct dyld *d = refobj->dyld;
         const struct instance *inst = obj->instance;
         uint32_t addr;
         if (symtype == SYM_TYPE_FUNC) {
@@ -1280,17 +1428,49 @@ dyld_resolve_symbol_in_obj(struct dyld_object *refobj, struct dyld_object *obj,
         return 0;
 }
 
+int
+dyld_resolve_symbol_in_obj(struct dyld_object *refobj, struct dyld_object *obj,
+                           enum symtype symtype, const struct name *sym,
+                           uint32_t *resultp)
+{
+        const struct module *m = obj->module;
+        uint32_t idx;
+        int ret;
+        ret = module_find_export(m, sym, symtype_externtype(symtype), &idx);
+        if (ret != 0) {
+                return ENOENT;
+        }
+        return dyld_resolve_export(refobj, obj, symtype, sym, idx, resultp);
+}
+
+/*
+ * dyld_resolve_symbol: resolve a symbol with the global symbol table.
+ *
+ * the result is the same as trying dyld_resolve_symbol_in_obj for
+ * each objects in dyld::objs in order.
+ */
 int
 dyld_resolve_symbol(struct dyld_object *refobj, enum symtype symtype,
                     const struct name *sym, uint32_t *resultp)
 {
         struct dyld *d = refobj->dyld;
-        struct dyld_object *obj;
-        SLIST_FOREACH(obj, &d->objs, q) {
-                int ret = dyld_resolve_symbol_in_obj(refobj, obj, symtype, sym,
-                                                     resultp);
-                if (ret == 0) {
-                        return 0;
+        if (d->symtab != NULL) {
+                const enum externtype etype = symtype_externtype(symtype);
+                const uint32_t mask = (UINT32_C(1) << d->symtab_bits) - 1;
+                const uint32_t hash = symbol_hash(sym);
+                uint32_t slot = hash & mask;
+                const struct dyld_symbol *ent;
+                while ((ent = &d->symtab[slot])->name != NULL) {
+                        if (ent->hash == hash && ent->type == etype &&
+                            !compare_name(ent->name, sym)) {
+                                int ret = dyld_resolve_export(
+                                        refobj, ent->obj, symtype, sym,
+                                        ent->idx, resultp);
+                                if (ret == 0) {
+                                        return 0;
+                                }
+                        }
+                        slot = (slot + 1) & mask;
                 }
         }
         if (is_binding_weak(refobj->module, sym)) {
@@ -1396,6 +1576,7 @@ dyld_resolve_dependencies(struct dyld *d, struct dyld_object *obj,
         if (ret != 0) {
                 goto fail;
         }
+        const uint64_t start_ns = dyld_now_ns();
         ret = dyld_resolve_all_got_symbols(d, obj);
         if (ret != 0) {
                 goto fail;
@@ -1406,6 +1587,7 @@ dyld_resolve_dependencies(struct dyld *d, struct dyld_object *obj,
                         goto fail;
                 }
         }
+        d->resolve_ns += dyld_now_ns() - start_ns;
         return 0;
 fail:
         return ret;
@@ -1417,6 +1599,7 @@ dyld_load(struct dyld *d, const char *filename)
         struct dyld_object *obj;
         int ret;
 
+        const uint64_t start_ns = dyld_now_ns();
         d->shared_import_obj = d->opts.base_import_obj;
         ret = dyld_load_object_from_file(d, &name_main_object, filename, &obj);
         if (ret != 0) {
@@ -1469,6 +1652,7 @@ dyld_load(struct dyld *d, const char *filename)
                         global_set_i32(&d->layout_globals[i], v);
                 }
         }
+        d->load_ns = dyld_now_ns() - start_ns;
         return 0;
 fail:
         dyld_clear(d);
@@ -1491,6 +1675,10 @@ dyld_clear(struct dyld *d)
                 SLIST_REMOVE_HEAD(&d->objs, obj, q);
                 dyld_object_destroy(obj);
         }
+        if (d->symtab != NULL) {
+                mem_free(mctx, d->symtab,
+                         ((size_t)1 << d->symtab_bits) * sizeof(*d->symtab));
+        }
         if (d->pie) {
                 if (d->meminst != NULL) {
                         memory_instance_destroy(mctx, d->meminst);
@@ -8,7 +8,9 @@
 #include "vec.h"
 
 struct dyld_object;
+struct dyld_symbol;
 struct mem_context;
+struct module_cache;
 
 struct dyld_options {
         struct import_object *base_import_obj;
@@ -39,6 +41,20 @@ struct dyld_options {
 #if defined(TOYWASM_ENABLE_DYLD_DLFCN)
         bool enable_dlfcn;
 #endif
+
+#if defined(TOYWASM_ENABLE_MODULE_CACHE)
+        /*
+         * if non-NULL, load modules via the cache so that they are
+         * shared with other dyld instances using the same cache.
+         * the cache should outlive the dyld.
+         *
+         * the memory for the modules is accounted to the cache's
+         * mem_context, not to the dyld's one. to bound it with the
+         * same limit, create the cache with the dyld's mem_context
+         * or its ancestor.
+         */
+        struct module_cache *module_cache;
+#endif
 };
 
 #define NUM_LAYOUT_GLOBAL 4
@@ -75,6 +91,19 @@ struct dyld {
 
         SLIST_HEAD(struct dyld_object) objs;
 
+        /*
+         * an open-addressing hash table of the symbols exported by
+         * the objects in objs. (see dyld_symtab_add)
+         * the table has (1 << symtab_bits) slots.
+         */
+        struct dyld_symbol *symtab;
+        uint32_t symtab_bits;
+        uint32_t nsyms;
+
+        /* startup timing for dyld_print_stats */
+        uint64_t load_ns;    /* dyld_load */
+        uint64_t resolve_ns; /* GOT and PLT symbol resolution */
+
         struct dyld_options opts;
 
 #if defined(TOYWASM_ENABLE_DYLD_DLFCN)
@@ -11,6 +11,21 @@ enum symtype {
         SYM_TYPE_MEM,
 };
 
+/*
+ * an entry of dyld::symtab.
+ *
+ * Note: exports with the same name from different objects have
+ * separate entries. they appear in the load order on a probe sequence.
+ * it's how we implement the first-object-wins search order.
+ */
+struct dyld_symbol {
+        const struct name *name; /* NULL for empty slots */
+        uint32_t hash;
+        enum externtype type;
+        uint32_t idx; /* funcidx or globalidx */
+        struct dyld_object *obj;
+};
+
 struct dyld_plt {
         const struct funcinst *finst;
         const struct name *sym;
@@ -34,6 +49,7 @@ struct dyld_object {
         struct globalinst *gots;
         uint32_t nplts;
         struct dyld_plt *plts;
+        uint64_t nplt_trampolines; /* calls via dyld_plt */
         struct import_object *local_import_obj;
 
         const uint8_t *bin;
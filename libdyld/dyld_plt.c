@@ -30,15 +30,40 @@ dyld_resolve_plt(struct exec_context *ectx, struct dyld_plt *plt)
         xlog_trace("dyld: PLT resolved %.*s %.*s to addr %08" PRIx32
                    " finst %p",
                    CSTR(refobj->name), CSTR(sym), addr, (void *)plt->finst);
+        dyld_patch_plt(plt);
         return 0;
 }
 
+/*
+ * dyld_patch_plt: rebind a resolved PLT entry to the target function.
+ *
+ * the importing instance refers to the PLT entry as &plt->pltfi.
+ * (via local_import_obj) we overwrite it with a copy of the target
+ * funcinst. later calls go to the target function directly, without
+ * dyld_plt and the restart. it's as cheap as intra-module calls.
+ *
+ * Note: funcinst_func allows such a copy of a funcinst.
+ *
+ * Note: this assumes that no other threads are calling the function
+ * via the PLT entry at the same time. it's fine as dyld doesn't
+ * support threads.
+ */
+void
+dyld_patch_plt(struct dyld_plt *plt)
+{
+        assert(plt->finst != NULL);
+        assert(!compare_functype(funcinst_functype(&plt->pltfi),
+                                 funcinst_functype(plt->finst)));
+        plt->pltfi = *plt->finst;
+}
+
 int
 dyld_plt(struct exec_context *ctx, struct host_instance *hi,
          const struct functype *ft, const struct cell *params,
          struct cell *results)
 {
         struct dyld_plt *plt = (void *)hi;
+        plt->refobj->nplt_trampolines++;
         if (plt->finst == NULL) {
                 /*
                  * resolve the symbol.
@@ -50,18 +75,12 @@ dyld_plt(struct exec_context *ctx, struct host_instance *hi,
                 }
         }
 
-#if 0 /* a bit dirty */
-        /*
-         * modify our funcinst so that next call will have no PLT overhead.
-         * if you enable this, you need to relax the assertion in
-         * funcinst_func.
-         */
-        plt->pltfi = *plt->finst;
-#endif
-
         /*
          * set up a call to the resolved function.
          *
+         * as dyld_resolve_plt has patched the PLT entry, this is
+         * usually the first and the last call via this trampoline.
+         *
          * note that we (PLT wrapper) and the resolved function share
          * the same function type. this is a tail-call.
          *
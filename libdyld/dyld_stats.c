@@ -1,24 +1,60 @@
+#include <inttypes.h>
+
 #include "dyld.h"
 #include "dyld_impl.h"
 #include "escape.h"
 #include "mem.h"
+#include "module_cache.h"
 #include "nbio.h"
 
 void
 dyld_print_stats(struct dyld *d)
 {
         struct dyld_object *obj;
+        nbio_printf("dyld_load %" PRIu64 " us (symbol resolution %" PRIu64
+                    " us, %" PRIu32 " symbols in %" PRIu32 " slots)\n",
+                    d->load_ns / 1000, d->resolve_ns / 1000, d->nsyms,
+                    d->symtab != NULL ? UINT32_C(1) << d->symtab_bits : 0);
         SLIST_FOREACH(obj, &d->objs, q) {
                 struct escaped_string e;
                 escape_name(&e, obj->name);
 
+#if defined(TOYWASM_ENABLE_HEAP_TRACKING)
+                size_t mod_allocated = obj->module_mctx.allocated;
+#if defined(TOYWASM_ENABLE_HEAP_TRACKING_PEAK)
+                size_t mod_peak = obj->module_mctx.peak;
+#endif
+#endif
+                /*
+                 * a module from the module cache is accounted to
+                 * the cache. report its usage, which is shared
+                 * with other users of the module.
+                 */
+                uint32_t nusers = 1;
+#if defined(TOYWASM_ENABLE_MODULE_CACHE)
+                if (d->opts.module_cache != NULL && obj->module != NULL) {
+                        struct module_cache_stat st;
+                        module_cache_stat(d->opts.module_cache, obj->module,
+                                          &st);
+                        nusers = st.refcount;
+#if defined(TOYWASM_ENABLE_HEAP_TRACKING)
+                        mod_allocated = st.allocated;
+#if defined(TOYWASM_ENABLE_HEAP_TRACKING_PEAK)
+                        mod_peak = st.peak;
+#endif
+#endif
+                }
+#endif
+
                 nbio_printf("%12.*s"
+                            " plt %5" PRIu32 " (trampolines %10" PRIu64 ")"
 #if defined(TOYWASM_ENABLE_HEAP_TRACKING)
                             " mod %10zu"
 #if defined(TOYWASM_ENABLE_HEAP_TRACKING_PEAK)
                             " (peak %10zu)"
 #endif
 #endif
+                            " users %3" PRIu32
 #if defined(TOYWASM_ENABLE_HEAP_TRACKING)
                             " inst %10zu"
 #if defined(TOYWASM_ENABLE_HEAP_TRACKING_PEAK)
@@ -26,15 +62,17 @@ dyld_print_stats(struct dyld *d)
 #endif
 #endif
                             "\n",
-                            ECSTR(&e)
+                            ECSTR(&e), obj->nplts, obj->nplt_trampolines
 #if defined(TOYWASM_ENABLE_HEAP_TRACKING)
-                                    ,
-                            obj->module_mctx.allocated
+                            ,
+                            mod_allocated
 #if defined(TOYWASM_ENABLE_HEAP_TRACKING_PEAK)
                             ,
-                            obj->module_mctx.peak
+                            mod_peak
 #endif
 #endif
+                            ,
+                            nusers
 #if defined(TOYWASM_ENABLE_HEAP_TRACKING)
                             ,
                             obj->instance_mctx.allocated
@@ -175,6 +175,10 @@ wasi_instance_create(struct mem_context *mctx,
         inst->mctx = mctx;
         toywasm_mutex_init(&inst->lock);
         toywasm_cv_init(&inst->cv);
+        wasi_pollset_init(&inst->pollset, mctx);
+#if defined(TOYWASM_USE_WASI_IO_URING)
+        wasi_uring_init(&inst->uring, mctx);
+#endif
         /* the first three slots are reserved for stdin, stdout, stderr */
         inst->fdtable[WASI_TABLE_FILES].reserved_slots = 3;
         *instp = inst;
@@ -301,6 +305,10 @@ wasi_instance_destroy(struct wasi_instance *inst)
         for (i = 0; i < WASI_NTABLES; i++) {
                 wasi_table_clear(inst, i);
         }
+#if defined(TOYWASM_USE_WASI_IO_URING)
+        wasi_uring_clear(&inst->uring);
+#endif
+        wasi_pollset_clear(&inst->pollset);
         toywasm_cv_destroy(&inst->cv);
         toywasm_mutex_destroy(&inst->lock);
         mem_free(inst->mctx, inst, sizeof(*inst));
@@ -154,6 +154,7 @@ wasi_fd_close(struct exec_context *ctx, struct host_instance *hi,
         *slot = NULL;
         toywasm_mutex_unlock(&wasi->lock);
 
+        wasi_pollset_forget(&wasi->pollset, fdinfo);
         ret = wasi_fdinfo_close(fdinfo);
 fail:
         wasi_fdinfo_release(wasi, fdinfo);
@@ -198,8 +199,8 @@ wasi_fd_write(struct exec_context *ctx, struct host_instance *hi,
 retry:
         ret = wasi_vfs_fd_writev(fdinfo, hostiov, iov_count, &n);
         if (ret != 0) {
-                if (emulate_blocking(ctx, fdinfo, POLLOUT, ret, &host_ret,
-                                     &ret)) {
+                if (emulate_blocking(ctx, wasi, fdinfo, POLLOUT, ret,
+                                     &host_ret, &ret)) {
                         goto retry;
                 }
                 goto fail;
@@ -218,6 +219,7 @@ fail:
                                      wasi_convert_errno(ret));
         }
         free(hostiov);
+        emulate_blocking_done(ctx, host_ret);
         HOST_FUNC_FREE_CONVERTED_PARAMS();
         return host_ret;
 }
@@ -256,8 +258,8 @@ wasi_fd_pwrite(struct exec_context *ctx, struct host_instance *hi,
 retry:
         ret = wasi_vfs_fd_pwritev(fdinfo, hostiov, iov_count, offset, &n);
         if (ret != 0) {
-                if (emulate_blocking(ctx, fdinfo, POLLOUT, ret, &host_ret,
-                                     &ret)) {
+                if (emulate_blocking(ctx, wasi, fdinfo, POLLOUT, ret,
+                                     &host_ret, &ret)) {
                         goto retry;
                 }
                 goto fail;
@@ -276,6 +278,7 @@ fail:
                                      wasi_convert_errno(ret));
         }
         free(hostiov);
+        emulate_blocking_done(ctx, host_ret);
         HOST_FUNC_FREE_CONVERTED_PARAMS();
         return host_ret;
 }
@@ -330,8 +333,8 @@ retry:
         ret = wasi_vfs_fd_readv(fdinfo, hostiov, iov_count, &n);
         if (ret != 0) {
 tty_hack:
-                if (emulate_blocking(ctx, fdinfo, POLLIN, ret, &host_ret,
-                                     &ret)) {
+                if (emulate_blocking(ctx, wasi, fdinfo, POLLIN, ret,
+                                     &host_ret, &ret)) {
                         goto retry;
                 }
                 goto fail;
@@ -350,6 +353,7 @@ fail:
                                      wasi_convert_errno(ret));
         }
         free(hostiov);
+        emulate_blocking_done(ctx, host_ret);
         HOST_FUNC_FREE_CONVERTED_PARAMS();
         return host_ret;
 }
@@ -388,8 +392,8 @@ wasi_fd_pread(struct exec_context *ctx, struct host_instance *hi,
 retry:
         ret = wasi_vfs_fd_preadv(fdinfo, hostiov, iov_count, offset, &n);
         if (ret != 0) {
-                if (emulate_blocking(ctx, fdinfo, POLLIN, ret, &host_ret,
-                                     &ret)) {
+                if (emulate_blocking(ctx, wasi, fdinfo, POLLIN, ret,
+                                     &host_ret, &ret)) {
                         goto retry;
                 }
                 goto fail;
@@ -408,6 +412,7 @@ fail:
                                      wasi_convert_errno(ret));
         }
         free(hostiov);
+        emulate_blocking_done(ctx, host_ret);
         HOST_FUNC_FREE_CONVERTED_PARAMS();
         return host_ret;
 }
@@ -935,6 +940,7 @@ wasi_fd_renumber(struct exec_context *ctx, struct host_instance *hi,
         fdinfo_from = NULL;
 
         /* close the old "to" file */
+        wasi_pollset_forget(&wasi->pollset, fdinfo_to);
         ret = wasi_fdinfo_close(fdinfo_to);
         if (ret != 0) {
                 /* log and ignore */
@@ -10,6 +10,7 @@
 #include "restart.h"
 #include "wasi_impl.h"
 #include "wasi_poll_subr.h"
+#include "wasi_pollset.h"
 #include "wasi_subr.h"
 #include "xlog.h"
 
@@ -30,6 +31,7 @@ wasi_poll_oneoff(struct exec_context *ctx, struct host_instance *hi,
         struct wasi_fdinfo **fdinfos = NULL;
         uint32_t nfdinfos = 0;
         struct wasi_event *events;
+        bool pollset_acquired = false;
         int host_ret = 0;
         int ret;
         if (nsubscriptions == 0) {
@@ -77,11 +79,18 @@ retry:
                 goto retry;
         }
         events = p;
-        pollfds = calloc(nsubscriptions, sizeof(*pollfds));
-        fdinfos = calloc(nsubscriptions, sizeof(*fdinfos));
-        if (pollfds == NULL || fdinfos == NULL) {
-                ret = ENOMEM;
-                goto fail;
+        if (wasi_pollset_acquire(&wasi->pollset, nsubscriptions)) {
+                pollset_acquired = true;
+                pollfds = wasi->pollset.pollfds;
+                fdinfos = wasi->pollset.fdinfos;
+        } else {
+                /* another thread is using the pollset */
+                pollfds = calloc(nsubscriptions, sizeof(*pollfds));
+                fdinfos = calloc(nsubscriptions, sizeof(*fdinfos));
+                if (pollfds == NULL || fdinfos == NULL) {
+                        ret = ENOMEM;
+                        goto fail;
+                }
         }
         uint32_t i;
         int timeout_ms = -1;
@@ -174,8 +183,15 @@ retry:
         }
         if (nevents == 0) {
                 xlog_trace("poll_oneoff: start polling");
-                host_ret = wasi_poll(ctx, pollfds, nsubscriptions, timeout_ms,
-                                     &ret, &nevents);
+                if (pollset_acquired) {
+                        host_ret = wasi_pollset_poll(ctx, &wasi->pollset,
+                                                     nsubscriptions,
+                                                     timeout_ms, &ret,
+                                                     &nevents);
+                } else {
+                        host_ret = wasi_poll(ctx, pollfds, nsubscriptions,
+                                             timeout_ms, &ret, &nevents);
+                }
                 if (host_ret != 0) {
                         goto fail;
                 }
@@ -240,12 +256,16 @@ fail:
         for (i = 0; i < nfdinfos; i++) {
                 wasi_fdinfo_release(wasi, fdinfos[i]);
         }
-        free(fdinfos);
+        if (pollset_acquired) {
+                wasi_pollset_release(&wasi->pollset);
+        } else {
+                free(fdinfos);
+                free(pollfds);
+        }
         if (host_ret == 0) {
                 HOST_FUNC_RESULT_SET(ft, results, 0, i32,
                                      wasi_convert_errno(ret));
         }
-        free(pollfds);
         if (!IS_RESTARTABLE(host_ret)) {
                 /*
                  * avoid leaving a stale restart state.
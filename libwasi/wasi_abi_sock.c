@@ -57,8 +57,8 @@ wasi_sock_accept(struct exec_context *ctx, struct host_instance *hi,
 retry:
         ret = wasi_vfs_sock_accept(fdinfo, (uint16_t)fdflags, fdinfo_child);
         if (ret != 0) {
-                if (emulate_blocking(ctx, fdinfo, POLLIN, ret, &host_ret,
-                                     &ret)) {
+                if (emulate_blocking(ctx, wasi, fdinfo, POLLIN, ret,
+                                     &host_ret, &ret)) {
                         goto retry;
                 }
                 goto fail;
@@ -85,6 +85,7 @@ fail:
                 HOST_FUNC_RESULT_SET(ft, results, 0, i32,
                                      wasi_convert_errno(ret));
         }
+        emulate_blocking_done(ctx, host_ret);
         HOST_FUNC_FREE_CONVERTED_PARAMS();
         return host_ret;
 }
@@ -144,8 +145,8 @@ retry:
         ret = wasi_vfs_sock_recv(fdinfo, hostiov, iov_count, (uint16_t)riflags,
                                  &roflags, &n);
         if (ret != 0) {
-                if (emulate_blocking(ctx, fdinfo, POLLIN, ret, &host_ret,
-                                     &ret)) {
+                if (emulate_blocking(ctx, wasi, fdinfo, POLLIN, ret,
+                                     &host_ret, &ret)) {
                         goto retry;
                 }
                 goto fail;
@@ -174,6 +175,7 @@ fail:
                                      wasi_convert_errno(ret));
         }
         free(hostiov);
+        emulate_blocking_done(ctx, host_ret);
         HOST_FUNC_FREE_CONVERTED_PARAMS();
         return host_ret;
 }
@@ -217,8 +219,8 @@ retry:
         ret = wasi_vfs_sock_send(fdinfo, hostiov, iov_count, (uint16_t)siflags,
                                  &n);
         if (ret != 0) {
-                if (emulate_blocking(ctx, fdinfo, POLLOUT, ret, &host_ret,
-                                     &ret)) {
+                if (emulate_blocking(ctx, wasi, fdinfo, POLLOUT, ret,
+                                     &host_ret, &ret)) {
                         goto retry;
                 }
                 goto fail;
@@ -237,6 +239,7 @@ fail:
                                      wasi_convert_errno(ret));
         }
         free(hostiov);
+        emulate_blocking_done(ctx, host_ret);
         HOST_FUNC_FREE_CONVERTED_PARAMS();
         return host_ret;
 }
@@ -3,7 +3,12 @@
 
 #include "host_instance.h"
 #include "lock.h"
+#include "toywasm_config.h"
 #include "wasi_abi.h"
+#include "wasi_pollset.h"
+#if defined(TOYWASM_USE_WASI_IO_URING)
+#include "wasi_uring.h"
+#endif
 #include "xlog.h"
 
 enum wasi_fdinfo_type {
@@ -61,6 +66,12 @@ struct wasi_instance {
 
         uint32_t exit_code;
 
+        struct wasi_pollset pollset;
+
+#if defined(TOYWASM_USE_WASI_IO_URING)
+        struct wasi_uring uring;
+#endif
+
         struct mem_context *mctx;
 };
 
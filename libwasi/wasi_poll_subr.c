@@ -11,9 +11,32 @@
 #include "wasi_impl.h"
 #include "wasi_poll_subr.h"
 
+struct poll_args {
+        struct pollfd *fds;
+        nfds_t nfds;
+};
+
+static int
+poll_wait(void *arg, int timeout_ms)
+{
+        struct poll_args *a = arg;
+        return poll(a->fds, a->nfds, timeout_ms);
+}
+
 int
 wasi_poll(struct exec_context *ctx, struct pollfd *fds, nfds_t nfds,
           int timeout_ms, int *retp, int *neventsp)
+{
+        struct poll_args a;
+        a.fds = fds;
+        a.nfds = nfds;
+        return wasi_poll_with(ctx, poll_wait, &a, timeout_ms, retp,
+                              neventsp);
+}
+
+int
+wasi_poll_with(struct exec_context *ctx, int (*wait)(void *, int),
+               void *arg, int timeout_ms, int *retp, int *neventsp)
 {
         const int interval_ms = check_interrupt_interval_ms(ctx);
         const struct timespec *abstimeout;
@@ -115,7 +138,7 @@ wasi_poll(struct exec_context *ctx, struct pollfd *fds, nfds_t nfds,
                                 }
                         }
                 }
-                ret = poll(fds, nfds, next_timeout_ms);
+                ret = wait(arg, next_timeout_ms);
                 if (ret < 0) {
                         ret = errno;
                         assert(ret > 0);
@@ -157,8 +180,9 @@ wait_fd_ready(struct exec_context *ctx, int hostfd, short event, int *retp)
 }
 
 bool
-emulate_blocking(struct exec_context *ctx, struct wasi_fdinfo *fdinfo,
-                 short poll_event, int orig_ret, int *host_retp, int *retp)
+emulate_blocking(struct exec_context *ctx, struct wasi_instance *wasi,
+                 struct wasi_fdinfo *fdinfo, short poll_event, int orig_ret,
+                 int *host_retp, int *retp)
 {
         if (!is_again(orig_ret) || !wasi_fdinfo_to_user(fdinfo)->blocking) {
                 *host_retp = 0;
@@ -174,7 +198,15 @@ emulate_blocking(struct exec_context *ctx, struct wasi_fdinfo *fdinfo,
         int host_ret;
         int ret;
 
-        host_ret = wait_fd_ready(ctx, hostfd, poll_event, &ret);
+#if defined(TOYWASM_USE_WASI_IO_URING)
+        if (wasi_uring_available(&wasi->uring)) {
+                host_ret = wasi_uring_wait_fd(ctx, &wasi->uring, hostfd,
+                                              poll_event, &ret);
+        } else
+#endif
+        {
+                host_ret = wait_fd_ready(ctx, hostfd, poll_event, &ret);
+        }
         if (host_ret != 0) {
                 ret = 0;
                 goto fail;
@@ -188,3 +220,20 @@ fail:
         *retp = ret;
         return false;
 }
+
+/*
+ * emulate_blocking_done: called by the users of emulate_blocking when
+ * they are done.
+ *
+ * avoid leaving a stale restart state. after a restart, the retried
+ * i/o can complete without calling emulate_blocking again. (eg. after
+ * wasi_uring_wait_fd woke us up because the fd became ready)
+ * see also the similar comment in wasi_poll_oneoff.
+ */
+void
+emulate_blocking_done(struct exec_context *ctx, int host_ret)
+{
+        if (!IS_RESTARTABLE(host_ret)) {
+                restart_info_clear(ctx);
+        }
+}
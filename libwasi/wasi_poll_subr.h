@@ -1,12 +1,25 @@
 #include <poll.h>
+#include <stdbool.h>
 
 struct exec_context;
 struct wasi_fdinfo;
+struct wasi_instance;
 
 int wasi_poll(struct exec_context *ctx, struct pollfd *fds, nfds_t nfds,
               int timeout_ms, int *retp, int *neventsp);
+
+/*
+ * wasi_poll_with: wasi_poll with a custom wait function.
+ *
+ * wait is called repeatedly with a timeout no longer than
+ * check_interrupt_interval_ms. it should behave like poll(2):
+ * returns the number of events, 0 on a timeout, or -1 with errno.
+ */
+int wasi_poll_with(struct exec_context *ctx, int (*wait)(void *, int),
+                   void *arg, int timeout_ms, int *retp, int *neventsp);
 int wait_fd_ready(struct exec_context *ctx, int hostfd, short event,
                   int *retp);
-bool emulate_blocking(struct exec_context *ctx, struct wasi_fdinfo *fdinfo,
-                      short poll_event, int orig_ret, int *host_retp,
-                      int *retp);
+bool emulate_blocking(struct exec_context *ctx, struct wasi_instance *wasi,
+                      struct wasi_fdinfo *fdinfo, short poll_event,
+                      int orig_ret, int *host_retp, int *retp);
+void emulate_blocking_done(struct exec_context *ctx, int host_ret);
@@ -0,0 +1,427 @@
+/*
+ * poll_oneoff backend.
+ *
+ * event-loop style apps call poll_oneoff in a tight loop, often with
+ * mostly the same set of fds. to make it cheap:
+ *
+ * - the scratch buffers are kept in the instance and reused.
+ *
+ * - with TOYWASM_USE_WASI_EPOLL, the host fds are registered to
+ *   a per-instance epoll set and the registrations are kept across
+ *   calls. a call only issues epoll_ctl for the fds whose interests
+ *   changed. the registrations which are not used by the current call
+ *   are removed lazily when they report an event.
+ *
+ * the epoll set is keyed by host fds, not wasi fds, because it's what
+ * the kernel keys the registrations by. it also naturally survives
+ * fd_renumber.
+ */
+
+#include "toywasm_config.h"
+
+#if defined(TOYWASM_USE_WASI_EPOLL)
+#include <sys/epoll.h>
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mem.h"
+#include "wasi_host_subr.h"
+#include "wasi_poll_subr.h"
+#include "wasi_pollset.h"
+#include "wasi_vfs_impl_host.h"
+#include "xlog.h"
+
+void
+wasi_pollset_init(struct wasi_pollset *ps, struct mem_context *mctx)
+{
+        memset(ps, 0, sizeof(*ps));
+        toywasm_mutex_init(&ps->lock);
+#if defined(TOYWASM_USE_WASI_EPOLL)
+        ps->epfd = -1;
+        VEC_INIT(ps->entries);
+#endif
+        ps->mctx = mctx;
+}
+
+void
+wasi_pollset_clear(struct wasi_pollset *ps)
+{
+        assert(!ps->busy);
+        if (ps->nalloc > 0) {
+                mem_free(ps->mctx, ps->pollfds,
+                         ps->nalloc * sizeof(*ps->pollfds));
+                mem_free(ps->mctx, ps->fdinfos,
+                         ps->nalloc * sizeof(*ps->fdinfos));
+        }
+#if defined(TOYWASM_USE_WASI_EPOLL)
+        if (ps->epfd != -1) {
+                close(ps->epfd);
+        }
+        VEC_FREE(ps->mctx, ps->entries);
+        if (ps->nevs > 0) {
+                mem_free(ps->mctx, ps->evs, ps->nevs * sizeof(*ps->evs));
+        }
+#endif
+        toywasm_mutex_destroy(&ps->lock);
+}
+
+bool
+wasi_pollset_acquire(struct wasi_pollset *ps, uint32_t n)
+{
+        assert(n > 0);
+        toywasm_mutex_lock(&ps->lock);
+        if (ps->busy) {
+                toywasm_mutex_unlock(&ps->lock);
+                return false;
+        }
+        ps->busy = true;
+        toywasm_mutex_unlock(&ps->lock);
+        if (n <= ps->nalloc) {
+                memset(ps->pollfds, 0, n * sizeof(*ps->pollfds));
+                memset(ps->fdinfos, 0, n * sizeof(*ps->fdinfos));
+                return true;
+        }
+        struct pollfd *pollfds = mem_calloc(ps->mctx, n, sizeof(*pollfds));
+        struct wasi_fdinfo **fdinfos =
+                mem_calloc(ps->mctx, n, sizeof(*fdinfos));
+        if (pollfds == NULL || fdinfos == NULL) {
+                if (pollfds != NULL) {
+                        mem_free(ps->mctx, pollfds, n * sizeof(*pollfds));
+                }
+                if (fdinfos != NULL) {
+                        mem_free(ps->mctx, fdinfos, n * sizeof(*fdinfos));
+                }
+                wasi_pollset_release(ps);
+                return false;
+        }
+        if (ps->nalloc > 0) {
+                mem_free(ps->mctx, ps->pollfds,
+                         ps->nalloc * sizeof(*ps->pollfds));
+                mem_free(ps->mctx, ps->fdinfos,
+                         ps->nalloc * sizeof(*ps->fdinfos));
+        }
+        ps->pollfds = pollfds;
+        ps->fdinfos = fdinfos;
+        ps->nalloc = n;
+        return true;
+}
+
+void
+wasi_pollset_release(struct wasi_pollset *ps)
+{
+        toywasm_mutex_lock(&ps->lock);
+        assert(ps->busy);
+        ps->busy = false;
+        toywasm_mutex_unlock(&ps->lock);
+}
+
+#if defined(TOYWASM_USE_WASI_EPOLL)
+static uint32_t
+to_epoll_events(short events)
+{
+        uint32_t ev = 0;
+        if ((events & POLLIN) != 0) {
+                ev |= EPOLLIN;
+        }
+        if ((events & POLLOUT) != 0) {
+                ev |= EPOLLOUT;
+        }
+        return ev;
+}
+
+static short
+from_epoll_events(uint32_t ev)
+{
+        short events = 0;
+        if ((ev & EPOLLIN) != 0) {
+                events |= POLLIN;
+        }
+        if ((ev & EPOLLOUT) != 0) {
+                events |= POLLOUT;
+        }
+        if ((ev & EPOLLERR) != 0) {
+                events |= POLLERR;
+        }
+        if ((ev & EPOLLHUP) != 0) {
+                events |= POLLHUP;
+        }
+        return events;
+}
+
+static bool
+epoll_available(struct wasi_pollset *ps) REQUIRES(ps->lock)
+{
+        if (ps->epfd != -1) {
+                return true;
+        }
+        if (ps->failed) {
+                return false;
+        }
+        int fd = epoll_create1(EPOLL_CLOEXEC);
+        if (fd == -1) {
+                xlog_trace("%s: epoll_create1 failed with %d", __func__,
+                           errno);
+                ps->failed = true;
+                return false;
+        }
+        ps->epfd = fd;
+        return true;
+}
+
+static int
+epoll_update(struct wasi_pollset *ps, int hostfd, struct wasi_epoll_entry *e)
+        REQUIRES(ps->lock)
+{
+        struct epoll_event ev;
+        int op;
+        int ret;
+
+        memset(&ev, 0, sizeof(ev));
+        ev.events = to_epoll_events(e->wanted);
+        ev.data.fd = hostfd;
+        op = (e->registered != 0) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+        ret = epoll_ctl(ps->epfd, op, hostfd, &ev);
+        if (ret == -1 && (errno == ENOENT || errno == EEXIST)) {
+                /* out of sync. it shouldn't happen. */
+                xlog_trace("%s: hostfd %d out of sync", __func__, hostfd);
+                op = (op == EPOLL_CTL_ADD) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+                ret = epoll_ctl(ps->epfd, op, hostfd, &ev);
+        }
+        if (ret == -1) {
+                ret = errno;
+                assert(ret > 0);
+                return ret;
+        }
+        e->registered = e->wanted;
+        return 0;
+}
+
+/*
+ * epoll_prepare: sync the epoll set with ps->pollfds.
+ *
+ * *readyp is set to true if some of fds are known to be ready without
+ * waiting.
+ */
+static int
+epoll_prepare(struct wasi_pollset *ps, uint32_t n, bool *readyp)
+        REQUIRES(ps->lock)
+{
+        struct wasi_epoll_entry *e;
+        bool ready = false;
+        uint32_t i;
+        int ret;
+
+        if (ps->nevs < n) {
+                struct epoll_event *evs =
+                        mem_calloc(ps->mctx, n, sizeof(*evs));
+                if (evs == NULL) {
+                        return ENOMEM;
+                }
+                if (ps->nevs > 0) {
+                        mem_free(ps->mctx, ps->evs,
+                                 ps->nevs * sizeof(*ps->evs));
+                }
+                ps->evs = evs;
+                ps->nevs = n;
+        }
+
+        /* 0 is reserved for never-used entries */
+        if (++ps->gen == 0) {
+                ps->gen++;
+        }
+        for (i = 0; i < n; i++) {
+                const struct pollfd *pfd = &ps->pollfds[i];
+                if (pfd->fd < 0) {
+                        continue;
+                }
+                if ((uint32_t)pfd->fd >= ps->entries.lsize) {
+                        ret = VEC_RESIZE(ps->mctx, ps->entries,
+                                         (uint32_t)pfd->fd + 1);
+                        if (ret != 0) {
+                                return ret;
+                        }
+                }
+                e = &VEC_ELEM(ps->entries, pfd->fd);
+                if (e->gen != ps->gen) {
+                        e->gen = ps->gen;
+                        e->wanted = 0;
+                        e->revents = 0;
+                }
+                e->wanted |= pfd->events;
+        }
+        for (i = 0; i < n; i++) {
+                const struct pollfd *pfd = &ps->pollfds[i];
+                if (pfd->fd < 0) {
+                        continue;
+                }
+                e = &VEC_ELEM(ps->entries, pfd->fd);
+                if (!e->unpollable && e->registered != e->wanted) {
+                        ret = epoll_update(ps, pfd->fd, e);
+                        if (ret == EPERM) {
+                                e->unpollable = true;
+                        } else if (ret != 0) {
+                                return ret;
+                        }
+                }
+                if (e->unpollable) {
+                        /* poll(2) reports them always ready */
+                        e->revents = e->wanted;
+                        ready = true;
+                }
+        }
+        *readyp = ready;
+        return 0;
+}
+
+/*
+ * epoll_collect: record the events returned by epoll_wait and
+ * translate them to ps->pollfds.
+ *
+ * returns the number of pollfds with non-zero revents.
+ */
+static int
+epoll_collect(struct wasi_pollset *ps, uint32_t n, int nev)
+        REQUIRES(ps->lock)
+{
+        struct wasi_epoll_entry *e;
+        int nready = 0;
+        int i;
+
+        for (i = 0; i < nev; i++) {
+                const struct epoll_event *ev = &ps->evs[i];
+                int hostfd = ev->data.fd;
+                if ((uint32_t)hostfd >= ps->entries.lsize) {
+                        continue;
+                }
+                e = &VEC_ELEM(ps->entries, hostfd);
+                if (e->registered == 0) {
+                        /* forgotten while we were waiting */
+                        continue;
+                }
+                if (e->gen != ps->gen) {
+                        /* a registration left by a previous call */
+                        xlog_trace("%s: removing hostfd %d", __func__,
+                                   hostfd);
+                        epoll_ctl(ps->epfd, EPOLL_CTL_DEL, hostfd, NULL);
+                        e->registered = 0;
+                        continue;
+                }
+                e->revents |= from_epoll_events(ev->events);
+        }
+        uint32_t j;
+        for (j = 0; j < n; j++) {
+                struct pollfd *pfd = &ps->pollfds[j];
+                if (pfd->fd < 0) {
+                        continue;
+                }
+                e = &VEC_ELEM(ps->entries, pfd->fd);
+                pfd->revents =
+                        e->revents & (pfd->events | POLLERR | POLLHUP);
+                if (pfd->revents != 0) {
+                        nready++;
+                }
+        }
+        return nready;
+}
+
+struct epoll_wait_args {
+        struct wasi_pollset *ps;
+        uint32_t n;
+};
+
+static int
+epoll_wait_events(void *arg, int timeout_ms)
+{
+        struct epoll_wait_args *a = arg;
+        struct wasi_pollset *ps = a->ps;
+        int nready;
+
+        /*
+         * Note: when we only got events for stale registrations,
+         * we wait again with the same timeout. it's ok because
+         * the timeout here is the minimum interval. (see wasi_poll)
+         */
+        do {
+                int nev = epoll_wait(ps->epfd, ps->evs, (int)ps->nevs,
+                                     timeout_ms);
+                if (nev <= 0) {
+                        return nev;
+                }
+                toywasm_mutex_lock(&ps->lock);
+                nready = epoll_collect(ps, a->n, nev);
+                toywasm_mutex_unlock(&ps->lock);
+        } while (nready == 0);
+        return nready;
+}
+#endif /* defined(TOYWASM_USE_WASI_EPOLL) */
+
+int
+wasi_pollset_poll(struct exec_context *ctx, struct wasi_pollset *ps,
+                  uint32_t n, int timeout_ms, int *retp, int *neventsp)
+{
+#if defined(TOYWASM_USE_WASI_EPOLL)
+        bool ready;
+        int ret;
+
+        assert(ps->busy);
+        assert(n <= ps->nalloc);
+        toywasm_mutex_lock(&ps->lock);
+        if (!epoll_available(ps)) {
+                toywasm_mutex_unlock(&ps->lock);
+                goto fallback;
+        }
+        ret = epoll_prepare(ps, n, &ready);
+        if (ret != 0) {
+                toywasm_mutex_unlock(&ps->lock);
+                xlog_trace("%s: epoll_prepare failed with %d", __func__,
+                           ret);
+                goto fallback;
+        }
+        if (ready) {
+                /* don't block. just pick up other events if any. */
+                int nev = epoll_wait(ps->epfd, ps->evs, (int)ps->nevs, 0);
+                if (nev < 0) {
+                        nev = 0;
+                }
+                *neventsp = epoll_collect(ps, n, nev);
+                assert(*neventsp > 0);
+                toywasm_mutex_unlock(&ps->lock);
+                *retp = 0;
+                return 0;
+        }
+        toywasm_mutex_unlock(&ps->lock);
+
+        struct epoll_wait_args a;
+        a.ps = ps;
+        a.n = n;
+        return wasi_poll_with(ctx, epoll_wait_events, &a, timeout_ms, retp,
+                              neventsp);
+fallback:
+#endif
+        return wasi_poll(ctx, ps->pollfds, n, timeout_ms, retp, neventsp);
+}
+
+void
+wasi_pollset_forget(struct wasi_pollset *ps, struct wasi_fdinfo *fdinfo)
+{
+#if defined(TOYWASM_USE_WASI_EPOLL)
+        if (!wasi_fdinfo_is_host(fdinfo)) {
+                return;
+        }
+        int hostfd = wasi_fdinfo_hostfd(fdinfo);
+        toywasm_mutex_lock(&ps->lock);
+        if ((uint32_t)hostfd < ps->entries.lsize) {
+                struct wasi_epoll_entry *e = &VEC_ELEM(ps->entries, hostfd);
+                if (e->registered != 0) {
+                        assert(ps->epfd != -1);
+                        epoll_ctl(ps->epfd, EPOLL_CTL_DEL, hostfd, NULL);
+                }
+                memset(e, 0, sizeof(*e));
+        }
+        toywasm_mutex_unlock(&ps->lock);
+#endif
+}
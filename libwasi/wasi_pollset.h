@@ -0,0 +1,96 @@
+#if !defined(_TOYWASM_WASI_POLLSET_H)
+#define _TOYWASM_WASI_POLLSET_H
+
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "lock.h"
+#include "toywasm_config.h"
+#include "vec.h"
+
+struct epoll_event;
+struct exec_context;
+struct mem_context;
+struct wasi_fdinfo;
+
+#if defined(TOYWASM_USE_WASI_EPOLL)
+/*
+ * the state of a host fd in the epoll set.
+ */
+struct wasi_epoll_entry {
+        short registered; /* poll events registered to the epoll set */
+        bool unpollable;  /* epoll doesn't support the fd. eg. regular files */
+
+        /* the following are only valid if gen == wasi_pollset::gen */
+        uint32_t gen;
+        short wanted;  /* poll events wanted by the current poll */
+        short revents; /* poll events returned for the current poll */
+};
+#endif
+
+/*
+ * per-instance state for poll_oneoff.
+ *
+ * it's owned by a poll_oneoff call at a time. (wasi_pollset_acquire)
+ * other concurrent poll_oneoff calls, which are rare in practice,
+ * use their own temporary buffers and poll(2).
+ */
+struct wasi_pollset {
+        TOYWASM_MUTEX_DEFINE(lock);
+        bool busy GUARDED_VAR(lock);
+
+        /* scratch buffers for the owner */
+        struct pollfd *pollfds;
+        struct wasi_fdinfo **fdinfos;
+        uint32_t nalloc;
+
+#if defined(TOYWASM_USE_WASI_EPOLL)
+        /*
+         * an epoll set which keeps the registrations across calls.
+         * the entries are protected by the lock because
+         * wasi_pollset_forget can be called by other threads.
+         */
+        int epfd;    /* -1 if not set up yet */
+        bool failed; /* epoll is not available. use poll instead */
+        uint32_t gen;
+        VEC(, struct wasi_epoll_entry) entries; /* indexed by host fd */
+        struct epoll_event *evs;
+        uint32_t nevs;
+#endif
+
+        struct mem_context *mctx;
+};
+
+void wasi_pollset_init(struct wasi_pollset *ps, struct mem_context *mctx);
+void wasi_pollset_clear(struct wasi_pollset *ps);
+
+/*
+ * wasi_pollset_acquire: take the ownership of the pollset and
+ * prepare zeroed scratch buffers for n subscriptions.
+ *
+ * returns false if the pollset is being used by another thread or
+ * the allocation failed.
+ */
+bool wasi_pollset_acquire(struct wasi_pollset *ps, uint32_t n);
+void wasi_pollset_release(struct wasi_pollset *ps);
+
+/*
+ * wasi_pollset_poll: wasi_poll on the owner's scratch pollfds.
+ *
+ * it's equivalent to wasi_poll(ctx, ps->pollfds, n, ...).
+ * with TOYWASM_USE_WASI_EPOLL, it uses the epoll set and only updates
+ * the registrations which changed since the previous call.
+ */
+int wasi_pollset_poll(struct exec_context *ctx, struct wasi_pollset *ps,
+                      uint32_t n, int timeout_ms, int *retp, int *neventsp);
+
+/*
+ * wasi_pollset_forget: forget the fd which is about to be closed.
+ *
+ * it's necessary because the host fd number can be reused
+ * for another file soon after the close.
+ */
+void wasi_pollset_forget(struct wasi_pollset *ps, struct wasi_fdinfo *fdinfo);
+
+#endif /* !defined(_TOYWASM_WASI_POLLSET_H) */
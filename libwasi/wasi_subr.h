@@ -10,6 +10,14 @@ struct meminst;
 int wasi_unstable_convert_filestat(const struct wasi_filestat *wst,
                                    struct wasi_unstable_filestat *uwst);
 int wasi_userfd_reject_directory(struct wasi_fdinfo *fdinfo);
+
+/*
+ * wasi_copyin_iovec: convert a wasi iovec array to a host one.
+ *
+ * the resulted iovec points directly to the linear memory so that
+ * backends with scatter-gather i/o (eg. readv/writev) don't need
+ * to copy the data. the caller should free() it.
+ */
 int wasi_copyin_iovec(struct exec_context *ctx, struct meminst *mem,
                       uint32_t iov_uaddr, uint32_t iov_count,
                       struct iovec **resultp, int *usererrorp);
@@ -9,10 +9,25 @@
 
 #include "wasi_uio.h"
 
+bool
+wasi_iovec_need_copy(const struct iovec *iov, int iovcnt)
+{
+        /*
+         * a single iovec is already flat. use the buffer as it is.
+         * it's the most common case. (eg. printf via wasi-libc)
+         */
+        return iovcnt != 1;
+}
+
 int
 wasi_iovec_flatten(const struct iovec *iov0, int iovcnt, void **bufp,
                    size_t *lenp)
 {
+        if (!wasi_iovec_need_copy(iov0, iovcnt)) {
+                *bufp = iov0[0].iov_base;
+                *lenp = iov0[0].iov_len;
+                return 0;
+        }
         size_t sz = 0;
         int i;
         for (i = 0; i < iovcnt; i++) {
@@ -39,6 +54,11 @@ int
 wasi_iovec_flatten_uninitialized(const struct iovec *iov0, int iovcnt,
                                  void **bufp, size_t *lenp)
 {
+        if (!wasi_iovec_need_copy(iov0, iovcnt)) {
+                *bufp = iov0[0].iov_base;
+                *lenp = iov0[0].iov_len;
+                return 0;
+        }
         size_t sz = 0;
         int i;
         for (i = 0; i < iovcnt; i++) {
@@ -58,6 +78,11 @@ void
 wasi_iovec_commit_flattened_data(const struct iovec *iov0, int iovcnt,
                                  const void *buf, size_t len)
 {
+        if (!wasi_iovec_need_copy(iov0, iovcnt)) {
+                assert(buf == iov0[0].iov_base);
+                assert(len <= iov0[0].iov_len);
+                return;
+        }
         const uint8_t *p = buf;
         size_t left = len;
         int i;
@@ -75,7 +100,11 @@ wasi_iovec_commit_flattened_data(const struct iovec *iov0, int iovcnt,
 }
 
 void
-wasi_iovec_free_flattened_buffer(void *buf)
+wasi_iovec_free_flattened_buffer(const struct iovec *iov, int iovcnt,
+                                 void *buf)
 {
+        if (!wasi_iovec_need_copy(iov, iovcnt)) {
+                return;
+        }
         free(buf);
 }
@@ -1,6 +1,8 @@
 #include <sys/types.h>
 #include <sys/uio.h>
 
+#include <stdbool.h>
+
 #include "platform.h"
 
 __BEGIN_EXTERN_C
@@ -8,8 +10,15 @@ __BEGIN_EXTERN_C
 /*
  * helper functions for backends which don't support iovec-like
  * scatter-gather operations. eg. littlefs.
+ *
+ * the iovec usually points directly to the linear memory.
+ * (see wasi_copyin_iovec) when it consists of a single buffer,
+ * these functions just use it without copying.
  */
 
+/* true if the following functions use a bounce buffer */
+bool wasi_iovec_need_copy(const struct iovec *iov, int iovcnt);
+
 /* for writev */
 int wasi_iovec_flatten(const struct iovec *iov, int iovcnt, void **bufp,
                        size_t *lenp);
@@ -19,6 +28,7 @@ int wasi_iovec_flatten_uninitialized(const struct iovec *iov, int iovcnt,
 void wasi_iovec_commit_flattened_data(const struct iovec *iov, int iovcnt,
                                       const void *buf, size_t len);
 
-void wasi_iovec_free_flattened_buffer(void *buf);
+void wasi_iovec_free_flattened_buffer(const struct iovec *iov, int iovcnt,
+                                      void *buf);
 
 __END_EXTERN_C
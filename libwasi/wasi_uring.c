@@ -0,0 +1,494 @@
+/*
+ * io_uring backend for blocking i/o on host fds.
+ *
+ * without this, a wasm thread doing a blocking read on a host fd
+ * (eg. a pipe or a socket) loops on poll() with a short timeout
+ * to check interrupts. with TOYWASM_USE_USER_SCHED, it also means
+ * that the thread keeps being scheduled just to poll the fd again.
+ *
+ * with this, a thread submits a poll request (IORING_OP_POLL_ADD)
+ * and the completion is delivered via the completion queue.
+ * with TOYWASM_USE_USER_SCHED, the thread is blocked with sched_block
+ * and yields the scheduler via the restart mechanism. the scheduler
+ * calls back our event source (uring_sched_wait) to reap completions
+ * and wake up the threads.
+ *
+ * we only use io_uring to wait for readiness, not to perform the i/o
+ * itself. the actual read/write is still done by the vfs layer
+ * (wasi_vfs_fd_readv etc) after the wakeup. it's because an in-flight
+ * read into the linear memory can't survive things like memory.grow,
+ * which might move the memory, or the termination of the thread.
+ *
+ * we use the raw system calls to avoid a dependency on liburing.
+ */
+
+#define _GNU_SOURCE /* syscall, MAP_POPULATE */
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <linux/io_uring.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "exec_context.h"
+#include "mem.h"
+#include "restart.h"
+#include "wasi_uring.h"
+#include "xlog.h"
+
+#define WASI_URING_ENTRIES 64
+
+struct wasi_uring_req {
+        LIST_ENTRY(struct wasi_uring_req) e;
+
+        /*
+         * the thread waiting on this request. NULL if cancelled.
+         *
+         * it's only dereferenced while the request is blocked.
+         * otherwise, the thread might have gone without picking up
+         * the request. (eg. terminated by a trap in another thread)
+         */
+        struct exec_context *ctx;
+        uint64_t id; /* saved in RESTART_URING across restarts */
+        int hostfd;
+        short event;
+
+        bool done;
+        bool blocked; /* ctx is blocked with sched_block */
+        int32_t res;
+};
+
+static void
+req_free(struct wasi_uring *u, struct wasi_uring_req *req)
+{
+        LIST_REMOVE(&u->reqs, req, e);
+        mem_free(u->mctx, req, sizeof(*req));
+}
+
+static struct wasi_uring_req *
+req_find(struct wasi_uring *u, uint64_t id)
+{
+        struct wasi_uring_req *req;
+        LIST_FOREACH(req, &u->reqs, e) {
+                if (req->ctx != NULL && req->id == id) {
+                        return req;
+                }
+        }
+        return NULL;
+}
+
+static uint32_t
+poll32_events(short event)
+{
+        uint32_t ev = (uint16_t)event;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        /* the kernel swaps the halfwords on big endian hosts */
+        ev = (ev << 16) | (ev >> 16);
+#endif
+        return ev;
+}
+
+static int
+uring_submit(struct wasi_uring *u, uint8_t opcode, int fd, uint64_t addr,
+             uint32_t poll_events, uint64_t user_data)
+{
+        /*
+         * Note: we submit each sqe immediately. thus the sq is never
+         * full unless the kernel is failing to consume it.
+         */
+        const uint32_t tail =
+                atomic_load_explicit(u->sq_tail, memory_order_relaxed);
+        const uint32_t head =
+                atomic_load_explicit(u->sq_head, memory_order_acquire);
+        if (tail - head >= u->sq_entries) {
+                return EAGAIN;
+        }
+        const uint32_t idx = tail & u->sq_mask;
+        struct io_uring_sqe *sqe = &u->sqes[idx];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->fd = fd;
+        sqe->addr = addr;
+        sqe->poll32_events = poll_events;
+        sqe->user_data = user_data;
+        u->sq_array[idx] = idx;
+        atomic_store_explicit(u->sq_tail, tail + 1, memory_order_release);
+        int ret;
+        do {
+                ret = (int)syscall(__NR_io_uring_enter, u->fd, 1, 0, 0, NULL,
+                                   0);
+        } while (ret == -1 && errno == EINTR);
+        if (ret == -1) {
+                ret = errno;
+                assert(ret > 0);
+                xlog_error("%s: io_uring_enter failed with %d", __func__,
+                           ret);
+                return ret;
+        }
+        return 0;
+}
+
+/*
+ * process completions.
+ * returns the number of threads woken up.
+ */
+static uint32_t
+uring_reap(struct wasi_uring *u)
+{
+        uint32_t head = atomic_load_explicit(u->cq_head, memory_order_relaxed);
+        const uint32_t tail =
+                atomic_load_explicit(u->cq_tail, memory_order_acquire);
+        uint32_t nwoken = 0;
+        while (head != tail) {
+                const struct io_uring_cqe *cqe = &u->cqes[head & u->cq_mask];
+                struct wasi_uring_req *req = (void *)(uintptr_t)cqe->user_data;
+                const int32_t res = cqe->res;
+                head++;
+                if (req == NULL) {
+                        /* IORING_OP_POLL_REMOVE */
+                        continue;
+                }
+                if (req->ctx == NULL) {
+                        /* cancelled by uring_cancel */
+                        req_free(u, req);
+                        continue;
+                }
+                assert(!req->done);
+                req->done = true;
+                req->res = res;
+#if defined(TOYWASM_USE_USER_SCHED)
+                if (req->blocked) {
+                        struct exec_context *ctx = req->ctx;
+                        req->blocked = false;
+                        sched_wakeup(ctx->sched, ctx);
+                        nwoken++;
+                }
+#endif
+        }
+        atomic_store_explicit(u->cq_head, head, memory_order_release);
+        return nwoken;
+}
+
+static int
+uring_wait(struct wasi_uring *u, int timeout_ms)
+{
+        struct __kernel_timespec ts;
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        int ret = (int)syscall(__NR_io_uring_enter, u->fd, 0, 1,
+                               IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                               &arg, sizeof(arg));
+        if (ret == -1) {
+                ret = errno;
+                assert(ret > 0);
+                if (ret == ETIME || ret == EINTR) {
+                        return 0;
+                }
+                xlog_error("%s: io_uring_enter failed with %d", __func__,
+                           ret);
+                return ret;
+        }
+        return 0;
+}
+
+/*
+ * cancel a request which is no longer interesting.
+ */
+static void
+uring_cancel(struct wasi_uring *u, struct wasi_uring_req *req)
+{
+        assert(!req->blocked);
+        if (req->done) {
+                req_free(u, req);
+                return;
+        }
+        /*
+         * the request is freed when its completion (-ECANCELED or
+         * the poll result if it raced with the cancellation) is reaped.
+         */
+        req->ctx = NULL;
+        int ret = uring_submit(u, IORING_OP_POLL_REMOVE, -1,
+                               (uint64_t)(uintptr_t)req, 0, 0);
+        if (ret != 0) {
+                /* the request is kept until wasi_uring_clear. */
+                xlog_error("%s: failed to cancel a request with %d",
+                           __func__, ret);
+        }
+}
+
+#if defined(TOYWASM_USE_USER_SCHED)
+static void
+uring_sched_wait(struct sched_event_source *src, struct sched *sched,
+                 int timeout_ms)
+{
+        struct wasi_uring *u = (void *)src;
+        if (timeout_ms > 0) {
+                /* errors are logged by uring_wait */
+                uring_wait(u, timeout_ms);
+        }
+        if (uring_reap(u) > 0 || timeout_ms == 0) {
+                return;
+        }
+        /*
+         * nothing happened within the timeout. wake up all the threads
+         * so that they can check interrupts. they block again with
+         * the same requests.
+         */
+        struct wasi_uring_req *req;
+        LIST_FOREACH(req, &u->reqs, e) {
+                if (req->blocked) {
+                        assert(req->ctx->sched == sched);
+                        req->blocked = false;
+                        sched_wakeup(sched, req->ctx);
+                }
+        }
+}
+#endif
+
+static int
+uring_setup(struct wasi_uring *u)
+{
+        struct io_uring_params p;
+        void *ring = MAP_FAILED;
+        void *sqes = MAP_FAILED;
+        size_t ring_size = 0;
+        size_t sqes_size = 0;
+        int ret;
+
+        memset(&p, 0, sizeof(p));
+        int fd = (int)syscall(__NR_io_uring_setup, WASI_URING_ENTRIES, &p);
+        if (fd == -1) {
+                ret = errno;
+                assert(ret > 0);
+                goto fail;
+        }
+        /*
+         * IORING_FEAT_SINGLE_MMAP: linux 5.4
+         * IORING_FEAT_NODROP: linux 5.5
+         * IORING_FEAT_EXT_ARG: linux 5.11
+         */
+        const uint32_t required_features = IORING_FEAT_SINGLE_MMAP |
+                                           IORING_FEAT_NODROP |
+                                           IORING_FEAT_EXT_ARG;
+        if ((p.features & required_features) != required_features) {
+                ret = ENOTSUP;
+                goto fail;
+        }
+        const size_t sq_size =
+                p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+        const size_t cq_size =
+                p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+        ring_size = (sq_size > cq_size) ? sq_size : cq_size;
+        ring = mmap(NULL, ring_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (ring == MAP_FAILED) {
+                ret = errno;
+                assert(ret > 0);
+                goto fail;
+        }
+        sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+        sqes = mmap(NULL, sqes_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+                ret = errno;
+                assert(ret > 0);
+                goto fail;
+        }
+        uint8_t *r = ring;
+        u->fd = fd;
+        u->ring = ring;
+        u->ring_size = ring_size;
+        u->sqes = sqes;
+        u->sqes_size = sqes_size;
+        u->sq_entries = p.sq_entries;
+        u->sq_head = (void *)(r + p.sq_off.head);
+        u->sq_tail = (void *)(r + p.sq_off.tail);
+        u->sq_mask = *(const uint32_t *)(r + p.sq_off.ring_mask);
+        u->sq_array = (void *)(r + p.sq_off.array);
+        u->cq_head = (void *)(r + p.cq_off.head);
+        u->cq_tail = (void *)(r + p.cq_off.tail);
+        u->cq_mask = *(const uint32_t *)(r + p.cq_off.ring_mask);
+        u->cqes = (void *)(r + p.cq_off.cqes);
+        xlog_trace("%s: io_uring fd %d sq %" PRIu32 " cq %" PRIu32, __func__,
+                   fd, p.sq_entries, p.cq_entries);
+        return 0;
+fail:
+        if (sqes != MAP_FAILED) {
+                munmap(sqes, sqes_size);
+        }
+        if (ring != MAP_FAILED) {
+                munmap(ring, ring_size);
+        }
+        if (fd != -1) {
+                close(fd);
+        }
+        return ret;
+}
+
+void
+wasi_uring_init(struct wasi_uring *u, struct mem_context *mctx)
+{
+        memset(u, 0, sizeof(*u));
+#if defined(TOYWASM_USE_USER_SCHED)
+        u->src.wait = uring_sched_wait;
+#endif
+        u->fd = -1;
+        u->mctx = mctx;
+        LIST_HEAD_INIT(&u->reqs);
+}
+
+void
+wasi_uring_clear(struct wasi_uring *u)
+{
+        struct wasi_uring_req *req;
+        while ((req = LIST_FIRST(&u->reqs)) != NULL) {
+                assert(!req->blocked);
+                req_free(u, req);
+        }
+        if (u->fd != -1) {
+                munmap(u->sqes, u->sqes_size);
+                munmap(u->ring, u->ring_size);
+                close(u->fd);
+                u->fd = -1;
+        }
+}
+
+bool
+wasi_uring_available(struct wasi_uring *u)
+{
+        if (u->fd != -1) {
+                return true;
+        }
+        if (u->failed) {
+                return false;
+        }
+        int ret = uring_setup(u);
+        if (ret != 0) {
+                xlog_trace("%s: io_uring is not available (%d). "
+                           "falling back to poll",
+                           __func__, ret);
+                u->failed = true;
+                return false;
+        }
+        return true;
+}
+
+/*
+ * cancel requests abandoned by a thread. (or by a dead thread which
+ * happened to have the same exec_context address)
+ *
+ * a thread waits for at most one request at a time. thus, when it
+ * starts a new wait, its other requests are not going to be picked up.
+ */
+static void
+uring_cancel_abandoned(struct wasi_uring *u, const struct exec_context *ctx)
+{
+        struct wasi_uring_req *req;
+        struct wasi_uring_req *next;
+        for (req = LIST_FIRST(&u->reqs); req != NULL; req = next) {
+                next = LIST_NEXT(req, e);
+                if (req->ctx == ctx) {
+                        uring_cancel(u, req);
+                }
+        }
+}
+
+int
+wasi_uring_wait_fd(struct exec_context *ctx, struct wasi_uring *u,
+                   int hostfd, short event, int *retp)
+{
+        struct wasi_uring_req *req = NULL;
+        int host_ret = 0;
+        int ret = 0;
+
+        assert(u->fd != -1);
+        host_ret = restart_info_prealloc(ctx);
+        if (host_ret != 0) {
+                return host_ret;
+        }
+        struct restart_info *restart = &VEC_NEXTELEM(ctx->restarts);
+        assert(restart->restart_type == RESTART_NONE ||
+               restart->restart_type == RESTART_URING);
+        if (restart->restart_type == RESTART_URING) {
+                req = req_find(u, restart->restart_u.uring.id);
+                restart->restart_type = RESTART_NONE;
+                assert(req == NULL || req->ctx == ctx);
+        }
+        if (req != NULL && (req->hostfd != hostfd || req->event != event)) {
+                /*
+                 * a request left by a previous call, which turned out
+                 * not to need to wait after a restart.
+                 */
+                uring_cancel(u, req);
+                req = NULL;
+        }
+        if (req == NULL) {
+                uring_cancel_abandoned(u, ctx);
+                req = mem_zalloc(u->mctx, sizeof(*req));
+                if (req == NULL) {
+                        ret = ENOMEM;
+                        goto fail;
+                }
+                req->ctx = ctx;
+                req->id = u->next_id++;
+                req->hostfd = hostfd;
+                req->event = event;
+                ret = uring_submit(u, IORING_OP_POLL_ADD, hostfd, 0,
+                                   poll32_events(event),
+                                   (uint64_t)(uintptr_t)req);
+                if (ret != 0) {
+                        mem_free(u->mctx, req, sizeof(*req));
+                        goto fail;
+                }
+                LIST_INSERT_TAIL(&u->reqs, req, e);
+        }
+        const int interval_ms = check_interrupt_interval_ms(ctx);
+        while (true) {
+                uring_reap(u);
+                if (req->done) {
+                        if (req->res < 0) {
+                                ret = -req->res;
+                        }
+                        req_free(u, req);
+                        break;
+                }
+                host_ret = check_interrupt(ctx);
+                if (host_ret != 0) {
+                        if (IS_RESTARTABLE(host_ret)) {
+                                /* picked up after the restart. */
+                                restart->restart_type = RESTART_URING;
+                                restart->restart_u.uring.id = req->id;
+                        }
+                        break;
+                }
+#if defined(TOYWASM_USE_USER_SCHED)
+                if (ctx->sched != NULL) {
+                        req->blocked = true;
+                        sched_block(ctx->sched, ctx, &u->src);
+                        restart->restart_type = RESTART_URING;
+                        restart->restart_u.uring.id = req->id;
+                        host_ret = ETOYWASMRESTART;
+                        break;
+                }
+#endif
+                ret = uring_wait(u, interval_ms);
+                if (ret != 0) {
+                        break;
+                }
+        }
+fail:
+        assert(IS_RESTARTABLE(host_ret) ||
+               restart->restart_type == RESTART_NONE);
+        if (host_ret == 0) {
+                *retp = ret;
+        }
+        return host_ret;
+}
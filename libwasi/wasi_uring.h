@@ -0,0 +1,78 @@
+#if !defined(_TOYWASM_WASI_URING_H)
+#define _TOYWASM_WASI_URING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "list.h"
+#include "toywasm_config.h"
+#if defined(TOYWASM_USE_USER_SCHED)
+#include "usched.h"
+#endif
+
+struct exec_context;
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct mem_context;
+struct wasi_uring_req;
+
+/*
+ * an io_uring instance to wait for i/o readiness of host fds.
+ *
+ * this is not thread-safe. TOYWASM_USE_WASI_IO_URING is only available
+ * for configurations where all wasm threads run on a single host thread.
+ * (no threads or TOYWASM_USE_USER_SCHED)
+ */
+struct wasi_uring {
+#if defined(TOYWASM_USE_USER_SCHED)
+        struct sched_event_source src;
+#endif
+        int fd;      /* -1 if not set up yet */
+        bool failed; /* io_uring is not available. use poll instead */
+
+        void *ring;
+        size_t ring_size;
+        struct io_uring_sqe *sqes;
+        size_t sqes_size;
+
+        uint32_t sq_entries;
+        _Atomic uint32_t *sq_head;
+        _Atomic uint32_t *sq_tail;
+        uint32_t sq_mask;
+        uint32_t *sq_array;
+        _Atomic uint32_t *cq_head;
+        _Atomic uint32_t *cq_tail;
+        uint32_t cq_mask;
+        struct io_uring_cqe *cqes;
+
+        LIST_HEAD_NAMED(struct wasi_uring_req, wasi_uring_reqlist) reqs;
+        uint64_t next_id;
+        struct mem_context *mctx;
+};
+
+void wasi_uring_init(struct wasi_uring *u, struct mem_context *mctx);
+void wasi_uring_clear(struct wasi_uring *u);
+
+/*
+ * wasi_uring_available: set up io_uring if it isn't yet.
+ * returns false if io_uring is not available. (eg. old kernels,
+ * seccomp) in that case, the caller should fall back to poll.
+ */
+bool wasi_uring_available(struct wasi_uring *u);
+
+/*
+ * wasi_uring_wait_fd: the io_uring version of wait_fd_ready.
+ *
+ * it submits a poll request to the kernel and waits for its completion.
+ * with TOYWASM_USE_USER_SCHED, instead of blocking the host thread, it
+ * blocks the calling thread with sched_block and returns
+ * ETOYWASMRESTART so that other threads can run meanwhile.
+ * the request is kept across restarts. its id is saved in the
+ * restart info (RESTART_URING) of the exec_context so that the
+ * next call picks it up.
+ */
+int wasi_uring_wait_fd(struct exec_context *ctx, struct wasi_uring *u,
+                       int hostfd, short event, int *retp);
+
+#endif /* !defined(_TOYWASM_WASI_URING_H) */
@@ -36,6 +36,8 @@ struct wasi_vfs_lfs {
                 uint64_t bd_prog_bytes;
                 uint64_t bd_erase;
                 uint64_t bd_sync;
+                /* bytes copied via bounce buffers. see wasi_uio.h */
+                uint64_t iov_copy_bytes;
         } stat;
 #endif
 #if !defined(NDEBUG)
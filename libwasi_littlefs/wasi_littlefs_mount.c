@@ -242,6 +242,7 @@ wasi_littlefs_umount_file(struct wasi_vfs *vfs)
         LFS_PRINT_STAT(&vfs_lfs->stat, bd_prog_bytes);
         LFS_PRINT_STAT(&vfs_lfs->stat, bd_erase);
         LFS_PRINT_STAT(&vfs_lfs->stat, bd_sync);
+        LFS_PRINT_STAT(&vfs_lfs->stat, iov_copy_bytes);
         free(vfs_lfs);
         return 0;
 }
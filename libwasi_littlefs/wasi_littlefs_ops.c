@@ -168,6 +168,9 @@ wasi_lfs_fd_writev(struct wasi_fdinfo *fdinfo, const struct iovec *iov,
                         goto fail;
                 }
         }
+        if (wasi_iovec_need_copy(iov, iovcnt)) {
+                LFS_STAT_ADD(lfs->stat.iov_copy_bytes, buflen);
+        }
         lfs_ssize_t ssz =
                 lfs_file_write(&lfs->lfs, file, buf, (lfs_size_t)buflen);
         UNLOCK(lfs);
@@ -178,7 +181,7 @@ wasi_lfs_fd_writev(struct wasi_fdinfo *fdinfo, const struct iovec *iov,
         *result = ssz;
         ret = 0;
 fail:
-        wasi_iovec_free_flattened_buffer(buf);
+        wasi_iovec_free_flattened_buffer(iov, iovcnt, buf);
         return ret;
 }
 
@@ -218,6 +221,9 @@ wasi_lfs_fd_pwritev(struct wasi_fdinfo *fdinfo, const struct iovec *iov,
                 ret = lfs_error_to_errno(ret);
                 goto fail;
         }
+        if (wasi_iovec_need_copy(iov, iovcnt)) {
+                LFS_STAT_ADD(lfs->stat.iov_copy_bytes, buflen);
+        }
         lfs_ssize_t ssz =
                 lfs_file_write(&lfs->lfs, file, buf, (lfs_size_t)buflen);
         if (ssz < 0) {
@@ -234,7 +240,7 @@ wasi_lfs_fd_pwritev(struct wasi_fdinfo *fdinfo, const struct iovec *iov,
         *result = ssz;
         ret = 0;
 fail:
-        wasi_iovec_free_flattened_buffer(buf);
+        wasi_iovec_free_flattened_buffer(iov, iovcnt, buf);
         return ret;
 }
 
@@ -281,6 +287,9 @@ wasi_lfs_fd_readv(struct wasi_fdinfo *fdinfo, const struct iovec *iov,
         LOCK(lfs);
         lfs_ssize_t ssz =
                 lfs_file_read(&lfs->lfs, file, buf, (lfs_size_t)buflen);
+        if (ssz > 0 && wasi_iovec_need_copy(iov, iovcnt)) {
+                LFS_STAT_ADD(lfs->stat.iov_copy_bytes, ssz);
+        }
         UNLOCK(lfs);
         if (ssz < 0) {
                 ret = lfs_error_to_errno(ssz);
@@ -290,7 +299,7 @@ wasi_lfs_fd_readv(struct wasi_fdinfo *fdinfo, const struct iovec *iov,
         *result = ssz;
         ret = 0;
 fail:
-        wasi_iovec_free_flattened_buffer(buf);
+        wasi_iovec_free_flattened_buffer(iov, iovcnt, buf);
         return ret;
 }
 
@@ -337,6 +346,9 @@ wasi_lfs_fd_preadv(struct wasi_fdinfo *fdinfo, const struct iovec *iov,
                 ret = lfs_error_to_errno(ssz);
                 goto fail;
         }
+        if (wasi_iovec_need_copy(iov, iovcnt)) {
+                LFS_STAT_ADD(lfs->stat.iov_copy_bytes, ssz);
+        }
         ret = lfs_file_seek(&lfs->lfs, file, origoff, LFS_SEEK_SET);
         UNLOCK(lfs);
         if (ret < 0) {
@@ -347,7 +359,7 @@ wasi_lfs_fd_preadv(struct wasi_fdinfo *fdinfo, const struct iovec *iov,
         *result = ssz;
         ret = 0;
 fail:
-        wasi_iovec_free_flattened_buffer(buf);
+        wasi_iovec_free_flattened_buffer(iov, iovcnt, buf);
         return ret;
 }
 
@@ -19,6 +19,7 @@
 #include "instance.h"
 #include "lock.h"
 #include "mem.h"
+#include "mnsched.h"
 #include "module.h"
 #include "suspend.h"
 #include "type.h"
@@ -58,6 +59,10 @@ struct wasi_threads_instance {
 #if defined(TOYWASM_USE_USER_SCHED)
         struct sched sched;
 #endif
+#if defined(TOYWASM_USE_MN_SCHED)
+        /* created on the first thread_spawn. protected by cluster.lock */
+        struct mnsched *mnsched;
+#endif
 
         struct mem_context *mctx;
 };
@@ -119,6 +124,11 @@ wasi_threads_instance_destroy(struct wasi_threads_instance *inst)
         cluster_destroy(&inst->cluster);
 #if defined(TOYWASM_USE_USER_SCHED)
         sched_clear(&inst->sched);
+#endif
+#if defined(TOYWASM_USE_MN_SCHED)
+        if (inst->mnsched != NULL) {
+                mnsched_destroy(inst->mnsched);
+        }
 #endif
         mem_free(mctx, inst, sizeof(*inst));
 }
@@ -383,6 +393,63 @@ user_runner_exec_start(struct thread_arg *arg)
 fail:
         return ret;
 }
+#elif defined(TOYWASM_USE_MN_SCHED)
+struct mn_runner {
+        struct mnsched_thread t;
+        struct exec_context ctx;
+};
+
+static int
+mn_runner_start(struct mnsched_thread *t)
+{
+        return exec_thread_start_func(t->ctx, t->arg);
+}
+
+static void
+mn_runner_done(struct mnsched_thread *t, int ret)
+{
+        struct mn_runner *r = (void *)t;
+        struct thread_arg *arg = t->arg;
+        done_thread_start_func(&r->ctx, arg, ret);
+        free(arg);
+        free(r);
+}
+
+static int
+mn_runner_exec_start(struct exec_context *parent, struct thread_arg *arg)
+{
+        struct wasi_threads_instance *wasi = arg->wasi;
+        struct mnsched *sched;
+        int ret;
+
+        toywasm_mutex_lock(&wasi->cluster.lock);
+        if (wasi->mnsched == NULL) {
+                /* XXX make the number of workers configurable */
+                ret = mnsched_create(wasi->mctx, 0, &wasi->mnsched);
+                if (ret != 0) {
+                        toywasm_mutex_unlock(&wasi->cluster.lock);
+                        return ret;
+                }
+        }
+        sched = wasi->mnsched;
+        toywasm_mutex_unlock(&wasi->cluster.lock);
+
+        struct mn_runner *r = malloc(sizeof(*r));
+        if (r == NULL) {
+                return ENOMEM;
+        }
+        struct exec_context *ctx = &r->ctx;
+        exec_context_init(ctx, arg->inst, arg->mctx);
+        /* exec_thread_start_func sets the other fields */
+        ctx->cluster = wasi_threads_cluster(wasi);
+        ctx->mnsched_thread = &r->t;
+        r->t.ctx = ctx;
+        r->t.start = mn_runner_start;
+        r->t.done = mn_runner_done;
+        r->t.arg = arg;
+        mnsched_spawn(sched, &r->t, parent->mnsched_thread);
+        return 0;
+}
 #else  /* defined(TOYWASM_USE_USER_SCHED) */
 static void *
 runner(void *vp)
@@ -467,6 +534,17 @@ wasi_thread_spawn_common(struct exec_context *ctx,
 
 #if defined(TOYWASM_USE_USER_SCHED)
         ret = user_runner_exec_start(arg);
+#elif defined(TOYWASM_USE_MN_SCHED)
+        ret = mn_runner_exec_start(ctx, arg);
+        if (ret != 0) {
+                toywasm_mutex_lock(&wasi->cluster.lock);
+                idalloc_free(&wasi->tids, tid, wasi->mctx);
+                cluster_remove_thread(&wasi->cluster);
+                toywasm_mutex_unlock(&wasi->cluster.lock);
+                xlog_trace("%s: mn_runner_exec_start failed with %d",
+                           __func__, ret);
+                goto fail;
+        }
 #else
         pthread_t t;
         ret = pthread_create(&t, NULL, runner, arg);
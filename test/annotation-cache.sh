@@ -0,0 +1,86 @@
+#! /bin/sh
+
+# test the annotation cache (--annotation-cache)
+#
+# expected usage:
+#
+# TEST_RUNTIME_EXE=toywasm ./test/annotation-cache.sh insn_fusion.wasm
+#
+# the module should be a self-checking one, which traps on a failure.
+#
+# the cache is only written on a miss. we tell a hit from a miss by
+# checking if the cache file has been rewritten.
+
+set -e
+
+TEST_RUNTIME_EXE=${TEST_RUNTIME_EXE:-toywasm}
+WASM=$1
+
+DIR=$(mktemp -d)
+trap "rm -rf ${DIR}" EXIT
+
+run() {
+    ${TEST_RUNTIME_EXE} --annotation-cache ${DIR}/cache "$1"
+}
+
+ncache() {
+    ls ${DIR}/cache | wc -l | tr -d ' '
+}
+
+# make the cache file look old.
+# the stamp is old as well to be independent from the timestamp
+# granularity of the filesystem.
+age() {
+    touch -t 200001010000 ${CACHE}
+    touch -t 200001010001 ${DIR}/stamp
+}
+
+rewritten() {
+    test -n "$(find ${CACHE} -newer ${DIR}/stamp)"
+}
+
+mkdir ${DIR}/cache
+
+echo "first run: a miss, which creates the cache"
+run ${WASM}
+test $(ncache) -eq 1
+CACHE=$(ls ${DIR}/cache/*.annotations)
+cp ${CACHE} ${DIR}/orig
+
+echo "second run: a hit, which doesn't touch the cache"
+age
+run ${WASM}
+if rewritten; then
+    echo "unexpected cache miss"
+    exit 1
+fi
+cmp ${CACHE} ${DIR}/orig
+
+echo "a broken cache: a miss, which rewrites the cache"
+printf 'XXXX' | dd of=${CACHE} bs=1 count=4 conv=notrunc 2> /dev/null
+age
+run ${WASM}
+rewritten
+cmp ${CACHE} ${DIR}/orig
+
+echo "a truncated cache: a miss, which rewrites the cache"
+head -c $(($(wc -c < ${DIR}/orig) - 1)) ${DIR}/orig > ${CACHE}
+age
+run ${WASM}
+rewritten
+cmp ${CACHE} ${DIR}/orig
+
+echo "a modified module: a miss, which creates another cache"
+# append an empty custom section named "x"
+cp ${WASM} ${DIR}/modified.wasm
+printf '\000\002\001x' >> ${DIR}/modified.wasm
+age
+run ${DIR}/modified.wasm
+test $(ncache) -eq 2
+if rewritten; then
+    echo "the cache for the original module was modified"
+    exit 1
+fi
+cmp ${CACHE} ${DIR}/orig
+
+echo "success"
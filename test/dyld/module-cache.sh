@@ -0,0 +1,43 @@
+#! /bin/sh
+
+# test the sharing of modules among dyld instances via the module cache
+#
+# expected usage:
+#
+# TEST_RUNTIME_EXE=toywasm ./test/dyld/module-cache.sh \
+# module_cache_main.wasm libshared.wasm
+#
+# the modules are wat/dyld/module_cache_main.wat and wat/dyld/libshared.wat.
+#
+# the cli loads each --load with its own dyld instance, all sharing
+# a module cache. it unloads them in the order of --load, printing
+# the stats of each dyld instance before unloading it.
+
+set -e
+
+TEST_RUNTIME_EXE=${TEST_RUNTIME_EXE:-toywasm}
+MAIN=$1
+LIB=$2
+
+DIR=$(mktemp -d)
+trap "rm -rf ${DIR}" EXIT
+
+cp ${LIB} ${DIR}/libshared.so
+
+# users LIBNAME: print the "users" column of the dyld stats for LIBNAME
+users() {
+    sed -n "s/^ *$1 .* users *\([0-9]*\).*/\1/p" ${DIR}/out
+}
+
+echo "load the same library twice"
+${TEST_RUNTIME_EXE} --dyld --dyld-path ${DIR} --print-stats \
+--load ${MAIN} --invoke run \
+--load ${MAIN} --invoke run > ${DIR}/out
+cat ${DIR}/out
+test $(grep -c "Result: 42:i32" ${DIR}/out) -eq 2
+
+echo "the library is shared by the two dyld instances"
+echo "and released when the first instance is unloaded"
+test "$(users libshared.so | tr '\n' ' ')" = "2 1 "
+
+echo "success"
@@ -0,0 +1,37 @@
+#! /bin/sh
+
+# test the symbol resolution of dyld
+#
+# expected usage:
+#
+# TEST_RUNTIME_EXE=toywasm ./test/dyld/symbols.sh \
+# symbols_main.wasm libdup_a.wasm libdup_b.wasm
+#
+# the modules are wat/dyld/symbols_main.wat, wat/dyld/libdup_a.wat
+# and wat/dyld/libdup_b.wat.
+
+set -e
+
+TEST_RUNTIME_EXE=${TEST_RUNTIME_EXE:-toywasm}
+MAIN=$1
+LIBA=$2
+LIBB=$3
+
+DIR=$(mktemp -d)
+trap "rm -rf ${DIR}" EXIT
+
+cp ${LIBA} ${DIR}/libdup_a.so
+cp ${LIBB} ${DIR}/libdup_b.so
+
+echo "a symbol exported by two objects resolves to the first loaded one"
+${TEST_RUNTIME_EXE} --dyld --dyld-path ${DIR} --print-stats \
+--load ${MAIN} --invoke run > ${DIR}/out
+cat ${DIR}/out
+grep -q "Result: 42:i32" ${DIR}/out
+
+# the table starts with 16 slots and keeps the load factor <= 1/2.
+# (see dyld_symtab_add)
+echo "the symbol table has grown to have all the 44 symbols"
+grep -q "44 symbols in 128 slots" ${DIR}/out
+
+echo "success"
@@ -0,0 +1,54 @@
+#! /bin/sh
+
+# test --snapshot-save and --snapshot-restore
+#
+# expected usage:
+#
+# TEST_RUNTIME_EXE=toywasm ./test/snapshot.sh snapshot.wasm
+#
+# the module is wat/snapshot.wat.
+
+set -e
+
+TEST_RUNTIME_EXE=${TEST_RUNTIME_EXE:-toywasm}
+WASM=$1
+
+DIR=$(mktemp -d)
+trap "rm -rf ${DIR}" EXIT
+
+echo "a fresh instance doesn't have the mutated state"
+if ${TEST_RUNTIME_EXE} --load ${WASM} --invoke check; then
+    echo "check unexpectedly succeeded"
+    exit 1
+fi
+
+echo "save a snapshot after mutating the instance"
+${TEST_RUNTIME_EXE} --load ${WASM} --invoke mutate \
+--snapshot-save ${DIR}/snapshot
+${TEST_RUNTIME_EXE} --snapshot-restore ${DIR}/snapshot \
+--load ${WASM} --invoke check
+
+echo "a snapshot of another module is rejected"
+# append an empty custom section named "x".
+# it has the same number of entities as the original module.
+cp ${WASM} ${DIR}/modified.wasm
+printf '\000\002\001x' >> ${DIR}/modified.wasm
+if ${TEST_RUNTIME_EXE} --snapshot-restore ${DIR}/snapshot \
+--load ${DIR}/modified.wasm --invoke check > ${DIR}/out 2>&1; then
+    echo "restore unexpectedly succeeded"
+    exit 1
+fi
+cat ${DIR}/out
+grep -F "doesn't match the module" ${DIR}/out
+
+echo "a truncated snapshot is rejected"
+head -c 100 ${DIR}/snapshot > ${DIR}/truncated
+if ${TEST_RUNTIME_EXE} --snapshot-restore ${DIR}/truncated \
+--load ${WASM} --invoke check > ${DIR}/out 2>&1; then
+    echo "restore unexpectedly succeeded"
+    exit 1
+fi
+cat ${DIR}/out
+grep -F "is broken" ${DIR}/out
+
+echo "success"
@@ -21,7 +21,9 @@
 #include "idalloc.h"
 #include "leb128.h"
 #include "list.h"
+#include "load_context.h"
 #include "mem.h"
+#include "module.h"
 #include "slist.h"
 #include "timeutil.h"
 #include "type.h"
@@ -385,6 +387,27 @@ test_endian(void **state)
         assert_int_equal(v, le8_decode(buf));
 }
 
+static void
+check_functype_id(struct mem_context *mctx, const char *a, const char *b,
+                  bool equal)
+{
+        struct functype *fta;
+        struct functype *ftb;
+        int ret;
+
+        ret = functype_from_string(mctx, a, &fta);
+        assert_int_equal(ret, 0);
+        ret = functype_from_string(mctx, b, &ftb);
+        assert_int_equal(ret, 0);
+        if (fta->id != 0 && ftb->id != 0) {
+                assert_int_equal(fta->id == ftb->id, equal);
+        }
+        assert_int_equal(compare_functype(fta, ftb), !equal);
+        assert_int_equal(compare_functype(ftb, fta), !equal);
+        functype_free(mctx, fta);
+        functype_free(mctx, ftb);
+}
+
 void
 test_functype(void **state)
 {
@@ -460,6 +483,70 @@ test_functype(void **state)
         ret = functype_from_string(mctx, "i", &ft);
         assert_int_equal(ret, EINVAL);
 
+        /* canonical ids. see functype_set_id */
+        check_functype_id(mctx, "(iIi)fF", "(iIi)fF", true);
+        check_functype_id(mctx, "()", "()", true);
+        check_functype_id(mctx, "(iI)f", "(Ii)f", false);
+        check_functype_id(mctx, "(i)", "()i", false);
+        check_functype_id(mctx, "(i)i", "(i)ii", false);
+        check_functype_id(mctx, "(f)", "(F)", false);
+
+        /* 15 params + results still fit */
+        ret = functype_from_string(mctx, "(iiiiiiii)iiiiiii", &ft);
+        assert_int_equal(ret, 0);
+        assert_int_not_equal(ft->id, 0);
+        functype_free(mctx, ft);
+
+        /* more than that fall back to id 0 and structural comparison */
+        ret = functype_from_string(mctx, "(iiiiiiii)iiiiiiii", &ft);
+        assert_int_equal(ret, 0);
+        assert_int_equal(ft->id, 0);
+        functype_free(mctx, ft);
+        check_functype_id(mctx, "(iiiiiiii)iiiiiiii", "(iiiiiiii)iiiiiiii",
+                          true);
+        check_functype_id(mctx, "(iiiiiiii)iiiiiiii", "(iiiiiiii)iiiiiiiI",
+                          false);
+        check_functype_id(mctx, "(iiiiiiii)iiiiiiii", "(iiiiiiiii)iiiiiii",
+                          false);
+        check_functype_id(mctx, "(iiiiiiii)iiiiiiii", "(iiiiiiii)iiiiiii",
+                          false);
+
+        /* read_functype and functype_from_string should agree */
+        static const uint8_t bin[] = {
+                0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00,
+                /* type section */
+                0x01, 0x1f, 0x03,
+                /* (i32 i64 i32) -> (f32 f64) */
+                0x60, 0x03, 0x7f, 0x7e, 0x7f, 0x02, 0x7d, 0x7c,
+                /* () -> () */
+                0x60, 0x00, 0x00,
+                /* (i32 x 8) -> (i32 x 8) */
+                0x60, 0x08, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f,
+                0x08, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f,
+        };
+        static const char *const strs[] = {
+                "(iIi)fF",
+                "()",
+                "(iiiiiiii)iiiiiiii",
+        };
+        struct load_context lctx;
+        struct module *m;
+        uint32_t i;
+        load_context_init(&lctx, mctx);
+        ret = module_create(&m, bin, bin + sizeof(bin), &lctx);
+        assert_int_equal(ret, 0);
+        load_context_clear(&lctx);
+        assert_int_equal(m->ntypes, ARRAYCOUNT(strs));
+        for (i = 0; i < ARRAYCOUNT(strs); i++) {
+                const struct functype *mft = &m->types[i];
+                ret = functype_from_string(mctx, strs[i], &ft);
+                assert_int_equal(ret, 0);
+                assert_int_equal(mft->id, ft->id);
+                assert_int_equal(compare_functype(mft, ft), 0);
+                functype_free(mctx, ft);
+        }
+        module_destroy(mctx, m);
+
 #if defined(TOYWASM_ENABLE_HEAP_TRACKING)
         assert_int_equal(mctx->allocated, 0);
         mem_context_clear(mctx);
@@ -530,6 +617,199 @@ test_idalloc(void **state)
         mem_context_clear(mctx);
 }
 
+void
+test_mem_context_transfer(void **state)
+{
+#if defined(TOYWASM_ENABLE_HEAP_TRACKING)
+        struct mem_context parent;
+        struct mem_context dst;
+        struct mem_context src;
+        void *p;
+        void *q;
+        void *tmp;
+        int ret;
+
+        mem_context_init(&parent);
+        mem_context_init(&dst);
+        mem_context_init(&src);
+        dst.parent = &parent;
+        ret = mem_context_setlimit(&parent, 1000);
+        assert_int_equal(ret, 0);
+
+        p = mem_alloc(&dst, 100);
+        assert_non_null(p);
+
+        /* src peaks at 700 bytes and ends up with 300 bytes */
+        q = mem_alloc(&src, 300);
+        assert_non_null(q);
+        tmp = mem_alloc(&src, 400);
+        assert_non_null(tmp);
+        mem_free(&src, tmp, 400);
+
+        ret = mem_context_transfer(&dst, &src);
+        assert_int_equal(ret, 0);
+        assert_int_equal(src.allocated, 0);
+        assert_int_equal(dst.allocated, 400);
+        assert_int_equal(parent.allocated, 400);
+#if defined(TOYWASM_ENABLE_HEAP_TRACKING_PEAK)
+        /* 100 (dst) + 700 (the peak of src) */
+        assert_int_equal(src.peak, 0);
+        assert_int_equal(dst.peak, 800);
+        assert_int_equal(parent.peak, 800);
+#endif
+
+        /* the transferred allocation is freed with dst */
+        mem_free(&dst, q, 300);
+        assert_int_equal(dst.allocated, 100);
+        assert_int_equal(parent.allocated, 100);
+
+        /* exceeding the limit of the parent of dst */
+        q = mem_alloc(&src, 950);
+        assert_non_null(q);
+        ret = mem_context_transfer(&dst, &src);
+        assert_int_equal(ret, ENOMEM);
+        assert_int_equal(src.allocated, 950);
+        assert_int_equal(dst.allocated, 100);
+        assert_int_equal(parent.allocated, 100);
+        mem_free(&src, q, 950);
+
+        /* nothing to transfer */
+        ret = mem_context_transfer(&dst, &src);
+        assert_int_equal(ret, 0);
+        assert_int_equal(dst.allocated, 100);
+        assert_int_equal(parent.allocated, 100);
+
+        mem_free(&dst, p, 100);
+        assert_int_equal(parent.allocated, 0);
+        mem_context_clear(&src);
+        mem_context_clear(&dst);
+        mem_context_clear(&parent);
+#endif
+}
+
+void
+test_mem_arena(void **state)
+{
+#if defined(TOYWASM_ENABLE_MEM_ARENA)
+        const size_t chunk_size = 64 * 1024;
+        const size_t big = 100 * 1024;
+        struct mem_context parent;
+        struct mem_context arena0;
+        struct mem_context *arena = &arena0;
+        uint8_t *p;
+        uint8_t *q;
+        uint8_t *r;
+        uint8_t *b;
+        uint8_t *np;
+
+        mem_context_init(&parent);
+        mem_context_init_arena(arena);
+        arena->parent = &parent;
+        assert_true(mem_context_is_arena(arena));
+
+        p = mem_alloc(arena, 16);
+        assert_non_null(p);
+        memset(p, 'p', 16);
+#if defined(TOYWASM_ENABLE_HEAP_TRACKING)
+        /* only the chunk is accounted */
+        assert_int_equal(arena->allocated, chunk_size);
+        assert_int_equal(parent.allocated, chunk_size);
+#endif
+
+        /* the last block is extended in place */
+        np = mem_extend(arena, p, 16, 100);
+        assert_ptr_equal(np, p);
+        memset(np + 16, 'P', 100 - 16);
+
+        /* a block which is not the last one is moved */
+        q = mem_alloc(arena, 16);
+        assert_non_null(q);
+        assert_true(q > p);
+        np = mem_extend(arena, p, 100, 200);
+        assert_non_null(np);
+        assert_true(np > q);
+        assert_memory_equal(np, "pppppppppppppppp", 16);
+        assert_int_equal(np[16], 'P');
+        assert_int_equal(np[99], 'P');
+        p = np;
+
+        /* the moved block is the last one now */
+        r = mem_alloc(arena, 16);
+        assert_non_null(r);
+        assert_true(r >= p + 200);
+        mem_free(arena, r, 16);
+        np = mem_extend(arena, p, 200, 400);
+        assert_ptr_equal(np, p);
+
+        /* freeing and shrinking the last block give the space back */
+        r = mem_alloc(arena, 16);
+        assert_non_null(r);
+        mem_free(arena, r, 16);
+        np = mem_alloc(arena, 16);
+        assert_ptr_equal(np, r);
+        mem_free(arena, np, 16);
+        np = mem_shrink(arena, p, 400, 16);
+        assert_ptr_equal(np, p);
+        r = mem_alloc(arena, 16);
+        assert_non_null(r);
+        assert_true(r > p && r < p + 400);
+
+        /* freeing a block which is not the last one is a no-op */
+        mem_free(arena, q, 16);
+        np = mem_alloc(arena, 16);
+        assert_non_null(np);
+        assert_true(np > r);
+
+#if defined(TOYWASM_ENABLE_HEAP_TRACKING)
+        /* all of the above fit in the first chunk */
+        assert_int_equal(arena->allocated, chunk_size);
+#endif
+
+        /* an allocation larger than a chunk gets its own chunk */
+        b = mem_alloc(arena, big);
+        assert_non_null(b);
+        memset(b, 'b', big);
+#if defined(TOYWASM_ENABLE_HEAP_TRACKING)
+        assert_in_range(arena->allocated, chunk_size + big,
+                        chunk_size + big + 256);
+        assert_int_equal(parent.allocated, arena->allocated);
+#endif
+
+        /* smaller allocations still use the first chunk */
+        q = mem_alloc(arena, 16);
+        assert_non_null(q);
+        assert_true(q > np && q < np + 256);
+
+        /* the large block can be extended in its own chunk */
+        np = mem_extend(arena, b, big, big + 16);
+        assert_non_null(np);
+        assert_int_equal(np[0], 'b');
+        assert_int_equal(np[big - 1], 'b');
+
+        /* everything is released at once */
+        mem_context_clear(arena);
+#if defined(TOYWASM_ENABLE_HEAP_TRACKING)
+        assert_int_equal(arena->allocated, 0);
+        assert_int_equal(parent.allocated, 0);
+#endif
+
+        /* the limit applies to the chunks */
+        mem_context_init_arena(arena);
+        arena->parent = &parent;
+#if defined(TOYWASM_ENABLE_HEAP_TRACKING)
+        int ret = mem_context_setlimit(&parent, chunk_size);
+        assert_int_equal(ret, 0);
+        p = mem_alloc(arena, 16);
+        assert_non_null(p);
+        p = mem_alloc(arena, big);
+        assert_null(p);
+        assert_int_equal(parent.allocated, chunk_size);
+#endif
+        mem_context_clear(arena);
+        mem_context_clear(&parent);
+#endif
+}
+
 void
 test_timeutil(void **state)
 {
@@ -1274,6 +1554,8 @@ main(int argc, char **argv)
                 cmocka_unit_test(test_endian),
                 cmocka_unit_test(test_functype),
                 cmocka_unit_test(test_idalloc),
+                cmocka_unit_test(test_mem_context_transfer),
+                cmocka_unit_test(test_mem_arena),
                 cmocka_unit_test(test_timeutil),
                 cmocka_unit_test(test_timeutil_int64),
                 cmocka_unit_test(test_list),
@@ -40,7 +40,9 @@ args = parser.parse_args()
 if args.version:
     # Note: wasi-testsuite expects runtime-name and version,
     # separated by a space.
-    result = subprocess.run([executable, "--version"], capture_output=True)
+    result = subprocess.run(
+        shlex.split(executable) + ["--version"], capture_output=True
+    )
     print(result.stdout.decode("utf-8").splitlines()[0])
     sys.exit(result.returncode)
 
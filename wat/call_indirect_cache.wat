@@ -0,0 +1,90 @@
+;; check that call_indirect sees table modifications.
+;; (see the call_indirect cache in lib/exec_context.h)
+;;
+;; all calls go through the single call_indirect site in $call_at.
+;; $expect calls it twice so that the second call can be a cache hit.
+;; then the table entry is modified with an instruction and the same
+;; index is called again.
+;;
+;; "test" traps unless each call reaches the new target.
+;; "set_null" and "set_mismatch" should trap with
+;; "call_indirect (null funcref)" and "call_indirect (functype mismatch)"
+;; respectively.
+
+(module
+  (type $ret_i32 (func (result i32)))
+  (table $t 2 funcref)
+  (elem (table $t) (i32.const 0) func $f1 $f2)
+  (elem $e4 func $f4)
+  (elem declare func $f3 $f5 $ret_i64)
+
+  (func $f1 (result i32) i32.const 1)
+  (func $f2 (result i32) i32.const 2)
+  (func $f3 (result i32) i32.const 3)
+  (func $f4 (result i32) i32.const 4)
+  (func $f5 (result i32) i32.const 5)
+  (func $ret_i64 (result i64) i64.const 1)
+
+  (func $call_at (param $i i32) (result i32)
+    (call_indirect $t (type $ret_i32) (local.get $i))
+  )
+
+  (func $expect (param $i i32) (param $v i32)
+    (call $call_at (local.get $i))
+    local.get $v
+    i32.ne
+    if
+      unreachable
+    end
+    (call $call_at (local.get $i))
+    local.get $v
+    i32.ne
+    if
+      unreachable
+    end
+  )
+
+  (func (export "test")
+    (call $expect (i32.const 0) (i32.const 1))
+
+    ;; table.set
+    (table.set $t (i32.const 0) (ref.func $f3))
+    (call $expect (i32.const 0) (i32.const 3))
+
+    ;; table.copy: [1] ($f2) -> [0]
+    (table.copy $t $t (i32.const 0) (i32.const 1) (i32.const 1))
+    (call $expect (i32.const 0) (i32.const 2))
+
+    ;; table.init: $e4 ($f4) -> [0]
+    (table.init $t $e4 (i32.const 0) (i32.const 0) (i32.const 1))
+    (call $expect (i32.const 0) (i32.const 4))
+
+    ;; table.grow: [2] = $f5
+    ;; the existing entries keep their targets.
+    (table.grow $t (ref.func $f5) (i32.const 1))
+    i32.const 2
+    i32.ne
+    if
+      unreachable
+    end
+    (call $expect (i32.const 0) (i32.const 4))
+    (call $expect (i32.const 2) (i32.const 5))
+
+    ;; table.fill: [0..2] = $f1
+    (table.fill $t (i32.const 0) (ref.func $f1) (i32.const 3))
+    (call $expect (i32.const 0) (i32.const 1))
+    (call $expect (i32.const 2) (i32.const 1))
+  )
+
+  (func (export "set_null") (result i32)
+    (call $expect (i32.const 0) (i32.const 1))
+    (table.set $t (i32.const 0) (ref.null func))
+    (call $call_at (i32.const 0))
+  )
+
+  (func (export "set_mismatch") (result i32)
+    (call $expect (i32.const 0) (i32.const 1))
+    (table.set $t (i32.const 0) (ref.func $ret_i64))
+    (call $call_at (i32.const 0))
+  )
+)
@@ -0,0 +1,10 @@
+;; a shared library for test/dyld/symbols.sh
+;; it exports "dup", which libdup_b.so exports as well.
+(module
+  ;; mem_info: no memory, no table
+  (@custom "dylink.0" (before first) "\01\04\00\00\00\00")
+  (import "env" "memory" (memory 0))
+  (func (export "dup") (result i32)
+    i32.const 1
+  )
+)
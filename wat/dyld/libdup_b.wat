@@ -0,0 +1,61 @@
+;; a shared library for test/dyld/symbols.sh
+;;
+;; it exports "dup", which libdup_a.so exports as well.
+;; "b_dup" calls "dup", which should be resolved to libdup_a.so's one.
+;; it also exports many symbols ("s0" - "s39") so that loading it
+;; grows the symbol table of dyld.
+(module
+  ;; mem_info: no memory, no table
+  (@custom "dylink.0" (before first) "\01\04\00\00\00\00")
+  (import "env" "memory" (memory 0))
+  (import "env" "dup" (func $dup (result i32)))
+  (func (export "dup") (result i32)
+    i32.const 2
+  )
+  (func (export "b_dup") (result i32)
+    call $dup
+  )
+  (func $seven (result i32)
+    i32.const 7
+  )
+  (export "s0" (func $seven))
+  (export "s1" (func $seven))
+  (export "s2" (func $seven))
+  (export "s3" (func $seven))
+  (export "s4" (func $seven))
+  (export "s5" (func $seven))
+  (export "s6" (func $seven))
+  (export "s7" (func $seven))
+  (export "s8" (func $seven))
+  (export "s9" (func $seven))
+  (export "s10" (func $seven))
+  (export "s11" (func $seven))
+  (export "s12" (func $seven))
+  (export "s13" (func $seven))
+  (export "s14" (func $seven))
+  (export "s15" (func $seven))
+  (export "s16" (func $seven))
+  (export "s17" (func $seven))
+  (export "s18" (func $seven))
+  (export "s19" (func $seven))
+  (export "s20" (func $seven))
+  (export "s21" (func $seven))
+  (export "s22" (func $seven))
+  (export "s23" (func $seven))
+  (export "s24" (func $seven))
+  (export "s25" (func $seven))
+  (export "s26" (func $seven))
+  (export "s27" (func $seven))
+  (export "s28" (func $seven))
+  (export "s29" (func $seven))
+  (export "s30" (func $seven))
+  (export "s31" (func $seven))
+  (export "s32" (func $seven))
+  (export "s33" (func $seven))
+  (export "s34" (func $seven))
+  (export "s35" (func $seven))
+  (export "s36" (func $seven))
+  (export "s37" (func $seven))
+  (export "s38" (func $seven))
+  (export "s39" (func $seven))
+)
@@ -0,0 +1,9 @@
+;; a shared library for test/dyld/module-cache.sh
+(module
+  ;; mem_info: no memory, no table
+  (@custom "dylink.0" (before first) "\01\04\00\00\00\00")
+  (import "env" "memory" (memory 0))
+  (func (export "shared") (result i32)
+    i32.const 42
+  )
+)
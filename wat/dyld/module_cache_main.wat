@@ -0,0 +1,13 @@
+;; a main module for test/dyld/module-cache.sh
+(module
+  ;; mem_info: no memory, no table
+  ;; needed: libshared.so
+  (@custom "dylink.0" (before first)
+    "\01\04\00\00\00\00"
+    "\02\0e\01\0clibshared.so")
+  (import "env" "memory" (memory 0))
+  (import "env" "shared" (func $shared (result i32)))
+  (func (export "run") (result i32)
+    call $shared
+  )
+)
@@ -0,0 +1,45 @@
+;; a main module for test/dyld/symbols.sh
+;;
+;; "run" returns 42 after checking the symbol resolution.
+;; it traps on a failure.
+(module
+  ;; mem_info: no memory, no table
+  ;; needed: libdup_a.so libdup_b.so
+  (@custom "dylink.0" (before first)
+    "\01\04\00\00\00\00"
+    "\02\19\02\0blibdup_a.so\0blibdup_b.so")
+  (import "env" "memory" (memory 0))
+  (import "env" "dup" (func $dup (result i32)))
+  (import "env" "b_dup" (func $b_dup (result i32)))
+  (import "env" "s0" (func $s0 (result i32)))
+  (import "env" "s39" (func $s39 (result i32)))
+  (func (export "run") (result i32)
+    ;; the first loaded object wins
+    call $dup
+    i32.const 1
+    i32.ne
+    if
+      unreachable
+    end
+    ;; even for libdup_b.so itself
+    call $b_dup
+    i32.const 1
+    i32.ne
+    if
+      unreachable
+    end
+    call $s0
+    i32.const 7
+    i32.ne
+    if
+      unreachable
+    end
+    call $s39
+    i32.const 7
+    i32.ne
+    if
+      unreachable
+    end
+    i32.const 42
+  )
+)
@@ -0,0 +1,485 @@
+;; check the results of the fused "i32.const c; OP" pairs.
+;; (see FUSE_I32_CONST_BINOP in lib/insn_impl_base.h)
+;;
+;; each check computes "a OP c" twice:
+;;   - "local.get a; i32.const c; OP", which is fused
+;;   - "local.get a; i32.const c; call $k; OP", which is not
+;; and traps if they differ.
+
+(module
+  (func $k (param i32) (result i32)
+    local.get 0
+  )
+
+  (func $check (param i32 i32)
+    (if (i32.ne (local.get 0) (local.get 1))
+      (then unreachable))
+  )
+
+  (func $eq (param $a i32)
+    (call $check
+      (i32.eq (local.get $a) (i32.const 0))
+      (i32.eq (local.get $a) (call $k (i32.const 0))))
+    (call $check
+      (i32.eq (local.get $a) (i32.const 1))
+      (i32.eq (local.get $a) (call $k (i32.const 1))))
+    (call $check
+      (i32.eq (local.get $a) (i32.const -1))
+      (i32.eq (local.get $a) (call $k (i32.const -1))))
+    (call $check
+      (i32.eq (local.get $a) (i32.const 5))
+      (i32.eq (local.get $a) (call $k (i32.const 5))))
+    (call $check
+      (i32.eq (local.get $a) (i32.const 33))
+      (i32.eq (local.get $a) (call $k (i32.const 33))))
+    (call $check
+      (i32.eq (local.get $a) (i32.const 0x7fffffff))
+      (i32.eq (local.get $a) (call $k (i32.const 0x7fffffff))))
+    (call $check
+      (i32.eq (local.get $a) (i32.const 0x80000000))
+      (i32.eq (local.get $a) (call $k (i32.const 0x80000000))))
+  )
+
+  (func $ne (param $a i32)
+    (call $check
+      (i32.ne (local.get $a) (i32.const 0))
+      (i32.ne (local.get $a) (call $k (i32.const 0))))
+    (call $check
+      (i32.ne (local.get $a) (i32.const 1))
+      (i32.ne (local.get $a) (call $k (i32.const 1))))
+    (call $check
+      (i32.ne (local.get $a) (i32.const -1))
+      (i32.ne (local.get $a) (call $k (i32.const -1))))
+    (call $check
+      (i32.ne (local.get $a) (i32.const 5))
+      (i32.ne (local.get $a) (call $k (i32.const 5))))
+    (call $check
+      (i32.ne (local.get $a) (i32.const 33))
+      (i32.ne (local.get $a) (call $k (i32.const 33))))
+    (call $check
+      (i32.ne (local.get $a) (i32.const 0x7fffffff))
+      (i32.ne (local.get $a) (call $k (i32.const 0x7fffffff))))
+    (call $check
+      (i32.ne (local.get $a) (i32.const 0x80000000))
+      (i32.ne (local.get $a) (call $k (i32.const 0x80000000))))
+  )
+
+  (func $lt_s (param $a i32)
+    (call $check
+      (i32.lt_s (local.get $a) (i32.const 0))
+      (i32.lt_s (local.get $a) (call $k (i32.const 0))))
+    (call $check
+      (i32.lt_s (local.get $a) (i32.const 1))
+      (i32.lt_s (local.get $a) (call $k (i32.const 1))))
+    (call $check
+      (i32.lt_s (local.get $a) (i32.const -1))
+      (i32.lt_s (local.get $a) (call $k (i32.const -1))))
+    (call $check
+      (i32.lt_s (local.get $a) (i32.const 5))
+      (i32.lt_s (local.get $a) (call $k (i32.const 5))))
+    (call $check
+      (i32.lt_s (local.get $a) (i32.const 33))
+      (i32.lt_s (local.get $a) (call $k (i32.const 33))))
+    (call $check
+      (i32.lt_s (local.get $a) (i32.const 0x7fffffff))
+      (i32.lt_s (local.get $a) (call $k (i32.const 0x7fffffff))))
+    (call $check
+      (i32.lt_s (local.get $a) (i32.const 0x80000000))
+      (i32.lt_s (local.get $a) (call $k (i32.const 0x80000000))))
+  )
+
+  (func $lt_u (param $a i32)
+    (call $check
+      (i32.lt_u (local.get $a) (i32.const 0))
+      (i32.lt_u (local.get $a) (call $k (i32.const 0))))
+    (call $check
+      (i32.lt_u (local.get $a) (i32.const 1))
+      (i32.lt_u (local.get $a) (call $k (i32.const 1))))
+    (call $check
+      (i32.lt_u (local.get $a) (i32.const -1))
+      (i32.lt_u (local.get $a) (call $k (i32.const -1))))
+    (call $check
+      (i32.lt_u (local.get $a) (i32.const 5))
+      (i32.lt_u (local.get $a) (call $k (i32.const 5))))
+    (call $check
+      (i32.lt_u (local.get $a) (i32.const 33))
+      (i32.lt_u (local.get $a) (call $k (i32.const 33))))
+    (call $check
+      (i32.lt_u (local.get $a) (i32.const 0x7fffffff))
+      (i32.lt_u (local.get $a) (call $k (i32.const 0x7fffffff))))
+    (call $check
+      (i32.lt_u (local.get $a) (i32.const 0x80000000))
+      (i32.lt_u (local.get $a) (call $k (i32.const 0x80000000))))
+  )
+
+  (func $gt_s (param $a i32)
+    (call $check
+      (i32.gt_s (local.get $a) (i32.const 0))
+      (i32.gt_s (local.get $a) (call $k (i32.const 0))))
+    (call $check
+      (i32.gt_s (local.get $a) (i32.const 1))
+      (i32.gt_s (local.get $a) (call $k (i32.const 1))))
+    (call $check
+      (i32.gt_s (local.get $a) (i32.const -1))
+      (i32.gt_s (local.get $a) (call $k (i32.const -1))))
+    (call $check
+      (i32.gt_s (local.get $a) (i32.const 5))
+      (i32.gt_s (local.get $a) (call $k (i32.const 5))))
+    (call $check
+      (i32.gt_s (local.get $a) (i32.const 33))
+      (i32.gt_s (local.get $a) (call $k (i32.const 33))))
+    (call $check
+      (i32.gt_s (local.get $a) (i32.const 0x7fffffff))
+      (i32.gt_s (local.get $a) (call $k (i32.const 0x7fffffff))))
+    (call $check
+      (i32.gt_s (local.get $a) (i32.const 0x80000000))
+      (i32.gt_s (local.get $a) (call $k (i32.const 0x80000000))))
+  )
+
+  (func $gt_u (param $a i32)
+    (call $check
+      (i32.gt_u (local.get $a) (i32.const 0))
+      (i32.gt_u (local.get $a) (call $k (i32.const 0))))
+    (call $check
+      (i32.gt_u (local.get $a) (i32.const 1))
+      (i32.gt_u (local.get $a) (call $k (i32.const 1))))
+    (call $check
+      (i32.gt_u (local.get $a) (i32.const -1))
+      (i32.gt_u (local.get $a) (call $k (i32.const -1))))
+    (call $check
+      (i32.gt_u (local.get $a) (i32.const 5))
+      (i32.gt_u (local.get $a) (call $k (i32.const 5))))
+    (call $check
+      (i32.gt_u (local.get $a) (i32.const 33))
+      (i32.gt_u (local.get $a) (call $k (i32.const 33))))
+    (call $check
+      (i32.gt_u (local.get $a) (i32.const 0x7fffffff))
+      (i32.gt_u (local.get $a) (call $k (i32.const 0x7fffffff))))
+    (call $check
+      (i32.gt_u (local.get $a) (i32.const 0x80000000))
+      (i32.gt_u (local.get $a) (call $k (i32.const 0x80000000))))
+  )
+
+  (func $le_s (param $a i32)
+    (call $check
+      (i32.le_s (local.get $a) (i32.const 0))
+      (i32.le_s (local.get $a) (call $k (i32.const 0))))
+    (call $check
+      (i32.le_s (local.get $a) (i32.const 1))
+      (i32.le_s (local.get $a) (call $k (i32.const 1))))
+    (call $check
+      (i32.le_s (local.get $a) (i32.const -1))
+      (i32.le_s (local.get $a) (call $k (i32.const -1))))
+    (call $check
+      (i32.le_s (local.get $a) (i32.const 5))
+      (i32.le_s (local.get $a) (call $k (i32.const 5))))
+    (call $check
+      (i32.le_s (local.get $a) (i32.const 33))
+      (i32.le_s (local.get $a) (call $k (i32.const 33))))
+    (call $check
+      (i32.le_s (local.get $a) (i32.const 0x7fffffff))
+      (i32.le_s (local.get $a) (call $k (i32.const 0x7fffffff))))
+    (call $check
+      (i32.le_s (local.get $a) (i32.const 0x80000000))
+      (i32.le_s (local.get $a) (call $k (i32.const 0x80000000))))
+  )
+
+  (func $le_u (param $a i32)
+    (call $check
+      (i32.le_u (local.get $a) (i32.const 0))
+      (i32.le_u (local.get $a) (call $k (i32.const 0))))
+    (call $check
+      (i32.le_u (local.get $a) (i32.const 1))
+      (i32.le_u (local.get $a) (call $k (i32.const 1))))
+    (call $check
+      (i32.le_u (local.get $a) (i32.const -1))
+      (i32.le_u (local.get $a) (call $k (i32.const -1))))
+    (call $check
+      (i32.le_u (local.get $a) (i32.const 5))
+      (i32.le_u (local.get $a) (call $k (i32.const 5))))
+    (call $check
+      (i32.le_u (local.get $a) (i32.const 33))
+      (i32.le_u (local.get $a) (call $k (i32.const 33))))
+    (call $check
+      (i32.le_u (local.get $a) (i32.const 0x7fffffff))
+      (i32.le_u (local.get $a) (call $k (i32.const 0x7fffffff))))
+    (call $check
+      (i32.le_u (local.get $a) (i32.const 0x80000000))
+      (i32.le_u (local.get $a) (call $k (i32.const 0x80000000))))
+  )
+
+  (func $ge_s (param $a i32)
+    (call $check
+      (i32.ge_s (local.get $a) (i32.const 0))
+      (i32.ge_s (local.get $a) (call $k (i32.const 0))))
+    (call $check
+      (i32.ge_s (local.get $a) (i32.const 1))
+      (i32.ge_s (local.get $a) (call $k (i32.const 1))))
+    (call $check
+      (i32.ge_s (local.get $a) (i32.const -1))
+      (i32.ge_s (local.get $a) (call $k (i32.const -1))))
+    (call $check
+      (i32.ge_s (local.get $a) (i32.const 5))
+      (i32.ge_s (local.get $a) (call $k (i32.const 5))))
+    (call $check
+      (i32.ge_s (local.get $a) (i32.const 33))
+      (i32.ge_s (local.get $a) (call $k (i32.const 33))))
+    (call $check
+      (i32.ge_s (local.get $a) (i32.const 0x7fffffff))
+      (i32.ge_s (local.get $a) (call $k (i32.const 0x7fffffff))))
+    (call $check
+      (i32.ge_s (local.get $a) (i32.const 0x80000000))
+      (i32.ge_s (local.get $a) (call $k (i32.const 0x80000000))))
+  )
+
+  (func $ge_u (param $a i32)
+    (call $check
+      (i32.ge_u (local.get $a) (i32.const 0))
+      (i32.ge_u (local.get $a) (call $k (i32.const 0))))
+    (call $check
+      (i32.ge_u (local.get $a) (i32.const 1))
+      (i32.ge_u (local.get $a) (call $k (i32.const 1))))
+    (call $check
+      (i32.ge_u (local.get $a) (i32.const -1))
+      (i32.ge_u (local.get $a) (call $k (i32.const -1))))
+    (call $check
+      (i32.ge_u (local.get $a) (i32.const 5))
+      (i32.ge_u (local.get $a) (call $k (i32.const 5))))
+    (call $check
+      (i32.ge_u (local.get $a) (i32.const 33))
+      (i32.ge_u (local.get $a) (call $k (i32.const 33))))
+    (call $check
+      (i32.ge_u (local.get $a) (i32.const 0x7fffffff))
+      (i32.ge_u (local.get $a) (call $k (i32.const 0x7fffffff))))
+    (call $check
+      (i32.ge_u (local.get $a) (i32.const 0x80000000))
+      (i32.ge_u (local.get $a) (call $k (i32.const 0x80000000))))
+  )
+
+  (func $add (param $a i32)
+    (call $check
+      (i32.add (local.get $a) (i32.const 0))
+      (i32.add (local.get $a) (call $k (i32.const 0))))
+    (call $check
+      (i32.add (local.get $a) (i32.const 1))
+      (i32.add (local.get $a) (call $k (i32.const 1))))
+    (call $check
+      (i32.add (local.get $a) (i32.const -1))
+      (i32.add (local.get $a) (call $k (i32.const -1))))
+    (call $check
+      (i32.add (local.get $a) (i32.const 5))
+      (i32.add (local.get $a) (call $k (i32.const 5))))
+    (call $check
+      (i32.add (local.get $a) (i32.const 33))
+      (i32.add (local.get $a) (call $k (i32.const 33))))
+    (call $check
+      (i32.add (local.get $a) (i32.const 0x7fffffff))
+      (i32.add (local.get $a) (call $k (i32.const 0x7fffffff))))
+    (call $check
+      (i32.add (local.get $a) (i32.const 0x80000000))
+      (i32.add (local.get $a) (call $k (i32.const 0x80000000))))
+  )
+
+  (func $sub (param $a i32)
+    (call $check
+      (i32.sub (local.get $a) (i32.const 0))
+      (i32.sub (local.get $a) (call $k (i32.const 0))))
+    (call $check
+      (i32.sub (local.get $a) (i32.const 1))
+      (i32.sub (local.get $a) (call $k (i32.const 1))))
+    (call $check
+      (i32.sub (local.get $a) (i32.const -1))
+      (i32.sub (local.get $a) (call $k (i32.const -1))))
+    (call $check
+      (i32.sub (local.get $a) (i32.const 5))
+      (i32.sub (local.get $a) (call $k (i32.const 5))))
+    (call $check
+      (i32.sub (local.get $a) (i32.const 33))
+      (i32.sub (local.get $a) (call $k (i32.const 33))))
+    (call $check
+      (i32.sub (local.get $a) (i32.const 0x7fffffff))
+      (i32.sub (local.get $a) (call $k (i32.const 0x7fffffff))))
+    (call $check
+      (i32.sub (local.get $a) (i32.const 0x80000000))
+      (i32.sub (local.get $a) (call $k (i32.const 0x80000000))))
+  )
+
+  (func $mul (param $a i32)
+    (call $check
+      (i32.mul (local.get $a) (i32.const 0))
+      (i32.mul (local.get $a) (call $k (i32.const 0))))
+    (call $check
+      (i32.mul (local.get $a) (i32.const 1))
+      (i32.mul (local.get $a) (call $k (i32.const 1))))
+    (call $check
+      (i32.mul (local.get $a) (i32.const -1))
+      (i32.mul (local.get $a) (call $k (i32.const -1))))
+    (call $check
+      (i32.mul (local.get $a) (i32.const 5))
+      (i32.mul (local.get $a) (call $k (i32.const 5))))
+    (call $check
+      (i32.mul (local.get $a) (i32.const 33))
+      (i32.mul (local.get $a) (call $k (i32.const 33))))
+    (call $check
+      (i32.mul (local.get $a) (i32.const 0x7fffffff))
+      (i32.mul (local.get $a) (call $k (i32.const 0x7fffffff))))
+    (call $check
+      (i32.mul (local.get $a) (i32.const 0x80000000))
+      (i32.mul (local.get $a) (call $k (i32.const 0x80000000))))
+  )
+
+  (func $and (param $a i32)
+    (call $check
+      (i32.and (local.get $a) (i32.const 0))
+      (i32.and (local.get $a) (call $k (i32.const 0))))
+    (call $check
+      (i32.and (local.get $a) (i32.const 1))
+      (i32.and (local.get $a) (call $k (i32.const 1))))
+    (call $check
+      (i32.and (local.get $a) (i32.const -1))
+      (i32.and (local.get $a) (call $k (i32.const -1))))
+    (call $check
+      (i32.and (local.get $a) (i32.const 5))
+      (i32.and (local.get $a) (call $k (i32.const 5))))
+    (call $check
+      (i32.and (local.get $a) (i32.const 33))
+      (i32.and (local.get $a) (call $k (i32.const 33))))
+    (call $check
+      (i32.and (local.get $a) (i32.const 0x7fffffff))
+      (i32.and (local.get $a) (call $k (i32.const 0x7fffffff))))
+    (call $check
+      (i32.and (local.get $a) (i32.const 0x80000000))
+      (i32.and (local.get $a) (call $k (i32.const 0x80000000))))
+  )
+
+  (func $or (param $a i32)
+    (call $check
+      (i32.or (local.get $a) (i32.const 0))
+      (i32.or (local.get $a) (call $k (i32.const 0))))
+    (call $check
+      (i32.or (local.get $a) (i32.const 1))
+      (i32.or (local.get $a) (call $k (i32.const 1))))
+    (call $check
+      (i32.or (local.get $a) (i32.const -1))
+      (i32.or (local.get $a) (call $k (i32.const -1))))
+    (call $check
+      (i32.or (local.get $a) (i32.const 5))
+      (i32.or (local.get $a) (call $k (i32.const 5))))
+    (call $check
+      (i32.or (local.get $a) (i32.const 33))
+      (i32.or (local.get $a) (call $k (i32.const 33))))
+    (call $check
+      (i32.or (local.get $a) (i32.const 0x7fffffff))
+      (i32.or (local.get $a) (call $k (i32.const 0x7fffffff))))
+    (call $check
+      (i32.or (local.get $a) (i32.const 0x80000000))
+      (i32.or (local.get $a) (call $k (i32.const 0x80000000))))
+  )
+
+  (func $xor (param $a i32)
+    (call $check
+      (i32.xor (local.get $a) (i32.const 0))
+      (i32.xor (local.get $a) (call $k (i32.const 0))))
+    (call $check
+      (i32.xor (local.get $a) (i32.const 1))
+      (i32.xor (local.get $a) (call $k (i32.const 1))))
+    (call $check
+      (i32.xor (local.get $a) (i32.const -1))
+      (i32.xor (local.get $a) (call $k (i32.const -1))))
+    (call $check
+      (i32.xor (local.get $a) (i32.const 5))
+      (i32.xor (local.get $a) (call $k (i32.const 5))))
+    (call $check
+      (i32.xor (local.get $a) (i32.const 33))
+      (i32.xor (local.get $a) (call $k (i32.const 33))))
+    (call $check
+      (i32.xor (local.get $a) (i32.const 0x7fffffff))
+      (i32.xor (local.get $a) (call $k (i32.const 0x7fffffff))))
+    (call $check
+      (i32.xor (local.get $a) (i32.const 0x80000000))
+      (i32.xor (local.get $a) (call $k (i32.const 0x80000000))))
+  )
+
+  (func $shl (param $a i32)
+    (call $check
+      (i32.shl (local.get $a) (i32.const 0))
+      (i32.shl (local.get $a) (call $k (i32.const 0))))
+    (call $check
+      (i32.shl (local.get $a) (i32.const 1))
+      (i32.shl (local.get $a) (call $k (i32.const 1))))
+    (call $check
+      (i32.shl (local.get $a) (i32.const -1))
+      (i32.shl (local.get $a) (call $k (i32.const -1))))
+    (call $check
+      (i32.shl (local.get $a) (i32.const 5))
+      (i32.shl (local.get $a) (call $k (i32.const 5))))
+    (call $check
+      (i32.shl (local.get $a) (i32.const 33))
+      (i32.shl (local.get $a) (call $k (i32.const 33))))
+    (call $check
+      (i32.shl (local.get $a) (i32.const 0x7fffffff))
+      (i32.shl (local.get $a) (call $k (i32.const 0x7fffffff))))
+    (call $check
+      (i32.shl (local.get $a) (i32.const 0x80000000))
+      (i32.shl (local.get $a) (call $k (i32.const 0x80000000))))
+  )
+
+  (func $shr_u (param $a i32)
+    (call $check
+      (i32.shr_u (local.get $a) (i32.const 0))
+      (i32.shr_u (local.get $a) (call $k (i32.const 0))))
+    (call $check
+      (i32.shr_u (local.get $a) (i32.const 1))
+      (i32.shr_u (local.get $a) (call $k (i32.const 1))))
+    (call $check
+      (i32.shr_u (local.get $a) (i32.const -1))
+      (i32.shr_u (local.get $a) (call $k (i32.const -1))))
+    (call $check
+      (i32.shr_u (local.get $a) (i32.const 5))
+      (i32.shr_u (local.get $a) (call $k (i32.const 5))))
+    (call $check
+      (i32.shr_u (local.get $a) (i32.const 33))
+      (i32.shr_u (local.get $a) (call $k (i32.const 33))))
+    (call $check
+      (i32.shr_u (local.get $a) (i32.const 0x7fffffff))
+      (i32.shr_u (local.get $a) (call $k (i32.const 0x7fffffff))))
+    (call $check
+      (i32.shr_u (local.get $a) (i32.const 0x80000000))
+      (i32.shr_u (local.get $a) (call $k (i32.const 0x80000000))))
+  )
+
+  (func $test (param $a i32)
+    (call $eq (local.get $a))
+    (call $ne (local.get $a))
+    (call $lt_s (local.get $a))
+    (call $lt_u (local.get $a))
+    (call $gt_s (local.get $a))
+    (call $gt_u (local.get $a))
+    (call $le_s (local.get $a))
+    (call $le_u (local.get $a))
+    (call $ge_s (local.get $a))
+    (call $ge_u (local.get $a))
+    (call $add (local.get $a))
+    (call $sub (local.get $a))
+    (call $mul (local.get $a))
+    (call $and (local.get $a))
+    (call $or (local.get $a))
+    (call $xor (local.get $a))
+    (call $shl (local.get $a))
+    (call $shr_u (local.get $a))
+  )
+
+  (func (export "_start")
+    (call $test (i32.const 0))
+    (call $test (i32.const 1))
+    (call $test (i32.const -1))
+    (call $test (i32.const 5))
+    (call $test (i32.const 0x7fffffff))
+    (call $test (i32.const 0x80000000))
+    (call $test (i32.const 0x12345678))
+  )
+
+  ;; a dummy memory export to appease wamr.
+  ;; https://github.com/bytecodealliance/wasm-micro-runtime/issues/2097
+  (memory (export "memory") 0)
+)
@@ -0,0 +1,27 @@
+;; a test module for --lazy-validation.
+;;
+;; it has two invalid functions. one of them is never called.
+;; the other is called by "call_invalid".
+;;
+;; % wat2wasm --no-check lazy_validation.wat
+;; % toywasm --load=lazy_validation.wasm --invoke=valid
+;; load/validation error: expected 7f actual 7e
+;; % toywasm --lazy-validation --load=lazy_validation.wasm --invoke=valid
+;; Result: 42:i32
+;; % toywasm --lazy-validation --load=lazy_validation.wasm --invoke=call_invalid
+;; Error: [trap] unknown (24): function 1 failed validation
+
+(module
+  (func $invalid_unused (result i32)
+    i64.const 0
+  )
+  (func $invalid (result i32)
+    i64.const 0
+  )
+  (func (export "call_invalid") (result i32)
+    call $invalid
+  )
+  (func (export "valid") (result i32)
+    i32.const 42
+  )
+)
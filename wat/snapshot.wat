@@ -0,0 +1,28 @@
+;; a test module for --snapshot-save and --snapshot-restore.
+;; (see test/snapshot.sh)
+;;
+;; "mutate" changes a global and the memory, including its size.
+;; "check" traps unless it sees the mutated state.
+
+(module
+  (memory (export "memory") 1)
+  (global $g (mut i32) (i32.const 1))
+
+  (func (export "mutate")
+    (global.set $g (i32.const 42))
+    (drop (memory.grow (i32.const 1)))
+    (i32.store (i32.const 100) (i32.const 0x12345678))
+    (i32.store (i32.const 65544) (i32.const 0x9abcdef0))
+  )
+
+  (func (export "check")
+    (if (i32.ne (global.get $g) (i32.const 42))
+      (then unreachable))
+    (if (i32.ne (memory.size) (i32.const 2))
+      (then unreachable))
+    (if (i32.ne (i32.load (i32.const 100)) (i32.const 0x12345678))
+      (then unreachable))
+    (if (i32.ne (i32.load (i32.const 65544)) (i32.const 0x9abcdef0))
+      (then unreachable))
+  )
+)